@@ -0,0 +1,184 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: clock_bench.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host benchmark for the disciplined clock. Runs a local
+ * clock with synthetic drift (Constant, plus a daily temperature swing)
+ * against a reference read with SNTP jitter, resyncs when the clock asks
+ * for it, and measures the residual error every second. The old clock
+ * (Offset from the last SNTP poll, polled hourly) runs alongside.
+ *
+ * Usage: clock_bench [days] [jitter ms]
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <math.h>
+
+#include "../../lib/wifi_conn/clock_sync.h"
+
+// Constants ----------------------------------------------------------
+
+#define BENCH_EPOCH_MS 1760572800000ULL // Reference time at the start (16/10/2025)
+#define BENCH_OFFSET_POLL 3600 // Poll interval of the old clock (in secs)
+#define BENCH_DAY 86400 // Secs in a day
+
+// --------------------------------------------------------------------
+
+// Drift of a scenario
+typedef struct {
+    const char *name;       // Name
+    double drift_ppm;       // Constant drift (in ppm, > 0 when the local clock runs fast)
+    double swing_ppm;       // Daily swing around it (in ppm)
+} BenchScenario;
+
+// Error of a clock over a run
+typedef struct {
+    uint32 syncs;           // Reference samples taken
+    double max_ms;          // Largest error (in msec)
+    double sum_ms;          // Sum of the errors (in msec)
+    uint32 reads;           // Errors summed
+    uint32 backwards;       // Reads below the previous one
+} BenchResult;
+
+/**
+ * Returns a uniform random number in [-range, range].
+ * @param double range Range
+ * @return double Number
+ */
+static double bench_jitter(double range) {
+    return ((rand() / (double)RAND_MAX) * 2.0 - 1.0) * range;
+}
+
+/**
+ * Adds the error of a read to a result.
+ * @param BenchResult *result Result
+ * @param double served_ms Time served (in msec)
+ * @param double true_ms Time (in msec)
+ * @return none
+ */
+static void bench_record(BenchResult *result, double served_ms, double true_ms) {
+    double error = fabs(served_ms - true_ms);
+
+    if (error > result->max_ms) {
+        result->max_ms = error;
+    }
+
+    result->sum_ms += error;
+    result->reads++;
+}
+
+/**
+ * Runs a scenario on both clocks.
+ * @param BenchScenario *scenario Drift
+ * @param uint32 days Simulated days
+ * @param double jitter_ms SNTP jitter (in msec)
+ * @param BenchResult *disciplined Result of the disciplined clock
+ * @param BenchResult *offset Result of the old clock
+ * @param ClockSyncStats *stats Final counters of the disciplined clock
+ * @return none
+ */
+static void bench_run(const BenchScenario *scenario, uint32 days, double jitter_ms,
+                      BenchResult *disciplined, BenchResult *offset, ClockSyncStats *stats) {
+    ClockSync clock;
+    double local = 0;
+    uint64 last_served = 0;
+    uint64 offset_local = 0;
+    double offset_unix = 0;
+    uint32 offset_next = 0;
+
+    clock_sync_init(&clock);
+    memset(disciplined, 0, sizeof(BenchResult));
+    memset(offset, 0, sizeof(BenchResult));
+
+    for (uint32 t = 0; t < (days * BENCH_DAY); t++) {
+        double true_ms = BENCH_EPOCH_MS + (t * 1000.0);
+        double ppm = scenario->drift_ppm + (scenario->swing_ppm * sin((2 * M_PI * t) / BENCH_DAY));
+        uint64 local_ms = (uint64)local;
+
+        // Disciplined clock, resynced when it asks
+        if (clock_sync_due(&clock, local_ms) == 0) {
+            clock_sync_sample(&clock, local_ms, (uint64)(true_ms + bench_jitter(jitter_ms)));
+            disciplined->syncs++;
+        }
+
+        uint64 served = 0;
+
+        clock_sync_read(&clock, local_ms, &served);
+        bench_record(disciplined, (double)served, true_ms);
+
+        if (served < last_served) {
+            disciplined->backwards++;
+        }
+
+        last_served = served;
+
+        // Old clock, offset of the hourly poll
+        if (t >= offset_next) {
+            offset_local = local_ms;
+            offset_unix = true_ms + bench_jitter(jitter_ms);
+            offset_next = t + BENCH_OFFSET_POLL;
+            offset->syncs++;
+        }
+
+        bench_record(offset, offset_unix + (double)(local_ms - offset_local), true_ms);
+
+        local += 1000.0 * (1.0 + (ppm / 1e6));
+    }
+
+    *stats = clock.stats;
+}
+
+int main(int argc, char **argv) {
+    uint32 days = (argc > 1) ? atoi(argv[1]) : 14;
+    double jitter_ms = (argc > 2) ? atof(argv[2]) : 20;
+    const BenchScenario scenarios[] = {
+        {"ideal", 0, 0},
+        {"+10ppm", 10, 0},
+        {"-25ppm", -25, 0},
+        {"+50ppm", 50, 0},
+        {"+20ppm~5", 20, 5},
+        {"-40ppm~10", -40, 10}
+    };
+    int failed = 0;
+
+    srand(1);
+
+    printf("%u days, SNTP jitter +/-%.0f ms, target error %d ms\n", days, jitter_ms, CLOCK_SYNC_ERROR);
+    printf("%-10s | %6s %9s %9s %9s %8s | %6s %9s %9s\n", "scenario", "syncs", "max ms", "avg ms",
+           "drift ppb", "interval", "syncs", "max ms", "avg ms");
+    printf("%-10s | %-45s | %s\n", "", "disciplined", "offset (hourly poll)");
+
+    for (uint32 i = 0; i < (sizeof(scenarios) / sizeof(scenarios[0])); i++) {
+        BenchResult disciplined;
+        BenchResult offset;
+        ClockSyncStats stats;
+
+        bench_run(&scenarios[i], days, jitter_ms, &disciplined, &offset, &stats);
+
+        printf("%-10s | %6u %9.1f %9.1f %9d %7us | %6u %9.1f %9.1f\n", scenarios[i].name,
+               disciplined.syncs, disciplined.max_ms, disciplined.sum_ms / disciplined.reads, stats.drift_ppb,
+               stats.interval_s, offset.syncs, offset.max_ms, offset.sum_ms / offset.reads);
+
+        if (disciplined.backwards) {
+            printf("FAIL: %s served %u timestamps below the previous one\n", scenarios[i].name, disciplined.backwards);
+            failed = 1;
+        }
+
+        // Within the target once the drift is known, plus the jitter of the anchor.
+        // Also with a moving drift, which the interval follows
+        if (disciplined.max_ms > (CLOCK_SYNC_ERROR + (2 * jitter_ms))) {
+            printf("FAIL: %s max error %.1f ms\n", scenarios[i].name, disciplined.max_ms);
+            failed = 1;
+        }
+    }
+
+    return failed;
+}
@@ -0,0 +1,351 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: mqtt_bench.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host benchmark of the MQTT publish path. Runs mqtt_conn
+ * and Paho against a broker (e.g. mosquitto on localhost) and reports
+ * messages/sec and p50/p99 latency for direct publishes at QoS 0/1/2 and
+ * for queued QoS1 publishes (mqtt_enqueue() + mqtt_queue_publish()) at
+ * different queue depths. Queued latency is enqueue to PUBACK. The
+ * submit runs pipeline QoS1 publishes through the non-blocking client
+ * (MQTTPublishSubmit() + MQTTPoll()) with a fixed number outstanding.
+ *
+ * Usage: mqtt_bench [host] [port] [messages] [-v]
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mqtt_conn.h"
+
+// Constants ----------------------------------------------------------
+
+#define BENCH_TOPIC "lihini/bench" // Publish topic
+#define BENCH_CLIENT_ID "lihini-bench" // MQTT client ID
+#define BENCH_PAYLOAD_SIZE 40 // Payload size (in bytes)
+#define BENCH_MAX_MESSAGES 100000 // Max messages per run
+
+// --------------------------------------------------------------------
+
+// Globals of main.c and wifi_conn.c used by mqtt_conn ----------------
+
+int8 mqtt_status = MQTT_DISCONNECT;
+char unique_identifier[22] = BENCH_CLIENT_ID;
+
+uint32 user_rf_cal_sector_set(void) {
+    return 0; // No spool
+}
+
+u_long get_time() {
+    return time(NULL);
+}
+
+void time_to_str(char *timestamp, u_long time) {
+    sprintf(timestamp, "%lu", time);
+}
+
+// --------------------------------------------------------------------
+
+// Bench Variables ----------------------------------------------------
+
+extern MQTTClient client;
+extern struct Network network;
+
+double enqueued_at[BENCH_MAX_MESSAGES]; // Enqueue time per message
+double latency[BENCH_MAX_MESSAGES];     // Latency per message (in msec)
+uint32 acks = 0;                        // PUBACKs of the current run
+uint32 completed = 0;                   // Submitted publishes completed
+uint32 failures = 0;                    // Submitted publishes failed
+int out = 1;                            // Result output
+NetworkStats run_stats;                 // Read counters at the start of the run
+
+// --------------------------------------------------------------------
+
+/**
+ * Returns a monotonic time in milliseconds.
+ * @param none
+ * @return double Time
+ */
+static double bench_now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (ts.tv_sec * 1e3) + (ts.tv_nsec / 1e6);
+}
+
+/**
+ * PUBACK callback. PUBACKs come back in publish order, so the n-th
+ * PUBACK of a run belongs to the n-th message enqueued.
+ * @param unsigned short packet_id Packet ID
+ * @return none
+ */
+static void bench_ack_received(unsigned short packet_id) {
+    mqtt_ack_received(packet_id);
+
+    if (acks < BENCH_MAX_MESSAGES) {
+        latency[acks] = bench_now() - enqueued_at[acks];
+    }
+
+    acks++;
+}
+
+/**
+ * Compares two latencies for qsort.
+ * @param void *a Latency
+ * @param void *b Latency
+ * @return int Order
+ */
+static int bench_compare(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Prints a result line. Reads are parser reads of the network layer,
+ * syscalls are the select/recv calls they took.
+ * @param char *mode Mode
+ * @param int qos QoS
+ * @param uint32 depth Queue depth
+ * @param uint32 messages No of messages
+ * @param double elapsed Run time (in msec)
+ * @return none
+ */
+static void bench_report(const char *mode, int qos, uint32 depth, uint32 messages, double elapsed) {
+    unsigned long reads = network.stats.reads - run_stats.reads;
+    unsigned long syscalls = (network.stats.selects + network.stats.recvs) - (run_stats.selects + run_stats.recvs);
+
+    qsort(latency, messages, sizeof(double), bench_compare);
+
+    dprintf(out, "%-8s %3d %6u %7u %10.0f %9.3f %9.3f %9.2f %9.2f\n", mode, qos, depth, messages,
+            messages / (elapsed / 1e3), latency[messages / 2], latency[(messages * 99) / 100],
+            (double)reads / messages, (double)syscalls / messages);
+}
+
+/**
+ * Fills a payload with a sequence number.
+ * @param char *payload Buffer (BENCH_PAYLOAD_SIZE + 1)
+ * @param uint32 seq Sequence number
+ * @return none
+ */
+static void bench_payload(char *payload, uint32 seq) {
+    int length = snprintf(payload, BENCH_PAYLOAD_SIZE + 1, "%u ", seq);
+
+    memset(payload + length, 'x', BENCH_PAYLOAD_SIZE - length);
+    payload[BENCH_PAYLOAD_SIZE] = '\0';
+}
+
+/**
+ * Publishes every message with MQTTPublish(), waiting for the broker on
+ * every message (Stop and wait).
+ * @param enum QoS qos QoS
+ * @param uint32 messages No of messages
+ * @return int Success/Fail
+ */
+static int bench_direct(enum QoS qos, uint32 messages) {
+    char payload[BENCH_PAYLOAD_SIZE + 1];
+    double start = bench_now();
+
+    run_stats = network.stats;
+
+    for (uint32 i = 0; i < messages; i++) {
+        MQTTMessage message = {
+            .payload = payload,
+            .payloadlen = BENCH_PAYLOAD_SIZE,
+            .qos = qos
+        };
+
+        bench_payload(payload, i);
+        enqueued_at[i] = bench_now();
+
+        if (MQTTPublish(&client, BENCH_TOPIC, &message) != SUCCESS) {
+            dprintf(out, "direct QoS%d: publish %u failed\n", qos, i);
+            return 1;
+        }
+
+        latency[i] = bench_now() - enqueued_at[i];
+    }
+
+    bench_report("direct", qos, 1, messages, bench_now() - start);
+
+    return 0;
+}
+
+/**
+ * Publishes through the outgoing queue at QoS1. depth messages are
+ * enqueued and then published with mqtt_queue_publish().
+ * @param uint32 depth Messages enqueued per publish
+ * @param uint32 messages No of messages
+ * @return int Success/Fail
+ */
+static int bench_queued(uint32 depth, uint32 messages) {
+    char payload[BENCH_PAYLOAD_SIZE + 1];
+    double start = bench_now();
+    uint32 sent = 0;
+
+    acks = 0;
+    run_stats = network.stats;
+
+    while (sent < messages) {
+        for (uint32 i = 0; (i < depth) && (sent < messages); i++, sent++) {
+            bench_payload(payload, sent);
+            enqueued_at[sent] = bench_now();
+
+            if (mqtt_enqueue(BENCH_TOPIC, payload) != MQTT_QUEUE_SUCCESS) {
+                dprintf(out, "queued %u: queue full, lower the depth\n", depth);
+                return 1;
+            }
+        }
+
+        if (mqtt_queue_publish() != MQTT_QUEUE_SUCCESS) {
+            dprintf(out, "queued %u: publish failed\n", depth);
+            return 1;
+        }
+    }
+
+    if (acks != messages) {
+        dprintf(out, "queued %u: %u PUBACKs for %u messages\n", depth, acks, messages);
+        return 1;
+    }
+
+    bench_report("queued", 1, depth, messages, bench_now() - start);
+
+    return 0;
+}
+
+/**
+ * Completion callback of a submitted publish. context is the sequence
+ * number of the message.
+ * @param void *context Sequence number
+ * @param unsigned short id Packet ID
+ * @param int rc Result
+ * @return none
+ */
+static void bench_publish_done(void *context, unsigned short id, int rc) {
+    uint32 seq = (uint32)(size_t)context;
+
+    (void)id;
+    latency[seq] = bench_now() - enqueued_at[seq];
+    completed++;
+
+    if (rc != SUCCESS) {
+        failures++;
+    }
+}
+
+/**
+ * Publishes at QoS1 with MQTTPublishSubmit(), keeping up to outstanding
+ * messages in flight and completing them with MQTTPoll().
+ * @param uint32 outstanding Max messages in flight
+ * @param uint32 messages No of messages
+ * @return int Success/Fail
+ */
+static int bench_submit(uint32 outstanding, uint32 messages) {
+    char payload[BENCH_PAYLOAD_SIZE + 1];
+    double start = bench_now();
+    uint32 sent = 0;
+
+    completed = 0;
+    failures = 0;
+    run_stats = network.stats;
+
+    while ((completed < messages) && (failures == 0)) {
+        while ((sent < messages) && ((sent - completed) < outstanding)) {
+            MQTTMessage message = {
+                .payload = payload,
+                .payloadlen = BENCH_PAYLOAD_SIZE,
+                .qos = QOS1
+            };
+
+            bench_payload(payload, sent);
+            enqueued_at[sent] = bench_now();
+
+            if (MQTTPublishSubmit(&client, BENCH_TOPIC, &message, bench_publish_done, (void *)(size_t)sent) != SUCCESS) {
+                dprintf(out, "submit %u: publish %u failed\n", outstanding, sent);
+                return 1;
+            }
+
+            sent++;
+        }
+
+        if (MQTTPoll(&client, MQTT_PUBLISH_TIMEOUT) == DISCONNECTED) {
+            dprintf(out, "submit %u: disconnected\n", outstanding);
+            return 1;
+        }
+    }
+
+    if (failures > 0) {
+        dprintf(out, "submit %u: %u publishes failed\n", outstanding, failures);
+        return 1;
+    }
+
+    bench_report("submit", 1, outstanding, messages, bench_now() - start);
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    char *host = (argc > 1) ? argv[1] : "localhost";
+    int port = (argc > 2) ? atoi(argv[2]) : MQTT_PORT;
+    uint32 messages = (argc > 3) ? (uint32)atoi(argv[3]) : 2000;
+    int verbose = (argc > 4) && !strcmp(argv[4], "-v");
+    uint32 full_depth = MQTT_QUEUE_BYTES / mqtt_ring_record_size(strlen(BENCH_TOPIC), BENCH_PAYLOAD_SIZE);
+    uint32 depths[] = {1, 8, 32, full_depth};
+    int failed = 0;
+
+    if (messages > BENCH_MAX_MESSAGES) {
+        messages = BENCH_MAX_MESSAGES;
+    }
+
+    // Library logs go to /dev/null unless -v
+    out = dup(STDOUT_FILENO);
+
+    if (!verbose) {
+        int null = open("/dev/null", O_WRONLY);
+
+        dup2(null, STDOUT_FILENO);
+        close(null);
+    }
+
+    mqtt_queue_init(MAX_QUEUE_SIZE);
+
+    if (mqtt_connect(host, BENCH_CLIENT_ID, port, MQTT_TIMEOUT, MQTT_BUFF_SIZE) != MQTT_CONNECTION_SUCCESS) {
+        dprintf(out, "Failed to connect to %s:%d\n", host, port);
+        return 1;
+    }
+
+    MQTTSetAckHandler(&client, bench_ack_received);
+
+    dprintf(out, "broker %s:%d, payload %d B, window %d, queue %d B\n", host, port, BENCH_PAYLOAD_SIZE, MQTT_INFLIGHT_WINDOW, MQTT_QUEUE_BYTES);
+    dprintf(out, "%-8s %3s %6s %7s %10s %9s %9s %9s %9s\n", "mode", "qos", "depth", "msgs", "msgs/s", "p50 ms", "p99 ms",
+            "reads/msg", "sys/msg");
+
+    failed |= bench_direct(QOS0, messages);
+    failed |= bench_direct(QOS1, messages);
+    failed |= bench_direct(QOS2, messages);
+
+    for (uint32 i = 0; (i < (sizeof(depths) / sizeof(depths[0]))) && !failed; i++) {
+        failed |= bench_queued(depths[i], messages);
+    }
+
+    for (uint32 outstanding = 1; (outstanding <= MAX_PENDING_OPS) && !failed; outstanding *= 2) {
+        failed |= bench_submit(outstanding, messages);
+    }
+
+    MQTTDisconnect(&client);
+    mqtt_disconnect();
+
+    return failed;
+}
@@ -0,0 +1,160 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: registry_bench.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host benchmark for the perfect hash of the zone registry.
+ * Finds every zone of kAtcZoneAndLinkRegistry by ID and by name, in a
+ * random order, with a registrar doing a binary search and with one using
+ * kAtcZoneAndLinkHash, and checks that both find the same zones and that
+ * IDs and names that are not in it are not found. Also times the
+ * registrar setup, which checks that the registry is sorted unless hashed.
+ *
+ * Usage: registry_bench [lookups]
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <time.h>
+
+#include "esp_common.h"
+#include "../../lib/wifi_conn/acetime/acetimec.h"
+
+// Constants ----------------------------------------------------------
+
+#define BENCH_INITS 10000 // Registrar setups timed
+
+// --------------------------------------------------------------------
+
+/**
+ * Returns the monotonic time in nsec.
+ * @param none
+ * @return uint64 Time (in nsec)
+ */
+static uint64 bench_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/**
+ * Checks that a registrar finds every zone by ID and by name, and nothing
+ * else.
+ * @param AtcZoneRegistrar *registrar Registrar
+ * @return int Success/Fail
+ */
+static int bench_check(const AtcZoneRegistrar *registrar) {
+    char name[64];
+
+    for (uint32 i = 0; i < kAtcZoneAndLinkRegistrySize; i++) {
+        const AtcZoneInfo *zone_info = kAtcZoneAndLinkRegistry[i];
+
+        if ((atc_registrar_find_by_id(registrar, zone_info->zone_id) != zone_info) ||
+            (atc_registrar_find_by_name(registrar, zone_info->name) != zone_info)) {
+            printf("FAIL: %s not found\n", zone_info->name);
+            return 1;
+        }
+
+        // Not in the registry: a changed name and its ID
+        snprintf(name, sizeof(name), "%s_", zone_info->name);
+
+        if ((atc_registrar_find_by_id(registrar, atc_djb2(name)) != NULL) ||
+            (atc_registrar_find_by_name(registrar, name) != NULL)) {
+            printf("FAIL: %s found\n", name);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Times finding zones by ID and by name.
+ * @param char *name Name of the registrar
+ * @param AtcZoneRegistrar *registrar Registrar
+ * @param uint16 *order Registry index of each lookup
+ * @param uint32 count No of lookups
+ * @return none
+ */
+static void bench_find(const char *name, const AtcZoneRegistrar *registrar, const uint16 *order, uint32 count) {
+    uintptr_t sink = 0;
+    uint64 start = bench_ns();
+
+    for (uint32 i = 0; i < count; i++) {
+        sink += (uintptr_t)atc_registrar_find_by_id(registrar, kAtcZoneAndLinkRegistry[order[i]]->zone_id);
+    }
+
+    uint64 id_ns = bench_ns() - start;
+
+    start = bench_ns();
+
+    for (uint32 i = 0; i < count; i++) {
+        sink += (uintptr_t)atc_registrar_find_by_name(registrar, kAtcZoneAndLinkRegistry[order[i]]->name);
+    }
+
+    uint64 name_ns = bench_ns() - start;
+
+    printf("%-9s | %9.1f ns | %9.1f ns | (%d)\n", name, (double)id_ns / count, (double)name_ns / count,
+           (int)(sink & 1));
+}
+
+int main(int argc, char **argv) {
+    uint32 count = (argc > 1) ? atoi(argv[1]) : 1000000;
+    AtcZoneRegistrar sorted;
+    AtcZoneRegistrar hashed;
+    int failed = 0;
+
+    uint64 start = bench_ns();
+
+    for (uint32 i = 0; i < BENCH_INITS; i++) {
+        atc_registrar_init(&sorted, kAtcZoneAndLinkRegistry, kAtcZoneAndLinkRegistrySize);
+    }
+
+    uint64 sorted_ns = bench_ns() - start;
+
+    start = bench_ns();
+
+    for (uint32 i = 0; i < BENCH_INITS; i++) {
+        atc_registrar_init_hashed(&hashed, kAtcZoneAndLinkRegistry, kAtcZoneAndLinkRegistrySize,
+                                  &kAtcZoneAndLinkHash);
+    }
+
+    uint64 hashed_ns = bench_ns() - start;
+
+    failed |= bench_check(&sorted);
+    failed |= bench_check(&hashed);
+
+    printf("%d zones, hash of %d buckets, %u bytes: %s\n", kAtcZoneAndLinkRegistrySize,
+           kAtcZoneAndLinkHash.num_seeds, (unsigned)((kAtcZoneAndLinkHash.num_seeds + kAtcZoneAndLinkHash.size) * 2),
+           failed ? "FAIL" : "OK");
+    printf("Init: sorted %.1f ns, hashed %.1f ns\n\n", (double)sorted_ns / BENCH_INITS,
+           (double)hashed_ns / BENCH_INITS);
+
+    uint16 *order = calloc(count, sizeof(uint16));
+
+    if (order == NULL) {
+        return 1;
+    }
+
+    srand(1);
+
+    for (uint32 i = 0; i < count; i++) {
+        order[i] = rand() % kAtcZoneAndLinkRegistrySize;
+    }
+
+    printf("%-9s | %12s | %12s |\n", "registrar", "by id", "by name");
+    bench_find("sorted", &sorted, order, count);
+    bench_find("hashed", &hashed, order, count);
+
+    free(order);
+
+    return failed;
+}
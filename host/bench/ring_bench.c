@@ -0,0 +1,193 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: ring_bench.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host benchmark for the MQTT ring arena. Checks that a
+ * reader never sees a record its producer (Task or ISR) has reserved but
+ * not yet committed and that released records are marked for resend,
+ * then times push, peek and drop of a record.
+ *
+ * Usage: ring_bench [records]
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <time.h>
+
+#include "mqtt_ring.h"
+
+// Constants ----------------------------------------------------------
+
+#define BENCH_RING_BYTES 4096 // Ring capacity (in bytes)
+#define BENCH_TOPIC "lihini/income" // Topic of the records
+#define BENCH_PAYLOAD "ESP says: 1" // Payload of the records
+
+// --------------------------------------------------------------------
+
+static uint8 bench_storage[BENCH_RING_BYTES];
+
+/**
+ * Returns the monotonic time in nsec.
+ * @param none
+ * @return uint64 Time (in nsec)
+ */
+static uint64 bench_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/**
+ * Reserves a record, checks the reader cannot see it until it is
+ * committed and that it then sees the whole payload.
+ * @param MqttRing *ring Ring
+ * @param uint8 from_isr Use the ISR variants
+ * @return int Success/Fail (Record seen early or cut short)
+ */
+static int bench_check(MqttRing *ring, uint8 from_isr) {
+    struct MqttRecord reserved;
+    struct MqttRecord seen;
+    uint16 len = strlen(BENCH_PAYLOAD);
+    uint8 error;
+
+    error = from_isr ? mqtt_ring_reserve_from_isr(ring, BENCH_TOPIC, len, &reserved)
+                     : mqtt_ring_reserve(ring, BENCH_TOPIC, len, &reserved);
+
+    if (error != MQTT_RING_SUCCESS) {
+        printf("FAIL: reserve (%d)\n", error);
+        return 1;
+    }
+
+    if (mqtt_ring_peek(ring, &seen) != MQTT_RING_EMPTY) {
+        printf("FAIL: reserved record peeked before commit (%s)\n", from_isr ? "ISR" : "task");
+        return 1;
+    }
+
+    if (mqtt_ring_drop(ring) != MQTT_RING_EMPTY) {
+        printf("FAIL: reserved record dropped before commit\n");
+        return 1;
+    }
+
+    memcpy(reserved.payload, BENCH_PAYLOAD, len);
+
+    if (from_isr) {
+        mqtt_ring_commit_from_isr(ring, &reserved, len);
+    } else {
+        mqtt_ring_commit(ring, &reserved, len);
+    }
+
+    if ((mqtt_ring_peek(ring, &seen) != MQTT_RING_SUCCESS) || (seen.payload_len != len) ||
+        (memcmp(seen.payload, BENCH_PAYLOAD, len) != 0) || (strcmp(seen.topic, BENCH_TOPIC) != 0)) {
+        printf("FAIL: committed record not peeked whole (%s)\n", from_isr ? "ISR" : "task");
+        return 1;
+    }
+
+    // A record reserved behind a committed one is not walked into either
+    mqtt_ring_reserve(ring, BENCH_TOPIC, len, &reserved);
+
+    if (mqtt_ring_next(ring, &seen) != MQTT_RING_EMPTY) {
+        printf("FAIL: reserved record reached with next\n");
+        return 1;
+    }
+
+    if (mqtt_ring_drop(ring) != MQTT_RING_SUCCESS) {
+        printf("FAIL: committed record not dropped\n");
+        return 1;
+    }
+
+    mqtt_ring_abort(ring, &reserved);
+
+    if (mqtt_ring_count(ring) != 0) {
+        printf("FAIL: records left after the check\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Claims a record, releases it and checks it is claimed again marked as
+ * a resend, while a record that was never claimed is not.
+ * @param MqttRing *ring Ring
+ * @return int Success/Fail (Resend not marked)
+ */
+static int bench_release(MqttRing *ring) {
+    struct MqttRecord claimed;
+    uint16 len = strlen(BENCH_PAYLOAD);
+
+    mqtt_ring_push(ring, BENCH_TOPIC, BENCH_PAYLOAD, len);
+    mqtt_ring_push(ring, BENCH_TOPIC, BENCH_PAYLOAD, len);
+
+    if ((mqtt_ring_claim(ring, &claimed) != MQTT_RING_SUCCESS) || (claimed.flags & MQTT_RECORD_DUP)) {
+        printf("FAIL: first claim\n");
+        return 1;
+    }
+
+    mqtt_ring_release(ring);
+
+    if ((mqtt_ring_claim(ring, &claimed) != MQTT_RING_SUCCESS) || !(claimed.flags & MQTT_RECORD_DUP)) {
+        printf("FAIL: released record not marked for resend\n");
+        return 1;
+    }
+
+    if ((mqtt_ring_claim(ring, &claimed) != MQTT_RING_SUCCESS) || (claimed.flags & MQTT_RECORD_DUP)) {
+        printf("FAIL: record never sent marked for resend\n");
+        return 1;
+    }
+
+    mqtt_ring_release(ring);
+
+    while (mqtt_ring_drop(ring) == MQTT_RING_SUCCESS);
+
+    if (mqtt_ring_count(ring) != 0) {
+        printf("FAIL: records left after the release check\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    uint32 count = (argc > 1) ? atoi(argv[1]) : 1000000;
+    struct MqttRecord record;
+    MqttRing ring;
+    int failed = 0;
+
+    mqtt_ring_init(&ring, bench_storage, sizeof(bench_storage));
+
+    failed |= bench_check(&ring, FALSE);
+    failed |= bench_check(&ring, TRUE);
+
+    printf("reserve, peek, commit: %s\n", failed ? "FAIL" : "OK");
+
+    int release_failed = bench_release(&ring);
+
+    printf("claim, release, resend: %s\n", release_failed ? "FAIL" : "OK");
+    failed |= release_failed;
+
+    uint64 start = bench_ns();
+    uint32 sink = 0;
+
+    for (uint32 i = 0; i < count; i++) {
+        mqtt_ring_push(&ring, BENCH_TOPIC, BENCH_PAYLOAD, strlen(BENCH_PAYLOAD));
+
+        if (mqtt_ring_peek(&ring, &record) == MQTT_RING_SUCCESS) {
+            sink += record.payload_len;
+        }
+
+        mqtt_ring_drop(&ring);
+    }
+
+    printf("push, peek, drop: %.1f ns per record (%u)\n", (double)(bench_ns() - start) / count, sink & 1);
+
+    return failed;
+}
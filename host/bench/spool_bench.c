@@ -0,0 +1,187 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: spool_bench.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host benchmark for the MQTT spool. Simulates an outage on
+ * a file backed flash, reboots, replays the backlog and checks order,
+ * loss, CRC recovery and sector wear.
+ *
+ * Usage: spool_bench [messages] [sectors] [file]
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <time.h>
+#include <unistd.h>
+
+#include "spool_flash_file.h"
+
+// Constants ----------------------------------------------------------
+
+#define BENCH_SECTOR_SIZE 4096 // Sector size of the ESP8266 flash
+#define BENCH_TOPIC "lihini/income" // Topic of the messages
+
+// --------------------------------------------------------------------
+
+/**
+ * Returns a monotonic time in seconds.
+ * @param none
+ * @return double Time
+ */
+static double bench_now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/**
+ * Mounts the spool, exits on failure.
+ * @param struct MqttSpool *spool Spool
+ * @param struct SpoolFlash *flash Flash
+ * @param char *path Backing file
+ * @param uint32 sectors No of sectors
+ * @return none
+ */
+static void bench_mount(struct MqttSpool *spool, struct SpoolFlash *flash, const char *path, uint32 sectors) {
+    if (spool_flash_file_open(flash, path, BENCH_SECTOR_SIZE, sectors) || (mqtt_spool_init(spool, flash) != MQTT_SPOOL_SUCCESS)) {
+        fprintf(stderr, "Failed to mount spool on %s\n", path);
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32 messages = (argc > 1) ? atoi(argv[1]) : 2000;
+    uint32 sectors = (argc > 2) ? atoi(argv[2]) : 8;
+    const char *path = (argc > 3) ? argv[3] : "/tmp/lihini_spool.bin";
+    struct SpoolFlash flash = {0};
+    struct MqttSpool spool = {0};
+    struct SpoolCursor cursor = {0};
+    struct SpoolEntry entry = {0};
+    char payload[64];
+    char buf[256];
+    int failed = 0;
+
+    unlink(path);
+    bench_mount(&spool, &flash, path, sectors);
+
+    // Outage: everything goes to the spool
+    double start = bench_now();
+
+    for (uint32 i = 0; i < messages; i++) {
+        int len = snprintf(payload, sizeof(payload), "[16-10-2026 10:00:00] ESP says: %u", i);
+
+        if (mqtt_spool_append(&spool, BENCH_TOPIC, payload, len) != MQTT_SPOOL_SUCCESS) {
+            printf("FAIL: append %u\n", i);
+            return 1;
+        }
+    }
+
+    double elapsed = bench_now() - start;
+    struct SpoolFlashFileStats *flash_stats = spool_flash_file_stats(&flash);
+
+    printf("append: %u msgs in %.3f s (%.0f msgs/s), %.1f flash bytes/msg, %u erases\n",
+           messages, elapsed, messages / elapsed, (double)flash_stats->bytes_written / messages, spool.stats.erases);
+    printf("spooled: %u, dropped (Spool full): %u\n", mqtt_spool_count(&spool), spool.stats.dropped);
+
+    // Reboot: the backlog must survive
+    uint32 before = mqtt_spool_count(&spool);
+
+    spool_flash_file_close(&flash);
+    bench_mount(&spool, &flash, path, sectors);
+
+    if (mqtt_spool_count(&spool) != before) {
+        printf("FAIL: %u messages after reboot, expected %u\n", mqtt_spool_count(&spool), before);
+        failed = 1;
+    }
+
+    // Replay: oldest first, no gaps
+    uint32 expected = messages - before;
+    uint32 replayed = 0;
+
+    start = bench_now();
+    mqtt_spool_first(&spool, &cursor);
+
+    while (mqtt_spool_read(&spool, &cursor, buf, sizeof(buf), &entry) == MQTT_SPOOL_SUCCESS) {
+        uint32 seq = strtoul(strrchr(entry.payload, ' ') + 1, NULL, 10);
+
+        if ((seq != expected) || strcmp(entry.topic, BENCH_TOPIC)) {
+            printf("FAIL: replayed %u, expected %u\n", seq, expected);
+            failed = 1;
+            break;
+        }
+
+        mqtt_spool_ack(&spool, &cursor);
+        mqtt_spool_next(&spool, &cursor);
+        expected++;
+        replayed++;
+    }
+
+    elapsed = bench_now() - start;
+
+    printf("replay: %u msgs in %.3f s (%.0f msgs/s), %u left\n", replayed, elapsed, replayed / elapsed, mqtt_spool_count(&spool));
+
+    if ((replayed != before) || (mqtt_spool_count(&spool) != 0)) {
+        printf("FAIL: replayed %u of %u\n", replayed, before);
+        failed = 1;
+    }
+
+    // Power cut in the middle of a write: the torn record is skipped
+    uint32 addr = (spool.tail.sector * BENCH_SECTOR_SIZE) + spool.tail.offset;
+    uint32 zero = 0;
+
+    mqtt_spool_append(&spool, BENCH_TOPIC, "torn", 4);
+    mqtt_spool_append(&spool, BENCH_TOPIC, "intact", 6);
+    flash.write(&flash, addr + 12, &zero, sizeof(zero));
+
+    spool_flash_file_close(&flash);
+    bench_mount(&spool, &flash, path, sectors);
+    mqtt_spool_first(&spool, &cursor);
+
+    if ((mqtt_spool_read(&spool, &cursor, buf, sizeof(buf), &entry) != MQTT_SPOOL_SUCCESS) ||
+        strcmp(entry.payload, "intact") || (spool.stats.crc_errors != 1)) {
+        printf("FAIL: torn record not skipped\n");
+        failed = 1;
+    }
+
+    // Wear: sectors are used in a circle
+    spool_flash_file_close(&flash);
+    bench_mount(&spool, &flash, path, sectors);
+
+    for (uint32 i = 0; i < (sectors * 100); i++) {
+        mqtt_spool_append(&spool, BENCH_TOPIC, payload, strlen(payload));
+    }
+
+    flash_stats = spool_flash_file_stats(&flash);
+    uint32 min_erases = flash_stats->sector_erases[0];
+    uint32 max_erases = flash_stats->sector_erases[0];
+
+    for (uint32 i = 1; i < sectors; i++) {
+        if (flash_stats->sector_erases[i] < min_erases)
+            min_erases = flash_stats->sector_erases[i];
+        if (flash_stats->sector_erases[i] > max_erases)
+            max_erases = flash_stats->sector_erases[i];
+    }
+
+    printf("wear: erases per sector min %u max %u\n", min_erases, max_erases);
+
+    if ((max_erases - min_erases) > 1) {
+        printf("FAIL: uneven wear\n");
+        failed = 1;
+    }
+
+    spool_flash_file_close(&flash);
+    unlink(path);
+
+    printf(failed ? "FAILED\n" : "OK\n");
+
+    return failed;
+}
@@ -0,0 +1,171 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: time_bench.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host benchmark for the timestamp formatter. Formats the same
+ * times with the old time_to_str() (AceTime civil conversion and sprintf)
+ * and with time_fmt, checks that the output is identical and times both.
+ * Consecutive seconds are the publish path, random times the worst case
+ * where every timestamp misses the cached day.
+ *
+ * Usage: time_bench [timestamps]
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <time.h>
+
+#include "../../lib/wifi_conn/time_fmt.h"
+#include "../../lib/wifi_conn/acetime/acetimec.h"
+
+// Constants ----------------------------------------------------------
+
+#define BENCH_START 1760572800LL // First timestamp (16/10/2025)
+#define BENCH_SPAN 3155760000LL // Range of the random times (100 years)
+
+// --------------------------------------------------------------------
+
+/**
+ * Old time_to_str() of wifi_conn.c.
+ * @param char *timestamp Generated timestamp
+ * @param u_long time Current time in Unix secs.
+ * @return none
+ */
+static void bench_time_to_str(char *timestamp, u_long time) {
+    AtcLocalDateTime current_time = {0};
+
+    atc_local_date_time_from_unix_seconds(&current_time, time);
+
+    int values[5] = {current_time.day, current_time.month, current_time.hour, current_time.minute, current_time.second};
+    char str_values[5][3] = {0};
+
+    for (int i = 0; i < 5; i++) {
+        if (values[i] < 10)
+            sprintf(str_values[i], "0%d", values[i]);
+        else
+            sprintf(str_values[i], "%d", values[i]);
+    }
+
+    sprintf(timestamp, "%s-%s-%d %s:%s:%s", str_values[0], str_values[1], current_time.year, str_values[2], str_values[3], str_values[4]);
+}
+
+/**
+ * Returns the monotonic time in nsec.
+ * @param none
+ * @return uint64 Time (in nsec)
+ */
+static uint64 bench_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/**
+ * Formats a set of times with both paths and prints the cost per
+ * timestamp.
+ * @param char *name Name of the set
+ * @param u_long *times Times
+ * @param uint32 count No of times
+ * @return int Success/Fail (Outputs differ)
+ */
+static int bench_run(const char *name, const u_long *times, uint32 count) {
+    char old_buffer[32];
+    char new_buffer[TIME_FMT_LENGTH + 1];
+    TimeFmtDay day = {0};
+    uint32 sink = 0;
+
+    for (uint32 i = 0; i < count; i++) {
+        bench_time_to_str(old_buffer, times[i]);
+        time_fmt_write(&day, new_buffer, times[i], TIME_FMT_DMY);
+
+        if (strcmp(old_buffer, new_buffer) != 0) {
+            printf("FAIL: %lu formatted as %s, expected %s\n", times[i], new_buffer, old_buffer);
+            return 1;
+        }
+    }
+
+    uint64 start = bench_ns();
+
+    for (uint32 i = 0; i < count; i++) {
+        bench_time_to_str(old_buffer, times[i]);
+        sink += old_buffer[18];
+    }
+
+    uint64 old_ns = bench_ns() - start;
+
+    memset(&day, 0, sizeof(day));
+    start = bench_ns();
+
+    for (uint32 i = 0; i < count; i++) {
+        time_fmt_write(&day, new_buffer, times[i], TIME_FMT_DMY);
+        sink += new_buffer[18];
+    }
+
+    uint64 new_ns = bench_ns() - start;
+
+    printf("%-12s | %9.1f ns | %9.1f ns | x%.1f (%u)\n", name, (double)old_ns / count, (double)new_ns / count,
+           (double)old_ns / (new_ns ? new_ns : 1), sink & 1);
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    uint32 count = (argc > 1) ? atoi(argv[1]) : 1000000;
+    u_long *times = calloc(count, sizeof(u_long));
+    char iso[TIME_FMT_LENGTH + 1];
+    TimeFmtDay day = {0};
+    int failed = 0;
+
+    if (times == NULL) {
+        return 1;
+    }
+
+    // ISO-8601 spot checks, including the leap day and the end of a year
+    const struct {
+        u_long time;
+        const char *expected;
+    } checks[] = {
+        {0, "1970-01-01T00:00:00"},
+        {951782400, "2000-02-29T00:00:00"},
+        {1767225599, "2025-12-31T23:59:59"},
+        {4102444800UL, "2100-01-01T00:00:00"}
+    };
+
+    for (uint32 i = 0; i < (sizeof(checks) / sizeof(checks[0])); i++) {
+        time_fmt_write(&day, iso, checks[i].time, TIME_FMT_ISO8601);
+
+        if (strcmp(iso, checks[i].expected) != 0) {
+            printf("FAIL: %lu formatted as %s, expected %s\n", checks[i].time, iso, checks[i].expected);
+            failed = 1;
+        }
+    }
+
+    printf("%-12s | %12s | %12s |\n", "timestamps", "time_to_str", "time_fmt");
+
+    for (uint32 i = 0; i < count; i++) {
+        times[i] = BENCH_START + i;
+    }
+
+    failed |= bench_run("consecutive", times, count);
+
+    srand(1);
+
+    for (uint32 i = 0; i < count; i++) {
+        times[i] = (u_long)((((uint64)rand() << 16) ^ rand()) % BENCH_SPAN);
+    }
+
+    failed |= bench_run("random", times, count);
+
+    free(times);
+
+    return failed;
+}
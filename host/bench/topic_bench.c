@@ -0,0 +1,247 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: topic_bench.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host microbenchmark of the topic filter trie (mqtt_topic.c)
+ * against the linear matcher it replaced in deliverMessage() (Every
+ * filter tried with MQTTPacket_equals() and isTopicMatched()). Filters
+ * model per-device sensor and command routes plus broadcast wildcards.
+ * Both matchers must agree on the no of matches of every topic.
+ *
+ * Usage: topic_bench [lookups]
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <time.h>
+
+#include "paho/MQTTClient.h"
+#include "mqtt_topic.h"
+
+// Constants ----------------------------------------------------------
+
+#define BENCH_MAX_FILTERS 1024 // Max filters per run
+#define BENCH_TOPICS 512 // Distinct topics looked up
+#define BENCH_TOPIC_SIZE 64 // Max topic length
+#define BENCH_NODES 4096 // Trie nodes
+#define BENCH_NAME_BYTES 32768 // Trie name storage
+#define BENCH_SENSORS 4 // Sensor topics per device
+
+// --------------------------------------------------------------------
+
+// Linear matcher of MQTTClient.c (Not in MQTTClient.h)
+char isTopicMatched(char *topicFilter, MQTTString *topicName);
+
+// Bench Variables ----------------------------------------------------
+
+char filters[BENCH_MAX_FILTERS][BENCH_TOPIC_SIZE];  // Filters of the run
+char topics[BENCH_TOPICS][BENCH_TOPIC_SIZE];        // Topics looked up
+MQTTString topic_strings[BENCH_TOPICS];
+MqttTopicNode nodes[BENCH_NODES];
+char names[BENCH_NAME_BYTES];
+MqttTopicTrie trie;
+uint32 visits = 0;                                  // Handlers visited
+
+// --------------------------------------------------------------------
+
+/**
+ * Returns a monotonic time in nanoseconds.
+ * @param none
+ * @return double Time
+ */
+static double bench_now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+/**
+ * Trie visitor, counts the handlers.
+ * @param void *handler Handler
+ * @param void *context Context
+ * @return none
+ */
+static void bench_visit(void *handler, void *context) {
+    (void)handler;
+    (void)context;
+    visits++;
+}
+
+/**
+ * Builds count filters. Every device has BENCH_SENSORS sensor routes and
+ * one command wildcard, every 16th filter is a broadcast wildcard.
+ * @param uint32 count No of filters
+ * @return none
+ */
+static void bench_filters(uint32 count) {
+    for (uint32 i = 0; i < count; i++) {
+        uint32 device = i / (BENCH_SENSORS + 1);
+        uint32 route = i % (BENCH_SENSORS + 1);
+
+        if ((i % 16) == 15) {
+            snprintf(filters[i], BENCH_TOPIC_SIZE, "lihini/+/broadcast/%u/#", i);
+        } else if (route == BENCH_SENSORS) {
+            snprintf(filters[i], BENCH_TOPIC_SIZE, "lihini/dev%04u/cmd/+", device);
+        } else {
+            snprintf(filters[i], BENCH_TOPIC_SIZE, "lihini/dev%04u/sensor/%u", device, route);
+        }
+    }
+}
+
+/**
+ * Builds the topics looked up, a mix of matching and unmatched topics.
+ * @param uint32 count No of filters
+ * @return none
+ */
+static void bench_topics(uint32 count) {
+    uint32 devices = (count / (BENCH_SENSORS + 1)) + 1;
+
+    srand(1);
+
+    for (uint32 i = 0; i < BENCH_TOPICS; i++) {
+        uint32 device = rand() % (devices * 2);
+
+        switch (rand() % 4) {
+            case 0:
+                snprintf(topics[i], BENCH_TOPIC_SIZE, "lihini/dev%04u/sensor/%u", device, rand() % (BENCH_SENSORS + 1));
+                break;
+            case 1:
+                snprintf(topics[i], BENCH_TOPIC_SIZE, "lihini/dev%04u/cmd/reboot", device);
+                break;
+            case 2:
+                snprintf(topics[i], BENCH_TOPIC_SIZE, "lihini/dev%04u/broadcast/%u/fw/chunk", device, rand() % count);
+                break;
+            default:
+                snprintf(topics[i], BENCH_TOPIC_SIZE, "other/dev%04u/sensor/0", device);
+                break;
+        }
+
+        topic_strings[i].cstring = NULL;
+        topic_strings[i].lenstring.data = topics[i];
+        topic_strings[i].lenstring.len = strlen(topics[i]);
+    }
+}
+
+/**
+ * Matches a topic the way deliverMessage() did before the trie.
+ * @param uint32 count No of filters
+ * @param MQTTString *topic Topic
+ * @return int No of matching filters
+ */
+static uint32 bench_linear(uint32 count, MQTTString *topic) {
+    uint32 matched = 0;
+
+    for (uint32 i = 0; i < count; i++) {
+        if (MQTTPacket_equals(topic, filters[i]) || isTopicMatched(filters[i], topic)) {
+            matched++;
+        }
+    }
+
+    return matched;
+}
+
+/**
+ * Runs both matchers over the topics with count filters and prints the
+ * time per lookup.
+ * @param uint32 count No of filters
+ * @param uint32 lookups No of lookups per matcher
+ * @return int Success/Fail
+ */
+static int bench_run(uint32 count, uint32 lookups) {
+    uint32 matched = 0;
+    uint32 check = 0;
+
+    bench_filters(count);
+    bench_topics(count);
+    mqtt_topic_init(&trie, nodes, BENCH_NODES, names, BENCH_NAME_BYTES);
+
+    for (uint32 i = 0; i < count; i++) {
+        if (mqtt_topic_add(&trie, filters[i], filters[i]) != MQTT_TOPIC_SUCCESS) {
+            printf("%u filters: failed to add %s\n", count, filters[i]);
+            return 1;
+        }
+    }
+
+    // Both must find the same matches
+    for (uint32 i = 0; i < BENCH_TOPICS; i++) {
+        uint32 expected = bench_linear(count, &topic_strings[i]);
+        uint32 found = mqtt_topic_match(&trie, topics[i], topic_strings[i].lenstring.len, bench_visit, NULL);
+
+        if (expected != found) {
+            printf("%u filters: %s matched %u filters, linear %u\n", count, topics[i], found, expected);
+            return 1;
+        }
+
+        matched += found;
+    }
+
+    double start = bench_now();
+
+    for (uint32 i = 0; i < lookups; i++) {
+        MQTTString *topic = &topic_strings[i % BENCH_TOPICS];
+
+        check += mqtt_topic_match(&trie, topic->lenstring.data, topic->lenstring.len, bench_visit, NULL);
+    }
+
+    double trie_ns = (bench_now() - start) / lookups;
+
+    start = bench_now();
+
+    for (uint32 i = 0; i < lookups; i++) {
+        check += bench_linear(count, &topic_strings[i % BENCH_TOPICS]);
+    }
+
+    double linear_ns = (bench_now() - start) / lookups;
+    uint32 used = 0;
+
+    for (uint32 i = 0; i < BENCH_NODES; i++) {
+        used += nodes[i].in_use;
+    }
+
+    printf("%7u %8.2f %9.0f %10.0f %8.1fx %6u %6u\n", count, (double)matched / BENCH_TOPICS, trie_ns, linear_ns,
+           linear_ns / trie_ns, used, trie.names_used);
+
+    // Removing every filter must free every node but the root
+    for (uint32 i = 0; i < count; i++) {
+        if (mqtt_topic_remove(&trie, filters[i]) != MQTT_TOPIC_SUCCESS) {
+            printf("%u filters: failed to remove %s\n", count, filters[i]);
+            return 1;
+        }
+    }
+
+    used = 0;
+
+    for (uint32 i = 0; i < BENCH_NODES; i++) {
+        used += nodes[i].in_use;
+    }
+
+    if ((used != 1) || (trie.names_used != 0) || (check == 0)) {
+        printf("%u filters: %u nodes, %u name bytes left after removing every filter\n", count, used, trie.names_used);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    uint32 lookups = (argc > 1) ? (uint32)atoi(argv[1]) : 200000;
+    uint32 counts[] = {5, 20, 100, 250, 500, 1000};
+    int failed = 0;
+
+    printf("%7s %8s %9s %10s %9s %6s %6s\n", "filters", "matches", "trie ns", "linear ns", "speedup", "nodes", "names");
+
+    for (uint32 i = 0; (i < (sizeof(counts) / sizeof(counts[0]))) && !failed; i++) {
+        failed |= bench_run(counts[i], lookups);
+    }
+
+    return failed;
+}
@@ -0,0 +1,310 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: tz_db_bench.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host benchmark for the binary zone database. Maps a
+ * database written by tz_db_gen and reads it in place, and through a
+ * source that copies, as the flash source does. Loads every zone of
+ * kAtcZoneAndLinkRegistry from each for every year of a range and checks
+ * that the zone processor gives the same results as with the compiled
+ * zonedb. Then times lookups with each: in a zone kept loaded, and
+ * switching zone on every lookup, which reloads the zone for the year.
+ *
+ * Usage: tz_db_gen zonedb.bin && tz_db_bench zonedb.bin [lookups]
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../lib/wifi_conn/tz_db.h"
+
+// Constants ----------------------------------------------------------
+
+#define BENCH_YEAR_START 2000 // First year checked and looked up
+#define BENCH_YEARS 50 // No of years checked and looked up
+
+// --------------------------------------------------------------------
+
+static TzDbZone bench_zone;
+static const uint8 *bench_data;
+
+/**
+ * Returns the monotonic time in nsec.
+ * @param none
+ * @return uint64 Time (in nsec)
+ */
+static uint64 bench_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/**
+ * Reads the mapped database by copying, as the flash source does.
+ * @param TzDbSource *source Source
+ * @param uint32 offset Offset in the database
+ * @param void *data Buffer
+ * @param uint32 len Length
+ * @return int Success/Fail
+ */
+static int bench_copy_read(TzDbSource *source, uint32 offset, void *data, uint32 len) {
+    (void)source;
+    memcpy(data, bench_data + offset, len);
+
+    return 0;
+}
+
+/**
+ * Returns the rules a loaded zone uses, each policy counted once.
+ * @param TzDbZone *zone Zone
+ * @return int No of rules
+ */
+static uint16 bench_rules(const TzDbZone *zone) {
+    uint16 rules = 0;
+
+    for (uint8 i = 0; i < zone->info.num_eras; i++) {
+        const AtcZonePolicy *policy = zone->info.eras[i].zone_policy;
+        uint8 seen = (policy == NULL);
+
+        for (uint8 j = 0; (j < i) && !seen; j++) {
+            seen = (zone->info.eras[j].zone_policy == policy);
+        }
+
+        rules += seen ? 0 : policy->num_rules;
+    }
+
+    return rules;
+}
+
+/**
+ * Checks that a zone loaded from the database gives the same results as
+ * the compiled one, a few times in every year it was loaded for, the
+ * first and the last hour included.
+ * @param AtcZoneInfo *compiled Compiled zone
+ * @param AtcZoneInfo *loaded Loaded zone
+ * @return int Success/Fail (Results differ)
+ */
+static int bench_check(const AtcZoneInfo *compiled, const AtcZoneInfo *loaded) {
+    static const uint8 days[][3] = {{1, 1, 0}, {1, 15, 2}, {4, 15, 2}, {7, 15, 2}, {10, 15, 2}, {12, 31, 23}};
+    AtcZoneProcessor expected;
+    AtcZoneProcessor actual;
+    AtcFindResult a;
+    AtcFindResult b;
+
+    atc_processor_init(&expected);
+    atc_processor_init(&actual);
+    atc_processor_init_for_zone_info(&expected, compiled);
+    atc_processor_init_for_zone_info(&actual, loaded);
+
+    if ((strcmp(compiled->name, loaded->name) != 0) ||
+        (atc_zone_info_is_link(compiled) != atc_zone_info_is_link(loaded))) {
+        printf("FAIL: %s loaded as %s\n", compiled->name, loaded->name);
+        return 1;
+    }
+
+    for (int16 year = loaded->zone_context->start_year; year < loaded->zone_context->until_year; year++) {
+        for (uint8 i = 0; i < (sizeof(days) / sizeof(days[0])); i++) {
+            AtcLocalDateTime local = {year, days[i][0], days[i][1], days[i][2], 30, 0, 0};
+            atc_time_t epoch_seconds = atc_local_date_time_to_epoch_seconds(&local);
+
+            atc_processor_find_by_epoch_seconds(&expected, epoch_seconds, &a);
+            atc_processor_find_by_epoch_seconds(&actual, epoch_seconds, &b);
+
+            uint8 same = (a.type == b.type) && (a.std_offset_seconds == b.std_offset_seconds) &&
+                         (a.dst_offset_seconds == b.dst_offset_seconds) && (strcmp(a.abbrev, b.abbrev) == 0);
+
+            atc_processor_find_by_local_date_time(&expected, &local, &a);
+            atc_processor_find_by_local_date_time(&actual, &local, &b);
+
+            same &= (a.type == b.type) && (a.fold == b.fold) && (a.std_offset_seconds == b.std_offset_seconds) &&
+                    (a.req_std_offset_seconds == b.req_std_offset_seconds) &&
+                    (a.req_dst_offset_seconds == b.req_dst_offset_seconds);
+
+            if (!same) {
+                printf("FAIL: %s at %d-%02d-%02d\n", compiled->name, year, days[i][0], days[i][1]);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    uint32 count = (argc > 2) ? atoi(argv[2]) : 200000;
+    TzDbSource sources[2];
+    TzDb dbs[2];
+    uint64 load_ns[2] = {0};
+    uint16 most_eras = 0;
+    uint16 most_rules = 0;
+    struct stat st;
+    int failed = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <zonedb.bin> [lookups]\n", argv[0]);
+        return 1;
+    }
+
+    int fd = open(argv[1], O_RDONLY);
+
+    if ((fd < 0) || (fstat(fd, &st) != 0)) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    const void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (data == MAP_FAILED) {
+        return 1;
+    }
+
+    // In place, and copied as from flash
+    bench_data = data;
+    tz_db_memory(&sources[0], data, st.st_size);
+    tz_db_memory(&sources[1], data, st.st_size);
+    sources[1].read = bench_copy_read;
+    sources[1].data = NULL;
+
+    if ((tz_db_open(&dbs[0], &sources[0]) != TZ_DB_SUCCESS) || (tz_db_open(&dbs[1], &sources[1]) != TZ_DB_SUCCESS)) {
+        fprintf(stderr, "%s is not a zone database\n", argv[1]);
+        return 1;
+    }
+
+    // Every zone loads for every year and agrees with zonedb
+    for (uint32 i = 0; i < kAtcZoneAndLinkRegistrySize; i++) {
+        const AtcZoneInfo *compiled = kAtcZoneAndLinkRegistry[i];
+
+        for (int16 year = BENCH_YEAR_START; year < (BENCH_YEAR_START + BENCH_YEARS); year++) {
+            for (uint8 j = 0; j < 2; j++) {
+                uint64 start = bench_ns();
+                uint8 status = tz_db_load(&dbs[j], compiled->zone_id, year, year + 1, &bench_zone);
+
+                load_ns[j] += bench_ns() - start;
+
+                if (status != TZ_DB_SUCCESS) {
+                    printf("FAIL: %s does not load for %d (%d)\n", compiled->name, year, status);
+                    failed = 1;
+                    continue;
+                }
+
+                most_eras = (bench_zone.info.num_eras > most_eras) ? bench_zone.info.num_eras : most_eras;
+                most_rules = (bench_rules(&bench_zone) > most_rules) ? bench_rules(&bench_zone) : most_rules;
+                failed |= bench_check(compiled, &bench_zone.info);
+            }
+        }
+    }
+
+    uint32 loads = kAtcZoneAndLinkRegistrySize * BENCH_YEARS;
+
+    printf("%s: %u bytes, %d zones, TzDbZone %u bytes\n", argv[1], dbs[0].header.size, dbs[0].header.zone_count,
+           (unsigned)sizeof(TzDbZone));
+    printf("%d zones checked for each year of %d-%d: %s, most %d eras and %d rules in a year\n",
+           kAtcZoneAndLinkRegistrySize, BENCH_YEAR_START, BENCH_YEAR_START + BENCH_YEARS - 1, failed ? "FAIL" : "OK",
+           most_eras, most_rules);
+    printf("load %.1f ns in place, %.1f ns copied per zone and year\n\n", (double)load_ns[0] / loads,
+           (double)load_ns[1] / loads);
+
+    atc_time_t *times = calloc(count, sizeof(atc_time_t));
+    int16 *years = calloc(count, sizeof(int16));
+    uint16 *zones = calloc(count, sizeof(uint16));
+
+    if ((times == NULL) || (years == NULL) || (zones == NULL)) {
+        return 1;
+    }
+
+    AtcLocalDateTime first = {BENCH_YEAR_START, 1, 1, 0, 0, 0, 0};
+    AtcLocalDateTime last = {BENCH_YEAR_START + BENCH_YEARS, 1, 1, 0, 0, 0, 0};
+    atc_time_t range_start = atc_local_date_time_to_epoch_seconds(&first);
+    atc_time_t range = atc_local_date_time_to_epoch_seconds(&last) - range_start;
+
+    srand(1);
+
+    for (uint32 i = 0; i < count; i++) {
+        AtcLocalDateTime utc;
+
+        times[i] = range_start + (atc_time_t)(((((uint64)rand()) << 16) ^ rand()) % (uint64)range);
+        zones[i] = rand() % kAtcZoneAndLinkRegistrySize;
+        atc_local_date_time_from_epoch_seconds(&utc, times[i]);
+        years[i] = utc.year;
+    }
+
+    AtcZoneProcessor processor;
+    AtcFindResult result;
+    int32 sink = 0;
+    uint64 lookup_ns[3];
+    const AtcZoneInfo *compiled = &kAtcZoneAmerica_Los_Angeles;
+
+    printf("%-16s | %12s | %12s | %12s |\n", "lookups", "zonedb", "in place", "copied");
+
+    // One zone, kept loaded over all the years
+    for (uint8 j = 0; j < 3; j++) {
+        if (j > 0) {
+            if (tz_db_load(&dbs[j - 1], compiled->zone_id, BENCH_YEAR_START, BENCH_YEAR_START + BENCH_YEARS,
+                           &bench_zone) != TZ_DB_SUCCESS) {
+                printf("FAIL: %s does not load for %d years\n", compiled->name, BENCH_YEARS);
+                return 1;
+            }
+        }
+
+        atc_processor_init(&processor);
+        atc_processor_init_for_zone_info(&processor, (j == 0) ? compiled : &bench_zone.info);
+
+        uint64 start = bench_ns();
+
+        for (uint32 i = 0; i < count; i++) {
+            atc_processor_find_by_epoch_seconds(&processor, times[i], &result);
+            sink += result.dst_offset_seconds;
+        }
+
+        lookup_ns[j] = bench_ns() - start;
+    }
+
+    printf("%-16s | %9.1f ns | %9.1f ns | %9.1f ns |\n", "same zone", (double)lookup_ns[0] / count,
+           (double)lookup_ns[1] / count, (double)lookup_ns[2] / count);
+
+    // A zone picked at random each time, reloaded from the database for the year
+    for (uint8 j = 0; j < 3; j++) {
+        uint64 start = bench_ns();
+
+        for (uint32 i = 0; i < count; i++) {
+            if (j == 0) {
+                atc_processor_init_for_zone_info(&processor, kAtcZoneAndLinkRegistry[zones[i]]);
+            } else {
+                tz_db_load(&dbs[j - 1], kAtcZoneAndLinkRegistry[zones[i]]->zone_id, years[i], years[i] + 1,
+                           &bench_zone);
+                atc_processor_init(&processor);
+                atc_processor_init_for_zone_info(&processor, &bench_zone.info);
+            }
+
+            atc_processor_find_by_epoch_seconds(&processor, times[i], &result);
+            sink += result.dst_offset_seconds;
+        }
+
+        lookup_ns[j] = bench_ns() - start;
+    }
+
+    printf("%-16s | %9.1f ns | %9.1f ns | %9.1f ns | (%d)\n", "switching zone", (double)lookup_ns[0] / count,
+           (double)lookup_ns[1] / count, (double)lookup_ns[2] / count, sink & 1);
+
+    free(times);
+    free(years);
+    free(zones);
+    munmap((void *)data, st.st_size);
+    close(fd);
+
+    return failed;
+}
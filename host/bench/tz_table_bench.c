@@ -0,0 +1,193 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: tz_table_bench.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host benchmark for the precomputed transition tables. Builds
+ * a table for every zone of kAtcZoneAndLinkRegistry over a range of years
+ * and reports its memory, then looks up timestamps of a few zones with the
+ * zone processor and with the table and checks that both agree. Samples
+ * alternating across a new year (A backlog straddling it) make the
+ * processor rebuild its window on every lookup.
+ *
+ * Usage: tz_table_bench [from year] [until year] [lookups]
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <time.h>
+
+#include "../../lib/wifi_conn/tz_table.h"
+
+// Constants ----------------------------------------------------------
+
+#define BENCH_ENTRIES 1024 // Most transitions of a table
+
+// --------------------------------------------------------------------
+
+static TzTableEntry bench_entries[BENCH_ENTRIES];
+
+/**
+ * Returns the monotonic time in nsec.
+ * @param none
+ * @return uint64 Time (in nsec)
+ */
+static uint64 bench_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/**
+ * Looks up a set of times of a zone with the processor and the table,
+ * checks the results and prints the cost per lookup.
+ * @param char *name Name of the set
+ * @param TzTable *table Table of the zone
+ * @param atc_time_t *times Times (AceTime epoch secs)
+ * @param uint32 count No of times
+ * @return int Success/Fail (Results differ)
+ */
+static int bench_lookup(const char *name, const TzTable *table, const atc_time_t *times, uint32 count) {
+    AtcZoneProcessor processor;
+    AtcFindResult result;
+    int32 sink = 0;
+
+    atc_processor_init(&processor);
+    atc_processor_init_for_zone_info(&processor, table->zone_info);
+
+    for (uint32 i = 0; i < count; i++) {
+        const TzTableEntry *entry = tz_table_find(table, times[i]);
+
+        atc_processor_find_by_epoch_seconds(&processor, times[i], &result);
+
+        if ((entry == NULL) || (entry->offset_seconds != result.std_offset_seconds) ||
+            (entry->delta_seconds != result.dst_offset_seconds) ||
+            (strcmp(table->abbrevs[entry->abbrev_index], result.abbrev) != 0)) {
+            printf("FAIL: %s at %d: table %d+%d, processor %d+%d %s\n", table->zone_info->name, times[i],
+                   entry ? entry->offset_seconds : 0, entry ? entry->delta_seconds : 0,
+                   result.std_offset_seconds, result.dst_offset_seconds, result.abbrev);
+            return 1;
+        }
+    }
+
+    atc_processor_init(&processor);
+    atc_processor_init_for_zone_info(&processor, table->zone_info);
+
+    uint64 start = bench_ns();
+
+    for (uint32 i = 0; i < count; i++) {
+        atc_processor_find_by_epoch_seconds(&processor, times[i], &result);
+        sink += result.dst_offset_seconds;
+    }
+
+    uint64 processor_ns = bench_ns() - start;
+
+    start = bench_ns();
+
+    for (uint32 i = 0; i < count; i++) {
+        sink += tz_table_find(table, times[i])->delta_seconds;
+    }
+
+    uint64 table_ns = bench_ns() - start;
+
+    printf("%-20s | %-9s | %9.1f ns | %9.1f ns | x%.0f (%d)\n", table->zone_info->name, name,
+           (double)processor_ns / count, (double)table_ns / count, (double)processor_ns / (table_ns ? table_ns : 1),
+           sink & 1);
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int16 from_year = (argc > 1) ? atoi(argv[1]) : 2000;
+    int16 until_year = (argc > 2) ? atoi(argv[2]) : 2050;
+    uint32 count = (argc > 3) ? atoi(argv[3]) : 200000;
+    const AtcZoneInfo *zones[] = {
+        &kAtcZoneAsia_Colombo,
+        &kAtcZoneAmerica_Los_Angeles,
+        &kAtcZoneEurope_London,
+        &kAtcZoneAustralia_Sydney,
+        &kAtcZonePacific_Apia
+    };
+    AtcZoneProcessor processor;
+    TzTable table;
+    uint32 total_bytes = 0;
+    uint32 max_count = 0;
+    const char *max_zone = "";
+    uint64 build_ns = 0;
+    int failed = 0;
+
+    atc_processor_init(&processor);
+
+    // Memory of a table per zone
+    for (uint32 i = 0; i < kAtcZoneAndLinkRegistrySize; i++) {
+        uint64 start = bench_ns();
+
+        if (!tz_table_build(&table, bench_entries, BENCH_ENTRIES, &processor, kAtcZoneAndLinkRegistry[i],
+                            from_year, until_year)) {
+            printf("FAIL: %s does not fit a table\n", kAtcZoneAndLinkRegistry[i]->name);
+            failed = 1;
+            continue;
+        }
+
+        build_ns += bench_ns() - start;
+        total_bytes += (table.count * sizeof(TzTableEntry)) + sizeof(TzTable);
+
+        if (table.count > max_count) {
+            max_count = table.count;
+            max_zone = kAtcZoneAndLinkRegistry[i]->name;
+        }
+    }
+
+    printf("%d-%d, entry %u bytes, table %u bytes + entries\n", from_year, until_year - 1,
+           (unsigned)sizeof(TzTableEntry), (unsigned)sizeof(TzTable));
+    printf("%d zones: %u bytes in total, %u on average, largest %s with %u transitions (%u bytes)\n",
+           kAtcZoneAndLinkRegistrySize, total_bytes, total_bytes / kAtcZoneAndLinkRegistrySize, max_zone, max_count,
+           (unsigned)((max_count * sizeof(TzTableEntry)) + sizeof(TzTable)));
+    printf("Build: %.1f us per zone\n\n", (double)build_ns / 1000 / kAtcZoneAndLinkRegistrySize);
+
+    atc_time_t *times = calloc(count, sizeof(atc_time_t));
+
+    if (times == NULL) {
+        return 1;
+    }
+
+    AtcLocalDateTime first = {from_year, 1, 1, 0, 0, 0, 0};
+    AtcLocalDateTime last = {until_year, 1, 1, 0, 0, 0, 0};
+    AtcLocalDateTime new_year = {(from_year + until_year) / 2, 1, 1, 0, 0, 0, 0};
+    atc_time_t range_start = atc_local_date_time_to_epoch_seconds(&first);
+    atc_time_t range = atc_local_date_time_to_epoch_seconds(&last) - range_start;
+    atc_time_t straddle = atc_local_date_time_to_epoch_seconds(&new_year);
+
+    printf("%-20s | %-9s | %12s | %12s |\n", "zone", "times", "processor", "table");
+
+    for (uint32 zone = 0; zone < (sizeof(zones) / sizeof(zones[0])); zone++) {
+        tz_table_build(&table, bench_entries, BENCH_ENTRIES, &processor, zones[zone], from_year, until_year);
+
+        // Backlog straddling the new year, alternating within a minute each side
+        for (uint32 i = 0; i < count; i++) {
+            times[i] = (i & 1) ? (straddle + (i % 60)) : (straddle - 1 - (i % 60));
+        }
+
+        failed |= bench_lookup("straddle", &table, times, count);
+
+        srand(1);
+
+        for (uint32 i = 0; i < count; i++) {
+            times[i] = range_start + (atc_time_t)(((((uint64)rand()) << 16) ^ rand()) % (uint64)range);
+        }
+
+        failed |= bench_lookup("random", &table, times, count);
+    }
+
+    free(times);
+
+    return failed;
+}
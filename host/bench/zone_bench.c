@@ -0,0 +1,195 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: zone_bench.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host benchmark for the fixed-offset fast path of the AceTime
+ * zone processor. Looks up every zone of kAtcZoneAndLinkRegistry in every
+ * year of a range, a new year each time so that the processor rebuilds its
+ * window, with find_by_epoch_seconds and find_by_local_date_time. Year
+ * windows with a single era without rules are timed apart from the rest.
+ * zone_bench_ref is the same bench built with ATC_FIXED_OFFSET_FAST_PATH 0,
+ * both must print the same checksum.
+ *
+ * Usage: zone_bench [rounds]
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <time.h>
+
+#include "esp_common.h"
+#include "../../lib/wifi_conn/acetime/acetimec.h"
+
+// Constants ----------------------------------------------------------
+
+#define BENCH_YEAR_START 2000 // First year looked up
+#define BENCH_YEARS 50 // No of years looked up
+
+// --------------------------------------------------------------------
+
+// Lookups of a group of year windows
+typedef struct {
+    const char *name;       // Name
+    uint32 windows;         // Year windows in the group
+    uint64 ns;              // Time spent (in nsec)
+} BenchGroup;
+
+static uint8 bench_fixed[kAtcZoneAndLinkRegistrySize][BENCH_YEARS]; // Window has a single era without rules
+static uint32 bench_checksum = 2166136261u;                         // FNV-1a of all results
+
+/**
+ * Returns the monotonic time in nsec.
+ * @param none
+ * @return uint64 Time (in nsec)
+ */
+static uint64 bench_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/**
+ * Adds bytes to the checksum.
+ * @param void *data Bytes
+ * @param uint32 length No of bytes
+ * @return none
+ */
+static void bench_hash(const void *data, uint32 length) {
+    const uint8 *bytes = data;
+
+    for (uint32 i = 0; i < length; i++) {
+        bench_checksum = (bench_checksum ^ bytes[i]) * 16777619u;
+    }
+}
+
+/**
+ * Adds a find result to the checksum.
+ * @param AtcFindResult *result Result
+ * @return none
+ */
+static void bench_hash_result(const AtcFindResult *result) {
+    int32 offsets[4] = {result->std_offset_seconds, result->dst_offset_seconds,
+                        result->req_std_offset_seconds, result->req_dst_offset_seconds};
+
+    bench_hash(&result->type, 1);
+    bench_hash(&result->fold, 1);
+    bench_hash(offsets, sizeof(offsets));
+
+    if (result->type != kAtcFindResultNotFound) {
+        bench_hash(result->abbrev, strlen(result->abbrev));
+    }
+}
+
+/**
+ * Finds which year windows have a single matching era without a zone
+ * policy, the same test the zone processor makes.
+ * @param none
+ * @return uint32 No of such windows
+ */
+static uint32 bench_classify() {
+    AtcMatchingEra matches[kAtcMaxMatches];
+    uint32 fixed = 0;
+
+    for (uint32 zone = 0; zone < kAtcZoneAndLinkRegistrySize; zone++) {
+        for (uint32 i = 0; i < BENCH_YEARS; i++) {
+            int16_t year = BENCH_YEAR_START + i;
+            AtcYearMonth start_ym = {year - 1, 12};
+            AtcYearMonth until_ym = {year + 1, 2};
+            uint8 count = atc_processor_find_matches(kAtcZoneAndLinkRegistry[zone], start_ym, until_ym,
+                                                     matches, kAtcMaxMatches);
+
+            bench_fixed[zone][i] = (count == 1) && (matches[0].era->zone_policy == NULL);
+            fixed += bench_fixed[zone][i];
+        }
+    }
+
+    return fixed;
+}
+
+/**
+ * Looks up every zone and year of a group, rebuilding the year window each
+ * time.
+ * @param AtcZoneProcessor *processor Zone processor
+ * @param BenchGroup *group Group
+ * @param uint8 fixed Group of the fixed windows
+ * @param uint8 hash Add the results to the checksum
+ * @return none
+ */
+static void bench_run(AtcZoneProcessor *processor, BenchGroup *group, uint8 fixed, uint8 hash) {
+    AtcFindResult result;
+    uint64 start = bench_ns();
+
+    for (uint32 zone = 0; zone < kAtcZoneAndLinkRegistrySize; zone++) {
+        atc_processor_init_for_zone_info(processor, kAtcZoneAndLinkRegistry[zone]);
+
+        for (uint32 i = 0; i < BENCH_YEARS; i++) {
+            if (bench_fixed[zone][i] != fixed) {
+                continue;
+            }
+
+            int16_t year = BENCH_YEAR_START + i;
+            AtcLocalDateTime mid_year = {year, 7, 1, 12, 0, 0, 0};
+            AtcLocalDateTime local = {year, 3, 15, 12, 0, 0, 0};
+
+            atc_processor_find_by_epoch_seconds(processor, atc_local_date_time_to_epoch_seconds(&mid_year), &result);
+
+            if (hash) {
+                bench_hash_result(&result);
+            }
+
+            atc_processor_find_by_local_date_time(processor, &local, &result);
+
+            if (hash) {
+                bench_hash_result(&result);
+            }
+
+            group->windows++;
+        }
+    }
+
+    group->ns += bench_ns() - start;
+}
+
+int main(int argc, char **argv) {
+    uint32 rounds = (argc > 1) ? atoi(argv[1]) : 20;
+    AtcZoneProcessor processor;
+    BenchGroup groups[2] = {{"fixed", 0, 0}, {"rules", 0, 0}};
+    uint32 fixed = bench_classify();
+
+    atc_processor_init(&processor);
+
+    printf("%d zones, %d-%d, fixed offset windows: %u of %u, fast path: %s\n", kAtcZoneAndLinkRegistrySize,
+           BENCH_YEAR_START, BENCH_YEAR_START + BENCH_YEARS - 1, fixed, kAtcZoneAndLinkRegistrySize * BENCH_YEARS,
+           ATC_FIXED_OFFSET_FAST_PATH ? "on" : "off");
+
+    for (uint32 round = 0; round < rounds; round++) {
+        bench_run(&processor, &groups[0], 1, round == 0);
+        bench_run(&processor, &groups[1], 0, round == 0);
+    }
+
+    printf("%-8s | %8s | %12s\n", "windows", "count", "ns/window");
+
+    uint64 total_ns = 0;
+    uint32 total_windows = 0;
+
+    for (uint32 i = 0; i < 2; i++) {
+        printf("%-8s | %8u | %12.1f\n", groups[i].name, groups[i].windows / rounds,
+               (double)groups[i].ns / (groups[i].windows ? groups[i].windows : 1));
+        total_ns += groups[i].ns;
+        total_windows += groups[i].windows;
+    }
+
+    printf("%-8s | %8u | %12.1f\n", "all", total_windows / rounds, (double)total_ns / total_windows);
+    printf("checksum %08x\n", bench_checksum);
+
+    return 0;
+}
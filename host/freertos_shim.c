@@ -0,0 +1,298 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: freertos_shim.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host implementation of the FreeRTOS 7.5 API used by the
+ * project (Ticks, delays, tasks, queues, semaphores and critical
+ * sections) on pthreads. One tick is one millisecond.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+// Queue state. Items are copied in and out of a ring of item_size slots.
+struct HostQueue {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    uint8 *items;
+    uint32 item_size;
+    uint32 length;
+    uint32 head;
+    uint32 count;
+};
+
+// Task start parameters
+struct HostTask {
+    pdTASK_CODE code;
+    void *parameters;
+};
+
+static pthread_mutex_t critical_lock;
+static pthread_once_t critical_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Creates the recursive mutex used for critical sections.
+ * @param none
+ * @return none
+ */
+static void host_critical_init(void) {
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&critical_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void vPortEnterCritical(void) {
+    pthread_once(&critical_once, host_critical_init);
+    pthread_mutex_lock(&critical_lock);
+}
+
+void vPortExitCritical(void) {
+    pthread_mutex_unlock(&critical_lock);
+}
+
+uint32 xPortGetFreeHeapSize(void) {
+    return 1 << 20; // Plenty, RAM_THRESHOLD never applies
+}
+
+// Tasks --------------------------------------------------------------
+
+portTickType xTaskGetTickCount(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (portTickType)((ts.tv_sec * 1000) + (ts.tv_nsec / 1000000));
+}
+
+portTickType xTaskGetTickCountFromISR(void) {
+    return xTaskGetTickCount();
+}
+
+void vTaskDelay(portTickType ticks) {
+    struct timespec ts = {ticks / 1000, (ticks % 1000) * 1000000L};
+
+    while (nanosleep(&ts, &ts) && (errno == EINTR));
+}
+
+/**
+ * Entry point of a task thread.
+ * @param void *arg Task start parameters
+ * @return void* NULL
+ */
+static void *host_task_entry(void *arg) {
+    struct HostTask task = *(struct HostTask *)arg;
+
+    free(arg);
+    task.code(task.parameters);
+
+    return NULL;
+}
+
+signed portBASE_TYPE xTaskCreate(pdTASK_CODE code, const char *name, uint16 stack_depth, void *parameters, unsigned portBASE_TYPE priority, xTaskHandle *handle) {
+    struct HostTask *task = malloc(sizeof(struct HostTask));
+    pthread_t thread;
+
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+
+    if (task == NULL) {
+        return pdFAIL;
+    }
+
+    task->code = code;
+    task->parameters = parameters;
+
+    if (pthread_create(&thread, NULL, host_task_entry, task)) {
+        free(task);
+        return pdFAIL;
+    }
+
+    pthread_detach(thread);
+
+    if (handle != NULL) {
+        *handle = (xTaskHandle)thread;
+    }
+
+    return pdPASS;
+}
+
+void vTaskDelete(xTaskHandle handle) {
+    if (handle == NULL) {
+        pthread_exit(NULL);
+    }
+
+    pthread_cancel((pthread_t)handle);
+}
+
+xTaskHandle xTaskGetCurrentTaskHandle(void) {
+    return (xTaskHandle)pthread_self();
+}
+
+// Queues -------------------------------------------------------------
+
+/**
+ * Converts a timeout in ticks to an absolute deadline.
+ * @param portTickType ticks Timeout
+ * @param struct timespec *deadline Pointer to store the deadline
+ * @return none
+ */
+static void host_deadline(portTickType ticks, struct timespec *deadline) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+
+    deadline->tv_sec += ticks / 1000;
+    deadline->tv_nsec += (ticks % 1000) * 1000000L;
+
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * Waits on a queue until the condition changes or the timeout expires.
+ * @param xQueueHandle queue Queue (Locked)
+ * @param portTickType ticks Timeout
+ * @param struct timespec *deadline Deadline
+ * @return int 0 if woken, non zero if timed out
+ */
+static int host_queue_wait(xQueueHandle queue, portTickType ticks, struct timespec *deadline) {
+    if (ticks == 0) {
+        return ETIMEDOUT;
+    }
+
+    if (ticks == portMAX_DELAY) {
+        return pthread_cond_wait(&queue->changed, &queue->lock);
+    }
+
+    return pthread_cond_timedwait(&queue->changed, &queue->lock, deadline);
+}
+
+xQueueHandle xQueueCreate(unsigned portBASE_TYPE length, unsigned portBASE_TYPE item_size) {
+    struct HostQueue *queue = calloc(1, sizeof(struct HostQueue));
+
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    queue->items = malloc((length * item_size) + 1);
+    queue->item_size = item_size;
+    queue->length = length;
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->changed, NULL);
+
+    return queue;
+}
+
+void vQueueDelete(xQueueHandle queue) {
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->changed);
+    free(queue->items);
+    free(queue);
+}
+
+signed portBASE_TYPE xQueueSendToBack(xQueueHandle queue, const void *item, portTickType ticks) {
+    struct timespec deadline;
+    signed portBASE_TYPE error = pdPASS;
+
+    host_deadline(ticks, &deadline);
+    pthread_mutex_lock(&queue->lock);
+
+    while (queue->count == queue->length) {
+        if (host_queue_wait(queue, ticks, &deadline)) {
+            error = errQUEUE_FULL;
+            break;
+        }
+    }
+
+    if (error == pdPASS) {
+        uint32 slot = (queue->head + queue->count) % queue->length;
+
+        if (queue->item_size > 0) {
+            memcpy(queue->items + (slot * queue->item_size), item, queue->item_size);
+        }
+
+        queue->count++;
+        pthread_cond_broadcast(&queue->changed);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return error;
+}
+
+signed portBASE_TYPE xQueueSendToBackFromISR(xQueueHandle queue, const void *item, signed portBASE_TYPE *woken) {
+    if (woken != NULL) {
+        *woken = pdFALSE;
+    }
+
+    return xQueueSendToBack(queue, item, 0);
+}
+
+signed portBASE_TYPE xQueueReceive(xQueueHandle queue, void *item, portTickType ticks) {
+    struct timespec deadline;
+    signed portBASE_TYPE error = pdPASS;
+
+    host_deadline(ticks, &deadline);
+    pthread_mutex_lock(&queue->lock);
+
+    while (queue->count == 0) {
+        if (host_queue_wait(queue, ticks, &deadline)) {
+            error = errQUEUE_EMPTY;
+            break;
+        }
+    }
+
+    if (error == pdPASS) {
+        if (queue->item_size > 0) {
+            memcpy(item, queue->items + (queue->head * queue->item_size), queue->item_size);
+        }
+
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        pthread_cond_broadcast(&queue->changed);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return error;
+}
+
+unsigned portBASE_TYPE uxQueueMessagesWaiting(xQueueHandle queue) {
+    pthread_mutex_lock(&queue->lock);
+    unsigned portBASE_TYPE count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+
+    return count;
+}
+
+// Semaphores ---------------------------------------------------------
+
+xSemaphoreHandle xSemaphoreCreateMutex(void) {
+    xSemaphoreHandle mutex = xQueueCreate(1, 0);
+
+    if (mutex != NULL) {
+        xSemaphoreGive(mutex);
+    }
+
+    return mutex;
+}
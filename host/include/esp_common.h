@@ -0,0 +1,48 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: esp_common.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host stand-in for the ESP8266 SDK header. Provides the SDK
+ * types so that platform independent modules build on a Linux host.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef HOST_ESP_COMMON_H
+#define HOST_ESP_COMMON_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t uint8;
+typedef int8_t int8;
+typedef uint16_t uint16;
+typedef int16_t int16;
+typedef uint32_t uint32;
+typedef int32_t int32;
+typedef uint64_t uint64;
+typedef int64_t int64;
+typedef int64_t sint64;
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+#define ICACHE_FLASH_ATTR
+
+// SDK hardware random number
+static inline unsigned long os_random(void) {
+    return (unsigned long)random();
+}
+
+#endif
@@ -0,0 +1,34 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: FreeRTOS.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host stand-in for the FreeRTOS 7.5 API used by the
+ * project, implemented on pthreads (host/freertos_shim.c).
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include "esp_common.h"
+#include "freertos/portmacro.h"
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+
+#define errQUEUE_EMPTY 0
+#define errQUEUE_FULL 0
+
+uint32 xPortGetFreeHeapSize(void);
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: portmacro.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host stand-in for the FreeRTOS port layer. One tick is one
+ * millisecond and critical sections are a global recursive mutex.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef HOST_PORTMACRO_H
+#define HOST_PORTMACRO_H
+
+#include "esp_common.h"
+
+#define portBASE_TYPE long
+#define portSTACK_TYPE uint32
+#define portMAX_DELAY 0xFFFFFFFF
+#define portTICK_RATE_MS 1
+
+typedef uint32 portTickType;
+
+void vPortEnterCritical(void);
+void vPortExitCritical(void);
+
+#define portENTER_CRITICAL() vPortEnterCritical()
+#define portEXIT_CRITICAL() vPortExitCritical()
+#define portSET_INTERRUPT_MASK_FROM_ISR() (vPortEnterCritical(), 0)
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(mask) ((void)(mask), vPortExitCritical())
+
+#endif
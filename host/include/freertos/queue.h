@@ -0,0 +1,33 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: queue.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host stand-in for the FreeRTOS queue API.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef HOST_QUEUE_H
+#define HOST_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct HostQueue *xQueueHandle;
+
+xQueueHandle xQueueCreate(unsigned portBASE_TYPE length, unsigned portBASE_TYPE item_size);
+void vQueueDelete(xQueueHandle queue);
+signed portBASE_TYPE xQueueSendToBack(xQueueHandle queue, const void *item, portTickType ticks);
+signed portBASE_TYPE xQueueSendToBackFromISR(xQueueHandle queue, const void *item, signed portBASE_TYPE *woken);
+signed portBASE_TYPE xQueueReceive(xQueueHandle queue, void *item, portTickType ticks);
+unsigned portBASE_TYPE uxQueueMessagesWaiting(xQueueHandle queue);
+
+#define xQueueSend(queue, item, ticks) xQueueSendToBack(queue, item, ticks)
+
+#endif
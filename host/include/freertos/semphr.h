@@ -0,0 +1,37 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: semphr.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host stand-in for the FreeRTOS semaphore API. As on
+ * FreeRTOS, semaphores are queues of empty items.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef HOST_SEMPHR_H
+#define HOST_SEMPHR_H
+
+#include "freertos/queue.h"
+
+typedef xQueueHandle xSemaphoreHandle;
+
+xSemaphoreHandle xSemaphoreCreateMutex(void);
+
+#define vSemaphoreCreateBinary(sem) \
+    do { \
+        (sem) = xQueueCreate(1, 0); \
+        xQueueSendToBack((sem), NULL, 0); \
+    } while (0)
+
+#define xSemaphoreTake(sem, ticks) xQueueReceive((sem), NULL, (ticks))
+#define xSemaphoreGive(sem) xQueueSendToBack((sem), NULL, 0)
+#define xSemaphoreGiveFromISR(sem, woken) xQueueSendToBackFromISR((sem), NULL, (woken))
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: task.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Host stand-in for the FreeRTOS task API. Tasks are
+ * pthreads.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *xTaskHandle;
+typedef void (*pdTASK_CODE)(void *);
+
+#define taskENTER_CRITICAL() portENTER_CRITICAL()
+#define taskEXIT_CRITICAL() portEXIT_CRITICAL()
+
+portTickType xTaskGetTickCount(void);
+portTickType xTaskGetTickCountFromISR(void);
+void vTaskDelay(portTickType ticks);
+signed portBASE_TYPE xTaskCreate(pdTASK_CODE code, const char *name, uint16 stack_depth, void *parameters, unsigned portBASE_TYPE priority, xTaskHandle *handle);
+void vTaskDelete(xTaskHandle handle);
+xTaskHandle xTaskGetCurrentTaskHandle(void);
+
+#endif
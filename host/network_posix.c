@@ -0,0 +1,270 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: network_posix.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: POSIX socket implementation of the Paho network and timer
+ * interface (paho/MQTTESP8266.h) for the host build. Replaces
+ * MQTTESP8266.c, which needs lwIP.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "paho/MQTTESP8266.h"
+
+// Timer --------------------------------------------------------------
+
+char expired(Timer *timer) {
+    int32_t left = timer->end_time - xTaskGetTickCount();
+
+    return (left < 0);
+}
+
+void countdown_ms(Timer *timer, unsigned int timeout) {
+    timer->end_time = xTaskGetTickCount() + (timeout / portTICK_RATE_MS);
+}
+
+void countdown(Timer *timer, unsigned int timeout) {
+    countdown_ms(timer, timeout * 1000);
+}
+
+int left_ms(Timer *timer) {
+    int32_t left = timer->end_time - xTaskGetTickCount();
+
+    return (left < 0) ? 0 : (left * portTICK_RATE_MS);
+}
+
+void InitTimer(Timer *timer) {
+    timer->end_time = 0;
+}
+
+// Network ------------------------------------------------------------
+
+/**
+ * Copies up to len bytes from the receive buffer.
+ * @param Network *n Network
+ * @param unsigned char *buffer Buffer
+ * @param int len Length
+ * @return int Bytes copied
+ */
+int mqtt_esp_buffered(Network *n, unsigned char *buffer, int len) {
+    int avail = n->rxtail - n->rxhead;
+
+    if (len > avail) {
+        len = avail;
+    }
+
+    if (len > 0) {
+        memcpy(buffer, n->rxbuf + n->rxhead, len);
+        n->rxhead += len;
+    }
+
+    if (n->rxhead == n->rxtail) {
+        n->rxhead = n->rxtail = 0;
+    }
+
+    return len;
+}
+
+/**
+ * Reads len bytes, from the receive buffer first and then the socket.
+ * Paho expects a read to return the whole length, so short reads are
+ * continued until the timeout. Same buffering as MQTTESP8266.c.
+ * @param Network *n Network
+ * @param unsigned char *buffer Buffer
+ * @param int len Length
+ * @param int timeout_ms Timeout
+ * @return int Bytes read, MQTT_NET_TIMEOUT if nothing arrived in time or
+ * MQTT_NET_CLOSED if the socket is closed
+ */
+int mqtt_esp_read(Network *n, unsigned char *buffer, int len, int timeout_ms) {
+    Timer timer;
+    int rcvd = 0;
+    int closed = 0;
+
+    n->stats.reads++;
+    rcvd = mqtt_esp_buffered(n, buffer, len);
+
+    if (rcvd == len) {
+        n->stats.buffered++;
+        return rcvd;
+    }
+
+    countdown_ms(&timer, timeout_ms);
+
+    while (rcvd < len) {
+        struct pollfd fd = {n->my_socket, POLLIN, 0};
+        int rc;
+
+        n->stats.selects++;
+
+        int ready = poll(&fd, 1, left_ms(&timer));
+
+        if (ready < 0) {
+            // Socket error
+            closed = 1;
+            break;
+        } else if (ready == 0) {
+            // Timeout
+            break;
+        }
+
+        n->stats.recvs++;
+
+        if ((len - rcvd) >= MQTT_RX_BUFFER_SIZE) {
+            rc = recv(n->my_socket, buffer + rcvd, len - rcvd, 0);
+
+            if (rc <= 0) {
+                // Closed by the broker or socket error
+                closed = 1;
+                break;
+            }
+
+            rcvd += rc;
+        } else {
+            rc = recv(n->my_socket, n->rxbuf, MQTT_RX_BUFFER_SIZE, 0);
+
+            if (rc <= 0) {
+                closed = 1;
+                break;
+            }
+
+            n->rxtail = rc;
+            rcvd += mqtt_esp_buffered(n, buffer + rcvd, len - rcvd);
+        }
+
+        n->stats.bytes += rc;
+    }
+
+    // Bytes that arrived before a close are returned, the next read reports it
+    if (rcvd > 0) {
+        return rcvd;
+    }
+
+    return closed ? MQTT_NET_CLOSED : MQTT_NET_TIMEOUT;
+}
+
+/**
+ * Writes len bytes to the socket.
+ * @param Network *n Network
+ * @param unsigned char *buffer Data
+ * @param int len Length
+ * @param int timeout_ms Timeout
+ * @return int Bytes written, -1 on error
+ */
+int mqtt_esp_write(Network *n, unsigned char *buffer, int len, int timeout_ms) {
+    struct pollfd fd = {n->my_socket, POLLOUT, 0};
+
+    if (poll(&fd, 1, timeout_ms) <= 0) {
+        return -1;
+    }
+
+    return send(n->my_socket, buffer, len, MSG_NOSIGNAL);
+}
+
+/**
+ * Writes the segments with one sendmsg().
+ * @param Network *n Network
+ * @param NetworkSegment *segments Segments
+ * @param int count No of segments
+ * @param int timeout_ms Timeout
+ * @return int Bytes written, -1 on error
+ */
+int mqtt_esp_writev(Network *n, NetworkSegment *segments, int count, int timeout_ms) {
+    struct pollfd fd = {n->my_socket, POLLOUT, 0};
+    struct iovec iov[count];
+    struct msghdr msg = {0};
+
+    if (poll(&fd, 1, timeout_ms) <= 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        iov[i].iov_base = segments[i].data;
+        iov[i].iov_len = segments[i].len;
+    }
+
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+
+    return sendmsg(n->my_socket, &msg, MSG_NOSIGNAL);
+}
+
+void mqtt_esp_disconnect(Network *n) {
+    DisconnectNetwork(n);
+}
+
+void NewNetwork(Network *n) {
+    n->my_socket = -1;
+    n->mqttread = mqtt_esp_read;
+    n->mqttwrite = mqtt_esp_write;
+    n->mqttwritev = mqtt_esp_writev;
+    n->rxhead = n->rxtail = 0;
+    memset(&n->stats, 0, sizeof(n->stats));
+}
+
+int ConnectNetwork(Network *n, const char *host, int port) {
+    struct addrinfo hints = {0};
+    struct addrinfo *result = NULL;
+    char service[8];
+    int one = 1;
+
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(service, sizeof(service), "%d", port);
+
+    if (getaddrinfo(host, service, &hints, &result) != 0) {
+        return -1;
+    }
+
+    n->my_socket = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+
+    if (n->my_socket < 0) {
+        freeaddrinfo(result);
+        return -1;
+    }
+
+    // Small MQTT packets must not wait on Nagle
+    setsockopt(n->my_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    int ret = connect(n->my_socket, result->ai_addr, result->ai_addrlen);
+
+    freeaddrinfo(result);
+
+    if (ret < 0) {
+        close(n->my_socket);
+        n->my_socket = -1;
+    }
+
+    return ret;
+}
+
+int DisconnectNetwork(Network *n) {
+    if (n->my_socket >= 0) {
+        close(n->my_socket);
+    }
+
+    n->my_socket = -1;
+    n->rxhead = n->rxtail = 0;
+
+    return 0;
+}
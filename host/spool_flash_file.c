@@ -0,0 +1,184 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: spool_flash_file.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: File backed spool flash for running the MQTT spool on a
+ * Linux host.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "spool_flash_file.h"
+
+// File flash state
+struct SpoolFlashFile {
+    int fd;                             // Backing file
+    uint8 *scratch;                     // One sector
+    struct SpoolFlashFileStats stats;   // Counters
+};
+
+/**
+ * Reads from the file.
+ * @param struct SpoolFlash *flash Flash
+ * @param uint32 addr Address
+ * @param void *data Buffer
+ * @param uint32 len Length
+ * @return int Success/Fail
+ */
+static int spool_flash_file_read(struct SpoolFlash *flash, uint32 addr, void *data, uint32 len) {
+    struct SpoolFlashFile *file = (struct SpoolFlashFile *)flash->context;
+
+    if ((addr + len) > (flash->sector_size * flash->sector_count)) {
+        return 1;
+    }
+
+    return pread(file->fd, data, len, addr) != (ssize_t)len;
+}
+
+/**
+ * Writes to the file. Like NOR flash, a write can only clear bits, so
+ * the data is ANDed with what is already there. Writes must be word
+ * aligned, as on the device.
+ * @param struct SpoolFlash *flash Flash
+ * @param uint32 addr Address
+ * @param void *data Data
+ * @param uint32 len Length
+ * @return int Success/Fail
+ */
+static int spool_flash_file_write(struct SpoolFlash *flash, uint32 addr, const void *data, uint32 len) {
+    struct SpoolFlashFile *file = (struct SpoolFlashFile *)flash->context;
+    const uint8 *bytes = (const uint8 *)data;
+
+    if ((addr & 3) || (len & 3) || ((addr + len) > (flash->sector_size * flash->sector_count)) || (len > flash->sector_size)) {
+        return 1;
+    }
+
+    if (pread(file->fd, file->scratch, len, addr) != (ssize_t)len) {
+        return 1;
+    }
+
+    for (uint32 i = 0; i < len; i++) {
+        file->scratch[i] &= bytes[i];
+    }
+
+    file->stats.bytes_written += len;
+    file->stats.writes++;
+
+    return pwrite(file->fd, file->scratch, len, addr) != (ssize_t)len;
+}
+
+/**
+ * Erases a sector of the file to 0xFF.
+ * @param struct SpoolFlash *flash Flash
+ * @param uint32 sector Sector
+ * @return int Success/Fail
+ */
+static int spool_flash_file_erase(struct SpoolFlash *flash, uint32 sector) {
+    struct SpoolFlashFile *file = (struct SpoolFlashFile *)flash->context;
+
+    if (sector >= flash->sector_count) {
+        return 1;
+    }
+
+    memset(file->scratch, 0xFF, flash->sector_size);
+    file->stats.sector_erases[sector]++;
+
+    return pwrite(file->fd, file->scratch, flash->sector_size, sector * flash->sector_size) != (ssize_t)flash->sector_size;
+}
+
+/**
+ * Opens (Or creates as erased flash) a file backed spool flash.
+ * @param struct SpoolFlash *flash Flash to set up
+ * @param char *path Backing file
+ * @param uint32 sector_size Sector size (in bytes)
+ * @param uint32 sector_count No of sectors
+ * @return int Success/Fail
+ */
+int spool_flash_file_open(struct SpoolFlash *flash, const char *path, uint32 sector_size, uint32 sector_count) {
+    struct SpoolFlashFile *file = calloc(1, sizeof(struct SpoolFlashFile));
+    off_t size = (off_t)sector_size * sector_count;
+
+    if (file == NULL) {
+        return 1;
+    }
+
+    file->fd = open(path, O_RDWR | O_CREAT, 0644);
+    file->scratch = malloc(sector_size);
+    file->stats.sector_erases = calloc(sector_count, sizeof(uint32));
+
+    if ((file->fd < 0) || (file->scratch == NULL) || (file->stats.sector_erases == NULL)) {
+        return 1;
+    }
+
+    flash->sector_size = sector_size;
+    flash->sector_count = sector_count;
+    flash->read = spool_flash_file_read;
+    flash->write = spool_flash_file_write;
+    flash->erase = spool_flash_file_erase;
+    flash->first_sector = 0;
+    flash->context = file;
+
+    // A new file starts out erased
+    if (lseek(file->fd, 0, SEEK_END) < size) {
+        memset(file->scratch, 0xFF, sector_size);
+
+        for (uint32 i = 0; i < sector_count; i++) {
+            if (pwrite(file->fd, file->scratch, sector_size, (off_t)i * sector_size) != (ssize_t)sector_size) {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Returns the counters of a file flash.
+ * @param struct SpoolFlash *flash Flash
+ * @return struct SpoolFlashFileStats* Counters
+ */
+struct SpoolFlashFileStats *spool_flash_file_stats(struct SpoolFlash *flash) {
+    return &((struct SpoolFlashFile *)flash->context)->stats;
+}
+
+/**
+ * Closes a file flash.
+ * @param struct SpoolFlash *flash Flash
+ * @return none
+ */
+void spool_flash_file_close(struct SpoolFlash *flash) {
+    struct SpoolFlashFile *file = (struct SpoolFlashFile *)flash->context;
+
+    close(file->fd);
+    free(file->scratch);
+    free(file->stats.sector_erases);
+    free(file);
+    flash->context = NULL;
+}
+
+/**
+ * Host version of the SPI flash backend. The spool sectors are kept in
+ * SPOOL_FLASH_FILE in the working directory.
+ * @param struct SpoolFlash *flash Flash to set up
+ * @param uint32 first_sector First flash sector
+ * @param uint32 sector_count No of sectors
+ * @return int Success/Fail
+ */
+uint8 mqtt_spool_flash_init(struct SpoolFlash *flash, uint32 first_sector, uint32 sector_count) {
+    if ((first_sector == 0) || (sector_count < 2) ||
+        spool_flash_file_open(flash, SPOOL_FLASH_FILE, SPOOL_FLASH_SECTOR_SIZE, sector_count)) {
+        return MQTT_SPOOL_FLASH_ERROR;
+    }
+
+    return MQTT_SPOOL_SUCCESS;
+}
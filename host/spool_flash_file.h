@@ -0,0 +1,38 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: spool_flash_file.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: File backed spool flash for running the MQTT spool on a
+ * Linux host. Behaves like NOR flash: erase sets every byte to 0xFF and
+ * a write can only clear bits.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef SPOOL_FLASH_FILE_H
+#define SPOOL_FLASH_FILE_H
+
+#include "mqtt_spool.h"
+
+#define SPOOL_FLASH_FILE "lihini_spool.bin" // Backing file of mqtt_spool_flash_init()
+#define SPOOL_FLASH_SECTOR_SIZE 4096 // Sector size of the device flash
+
+// Counters of the file flash
+struct SpoolFlashFileStats {
+    uint32 *sector_erases;  // Erases per sector
+    uint64 bytes_written;   // Bytes programmed
+    uint32 writes;          // Write calls
+};
+
+int spool_flash_file_open(struct SpoolFlash *flash, const char *path, uint32 sector_size, uint32 sector_count);
+struct SpoolFlashFileStats *spool_flash_file_stats(struct SpoolFlash *flash);
+void spool_flash_file_close(struct SpoolFlash *flash);
+
+#endif
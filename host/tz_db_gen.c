@@ -0,0 +1,347 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: tz_db_gen.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Generates a binary zone database (tz_db.h) from the zonedb
+ * compiled in, for every zone or the given zones and the targets of their
+ * links. Prints the size of each section and of the same records as
+ * zonedb structs on a 32-bit target.
+ *
+ * Usage: tz_db_gen <file> [zone name ...]
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "../lib/wifi_conn/tz_db.h"
+
+// Constants ----------------------------------------------------------
+
+#define GEN_ZONES 1024 // Most zones
+#define GEN_ERAS 2048 // Most eras
+#define GEN_POLICIES 256 // Most policies
+#define GEN_RULES 2048 // Most rules
+#define GEN_STRINGS 65536 // Most string bytes (String offsets are 16 bits)
+
+// Record sizes (in bytes) of the zonedb structs on 32-bit targets
+#define GEN_STRUCT_CONTEXT 24
+#define GEN_STRUCT_INFO 24
+#define GEN_STRUCT_ERA 20
+#define GEN_STRUCT_POLICY 8
+#define GEN_STRUCT_RULE 12
+#define GEN_STRUCT_POINTER 4
+
+// --------------------------------------------------------------------
+
+static const AtcZoneInfo *gen_zones[GEN_ZONES];
+static const AtcZonePolicy *gen_policies[GEN_POLICIES];
+static TzDbZoneRecord gen_zone_records[GEN_ZONES];
+static TzDbEraRecord gen_era_records[GEN_ERAS];
+static TzDbPolicyRecord gen_policy_records[GEN_POLICIES];
+static TzDbRuleRecord gen_rule_records[GEN_RULES];
+static uint16 gen_letters[TZ_DB_LETTERS];
+static char gen_strings[GEN_STRINGS];
+static uint32 gen_strings_used = 0;
+static uint16 gen_zone_count = 0;
+static uint16 gen_era_count = 0;
+static uint16 gen_policy_count = 0;
+static uint16 gen_rule_count = 0;
+static uint32 gen_format_bytes = 0; // Distinct formats, as the zonedb structs store them
+
+/**
+ * Adds a string to the string pool, once.
+ * @param char *string String
+ * @return uint16 String offset
+ */
+static uint16 gen_string(const char *string) {
+    uint32 offset = 0;
+
+    while (offset < gen_strings_used) {
+        if (strcmp(gen_strings + offset, string) == 0) {
+            return offset;
+        }
+
+        offset += strlen(gen_strings + offset) + 1;
+    }
+
+    uint32 len = strlen(string) + 1;
+
+    if ((gen_strings_used + len) > GEN_STRINGS) {
+        fprintf(stderr, "Strings do not fit 16 bit offsets\n");
+        exit(1);
+    }
+
+    memcpy(gen_strings + gen_strings_used, string, len);
+    gen_strings_used += len;
+
+    return offset;
+}
+
+/**
+ * Adds a zone, once.
+ * @param AtcZoneInfo *zone_info Zone
+ * @return none
+ */
+static void gen_add_zone(const AtcZoneInfo *zone_info) {
+    for (uint16 i = 0; i < gen_zone_count; i++) {
+        if (gen_zones[i] == zone_info) {
+            return;
+        }
+    }
+
+    if (gen_zone_count == GEN_ZONES) {
+        fprintf(stderr, "Too many zones\n");
+        exit(1);
+    }
+
+    gen_zones[gen_zone_count++] = zone_info;
+}
+
+/**
+ * Adds a policy and its rules, once.
+ * @param AtcZonePolicy *policy Policy
+ * @return uint16 Policy index
+ */
+static uint16 gen_add_policy(const AtcZonePolicy *policy) {
+    for (uint16 i = 0; i < gen_policy_count; i++) {
+        if (gen_policies[i] == policy) {
+            return i;
+        }
+    }
+
+    if ((gen_policy_count == GEN_POLICIES) || ((gen_rule_count + policy->num_rules) > GEN_RULES)) {
+        fprintf(stderr, "Too many policies\n");
+        exit(1);
+    }
+
+    TzDbPolicyRecord *record = &gen_policy_records[gen_policy_count];
+    record->rule_index = gen_rule_count;
+    record->num_rules = policy->num_rules;
+
+    for (uint8 i = 0; i < policy->num_rules; i++) {
+        const AtcZoneRule *rule = &policy->rules[i];
+        TzDbRuleRecord *r = &gen_rule_records[gen_rule_count++];
+
+        r->from_year = rule->from_year;
+        r->to_year = rule->to_year;
+        r->at_time_code = rule->at_time_code;
+        r->in_month = rule->in_month;
+        r->on_day_of_week = rule->on_day_of_week;
+        r->on_day_of_month = rule->on_day_of_month;
+        r->at_time_modifier = rule->at_time_modifier;
+        r->delta_minutes = rule->delta_minutes;
+        r->letter_index = rule->letter_index;
+    }
+
+    gen_policies[gen_policy_count] = policy;
+
+    return gen_policy_count++;
+}
+
+/**
+ * Returns the record index of a zone.
+ * @param AtcZoneInfo *zone_info Zone
+ * @return uint16 Index
+ */
+static uint16 gen_zone_index(const AtcZoneInfo *zone_info) {
+    for (uint16 i = 0; i < gen_zone_count; i++) {
+        if (gen_zones[i] == zone_info) {
+            return i;
+        }
+    }
+
+    return TZ_DB_NONE;
+}
+
+/**
+ * Orders zones by zone ID.
+ * @param void *a Zone
+ * @param void *b Zone
+ * @return int Order
+ */
+static int gen_compare(const void *a, const void *b) {
+    uint32 id_a = (*(const AtcZoneInfo * const *)a)->zone_id;
+    uint32 id_b = (*(const AtcZoneInfo * const *)b)->zone_id;
+
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+/**
+ * Returns an offset rounded up to a word.
+ * @param uint32 offset Offset
+ * @return uint32 Aligned offset
+ */
+static uint32 gen_align(uint32 offset) {
+    return (offset + 3) & ~3u;
+}
+
+int main(int argc, char **argv) {
+    const AtcZoneContext *context = &kAtcZoneContext;
+    uint32 struct_bytes = GEN_STRUCT_CONTEXT;
+    TzDbHeader header = {0};
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file> [zone name ...]\n", argv[0]);
+        return 1;
+    }
+
+    if (context->num_letters > TZ_DB_LETTERS) {
+        fprintf(stderr, "%d letters do not fit TZ_DB_LETTERS\n", context->num_letters);
+        return 1;
+    }
+
+    // Zones, and the targets of links
+    for (uint32 i = 0; i < kAtcZoneAndLinkRegistrySize; i++) {
+        const AtcZoneInfo *zone_info = kAtcZoneAndLinkRegistry[i];
+        uint8 selected = (argc == 2);
+
+        for (int arg = 2; arg < argc; arg++) {
+            selected |= (strcmp(zone_info->name, argv[arg]) == 0);
+        }
+
+        if (selected) {
+            gen_add_zone(zone_info);
+
+            if (zone_info->target_info != NULL) {
+                gen_add_zone(zone_info->target_info);
+            }
+        }
+    }
+
+    if (gen_zone_count < (argc - 2)) {
+        fprintf(stderr, "Unknown zone\n");
+        return 1;
+    }
+
+    qsort(gen_zones, gen_zone_count, sizeof(gen_zones[0]), gen_compare);
+
+    // Letters first, as zonedb has them
+    for (uint8 i = 0; i < context->num_letters; i++) {
+        gen_letters[i] = gen_string(context->letters[i]);
+        struct_bytes += GEN_STRUCT_POINTER + strlen(context->letters[i]) + 1;
+    }
+
+    header.tz_version = gen_string(context->tz_version);
+
+    // Eras of the zones, links reuse their target's
+    for (uint16 i = 0; i < gen_zone_count; i++) {
+        const AtcZoneInfo *zone_info = gen_zones[i];
+        TzDbZoneRecord *record = &gen_zone_records[i];
+
+        record->zone_id = zone_info->zone_id;
+        record->name = gen_string(zone_info->name);
+        record->num_eras = zone_info->num_eras;
+        record->target = TZ_DB_NONE;
+        struct_bytes += GEN_STRUCT_INFO + GEN_STRUCT_POINTER + strlen(zone_info->name) + 1;
+
+        if (zone_info->target_info != NULL) {
+            record->target = gen_zone_index(zone_info->target_info);
+            continue;
+        }
+
+        if ((gen_era_count + zone_info->num_eras) > GEN_ERAS) {
+            fprintf(stderr, "Too many eras\n");
+            return 1;
+        }
+
+        record->era_index = gen_era_count;
+
+        for (uint8 e = 0; e < zone_info->num_eras; e++) {
+            const AtcZoneEra *era = &zone_info->eras[e];
+            TzDbEraRecord *r = &gen_era_records[gen_era_count];
+            uint8 distinct = TRUE;
+
+            r->policy = (era->zone_policy != NULL) ? gen_add_policy(era->zone_policy) : TZ_DB_NONE;
+            r->format = gen_string(era->format);
+            r->offset_code = era->offset_code;
+            r->until_year = era->until_year;
+            r->until_time_code = era->until_time_code;
+            r->offset_remainder = era->offset_remainder;
+            r->delta_minutes = era->delta_minutes;
+            r->until_month = era->until_month;
+            r->until_day = era->until_day;
+            r->until_time_modifier = era->until_time_modifier;
+
+            // Equal strings share an offset
+            for (uint16 j = 0; distinct && (j < gen_era_count); j++) {
+                distinct = (gen_era_records[j].format != r->format);
+            }
+
+            if (distinct) {
+                gen_format_bytes += strlen(era->format) + 1;
+            }
+
+            gen_era_count++;
+        }
+    }
+
+    for (uint16 i = 0; i < gen_zone_count; i++) {
+        if (gen_zone_records[i].target != TZ_DB_NONE) {
+            gen_zone_records[i].era_index = gen_zone_records[gen_zone_records[i].target].era_index;
+        }
+    }
+
+    struct_bytes += (gen_era_count * GEN_STRUCT_ERA) + (gen_policy_count * GEN_STRUCT_POLICY) +
+                    (gen_rule_count * GEN_STRUCT_RULE) + gen_format_bytes;
+
+    header.magic = TZ_DB_MAGIC;
+    header.version = TZ_DB_VERSION;
+    header.zone_count = gen_zone_count;
+    header.era_count = gen_era_count;
+    header.policy_count = gen_policy_count;
+    header.rule_count = gen_rule_count;
+    header.letter_count = context->num_letters;
+    header.start_year = context->start_year;
+    header.until_year = context->until_year;
+    header.start_year_accurate = context->start_year_accurate;
+    header.until_year_accurate = context->until_year_accurate;
+    header.max_transitions = context->max_transitions;
+    header.zones = gen_align(sizeof(TzDbHeader));
+    header.eras = gen_align(header.zones + (gen_zone_count * sizeof(TzDbZoneRecord)));
+    header.policies = gen_align(header.eras + (gen_era_count * sizeof(TzDbEraRecord)));
+    header.rules = gen_align(header.policies + (gen_policy_count * sizeof(TzDbPolicyRecord)));
+    header.letters = gen_align(header.rules + (gen_rule_count * sizeof(TzDbRuleRecord)));
+    header.strings = header.letters + (context->num_letters * sizeof(uint16));
+    header.size = gen_align(header.strings + gen_strings_used);
+
+    uint8 *image = calloc(1, header.size);
+
+    if (image == NULL) {
+        return 1;
+    }
+
+    memcpy(image, &header, sizeof(TzDbHeader));
+    memcpy(image + header.zones, gen_zone_records, gen_zone_count * sizeof(TzDbZoneRecord));
+    memcpy(image + header.eras, gen_era_records, gen_era_count * sizeof(TzDbEraRecord));
+    memcpy(image + header.policies, gen_policy_records, gen_policy_count * sizeof(TzDbPolicyRecord));
+    memcpy(image + header.rules, gen_rule_records, gen_rule_count * sizeof(TzDbRuleRecord));
+    memcpy(image + header.letters, gen_letters, context->num_letters * sizeof(uint16));
+    memcpy(image + header.strings, gen_strings, gen_strings_used);
+
+    FILE *file = fopen(argv[1], "wb");
+
+    if ((file == NULL) || (fwrite(image, 1, header.size, file) != header.size) || fclose(file)) {
+        fprintf(stderr, "Could not write %s\n", argv[1]);
+        return 1;
+    }
+
+    free(image);
+
+    printf("%-8s | %6s | %8s\n", "section", "count", "bytes");
+    printf("%-8s | %6d | %8u\n", "header", 1, (unsigned)sizeof(TzDbHeader));
+    printf("%-8s | %6d | %8u\n", "zones", gen_zone_count, header.eras - header.zones);
+    printf("%-8s | %6d | %8u\n", "eras", gen_era_count, header.policies - header.eras);
+    printf("%-8s | %6d | %8u\n", "policies", gen_policy_count, header.rules - header.policies);
+    printf("%-8s | %6d | %8u\n", "rules", gen_rule_count, header.letters - header.rules);
+    printf("%-8s | %6d | %8u\n", "letters", context->num_letters, header.strings - header.letters);
+    printf("%-8s | %6s | %8u\n", "strings", "", header.size - header.strings);
+    printf("%s: %u bytes, %u as zonedb structs (32-bits)\n", argv[1], header.size, struct_bytes);
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: tz_table_gen.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Generates the precomputed transition table of a timezone at
+ * build time. Prints a const TzTable named tz_table_<Zone_Name> to add to
+ * the firmware and attach with tz_cache_use_table(), so the table sits in
+ * flash and costs no startup time.
+ *
+ * Usage: tz_table_gen <zone name> <from year> <until year> > tz_table_zone.c
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "../lib/wifi_conn/tz_table.h"
+
+// Constants ----------------------------------------------------------
+
+#define TZ_GEN_ENTRIES 1024 // Most transitions generated
+
+// --------------------------------------------------------------------
+
+/**
+ * Returns the zone of a name from kAtcZoneAndLinkRegistry.
+ * @param char *name Zone name (e.g. America/Los_Angeles)
+ * @return AtcZoneInfo* Zone, NULL if not found
+ */
+static const AtcZoneInfo *tz_gen_find(const char *name) {
+    for (uint32 i = 0; i < kAtcZoneAndLinkRegistrySize; i++) {
+        if (strcmp(kAtcZoneAndLinkRegistry[i]->name, name) == 0) {
+            return kAtcZoneAndLinkRegistry[i];
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    static TzTableEntry entries[TZ_GEN_ENTRIES];
+    AtcZoneProcessor processor;
+    TzTable table;
+    char symbol[64];
+
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <zone name> <from year> <until year>\n", argv[0]);
+        return 1;
+    }
+
+    const AtcZoneInfo *zone_info = tz_gen_find(argv[1]);
+    int16 from_year = atoi(argv[2]);
+    int16 until_year = atoi(argv[3]);
+
+    if (zone_info == NULL) {
+        fprintf(stderr, "Unknown zone %s\n", argv[1]);
+        return 1;
+    }
+
+    atc_processor_init(&processor);
+
+    if (!tz_table_build(&table, entries, TZ_GEN_ENTRIES, &processor, zone_info, from_year, until_year)) {
+        fprintf(stderr, "Could not build %s for %d-%d\n", argv[1], from_year, until_year);
+        return 1;
+    }
+
+    // Zone name as a C identifier as in zone_infos.h, e.g. Etc/GMT+5 -> Etc_GMT_PLUS_5
+    uint32 length = 0;
+
+    for (const char *c = zone_info->name; *c && (length < (sizeof(symbol) - 7)); c++) {
+        if (*c == '+') {
+            length += sprintf(symbol + length, "_PLUS_");
+        } else if (((*c >= 'a') && (*c <= 'z')) || ((*c >= 'A') && (*c <= 'Z')) || ((*c >= '0') && (*c <= '9'))) {
+            symbol[length++] = *c;
+        } else {
+            symbol[length++] = '_';
+        }
+    }
+
+    symbol[length] = '\0';
+
+    printf("// Generated by tz_table_gen %s %d %d, do not edit.\n", zone_info->name, from_year, until_year);
+    printf("// %d transitions, %u bytes.\n\n", table.count,
+           (unsigned)((table.count * sizeof(TzTableEntry)) + sizeof(TzTable)));
+    printf("#include \"tz_table.h\"\n\n");
+    printf("static const TzTableEntry tz_table_entries_%s[%d] = {\n", symbol, table.count);
+
+    for (uint16 i = 0; i < table.count; i++) {
+        printf("    {%d, %d, %d, %d},\n", entries[i].start_epoch_seconds, entries[i].offset_seconds,
+               entries[i].delta_seconds, entries[i].abbrev_index);
+    }
+
+    printf("};\n\n");
+    printf("const TzTable tz_table_%s = {\n", symbol);
+    printf("    &kAtcZone%s,\n", symbol);
+    printf("    %d, // AceTime epoch year\n", table.epoch_year);
+    printf("    %d, // Until %d-01-01\n", table.valid_until, until_year);
+    printf("    tz_table_entries_%s,\n", symbol);
+    printf("    %d,\n", table.count);
+    printf("    %d,\n", table.abbrev_count);
+    printf("    {");
+
+    for (uint8 i = 0; i < table.abbrev_count; i++) {
+        printf("%s\"%s\"", i ? ", " : "", table.abbrevs[i]);
+    }
+
+    printf("}\n};\n");
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+#
+# Project Name: Project Lihini
+# File Name: zone_hash_gen.py
+# Author: Asanka Sovis
+# Created: 16/10/2026
+# Description: Generates zone_hash.c/h next to the zone_registry.c of a
+# zone database: a minimal perfect hash of kAtcZoneAndLinkRegistry by zone
+# ID (hash and displace), for atc_registrar_init_hashed(). The keys of the
+# largest buckets are placed first, each bucket trying seeds until its keys
+# land on free, distinct slots. The hash functions are those of
+# zone_registrar.c.
+#
+# Usage: python3 zone_hash_gen.py <zonedb directory> (make -C host zonedb)
+#
+# Modified By: Asanka Sovis
+# Modified: 16/10/2026
+#
+# Changelog:
+#   - Initial Commit
+#
+# Copyright (C) 2024 Project Lihini. All rights reserved.
+#
+
+import os
+import re
+import sys
+
+# Constants -----------------------------------------------------------
+
+MASK = 0xffffffff
+MAX_SEED = 0xffff       # Seeds are 16 bits
+KEYS_PER_BUCKET = 4     # Average keys per bucket tried first, fewer if no seeds fit
+PER_LINE = 12           # Array values per line
+
+# ---------------------------------------------------------------------
+
+
+def hash_mix(x):
+    """atc_hash_mix()"""
+    x ^= x >> 16
+    x = (x * 0x7feb352d) & MASK
+    x ^= x >> 15
+    x = (x * 0x846ca68b) & MASK
+    x ^= x >> 16
+    return x
+
+
+def hash_reduce(hash, size):
+    """atc_hash_reduce()"""
+    return ((hash >> 16) * size) >> 16
+
+
+def hash_slot(zone_id, seed, size):
+    return hash_reduce(hash_mix(zone_id ^ ((0x9e3779b9 * (seed + 1)) & MASK)), size)
+
+
+def build(zone_ids, num_seeds):
+    """Returns the seeds and index of the hash, None if a bucket has no seed."""
+    size = len(zone_ids)
+    buckets = [[] for _ in range(num_seeds)]
+
+    for index, zone_id in enumerate(zone_ids):
+        buckets[hash_reduce(hash_mix(zone_id), num_seeds)].append(index)
+
+    seeds = [0] * num_seeds
+    slots = [None] * size
+
+    for bucket in sorted(range(num_seeds), key=lambda b: -len(buckets[b])):
+        if not buckets[bucket]:
+            continue
+
+        for seed in range(MAX_SEED + 1):
+            taken = [hash_slot(zone_ids[i], seed, size) for i in buckets[bucket]]
+
+            if (len(set(taken)) == len(taken)) and all(slots[slot] is None for slot in taken):
+                break
+        else:
+            return None
+
+        seeds[bucket] = seed
+
+        for i, slot in zip(buckets[bucket], taken):
+            slots[slot] = i
+
+    return seeds, slots
+
+
+def array(values):
+    lines = []
+
+    for i in range(0, len(values), PER_LINE):
+        lines.append("  " + " ".join("%d," % value for value in values[i:i + PER_LINE]))
+
+    return "\n".join(lines)
+
+
+def write_hash(directory):
+    """Writes zone_hash.c/h of the zone database in directory, returns the
+    no of zones and the bytes of the hash."""
+    with open(os.path.join(directory, "zone_registry.c")) as file:
+        registry = file.read()
+
+    match = re.search(r"const AtcZoneInfo \* const (kAtc\w*)ZoneAndLinkRegistry\[\d+\]\s*=\s*\{(.*?)\};",
+                      registry, re.S)
+
+    if match is None:
+        sys.exit("kAtcZoneAndLinkRegistry not found in " + directory)
+
+    prefix = match.group(1)
+    zone_ids = [int(zone_id, 16) for zone_id in re.findall(r"&\w+, // (0x[0-9a-f]{8}),", match.group(2))]
+    size = len(zone_ids)
+    result = None
+    keys = KEYS_PER_BUCKET
+
+    while (result is None) and (keys > 0):
+        num_seeds = max(1, (size + keys - 1) // keys)
+        result = build(zone_ids, num_seeds)
+        keys -= 1
+
+    if result is None:
+        sys.exit("No perfect hash for " + directory)
+
+    seeds, slots = result
+    name = prefix + "ZoneAndLinkHash"
+    guard = "ACE_TIME_C_%s_ATC_ZONE_HASH_H" % os.path.basename(os.path.normpath(directory)).upper()
+    bytes = (len(seeds) + len(slots)) * 2
+    comment = "\n".join([
+        "// This file was generated by host/zone_hash_gen.py from zone_registry.c.",
+        "//",
+        "// Minimal perfect hash of %sZoneAndLinkRegistry by zone_id, for" % prefix,
+        "// atc_registrar_init_hashed().",
+        "//",
+        "// Zones: %d, Buckets: %d" % (size, len(seeds)),
+        "// Memory: %d bytes of seeds and index" % bytes,
+        "//",
+        "// DO NOT EDIT, regenerate with make -C host zonedb",
+        ""])
+
+    with open(os.path.join(directory, "zone_hash.h"), "w") as file:
+        file.write(comment + "\n")
+        file.write("#ifndef %s\n#define %s\n\n" % (guard, guard))
+        file.write('#include "../zoneinfo/zone_info.h"\n\n')
+        file.write('#ifdef __cplusplus\nextern "C" {\n#endif\n\n')
+        file.write("// Perfect hash of %sZoneAndLinkRegistry\n" % prefix)
+        file.write("extern const AtcZoneHash %s;\n\n" % name)
+        file.write("#ifdef __cplusplus\n}\n#endif\n\n#endif\n")
+
+    with open(os.path.join(directory, "zone_hash.c"), "w") as file:
+        file.write(comment + "\n")
+        file.write('#include "zone_hash.h"\n\n')
+        file.write("static const uint16_t %sSeeds[%d] = {\n%s\n};\n\n" % (name, len(seeds), array(seeds)))
+        file.write("static const uint16_t %sIndex[%d] = {\n%s\n};\n\n" % (name, size, array(slots)))
+        file.write("const AtcZoneHash %s = {\n" % name)
+        file.write("  %sSeeds /*seeds*/,\n" % name)
+        file.write("  %sIndex /*index*/,\n" % name)
+        file.write("  %d /*num_seeds*/,\n" % len(seeds))
+        file.write("  %d /*size*/,\n};\n" % size)
+
+    return size, bytes
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit("Usage: zone_hash_gen.py <zonedb directory>")
+
+    size, bytes = write_hash(sys.argv[1])
+    print("%s: %d zones, %d bytes" % (sys.argv[1], size, bytes))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+#
+# Project Name: Project Lihini
+# File Name: zonedb_prune.py
+# Author: Asanka Sovis
+# Created: 16/10/2026
+# Description: Generates lib/wifi_conn/acetime/zonedbpruned, the zone
+# database the firmware links, from the full zonedb. Only the zones of
+# ZONEDB_ZONES in include/app_conf.h are kept, with the zones their links
+# point to, the policies of their eras and a registry of just them with its
+# perfect hash (zone_hash_gen.py). The symbols are the same as zonedb's, so
+# the firmware is unchanged. Prints the records and memory (32-bits, as
+# counted in the zonedb headers) before and after.
+#
+# Usage: python3 zonedb_prune.py [zone name ...] (make -C host zonedb)
+#
+# Modified By: Asanka Sovis
+# Modified: 16/10/2026
+#
+# Changelog:
+#   - Initial Commit
+#
+# Copyright (C) 2024 Project Lihini. All rights reserved.
+#
+
+import os
+import re
+import sys
+
+import zone_hash_gen
+
+# Constants -----------------------------------------------------------
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+APP_CONF = os.path.join(ROOT, "include", "app_conf.h")
+SOURCE = os.path.join(ROOT, "lib", "wifi_conn", "acetime", "zonedb")
+TARGET = os.path.join(ROOT, "lib", "wifi_conn", "acetime", "zonedbpruned")
+
+# Record sizes (in bytes) on 32-bit targets, as used by the zonedb headers
+SIZE_CONTEXT = 24
+SIZE_RULE = 12
+SIZE_POLICY = 8
+SIZE_ERA = 20
+SIZE_INFO = 24
+SIZE_REGISTRY = 4
+SIZE_POINTER = 4
+
+SEPARATOR = "//" + ("-" * 75)
+
+# ---------------------------------------------------------------------
+
+
+def read(name):
+    with open(os.path.join(SOURCE, name)) as file:
+        return file.read()
+
+
+def write(name, text):
+    with open(os.path.join(TARGET, name), "w") as file:
+        file.write(text)
+
+
+def conf_zones():
+    """Returns the zone names of ZONEDB_ZONES in app_conf.h."""
+    with open(APP_CONF) as file:
+        match = re.search(r"^#define\s+ZONEDB_ZONES\s+(.*?)\s*(//.*)?$", file.read(), re.M)
+
+    if match is None:
+        sys.exit("ZONEDB_ZONES not found in " + APP_CONF)
+
+    return re.findall(r'"([^"]+)"', match.group(1))
+
+
+def split_blocks(text):
+    """Splits a zonedb .c file into its head (up to the first record) and
+    records ("Zone", "Link" or "Policy"), each a dict of the name, the link
+    target and the text up to the next separator of a section."""
+    starts = [m.start() for m in re.finditer("^" + SEPARATOR + r"\n// \w+", text, re.M)]
+    blocks = []
+    head = None
+
+    for i, start in enumerate(starts):
+        end = starts[i + 1] if (i + 1) < len(starts) else len(text)
+        chunk = text[start:end]
+        match = re.match(SEPARATOR + r"\n// (\w+) name: (\S+)( -> (\S+))?\n", chunk)
+
+        if match is None:
+            continue
+
+        if head is None:
+            head = text[:start]
+
+        blocks.append({"kind": match.group(1), "name": match.group(2), "target": match.group(4),
+                       "text": chunk})
+
+    return head, blocks
+
+
+def header_comment(text):
+    """Returns the generator and TZ database lines of a zonedb header."""
+    return text[:text.index("// Supported Zones")]
+
+
+def zone_size(blocks, policies, letters):
+    """Returns the records and memory of a set of zones and policies."""
+    eras = 0
+    names = 0
+    formats = set()
+    rules = 0
+
+    for block in blocks:
+        names += len(block["name"]) + 1
+
+        if block["kind"] == "Zone":
+            eras += len(re.findall(r"/\*zone_policy\*/", block["text"]))
+            formats.update(re.findall(r'^\s*"([^"]*)" /\*format\*/', block["text"], re.M))
+
+    for policy in policies:
+        rules += len(re.findall(r"/\*from_year\*/", policy["text"]))
+
+    total = (SIZE_CONTEXT + sum(SIZE_POINTER + len(letter) + 1 for letter in letters) + (rules * SIZE_RULE) + (len(policies) * SIZE_POLICY) + (eras * SIZE_ERA) +
+             (len(blocks) * (SIZE_INFO + SIZE_REGISTRY)) + sum(len(f) + 1 for f in formats) + names)
+
+    return {"infos": len(blocks), "eras": eras, "policies": len(policies), "rules": rules, "bytes": total}
+
+
+def stats_comment(zones, before, after):
+    lines = ["// Pruned by host/zonedb_prune.py to ZONEDB_ZONES of include/app_conf.h:", "//"]
+    lines += ["//   " + zone for zone in zones]
+    lines += ["//", "// Records: Infos %(infos)d, Eras %(eras)d, Policies %(policies)d, Rules %(rules)d" % after]
+    lines += ["// Memory (32-bits): %d (zonedb: %d)" % (after["bytes"], before["bytes"]), "//"]
+    lines += ["// DO NOT EDIT, regenerate with make -C host zonedb"]
+
+    return "\n".join(lines) + "\n"
+
+
+def filter_lines(text, symbols, pattern):
+    """Drops the lines declaring a symbol not in symbols."""
+    lines = []
+
+    for line in text.split("\n"):
+        match = re.match(pattern, line)
+
+        if (match is None) or (match.group(1) in symbols):
+            lines.append(line)
+
+    return "\n".join(lines)
+
+
+def strip_comment(text):
+    """Drops the zonedb header comment, up to and including DO NOT EDIT, and
+    renames the include guard."""
+    text = text[text.index("// DO NOT EDIT\n") + len("// DO NOT EDIT\n"):]
+
+    return text.replace("ACE_TIME_C_ZONEDB_", "ACE_TIME_C_ZONEDBPRUNED_")
+
+
+def main():
+    zones = sys.argv[1:] or conf_zones()
+    infos_c = read("zone_infos.c")
+    policies_c = read("zone_policies.c")
+    infos_head, infos = split_blocks(infos_c)
+    policies_head, policies = split_blocks(policies_c)
+    by_name = {block["name"]: block for block in infos}
+
+    # Zones asked for, links with their targets
+    selected = []
+
+    for zone in zones:
+        if zone not in by_name:
+            sys.exit("Unknown zone " + zone)
+
+        names = [zone] if by_name[zone]["target"] is None else [by_name[zone]["target"], zone]
+
+        for name in names:
+            if by_name[name] not in selected:
+                selected.append(by_name[name])
+
+    selected.sort(key=lambda block: (block["kind"] != "Zone", block["name"]))
+    symbols = set(re.search(r"const AtcZoneInfo kAtcZone(\w+)", block["text"]).group(1) for block in selected)
+    used = set()
+
+    for block in selected:
+        used.update(re.findall(r"&kAtcZonePolicy(\w+) /\*zone_policy\*/", block["text"]))
+
+    kept = [policy for policy in policies
+            if re.search(r"const AtcZonePolicy kAtcZonePolicy(\w+)", policy["text"]).group(1) in used]
+    letters = re.findall(r'^/\*\d+\*/ "([^"]*)",', infos_head, re.M)
+    before = zone_size(infos, policies, letters)
+    after = zone_size(selected, kept, letters)
+    comment = header_comment(infos_c) + stats_comment(zones, before, after)
+    zone_blocks = [block for block in selected if block["kind"] == "Zone"]
+    link_blocks = [block for block in selected if block["kind"] == "Link"]
+
+    os.makedirs(TARGET, exist_ok=True)
+
+    # zone_policies.c/h
+    text = comment + strip_comment(policies_head).split(SEPARATOR)[0]
+    text += "%s\n// Policies: %d\n// Rules: %d\n%s\n\n" % (SEPARATOR, after["policies"], after["rules"], SEPARATOR)
+    write("zone_policies.c", text + "".join(policy["text"] for policy in kept).rstrip("\n") + "\n")
+
+    text = strip_comment(read("zone_policies.h"))
+    text = re.sub(r"// Supported policies: \d+", "// Supported policies: %d" % len(kept), text)
+    text = text[:text.index(SEPARATOR + "\n// Unsupported")].rstrip("\n") + "\n\n"
+    text += "#ifdef __cplusplus\n}\n#endif\n\n#endif\n"
+    write("zone_policies.h", comment + filter_lines(text, used, r"extern const AtcZonePolicy kAtcZonePolicy(\w+);"))
+
+    # zone_infos.c/h
+    context = infos_head[infos_head.index(SEPARATOR + "\n// ZoneContext"):infos_head.index(SEPARATOR + "\n// Zones:")]
+    text = comment + strip_comment(infos_c[:infos_c.index(SEPARATOR)]) + context
+    text += "%s\n// Zones: %d\n// Eras: %d\n%s\n\n" % (SEPARATOR, len(zone_blocks), after["eras"], SEPARATOR)
+    text += "".join(block["text"] for block in zone_blocks)
+    text += "%s\n// Links: %d\n%s\n\n" % (SEPARATOR, len(link_blocks), SEPARATOR)
+    text += "".join(block["text"] for block in link_blocks)
+    write("zone_infos.c", text.rstrip("\n") + "\n")
+
+    text = strip_comment(read("zone_infos.h"))
+    text = re.sub(r"// Supported zones: \d+", "// Supported zones: %d" % len(zone_blocks), text)
+    text = re.sub(r"// Supported eras: \d+", "// Supported eras: %d" % after["eras"], text)
+    text = re.sub(r"// Supported links: \d+", "// Supported links: %d" % len(link_blocks), text)
+    text = text[:text.index(SEPARATOR + "\n// Unsupported")].rstrip("\n") + "\n\n"
+    text += "#ifdef __cplusplus\n}\n#endif\n\n#endif\n"
+    text = filter_lines(text, symbols, r"extern const AtcZoneInfo kAtcZone(\w+);")
+    text = filter_lines(text, symbols, r"#define kAtcZoneId(\w+) ")
+    write("zone_infos.h", comment + filter_lines(text, symbols, r"#define kAtcZoneBufSize(\w+) "))
+
+    # zone_registry.c/h
+    text = strip_comment(read("zone_registry.c"))
+    text = filter_lines(text, symbols, r"  &kAtcZone(\w+), //")
+    text = re.sub(r"kAtcZoneRegistry\[\d+\]", "kAtcZoneRegistry[%d]" % len(zone_blocks), text)
+    text = re.sub(r"kAtcZoneAndLinkRegistry\[\d+\]", "kAtcZoneAndLinkRegistry[%d]" % len(selected), text)
+    write("zone_registry.c", comment + text)
+
+    text = strip_comment(read("zone_registry.h"))
+    text = re.sub(r"(kAtcZoneRegistrySize |kAtcZoneRegistry\[)\d+", r"\g<1>%d" % len(zone_blocks), text)
+    text = re.sub(r"(kAtcZoneAndLinkRegistrySize |kAtcZoneAndLinkRegistry\[)\d+", r"\g<1>%d" % len(selected),
+                  text)
+    write("zone_registry.h", comment + text)
+    zone_hash_gen.write_hash(TARGET)
+
+    print("%-8s | %6s | %6s | %8s | %6s | %8s" % ("zonedb", "infos", "eras", "policies", "rules", "bytes"))
+
+    for name, size in (("full", before), ("pruned", after)):
+        print("%-8s | %6d | %6d | %8d | %6d | %8d" % (name, size["infos"], size["eras"], size["policies"],
+                                                     size["rules"], size["bytes"]))
+
+    print("Saved %d bytes of flash (and of RAM where .rodata is loaded to it)" % (before["bytes"] - after["bytes"]))
+
+
+if __name__ == "__main__":
+    main()
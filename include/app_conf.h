@@ -21,12 +21,44 @@
 
 // Connection -------------------------------------------------------------------------------
 #define DEFAULT_CONN_SERVER "www.google.com"        // Default ping server
+#define CONN_PROBE_TARGETS {DEFAULT_CONN_SERVER, DEFAULT_MQTT_SERVER} // Hosts probed in order until one answers
+#define CONN_PROBE_PORT 80                          // Port probed on the targets
+#define CONN_PROBE_IDLE 60                          // Time without broker traffic before a probe is due (in secs)
+#define DNS_CACHE_ENTRIES 4                         // Hostnames held in the DNS cache
+#define DNS_CACHE_TTL 300                           // Time a resolved address is reused (in secs)
+#define DNS_CACHE_STALE_TTL 86400                   // Time the last-known-good address is used when DNS fails (in secs)
+#define DNS_CACHE_RETRY 30                          // Time before a failed DNS lookup is retried (in secs)
+
+// Retry Backoff ---------------------------------------------------------------------------
+// After the nth consecutive failure a stage is retried after a random wait between 0 and
+// min(CAP, BASE * 2^(n - 1))
+
+#define BACKOFF_WIFI_BASE 1000                      // WiFi reconnect window after the first failure (in msec)
+#define BACKOFF_WIFI_CAP 60000                      // Largest WiFi reconnect window (in msec)
+#define BACKOFF_INTERNET_BASE 2000                  // Internet probe window after the first failure (in msec)
+#define BACKOFF_INTERNET_CAP 60000                  // Largest internet probe window (in msec)
+#define BACKOFF_NTP_BASE 2000                       // SNTP update window after the first failure (in msec)
+#define BACKOFF_NTP_CAP 120000                      // Largest SNTP update window (in msec)
+#define BACKOFF_MQTT_BASE 1000                      // MQTT connect window after the first failure (in msec)
+#define BACKOFF_MQTT_CAP 120000                     // Largest MQTT connect window (in msec)
+#define BACKOFF_SUBSCRIBE_BASE 1000                 // MQTT subscribe window after the first failure (in msec)
+#define BACKOFF_SUBSCRIBE_CAP 30000                 // Largest MQTT subscribe window (in msec)
 
 // SNTP -------------------------------------------------------------------------------------
 
 #define DEFAULT_SNTP_SERVER "time.nist.gov"         // Default SNTP server
 #define DEFAULT_TIMEZONE kAtcZoneAsia_Colombo       // Default timezone
+#define SNTP_TIMEZONE kAtcZoneAsia_Shanghai         // Timezone of the time set by the SNTP client
+#define ZONEDB_ZONES "Asia/Colombo", "Asia/Shanghai" // Zones linked in, incl. the above (make -C host zonedb after changing)
+#define TZ_TABLE_FROM_YEAR 2024                     // First year of the precomputed transitions of DEFAULT_TIMEZONE
+#define TZ_TABLE_YEARS 16                           // Years precomputed (0 to not precompute)
+#define TZ_TABLE_ENTRIES 40                         // Transitions the precomputed table holds (2 per year with DST)
 #define SNTP_UPDATE_TIMEOUT 500                     // SNTP update timeout (in msec)
+#define CLOCK_SYNC_SAMPLES 4                        // SNTP samples the clock drift is estimated over
+#define CLOCK_SYNC_ERROR 100                        // Target clock error between resyncs (in msec)
+#define CLOCK_SYNC_MIN 600                          // Shortest resync interval (in secs)
+#define CLOCK_SYNC_MAX 14400                        // Longest resync interval (in secs, longer misses daily temperature drift)
+#define CLOCK_DRIFT_MAX 500                         // Largest clock drift believed (in ppm)
 
 // MQTT Conn -------------------------------------------------------------------------------
 
@@ -37,18 +69,34 @@
 #define MQTT_USERNAME ""                            // MQTT server uname
 #define MQTT_PASSWORD ""                            // MQTT server pword
 #define MQTT_KEEP_ALIVE_TIME 10                     // MQTT keep-alive time (in secs)
+#define MQTT_PERSISTENT_SESSION 1                   // Keep MQTT connected across cycles (0 to reconnect every cycle)
 
 // MQTT Subscribe/ Publish -----------------------------------------------------------------
 
 #define MQTT_SUBSCRIBE_TOPIC "lihini/outgo"         // MQTT subscribe topic
 #define MQTT_PUBLISH_TIMEOUT 10                     // MQTT publish timeout (in msec)
 #define MAX_RETRY_COUNT 3                           // MQTT retry count (Connect, Publish, Subscribe)
+#define MQTT_INFLIGHT_WINDOW 4                      // Max QoS1 publishes awaiting PUBACK at once
+#define MQTT_ACK_TIMEOUT 5000                       // Time to wait for a PUBACK before resending (in msec)
+#define MQTT_PUBLISH_BUDGET 5000                    // Time a publish cycle keeps sending new messages (in msec)
 
 // MQTT payload/ queue ---------------------------------------------------------------------
 
-#define MAX_QUEUE_SIZE 50                           // Maximum queue size
+#define MAX_QUEUE_SIZE 50                           // Maximum messages held in the incoming ring
+#define MQTT_INBOUND_BYTES 2048                     // Incoming ring capacity (in bytes)
+#define MQTT_ROUTE_NODES 16                         // Incoming route trie nodes (One per distinct filter level)
+#define MQTT_ROUTE_NAME_BYTES 128                   // Incoming route level name storage (in bytes)
+#define MQTT_DEDUP_WINDOW 128                       // Recent incoming packet IDs checked for redeliveries
+                                                    // (Power of 2)
+#define MQTT_QUEUE_BYTES 4096                       // Outgoing queue capacity (in bytes)
+#define MQTT_QUEUE_HIGH_WATER 3072                  // Queue bytes over which the MQTT thread spills to the
+                                                    // spool, leaving room for the timer/ISR producers
 #define MAX_MQTT_TOPIC_SIZE 50                      // Maximum topic size
 #define MAX_MQTT_PAYLOAD 150                        // Maximum MQTT payload
+#define MAX_MQTT_STREAM 16384                       // Maximum incoming payload streamed in chunks (Over MQTT_BUFF_SIZE)
+#define MQTT_SPOOL_SECTORS 8                        // Flash sectors below the RF cal. sector used to spool
+                                                    // messages when the queue is full (0 to disable)
+                                                    // NOTE: Must not overlap the irom0 text
 
 // Indicators ------------------------------------------------------------------------------
 
@@ -19,15 +19,18 @@
  */
 
 #include "mqtt_conn.h"
+#include "../wifi_conn/conn_state.h"
+#include "../wifi_conn/conn_probe.h"
+#include "../wifi_conn/conn_backoff.h"
 
 // Constants ----------------------------------------------------------
 
 #define MQTT_BUFF_SIZE 100 // MQTT buffer size (Use 100)
 #define MQTT_VERSION 3 // MQTT version (Use 3)
-#define MQTT_SUBSCRIBE_RETRY_FREQ 100 // Frequency to retry subscribe
-#define TIMESTAMP_SIZE 20 // Timestamp size (20 for DD-MM-YYYY hh:mm:ss)
 #define SNTP_EPOCH_THRESHOLD 905536800 // Value after which NTP update is assumed to
 // be successful
+#define MQTT_SOURCE_QUEUE 0 // In-flight message is in the outgoing queue
+#define MQTT_SOURCE_SPOOL 1 // In-flight message is in the spool
 
 // --------------------------------------------------------------------
 
@@ -45,42 +48,187 @@ MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
 
 // MQTT Variables -----------------------------------------------------
 
-// Message ID of the last MQTT message. Used to stop receiving
+// IDs of the recent incoming messages. Used to stop receiving
 // duplicate messages
-uint16 last_mqtt_message = 65535;
+MqttDedup incoming_dedup = {0};
+
+struct MqttSessionStats mqtt_session = {0}; // Session counters
+uint32 subscribed_session = 0; // Connect count at the last subscribe
 
 ulong counter = 0; // Counted used by fake publish function
 
 // --------------------------------------------------------------------
 
-// External Variables -------------------------------------------------
+// Outgoing Queue -----------------------------------------------------
+
+// Messages waiting to be published. Stored as length-prefixed records
+// (Topic + Payload) in a byte ring, so every message only takes the
+// bytes it needs. Capacity is set in bytes by MQTT_QUEUE_BYTES.
+
+uint32 outgoing_storage[MQTT_QUEUE_BYTES / 4] = {0};
+MqttRing outgoing_ring = {0};
+
+// --------------------------------------------------------------------
+
+// Incoming Messages --------------------------------------------------
+
+// Incoming messages are handed to the handler routed to their topic as a
+// view into the MQTT read buffer, without copying. Only the messages a
+// handler defers, and those with no route, are copied into the incoming
+// ring (With only the bytes they use) to be read by another task.
+
+uint32 incoming_storage[MQTT_INBOUND_BYTES / 4] = {0};
+MqttRing incoming_ring = {0};
+uint16 incoming_limit = 0;              // Max messages held in the ring
+MqttTopicNode route_nodes[MQTT_ROUTE_NODES];
+char route_names[MQTT_ROUTE_NAME_BYTES];
+MqttTopicTrie routes = {0};             // Topic filter -> MqttInboundHandler
+
+// --------------------------------------------------------------------
+
+// In-flight Window ---------------------------------------------------
+
+// QoS1 messages that are sent and still waiting on a PUBACK. A record is
+// claimed from the outgoing queue when it is sent and is only dropped
+// once the PUBACK with its packet ID comes back. If the window gives up,
+// the records are released and are sent again in order.
+
+struct InflightSlot {
+    uint8 source;               // MQTT_SOURCE_x
+    struct MqttRecord record;   // Message being delivered (Queue)
+    struct SpoolCursor cursor;  // Message being delivered (Spool)
+    uint16 packet_id;           // Packet ID used for the publish
+    uint8 in_use;               // Slot holds a message
+    uint8 retry;                // Number of resends
+    uint8 dup;                  // Sent by an earlier attempt, resent with the dup flag
+    portTickType sent_at;       // Tick of the last send
+};
+
+struct InflightSlot inflight[MQTT_INFLIGHT_WINDOW] = {0};
+uint8 inflight_count = 0;   // No of slots in use
+
+// --------------------------------------------------------------------
+
+// Store-and-forward Spool --------------------------------------------
+
+// Messages pushed out of the full outgoing queue are written to
+// MQTT_SPOOL_SECTORS flash sectors below the RF calibration sector
+// instead of being lost. Spooled messages are older than the ones in the
+// queue, so they are sent first once MQTT is back. A spooled message is
+// read back from flash every time it is sent.
+
+struct SpoolFlash spool_flash = {0};
+struct MqttSpool spool = {0};
+xSemaphoreHandle spool_lock = NULL;     // Guards the spool
+xTaskHandle spool_owner = NULL;         // Task holding spool_lock
+uint8 spool_ready = 0;                  // Spool is mounted
+struct SpoolCursor spool_replay = {0};  // Next spooled message to send
+struct SpoolCursor spool_sent = {0};    // Spooled messages before this were sent by an earlier attempt
+char spool_buf[MAX_MQTT_TOPIC_SIZE + MAX_MQTT_PAYLOAD + 2] = {0}; // Message read from the spool
+
+// --------------------------------------------------------------------
 
-// Main queues
-extern xQueueHandle incoming_queue;         // Incoming from server
-extern xQueueHandle outgoing_queue;         // Outgoing to server
+// Broker Operations --------------------------------------------------
+
+// Connect, subscribe, unsubscribe and single publishes are submitted
+// without blocking and completed by MQTTPoll, so incoming messages and
+// PUBACKs are still handled while they wait on the broker.
+
+struct MqttOp {
+    uint8 done;     // Operation completed
+    int rc;         // SUCCESS, FAILURE (Refused or timed out) or DISCONNECTED
+};
+
+// --------------------------------------------------------------------
+
+// External Variables -------------------------------------------------
 
 extern int8 mqtt_status;                    // MQTT status
 
 extern char unique_identifier[22];          //Unique identifier of the ESP32
 // NOTE: This is used as the client ID for MQTT
 
+extern uint32 user_rf_cal_sector_set(void); // RF calibration sector (main.c)
+extern u_long get_time();                   // Current local time (wifi_conn.c)
+extern void time_to_str(char *timestamp, u_long time); // Time as DD-MM-YYYY hh:mm:ss (wifi_conn.c)
+
 // --------------------------------------------------------------------
 
+/**
+ * Callback when a submitted operation completes.
+ * @param void *context struct MqttOp of the operation
+ * @param unsigned short id Packet ID
+ * @param int rc SUCCESS, FAILURE or DISCONNECTED
+ * @return none
+ */
+static void mqtt_op_finished(void *context, unsigned short id, int rc) {
+    struct MqttOp *op = (struct MqttOp *)context;
+
+    (void)id;
+    op->rc = rc;
+    op->done = 1;
+}
+
+/**
+ * Polls the client until a submitted operation completes. The client
+ * fails the operation once the command timeout expires or the connection
+ * drops, so this always returns.
+ * @param struct MqttOp *op Operation
+ * @return int SUCCESS, FAILURE or DISCONNECTED
+ */
+static int mqtt_op_wait(struct MqttOp *op) {
+    while (!op->done) {
+        MQTTPoll(&client, MQTT_PUBLISH_TIMEOUT);
+    }
+
+    return op->rc;
+}
+
 /**
  * Initialize the MQTT queue. Both incoming and outgoing queues are initialized.
  * 
  * NOTE: The max_size defines what the maximum number of messages to be stored
- * in the queue. When more data are available, last message is dequeued and
+ * in the incoming ring (Of MQTT_INBOUND_BYTES bytes). The outgoing queue is a ring of MQTT_QUEUE_BYTES
+ * bytes. When more data are available, last message is dequeued and
  * new message is queued. Increasing the queue size may affect the function
  * of the program but shorter queue may result in data loss in case of conn.
- * loss.
+ * loss. The outgoing queue is kept if the MQTT thread is restarted, the
+ * messages it left in flight are sent again.
+ * Messages pushed out of the outgoing queue go to the flash spool, which
+ * is mounted here once and survives a reset.
  * 
- * @param int max_size Maximum size of the queues
+ * @param int max_size Maximum size of the incoming queue
  * @return none
  */
 void mqtt_queue_init(int max_size) {
-    incoming_queue = xQueueCreate(max_size, sizeof(struct QueueData));
-    outgoing_queue = xQueueCreate(max_size, sizeof(struct QueueData));
+    incoming_limit = max_size;
+
+    if (incoming_ring.buf == NULL) {
+        mqtt_ring_init(&incoming_ring, (uint8 *)incoming_storage, sizeof(incoming_storage));
+    }
+
+    if (outgoing_ring.buf == NULL) {
+        mqtt_ring_init(&outgoing_ring, (uint8 *)outgoing_storage, sizeof(outgoing_storage));
+    }
+
+    if ((spool_lock == NULL) && (MQTT_SPOOL_SECTORS > 0)) {
+        uint32 rf_cal_sector = user_rf_cal_sector_set();
+
+        spool_lock = xSemaphoreCreateMutex();
+
+        if ((rf_cal_sector > MQTT_SPOOL_SECTORS) &&
+            (mqtt_spool_flash_init(&spool_flash, rf_cal_sector - MQTT_SPOOL_SECTORS, MQTT_SPOOL_SECTORS) == MQTT_SPOOL_SUCCESS) &&
+            (mqtt_spool_init(&spool, &spool_flash) == MQTT_SPOOL_SUCCESS)) {
+            spool_ready = 1;
+            printf("Spool mounted. %d messages spooled.\n", mqtt_spool_count(&spool));
+        } else {
+            printf("Failed to mount spool. Messages will be dropped when the queue is full.\n");
+        }
+    }
+
+    // A restarted MQTT thread may have left messages in flight. They are
+    // sent again, in order, with the dup flag
+    mqtt_inflight_requeue();
 
     printf("Queues initialized.\n");
 }
@@ -97,7 +245,8 @@ void mqtt_queue_init(int max_size) {
  *                      is using the MQTT connection)
  *      MQTT_PUBLISHING - MQTT thread is publishing some data
  *      MQTT_PUBLISH_FAIL - Failed to publish
- *      MQTT_DISCONNECT - MQTT disconnected
+ *      MQTT_DISCONNECT - MQTT disconnected (Or a failed connect is waiting
+ *                      to be retried on the CONN_STAGE_MQTT backoff)
  * @param char *mqtt_host MQTT host URL
  * @param char *mqtt_client_id Client ID of the device
  * @param int mqtt_port MQTT port (502 default)
@@ -108,6 +257,11 @@ void mqtt_queue_init(int max_size) {
 uint8 mqtt_connect(char *mqtt_host, char *mqtt_client_id, int mqtt_port, int mqtt_timeout, int mqtt_buff_length) {
     int error = MQTT_DISCONNECT;
 
+    // Failed recently, retry later
+    if (conn_backoff_wait(CONN_STAGE_MQTT) > 0) {
+        return MQTT_DISCONNECT;
+    }
+
     // Connect to network
     NewNetwork(&network);
     error = ConnectNetwork(&network, mqtt_host, mqtt_port);
@@ -115,6 +269,8 @@ uint8 mqtt_connect(char *mqtt_host, char *mqtt_client_id, int mqtt_port, int mqt
     if (error == 0) {
         // If connected, new MQTT client is created
         NewMQTTClient(&client, &network, mqtt_timeout, mqtt_buf, mqtt_buff_length, mqtt_readbuf, mqtt_buff_length);
+        MQTTSetAckHandler(&client, mqtt_ack_received);
+        MQTTSetStreamHandler(&client, topic_streamed);
         
         data.willFlag = 0;
         data.MQTTVersion = MQTT_VERSION;
@@ -124,20 +280,40 @@ uint8 mqtt_connect(char *mqtt_host, char *mqtt_client_id, int mqtt_port, int mqt
         data.keepAliveInterval = MQTT_KEEP_ALIVE_TIME;
         data.cleansession = 0;
 
-        // Connect
-        error = MQTTConnect(&client, &data);
+        // Connect. The CONNACK is read by MQTTPoll
+        struct MqttOp connack = {0};
+
+        error = FAILURE;
+
+        if (MQTTConnectSubmit(&client, &data, mqtt_op_finished, &connack) == SUCCESS) {
+            error = mqtt_op_wait(&connack);
+        }
 
         if (error == 0) {
             // MQTT connection success
-            printf("MQTT Connected.\n");
+            mqtt_session.connect_count++;
+            mqtt_session.connected_at = xTaskGetTickCount();
+            conn_probe_heard(); // CONNACK proves the link
+            conn_backoff_succeeded(CONN_STAGE_MQTT);
+            conn_backoff_reset(CONN_STAGE_SUBSCRIBE); // New session, subscribe at once
+
+            // New broker session, nothing of the old one is redelivered. MQTT
+            // 3.1 has no session present flag, the session is kept unless clean
+            if (data.cleansession || ((data.MQTTVersion >= 4) && !client.sessionPresent)) {
+                mqtt_dedup_reset(&incoming_dedup);
+            }
+
+            printf("MQTT Connected. Connects: %d\n", mqtt_session.connect_count);
             return MQTT_CONNECTION_SUCCESS;
         } else {
             // MQTT connection fail
+            conn_backoff_failed(CONN_STAGE_MQTT);
             printf("Failed to connect to MQTT client.\n");
             return MQTT_CONNECTION_ERROR;
         }
     } else {
         // Network connection success
+        conn_backoff_failed(CONN_STAGE_MQTT);
         printf("Failed to connect to MQTT network.\n");
         return MQTT_NETWORK_ERROR;
     }
@@ -147,25 +323,99 @@ uint8 mqtt_connect(char *mqtt_host, char *mqtt_client_id, int mqtt_port, int mqt
 
 /**
  * Disconnects the MQTT network. Will be called after MQTT function is
- * completed. This is to stop traffic congestion in the MQTT server.
- * Always disconect once all traffic is completed.
+ * completed when MQTT_PERSISTENT_SESSION is off. This is to stop traffic
+ * congestion in the MQTT server. With a persistent session, this is only
+ * called once the connection has failed.
  * @param none
  * @return none
  */
 void mqtt_disconnect() {
+    if (client.isconnected) {
+        mqtt_session.disconnect_count++;
+    }
+
     DisconnectNetwork(&network);
+    client.isconnected = 0;
+}
+
+/**
+ * Returns true if the MQTT client is connected.
+ * @param none
+ * @return int Connected/Disconnected
+ */
+uint8 mqtt_is_connected() {
+    return client.isconnected;
+}
+
+/**
+ * Keeps a persistent session alive between publish cycles. Waits up to
+ * timeout_ms for incoming packets, processes the ones that arrived and
+ * lets the Paho keepalive send a PINGREQ when due. If the broker stops answering the pings, the
+ * connection is closed so that the next cycle reconnects.
+ *      MQTT_CONNECTION_SUCCESS - Session is alive
+ *      MQTT_DISCONNECT - Session dropped
+ * @param int timeout_ms Time to process incoming packets
+ * @return int Success/Fail
+ */
+uint8 mqtt_keep_alive(int timeout_ms) {
+    if (!client.isconnected) {
+        return MQTT_DISCONNECT;
+    }
+
+    int packets = MQTTPoll(&client, timeout_ms);
+
+    if (packets == DISCONNECTED) {
+        printf("MQTT keep-alive failed. Session age: %d s\n", mqtt_session_age());
+        mqtt_disconnect();
+
+        return MQTT_DISCONNECT;
+    }
+
+    if (packets > 0) {
+        // PINGRESP or other broker traffic proves the link
+        conn_probe_heard();
+    }
+
+    return MQTT_CONNECTION_SUCCESS;
+}
+
+/**
+ * Returns the age of the current MQTT session in seconds. Returns 0 if
+ * not connected.
+ * @param none
+ * @return int Session age (in secs)
+ */
+uint32 mqtt_session_age() {
+    if (!client.isconnected) {
+        return 0;
+    }
+
+    return ((xTaskGetTickCount() - mqtt_session.connected_at) * portTICK_RATE_MS) / 1000;
+}
+
+/**
+ * Copies the MQTT session counters.
+ * @param struct MqttSessionStats *stats Pointer to store the counters
+ * @return none
+ */
+void mqtt_get_session_stats(struct MqttSessionStats *stats) {
+    *stats = mqtt_session;
 }
 
 /**
  * Checks the topic for available messages. If the server is to congested, the
  * subscription tend to get expired. This function call ensures that this
  * won't affect operation. Also the connection is disconnected everytime
- * work is completed. Returns error state as defined in MQTT_MESSAGE_STATUS
- * by mqtt_conn.h.
+ * work is completed. With MQTT_PERSISTENT_SESSION, the subscription lives
+ * as long as the session, so it is only renewed after a reconnect. A
+ * failed subscribe is retried by a later call on the CONN_STAGE_SUBSCRIBE
+ * backoff, rather than blocking the MQTT thread. Returns error state as
+ * defined in MQTT_MESSAGE_STATUS by mqtt_conn.h.
  *      MQTT_MESSAGE_SUCCESS - Subscribe success
  *      MQTT_TOPIC_LENGTH_EXCEEDED - Topic length too long
  *      MQTT_BUFFER_LENGTH_EXCEED - Message length too long
  *      MQTT_PUBLISH_ERROR - Publish error
+ *      MQTT_SUBSCRIBE_ERROR - Subscribe failed or waiting to be retried
  * @param char *mqtt_topic Topic to subscribe
  * @param int qos_state QoS state to receive messages
  * @return int Success/Fail
@@ -175,24 +425,43 @@ uint8 mqtt_check_topic(char *mqtt_topic, int qos_state) {
     if (client.isconnected) {
         // Check for topic length exceed
         if (strlen(mqtt_topic) <= MAX_MQTT_TOPIC_SIZE) {
-            int ret = -1;
+            struct MqttOp unsuback = {0};
+            struct MqttOp suback = {0};
+            int ret = FAILURE;
 
-            while (TRUE) {
-                // Unsubscribe
-                ret = MQTTUnsubscribe(&client, mqtt_topic);
-                //printf("MQTT Unsubscribed. Err: %d...", ret);
+            // Already subscribed in this session
+            if (MQTT_PERSISTENT_SESSION && (subscribed_session == mqtt_session.connect_count)) {
+                return MQTT_MESSAGE_SUCCESS;
+            }
 
-                // Subscribe
-                ret = MQTTSubscribe(&client, mqtt_topic, qos_state, topic_received);
-                //printf("MQTT Subscribed. Err: %d\n", ret);
+            // Failed recently, retry later
+            if (conn_backoff_wait(CONN_STAGE_SUBSCRIBE) > 0) {
+                return MQTT_SUBSCRIBE_ERROR;
+            }
 
-                // QoS state tally with sent QoS, (Indicate success) then exit loop
-                if (ret == qos_state)
-                    break;
+            // Unsubscribe and subscribe back to back. Both acks are read by
+            // MQTTPoll. The unsubscribe result does not matter
+            if (MQTTUnsubscribeSubmit(&client, mqtt_topic, mqtt_op_finished, &unsuback) != SUCCESS) {
+                unsuback.done = 1;
+            }
 
-                vTaskDelay(MQTT_SUBSCRIBE_RETRY_FREQ);
+            if (MQTTSubscribeSubmit(&client, mqtt_topic, qos_state, topic_received, mqtt_op_finished, &suback) == SUCCESS) {
+                ret = mqtt_op_wait(&suback);
             }
 
+            mqtt_op_wait(&unsuback);
+
+            // Broker refused the subscription (Indicate failure)
+            if (ret != SUCCESS) {
+                conn_backoff_failed(CONN_STAGE_SUBSCRIBE);
+                printf("MQTT subscribe failed. Err: %d\n", ret);
+
+                return client.isconnected ? MQTT_SUBSCRIBE_ERROR : MQTT_CONNECTION_DISCONNECT;
+            }
+
+            conn_backoff_succeeded(CONN_STAGE_SUBSCRIBE);
+            subscribed_session = mqtt_session.connect_count;
+
             vTaskDelay(MQTT_PUBLISH_TIMEOUT);
 
             return MQTT_MESSAGE_SUCCESS;
@@ -211,75 +480,601 @@ uint8 mqtt_check_topic(char *mqtt_topic, int qos_state) {
 }
 
 /**
- * Callback when a message is received for a certain topic. Will copy the message
- * to the incoming queue.
+ * Trie visitor that calls a routed handler.
+ * @param void *handler MqttInboundHandler
+ * @param void *message struct MqttInbound
+ * @return none
+ */
+static void mqtt_inbound_dispatch(void *handler, void *message) {
+    ((MqttInboundHandler)handler)((struct MqttInbound *)message);
+}
+
+/**
+ * Passes a message, or a chunk of one, to the handlers routed to its topic.
+ * Messages with no route are copied to the incoming ring.
+ * @param MessageData* md Received message (Or chunk)
+ * @param uint32 offset Position of the chunk in the payload
+ * @param uint32 total Payload length
+ * @return int Success/Fail (Duplicate, or dropped with no route)
+ */
+static int mqtt_inbound_deliver(MessageData* md, uint32 offset, uint32 total) {
+    // Drop messages the broker redelivered before copying anything. This
+    // stops duplicates from entering the queue. QoS0 messages carry no ID
+    if ((offset == 0) && (md->message->qos != QOS0) &&
+        (mqtt_dedup_check(&incoming_dedup, md->message->id, md->message->dup) == MQTT_DEDUP_DUPLICATE)) {
+        mqtt_session.duplicates++;
+        printf("Duplicate message %d dropped.\n", md->message->id);
+        return FAILURE;
+    }
+
+    struct MqttInbound message = {
+        .topic = md->topic->lenstring.data,
+        .topic_len = md->topic->lenstring.len,
+        .payload = md->message->payload,
+        .payload_len = md->message->payloadlen,
+        .qos = md->message->qos,
+        .retained = md->message->retained,
+        .offset = offset,
+        .total = total
+    };
+
+    if ((routes.nodes == NULL) ||
+        (mqtt_topic_match(&routes, message.topic, message.topic_len, mqtt_inbound_dispatch, &message) == 0)) {
+        // A streamed message with no route is dropped whole, the rest of it is not read
+        if (mqtt_inbound_defer(&message) != MQTT_RING_SUCCESS) {
+            return FAILURE;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * Callback when a message is received for a certain topic. Hands the
+ * message to the handlers routed to its topic without copying it. Messages
+ * with no route are copied to the incoming ring.
  * @param MessageData* md Received message
  * @return none
  */
 void ICACHE_FLASH_ATTR topic_received(MessageData* md) {
-    // Check if last received message ID is not the current message. This stops
-    // duplicates from entering the queue
-    if (last_mqtt_message != md->message->id) {
-        printf("Message received.\n");
+    mqtt_inbound_deliver(md, 0, md->message->payloadlen);
+}
 
-        struct QueueData incoming_data = {0};
+/**
+ * Callback with each chunk of a message too large for the MQTT read buffer.
+ * Chunks go to the routed handlers like whole messages, with the position
+ * of the chunk in the payload. The next chunk is only read from the socket
+ * once the handlers return, so slow handlers hold the broker back.
+ * @param MessageData* md Received chunk
+ * @param size_t offset Position of the chunk in the payload
+ * @param size_t total Payload length
+ * @return int Success/Fail (Rest of the message dropped)
+ */
+int ICACHE_FLASH_ATTR topic_streamed(MessageData* md, size_t offset, size_t total) {
+    if ((offset == 0) && (total > MAX_MQTT_STREAM)) {
+        printf("Incoming message of %u bytes over MAX_MQTT_STREAM. Will drop the data.\n", (uint32)total);
+        return FAILURE;
+    }
+
+    return mqtt_inbound_deliver(md, offset, total);
+}
 
-        // Copy topic and message to queue
-        strncpy(incoming_data.topic, md->topic->lenstring.data, md->topic->lenstring.len);
-        strcpy(incoming_data.payload, md->message->payload);
+/**
+ * Routes the incoming messages matching a topic filter (Wildcards
+ * allowed) to a handler. The handler runs in the MQTT thread with a view
+ * of the message. A filter routed again gets the new handler. The filter
+ * must also be covered by a subscription. Returns the status as defined
+ * in MQTT_TOPIC_STATUS.
+ *      MQTT_TOPIC_SUCCESS - Routed
+ *      MQTT_TOPIC_INVALID - Malformed filter
+ *      MQTT_TOPIC_FULL - MQTT_ROUTE_NODES or MQTT_ROUTE_NAME_BYTES exceeded
+ * @param char *filter Topic filter
+ * @param MqttInboundHandler handler Handler (NULL to remove the route)
+ * @return int Success/Fail
+ */
+uint8 mqtt_inbound_route(char *filter, MqttInboundHandler handler) {
+    if (routes.nodes == NULL) {
+        mqtt_topic_init(&routes, route_nodes, MQTT_ROUTE_NODES, route_names, MQTT_ROUTE_NAME_BYTES);
+    }
 
-        printf("Topic: %s | Payload: %s\n", incoming_data.topic, incoming_data.payload);
+    if (handler == NULL) {
+        return mqtt_topic_remove(&routes, filter);
+    }
 
-        // Queueing the message
-        if (xQueueSendToBack(incoming_queue, &incoming_data, 0) == pdPASS) {
-            printf("Incoming data queued.\n");
-        } else {
-            printf("Failed to queue incoming data. Will drop the data.\n");
+    return mqtt_topic_add(&routes, filter, (void *)handler);
+}
+
+/**
+ * Copies an incoming message to the incoming ring, for handlers that
+ * process it later or in another task. Returns the status as defined in
+ * MQTT_RING_STATUS.
+ *      MQTT_RING_SUCCESS - Copied
+ *      MQTT_RING_FULL - Ring full (Or holds max_size messages), dropped
+ *      MQTT_RING_TOO_LARGE - Message can never fit the ring (Or is a chunk), dropped
+ * @param struct MqttInbound *message Message
+ * @return int Success/Fail
+ */
+uint8 mqtt_inbound_defer(struct MqttInbound *message) {
+    uint8 error = MQTT_RING_FULL;
+
+    if ((message->offset != 0) || (message->payload_len != message->total)) {
+        // Chunks of a streamed message are never whole, only a handler can take them
+        error = MQTT_RING_TOO_LARGE;
+    } else if (mqtt_ring_count(&incoming_ring) < incoming_limit) {
+        error = mqtt_ring_push_len(&incoming_ring, message->topic, message->topic_len, message->payload, message->payload_len);
+    }
+
+    if (error == MQTT_RING_SUCCESS) {
+        printf("Incoming data queued.\n");
+    } else if (message->offset == 0) {
+        // Counted once per message, not once per chunk
+        mqtt_session.inbound_dropped++;
+        printf("Failed to queue incoming data. Will drop the data.\n");
+    }
+
+    return error;
+}
+
+/**
+ * Returns a view of the oldest message in the incoming ring. Topic and
+ * payload are NUL terminated, the payload may also contain NULs. The view
+ * is valid until mqtt_inbound_drop().
+ *      MQTT_RING_SUCCESS - Success
+ *      MQTT_RING_EMPTY - No message available
+ * @param struct MqttRecord *record View to fill
+ * @return int Success/Fail
+ */
+uint8 mqtt_inbound_peek(struct MqttRecord *record) {
+    return mqtt_ring_peek(&incoming_ring, record);
+}
+
+/**
+ * Drops the oldest message in the incoming ring.
+ * @param none
+ * @return none
+ */
+void mqtt_inbound_drop() {
+    mqtt_ring_drop(&incoming_ring);
+}
+
+/**
+ * Takes the spool lock and records the task holding it.
+ * @param none
+ * @return none
+ */
+static void spool_take() {
+    xSemaphoreTake(spool_lock, portMAX_DELAY);
+    spool_owner = xTaskGetCurrentTaskHandle();
+}
+
+/**
+ * Releases the spool lock.
+ * @param none
+ * @return none
+ */
+static void spool_give() {
+    spool_owner = NULL;
+    xSemaphoreGive(spool_lock);
+}
+
+/**
+ * Returns true if the task holds the spool lock, which it does while it
+ * reads or writes the spool flash. A task deleted then would never
+ * release the lock and every later enqueue would block on it.
+ * @param xTaskHandle task Task
+ * @return int Holds/Does not hold the lock
+ */
+uint8 mqtt_queue_spooling(xTaskHandle task) {
+    return (task != NULL) && (spool_owner == task);
+}
+
+/**
+ * Makes room in the MQTT publish queue by moving the oldest message to
+ * the spool. If the spool is not available the message is dropped. The
+ * message is held at the head while it is written to flash, so the
+ * publisher and the ISR producers can not send or drop it meanwhile.
+ * Returns the status of the drop as defined in MQTT_RING_STATUS.
+ * @param none
+ * @return int Success/Fail
+ */
+uint8 mqtt_queue_spill() {
+    struct MqttRecord record = {0};
+
+    if (!spool_ready) {
+        return mqtt_ring_drop(&outgoing_ring);
+    }
+
+    // One spill at a time, a second one waits for the next head
+    spool_take();
+
+    uint8 error = mqtt_ring_hold(&outgoing_ring, &record);
+
+    if (error == MQTT_RING_SUCCESS) {
+        if (mqtt_spool_append(&spool, record.topic, record.payload, record.payload_len) != MQTT_SPOOL_SUCCESS) {
+            printf("Failed to spool outgoing data. Will drop the data.\n");
         }
+
+        // The held record is still the head, drop only that one
+        mqtt_ring_set_flags(&outgoing_ring, &record, MQTT_RECORD_ACKED);
+        mqtt_ring_drop_acked(&outgoing_ring);
     }
 
-    last_mqtt_message = md->message->id; // Update message ID
+    spool_give();
+
+    return error;
 }
 
 /**
- * Enqueue data in the MQTT publish queue. Any function that needs to
- * publish any data to the MQTT server can call this function. The
- * message should be formatted in the struct QueueData. Will return
- * error state as defined in MQTT_QUEUE_STATUS by mqtt_conn.h.
- *      MQTT_QUEUE_SUCCESS - Queue success success
- *      MQTT_QUEUE_EXCEEDED - Queue size exceeded
- * @param struct QueueData data Data to be queued
+ * Spills the oldest messages to the spool while the MQTT publish queue is
+ * over MQTT_QUEUE_HIGH_WATER. Called by the MQTT thread every cycle, so
+ * that the ISR producers, which can not write to flash, find room in the
+ * queue during an outage instead of dropping messages. Does nothing
+ * without a spool. Reports the messages the ISR producers dropped.
+ * @param none
+ * @return int No of messages spilled
+ */
+uint16 mqtt_queue_relieve() {
+    static uint32 isr_dropped = 0; // Drops already reported
+    uint16 spilled = 0;
+
+    if (mqtt_session.isr_dropped != isr_dropped) {
+        isr_dropped = mqtt_session.isr_dropped;
+        printf("Queue full. %d messages dropped by ISR producers.\n", isr_dropped);
+    }
+
+    while (spool_ready && (mqtt_ring_used(&outgoing_ring) > MQTT_QUEUE_HIGH_WATER) &&
+           (mqtt_queue_spill() == MQTT_RING_SUCCESS)) {
+        spilled++;
+    }
+
+    return spilled;
+}
+
+/**
+ * Reserves space in the MQTT publish queue for a message of up to
+ * payload_size bytes. The caller formats the payload straight into
+ * record->payload and then calls mqtt_enqueue_commit() with the length
+ * written, or mqtt_enqueue_abort(). This avoids building the message on
+ * the stack and copying it into the queue. If the queue is filled or RAM
+ * availabe is lower than threshold, last messages are moved to the
+ * spool (Or dequeued if there is no spool). Will
+ * return error state as defined in MQTT_QUEUE_STATUS by mqtt_conn.h.
+ *      MQTT_QUEUE_SUCCESS - Reserved
+ *      MQTT_QUEUE_EXCEEDED - Reserved after dequeuing old messages
+ *      MQTT_QUEUE_FAIL - Failed to reserve (record is not valid)
+ * @param char *topic Topic
+ * @param uint16 payload_size Max payload length
+ * @param struct MqttRecord *record Pointer to store the reserved record
  * @return int Success/Fail
  */
-uint8 mqtt_enqueue(struct QueueData data) {
+uint8 mqtt_enqueue_reserve(char *topic, uint16 payload_size, struct MqttRecord *record) {
     int error = MQTT_QUEUE_SUCCESS; // Error state
     int free_ram = xPortGetFreeHeapSize(); // Heap size
-    uint32_t queue_size = uxQueueMessagesWaiting(outgoing_queue); // Queue size
+    uint8 ring_error = MQTT_RING_SUCCESS;
 
-    // Check both free_ram and queue_size before queueing. If queue
-    // is filled or RAM availabe is lower than threshold, last
-    // message is dequeued.
-    if ((free_ram < RAM_THRESHOLD) || (queue_size >= MAX_QUEUE_SIZE)) {
-        printf("RAM: %d B / %d B | Queue: %d / %d\n", free_ram, TOTAL_RAM, queue_size, MAX_QUEUE_SIZE);
-        printf("Queue/RAM exceeded. Dequeuing...\n");
+    // Check free_ram before queueing. If RAM availabe is lower than
+    // threshold, last message is dequeued.
+    if (free_ram < RAM_THRESHOLD) {
+        printf("RAM: %d B / %d B | Queue: %d B / %d B\n", free_ram, TOTAL_RAM, mqtt_ring_used(&outgoing_ring), MQTT_QUEUE_BYTES);
+        printf("RAM exceeded. Dequeuing...\n");
+
+        mqtt_queue_spill();
+        error = MQTT_QUEUE_EXCEEDED;
+    }
+
+    // If the queue is filled, last messages are dequeued until the new
+    // message fits. Messages in flight are never dropped.
+    while ((ring_error = mqtt_ring_reserve(&outgoing_ring, topic, payload_size, record)) == MQTT_RING_FULL) {
+        if (error == MQTT_QUEUE_SUCCESS) {
+            printf("Queue: %d B / %d B | Messages: %d\n", mqtt_ring_used(&outgoing_ring), MQTT_QUEUE_BYTES, mqtt_ring_count(&outgoing_ring));
+            printf("Queue exceeded. Dequeuing...\n");
+        }
+
+        error = MQTT_QUEUE_EXCEEDED;
+
+        if (mqtt_queue_spill() != MQTT_RING_SUCCESS)
+            break;
+    }
+
+    if (ring_error != MQTT_RING_SUCCESS) {
+        printf("Failed to queue outgoing data. Will drop the data.\n");
+        return MQTT_QUEUE_FAIL;
+    }
+
+    return error;
+}
+
+/**
+ * Commits a message reserved with mqtt_enqueue_reserve(). The message is
+ * published from the queue with the given payload length.
+ * @param struct MqttRecord *record Reserved record
+ * @param uint16 payload_len Payload length written
+ * @return none
+ */
+void mqtt_enqueue_commit(struct MqttRecord *record, uint16 payload_len) {
+    mqtt_ring_commit(&outgoing_ring, record, payload_len);
+}
+
+/**
+ * Discards a message reserved with mqtt_enqueue_reserve().
+ * @param struct MqttRecord *record Reserved record
+ * @return none
+ */
+void mqtt_enqueue_abort(struct MqttRecord *record) {
+    mqtt_ring_abort(&outgoing_ring, record);
+}
 
-        struct QueueData publish_sink = {0};
-        xQueueReceive(outgoing_queue, &publish_sink, 0);
+/**
+ * ISR safe version of mqtt_enqueue_reserve(). Can be called from timer
+ * callbacks and interrupts. Does not print. Flash can not be written
+ * from an interrupt, so the MQTT thread keeps the queue under
+ * MQTT_QUEUE_HIGH_WATER with mqtt_queue_relieve(). If the queue still
+ * fills up (No spool, or the MQTT thread is held up), old messages are
+ * dropped and counted in MqttSessionStats.isr_dropped.
+ * @param char *topic Topic
+ * @param uint16 payload_size Max payload length
+ * @param struct MqttRecord *record Pointer to store the reserved record
+ * @return int Success/Fail
+ */
+uint8 mqtt_enqueue_reserve_from_isr(char *topic, uint16 payload_size, struct MqttRecord *record) {
+    int error = MQTT_QUEUE_SUCCESS; // Error state
+    uint8 ring_error = MQTT_RING_SUCCESS;
 
+    while ((ring_error = mqtt_ring_reserve_from_isr(&outgoing_ring, topic, payload_size, record)) == MQTT_RING_FULL) {
         error = MQTT_QUEUE_EXCEEDED;
+
+        if (mqtt_ring_drop_from_isr(&outgoing_ring) != MQTT_RING_SUCCESS)
+            break;
+
+        mqtt_session.isr_dropped++;
+    }
+
+    if (ring_error != MQTT_RING_SUCCESS) {
+        return MQTT_QUEUE_FAIL;
+    }
+
+    return error;
+}
+
+/**
+ * ISR safe version of mqtt_enqueue_commit().
+ * @param struct MqttRecord *record Reserved record
+ * @param uint16 payload_len Payload length written
+ * @return none
+ */
+void mqtt_enqueue_commit_from_isr(struct MqttRecord *record, uint16 payload_len) {
+    mqtt_ring_commit_from_isr(&outgoing_ring, record, payload_len);
+}
+
+/**
+ * ISR safe version of mqtt_enqueue_abort().
+ * @param struct MqttRecord *record Reserved record
+ * @return none
+ */
+void mqtt_enqueue_abort_from_isr(struct MqttRecord *record) {
+    mqtt_ring_abort_from_isr(&outgoing_ring, record);
+}
+
+/**
+ * Enqueue data in the MQTT publish queue. Any function that needs to
+ * publish any data to the MQTT server can call this function. Copies the
+ * message into the queue, producers that format their payload should use
+ * mqtt_enqueue_reserve() instead. Will return error state as defined in
+ * MQTT_QUEUE_STATUS by mqtt_conn.h.
+ *      MQTT_QUEUE_SUCCESS - Queue success success
+ *      MQTT_QUEUE_EXCEEDED - Queue size exceeded
+ *      MQTT_QUEUE_FAIL - Failed to queue
+ * @param char *topic Topic
+ * @param char *payload Payload
+ * @return int Success/Fail
+ */
+uint8 mqtt_enqueue(char *topic, char *payload) {
+    struct MqttRecord record = {0};
+    uint16 payload_len = strlen(payload);
+    uint8 error = mqtt_enqueue_reserve(topic, payload_len, &record);
+
+    if (error != MQTT_QUEUE_FAIL) {
+        memcpy(record.payload, payload, payload_len);
+        mqtt_enqueue_commit(&record, payload_len);
+    }
+
+    return error;
+}
+
+/**
+ * Callback when a PUBACK is received. Releases the in-flight slot that
+ * holds the message with the matching packet ID.
+ * @param unsigned short packet_id Packet ID of the PUBACK
+ * @return none
+ */
+void ICACHE_FLASH_ATTR mqtt_ack_received(unsigned short packet_id) {
+    conn_probe_heard();
+
+    for (int i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+        if (inflight[i].in_use && (inflight[i].packet_id == packet_id)) {
+            if (inflight[i].source == MQTT_SOURCE_SPOOL) {
+                spool_take();
+                mqtt_spool_ack(&spool, &inflight[i].cursor);
+                spool_give();
+            } else {
+                mqtt_ring_set_flags(&outgoing_ring, &inflight[i].record, MQTT_RECORD_ACKED);
+            }
+
+            inflight[i].in_use = 0;
+            inflight_count--;
+            break;
+        }
+    }
+
+    // Dequeue the messages that are delivered
+    mqtt_ring_drop_acked(&outgoing_ring);
+}
+
+/**
+ * Sends the message held in an in-flight slot without waiting for the
+ * PUBACK. A resend reuses the packet ID of the first send with the dup
+ * flag set. Spooled messages are read back from flash. Returns error
+ * state as defined in MQTT_MESSAGE_STATUS by mqtt_conn.h.
+ *      MQTT_MESSAGE_SUCCESS - Sent
+ *      MQTT_BUFFER_LENGTH_EXCEED - Message can never fit the MQTT buffer
+ *      MQTT_PUBLISH_ERROR - Send error
+ * @param struct InflightSlot *slot Slot to send
+ * @return int Success/Fail
+ */
+uint8 mqtt_inflight_send(struct InflightSlot *slot) {
+    char *topic = slot->record.topic;
+
+    MQTTMessage message = {
+        .payload = slot->record.payload,
+        .payloadlen = slot->record.payload_len,
+        .dup = (slot->dup || (slot->retry > 0)),
+        .qos = QOS1,
+        .retained = 0,
+        .id = slot->packet_id
+    };
+
+    if (slot->source == MQTT_SOURCE_SPOOL) {
+        struct SpoolEntry entry = {0};
+        struct SpoolCursor cursor = slot->cursor;
+
+        spool_take();
+        uint8 spool_error = mqtt_spool_read(&spool, &cursor, spool_buf, sizeof(spool_buf), &entry);
+        spool_give();
+
+        if (spool_error == MQTT_SPOOL_TOO_LARGE) {
+            printf("MQTT message does not fit the buffer.\n");
+            return MQTT_BUFFER_LENGTH_EXCEED;
+        } else if ((spool_error != MQTT_SPOOL_SUCCESS) || (cursor.offset != slot->cursor.offset) || (cursor.seq != slot->cursor.seq)) {
+            // Overwritten or corrupt, nothing to send
+            return MQTT_BUFFER_LENGTH_EXCEED;
+        }
+
+        topic = entry.topic;
+        message.payload = entry.payload;
+        message.payloadlen = entry.payload_len;
+    }
+
+    int error = MQTTPublishAsync(&client, topic, &message);
+
+    slot->packet_id = message.id;
+    slot->sent_at = xTaskGetTickCount();
+
+    if (error == BUFFER_OVERFLOW) {
+        printf("MQTT message does not fit the buffer.\n");
+        return MQTT_BUFFER_LENGTH_EXCEED;
+    } else if (error != SUCCESS) {
+        printf("Failed to publish to MQTT client.\n");
+        return MQTT_PUBLISH_ERROR;
     }
 
-    xQueueSendToBack(outgoing_queue, &data, 0); // Queue message
+    return MQTT_MESSAGE_SUCCESS;
+}
+
+/**
+ * Returns true if spool cursor a is before cursor b.
+ * @param struct SpoolCursor *a Cursor
+ * @param struct SpoolCursor *b Cursor
+ * @return int Before/Not before
+ */
+static uint8 spool_cursor_before(struct SpoolCursor *a, struct SpoolCursor *b) {
+    return ((int32)(a->seq - b->seq) < 0) || ((a->seq == b->seq) && (a->offset < b->offset));
+}
+
+/**
+ * Releases every unacknowledged message in the in-flight window. The
+ * messages stay in the outgoing queue (Or the spool) in their original
+ * order and are sent again on the next attempt, with the dup flag.
+ * @param none
+ * @return none
+ */
+void mqtt_inflight_requeue() {
+    for (int i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+        inflight[i].in_use = 0;
+    }
+
+    inflight_count = 0;
+    mqtt_ring_release(&outgoing_ring);
+
+    // Spooled messages are replayed from the start of the spool
+    if (spool_cursor_before(&spool_sent, &spool_replay)) {
+        spool_sent = spool_replay;
+    }
+}
+
+/**
+ * Claims the next message to send into an in-flight slot. Spooled
+ * messages go first as they are older than the ones in the queue.
+ * Returns MQTT_RING_SUCCESS if a message was claimed.
+ * @param struct InflightSlot *slot Slot to fill
+ * @return int Success/Fail
+ */
+uint8 mqtt_inflight_claim(struct InflightSlot *slot) {
+    if (spool_ready) {
+        struct SpoolEntry entry = {0};
+
+        spool_take();
+
+        uint8 spool_error = mqtt_spool_read(&spool, &spool_replay, spool_buf, sizeof(spool_buf), &entry);
+
+        if (spool_error == MQTT_SPOOL_SUCCESS || spool_error == MQTT_SPOOL_TOO_LARGE) {
+            slot->source = MQTT_SOURCE_SPOOL;
+            slot->cursor = spool_replay;
+            slot->dup = spool_cursor_before(&spool_replay, &spool_sent);
+            mqtt_spool_next(&spool, &spool_replay);
+        }
+
+        spool_give();
+
+        if (slot->source == MQTT_SOURCE_SPOOL) {
+            return MQTT_RING_SUCCESS;
+        }
+    }
+
+    slot->source = MQTT_SOURCE_QUEUE;
+
+    uint8 error = mqtt_ring_claim(&outgoing_ring, &slot->record);
+
+    slot->dup = ((slot->record.flags & MQTT_RECORD_DUP) != 0);
 
     return error;
 }
 
 /**
- * Calls mqtt_publish() to publish the messages in the MQTT incoming queue.
- * This function must be called after MQTT is connected. Returns error
- * state as defined in MQTT_QUEUE_STATUS by mqtt_conn.h.
+ * Drops an in-flight message that can never be sent.
+ * @param struct InflightSlot *slot Slot to drop
+ * @return none
+ */
+void mqtt_inflight_drop(struct InflightSlot *slot) {
+    if (slot->source == MQTT_SOURCE_SPOOL) {
+        spool_take();
+        mqtt_spool_ack(&spool, &slot->cursor);
+        spool_give();
+    } else {
+        mqtt_ring_set_flags(&outgoing_ring, &slot->record, MQTT_RECORD_ACKED);
+        mqtt_ring_drop_acked(&outgoing_ring);
+    }
+
+    slot->in_use = 0;
+    inflight_count--;
+}
+
+/**
+ * Publishes the messages in the MQTT outgoing queue. Up to
+ * MQTT_INFLIGHT_WINDOW QoS1 messages are kept in flight at once and each
+ * is only released once its PUBACK arrives, so draining a backlog is
+ * bound by bandwidth rather than the broker round trip. A message not
+ * acknowledged within MQTT_ACK_TIMEOUT is resent up to MAX_RETRY_COUNT
+ * times. New messages are only sent for MQTT_PUBLISH_BUDGET, after which
+ * the window is drained and the rest is left for the next cycle, so a
+ * producer that keeps up with the link cannot hold the MQTT thread. This
+ * function must be called after MQTT is connected. Returns error state as
+ * defined in MQTT_QUEUE_STATUS by mqtt_conn.h.
  *      MQTT_QUEUE_SUCCESS - Queue success success
- *      MQTT_QUEUE_FAIL - At least 1 message failed to publish
+ *      MQTT_QUEUE_FAIL - At least 1 message failed to publish (Send error
+ *                      or PUBACK timeout, the connection is suspect)
+ *      MQTT_QUEUE_DROPPED - Published, but messages too large for the
+ *                      MQTT buffer (Or overwritten in the spool) were
+ *                      dropped. The connection is fine
  *      MQTT_CONNECTION_DISCONNECT - Disconnected
  * @param none
  * @return int Success/Fail
@@ -288,43 +1083,83 @@ uint8 mqtt_queue_publish() {
     // Check if connected
     if (client.isconnected) {
         int error_count = 0; // Will hold the no of failed publishes
+        int drop_count = 0; // Will hold the no of messages dropped
+        portTickType started = xTaskGetTickCount();
 
-        printf("Ready to publish %d messages in queue...\n", uxQueueMessagesWaiting(outgoing_queue));
+        printf("Ready to publish %d messages in queue...\n", mqtt_ring_count(&outgoing_ring));
 
-        // While the queue still has messages
-        while (uxQueueMessagesWaiting(outgoing_queue) > 0) {
-            mqtt_status = MQTT_PUBLISHING; // Status set to prevent conflicts
+        if (spool_ready) {
+            // Unacked messages in the spool are sent again from the start
+            spool_take();
+            printf("Ready to publish %d spooled messages...\n", mqtt_spool_count(&spool));
+            mqtt_spool_first(&spool, &spool_replay);
+            spool_give();
+        }
 
-            int retry = 0;
+        // While the queue or the window still has messages
+        while (TRUE) {
             uint8 mqtt_error = MQTT_MESSAGE_SUCCESS;
+            uint8 in_budget = ((xTaskGetTickCount() - started) < (MQTT_PUBLISH_BUDGET / portTICK_RATE_MS));
 
-            vTaskDelay(MQTT_PUBLISH_TIMEOUT);
-
-            // Check retry count
-            while (retry < MAX_RETRY_COUNT) {
-                struct QueueData publish_data = {0};
+            // Fill the window
+            for (int i = 0; in_budget && (i < MQTT_INFLIGHT_WINDOW) && (mqtt_error != MQTT_PUBLISH_ERROR); i++) {
+                if (inflight[i].in_use)
+                    continue;
 
                 // Retrieve data
-                if (xQueuePeek(outgoing_queue, &publish_data, 0) != pdPASS) {
-                    printf("Failed to read publish queue.\n");
-                    continue;
-                }
+                inflight[i].source = MQTT_SOURCE_QUEUE;
+
+                if (mqtt_inflight_claim(&inflight[i]) != MQTT_RING_SUCCESS)
+                    break;
+
+                mqtt_status = MQTT_PUBLISHING; // Status set to prevent conflicts
+                conn_state_set(CONN_MQTT_PUBLISHING);
+
+                inflight[i].in_use = 1;
+                inflight[i].retry = 0;
+                inflight[i].packet_id = 0;
+                inflight_count++;
 
                 // Publish
-                mqtt_error = mqtt_publish(publish_data.payload, publish_data.topic, strlen(publish_data.payload), QOS1, 0);
+                mqtt_error = mqtt_inflight_send(&inflight[i]);
 
-                if (mqtt_error != MQTT_PUBLISH_ERROR) {
-                    // If successful, dequeue message
-                    if (xQueueReceive(outgoing_queue, &publish_data, 0) != pdPASS) {
-                        /* Process received data */
-                        printf("Failed to dequeue publish queue.\n");
-                    }
-                    
-                    break;
+                if (mqtt_error == MQTT_BUFFER_LENGTH_EXCEED) {
+                    // Can never be sent, drop it
+                    mqtt_inflight_drop(&inflight[i]);
+                    drop_count++;
+                }
+            }
+
+            // Nothing left to send or to wait on
+            if ((inflight_count == 0) && (mqtt_error != MQTT_PUBLISH_ERROR))
+                break;
+
+            // Collect the PUBACKs that arrived. Returns as soon as one does, so
+            // the window is refilled without waiting out the timeout
+            if ((mqtt_error != MQTT_PUBLISH_ERROR) && (MQTTPoll(&client, MQTT_PUBLISH_TIMEOUT) == DISCONNECTED)) {
+                mqtt_error = MQTT_PUBLISH_ERROR;
+            }
+
+            // Resend the messages whose PUBACK timed out
+            portTickType now = xTaskGetTickCount();
+
+            for (int i = 0; (i < MQTT_INFLIGHT_WINDOW) && (mqtt_error != MQTT_PUBLISH_ERROR); i++) {
+                if (!inflight[i].in_use || ((now - inflight[i].sent_at) < (MQTT_ACK_TIMEOUT / portTICK_RATE_MS)))
+                    continue;
+
+                if (inflight[i].retry >= MAX_RETRY_COUNT) {
+                    mqtt_error = MQTT_PUBLISH_ERROR;
                 } else {
                     // Retry otherwise
                     printf("Retrying...\n");
-                    retry++;
+                    inflight[i].retry++;
+                    mqtt_error = mqtt_inflight_send(&inflight[i]);
+
+                    if (mqtt_error == MQTT_BUFFER_LENGTH_EXCEED) {
+                        // Spooled message was overwritten
+                        mqtt_inflight_drop(&inflight[i]);
+                        drop_count++;
+                    }
                 }
             }
 
@@ -332,18 +1167,24 @@ uint8 mqtt_queue_publish() {
                 // Publish error (Will break because if this timed out
                 // we know the others will not and must not be looped again)
                 printf("Publishing timed out. Giving up. Will try again...\n");
+                mqtt_inflight_requeue();
                 error_count++;
                 break;
-            } else if (mqtt_error != MQTT_MESSAGE_SUCCESS) {
-                // Publish success
-                error_count++;
             }
         }
 
+        if ((error_count == 0) && (mqtt_ring_count(&outgoing_ring) > 0)) {
+            printf("Publish budget used. %d messages left for the next cycle.\n", mqtt_ring_count(&outgoing_ring));
+        }
+
         if (error_count > 0) {
             // At least one publish failed
             printf("Publishing failed in one or more instances.\n");
             return MQTT_QUEUE_FAIL;
+        } else if (drop_count > 0) {
+            // The link is fine, only the dropped messages were lost
+            printf("MQTT publish queue cleared. %d messages dropped.\n", drop_count);
+            return MQTT_QUEUE_DROPPED;
         } else {
             // Publish success
             printf("MQTT publish queue cleared.\n");
@@ -388,8 +1229,13 @@ uint8 mqtt_publish(char *mqtt_message, char *mqtt_topic, uint16 mqtt_message_siz
                 .retained = retained
             };
 
-            // Publish
-            int error = MQTTPublish(&client, mqtt_topic, &message);
+            // Publish. QoS0 completes once sent, QoS1/2 on the ack read by MQTTPoll
+            struct MqttOp ack = {0};
+            int error = FAILURE;
+
+            if (MQTTPublishSubmit(&client, mqtt_topic, &message, mqtt_op_finished, &ack) == SUCCESS) {
+                error = mqtt_op_wait(&ack);
+            }
 
             if (error == 0) {
                 // Publish successful
@@ -416,7 +1262,9 @@ uint8 mqtt_publish(char *mqtt_message, char *mqtt_topic, uint16 mqtt_message_siz
 
 /**
  * Fake publish for fake traffic. It adds a text string every x times.
- * Also dequeues any messages on subscribe queue and prints it.
+ * Also dequeues any messages on subscribe queue and prints it. The
+ * outgoing queue is locked, so this does not need to wait for the MQTT
+ * thread to finish publishing.
  * FOR TESTING PURPOSES ONLY
  * @param char *topic Publish topic
  * @return none
@@ -426,38 +1274,28 @@ void fake_publish(char *topic) {
 
     // Check if valid time is available
     if (current_time > SNTP_EPOCH_THRESHOLD) {
-        struct QueueData outgoing_data = {0};
-        char data[MAX_MQTT_PAYLOAD] = {0};
-        char timestamp[TIMESTAMP_SIZE] = {0};
-
-        // Get current time in string format: DD-MM-YYYY hh:mm:ss
-        time_to_str(&timestamp, current_time);
+        struct MqttRecord record = {0};
 
         // Create a dummy MQTT message in format:
-        // [DD-MM-YYYY hh:mm:ss ESP says: X]
-        // X increase after every publish
-        sprintf(data, "[%s] %s says: %d\0", timestamp, unique_identifier, counter);
+        // [DD-MM-YYYY hh:mm:ss] ESP says: X
+        // X increase after every publish. Written straight into the queue.
+        if (mqtt_enqueue_reserve(topic, MAX_MQTT_PAYLOAD, &record) != MQTT_QUEUE_FAIL) {
+            // Get current time in string format: DD-MM-YYYY hh:mm:ss
+            record.payload[0] = '[';
+            time_to_str(record.payload + 1, current_time);
 
-        // Topic and message set
-        strcpy(outgoing_data.topic, topic);
-        strcpy(outgoing_data.payload, data);
+            int length = strlen(record.payload);
+            length += snprintf(record.payload + length, MAX_MQTT_PAYLOAD + 1 - length, "] %s says: %lu", unique_identifier, counter);
 
-        while (TRUE) {
-            // While publishing didn't succeed, try to enqueue the
-            // MQTT message. Will not enqueue until mqtt_status is
-            // MQTT_ACTIVE or MQTT_PUBLISHING
-            if (!((mqtt_status == MQTT_ACTIVE) || (mqtt_status == MQTT_PUBLISHING))) {
-                mqtt_enqueue(outgoing_data);
-                break;
-            }
+            mqtt_enqueue_commit(&record, length);
         }
 
         // Check subscribe queue has messages and print
-        while (uxQueueMessagesWaiting(incoming_queue) > 0) {
-            struct QueueData incoming_data = {0};
+        struct MqttRecord incoming = {0};
 
-            xQueueReceive(incoming_queue, &incoming_data, 0);
-            printf("Server Says: [Topic: %s | Payload: %s]\n", incoming_data.topic, incoming_data.payload);
+        while (mqtt_inbound_peek(&incoming) == MQTT_RING_SUCCESS) {
+            printf("Server Says: [Topic: %s | Payload: %.*s]\n", incoming.topic, incoming.payload_len, incoming.payload);
+            mqtt_inbound_drop();
         }
 
         counter++;
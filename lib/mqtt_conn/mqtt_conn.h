@@ -19,17 +19,46 @@
  */
 
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 #include "paho/MQTTClient.h"
 #include "paho/MQTTESP8266.h"
+#include "mqtt_ring.h"
+#include "mqtt_spool.h"
+#include "mqtt_dedup.h"
+#include "mqtt_topic.h"
 #include "../../include/app_conf.h"
 
-// Struct to hold the MQTT data. Both topic and payload as per the
-// requirement of MQTT client.
-struct QueueData {
-    char topic[MAX_MQTT_TOPIC_SIZE];
-    char payload[MAX_MQTT_PAYLOAD];
+// View of an incoming message. Topic and payload point into the MQTT
+// read buffer, are not NUL terminated and are only valid until the
+// handler returns. Payloads may be binary. Messages too large for the
+// read buffer arrive as consecutive chunks of the payload.
+struct MqttInbound {
+    const char *topic;      // Topic
+    uint16 topic_len;       // Topic length
+    const char *payload;    // Payload (Or chunk)
+    uint16 payload_len;     // Payload (Or chunk) length
+    uint8 qos;              // QoS
+    uint8 retained;         // Retained flag
+    uint32 offset;          // Position of the chunk in the payload (0 if whole)
+    uint32 total;           // Payload length (payload_len if whole)
+};
+
+// Handler of incoming messages. Parses the message in place, or calls
+// mqtt_inbound_defer() to keep a copy for later.
+typedef void (*MqttInboundHandler)(struct MqttInbound *message);
+
+// Struct to hold the MQTT session counters. Used to verify that a
+// persistent session is kept alive rather than reconnected.
+struct MqttSessionStats {
+    uint32 connect_count;       // No of successful MQTT connects
+    uint32 disconnect_count;    // No of times the connection was closed
+    portTickType connected_at;  // Tick at which the current session started
+    uint32 duplicates;          // Redelivered incoming messages dropped
+    uint32 inbound_dropped;     // Incoming messages dropped with the incoming ring full
+    uint32 isr_dropped;         // Outgoing messages dropped by ISR producers with the queue full
 };
 
 // Type to hold the MQTT connection status
@@ -48,7 +77,8 @@ typedef enum {
     MQTT_MESSAGE_SUCCESS,       // Success
     MQTT_TOPIC_LENGTH_EXCEEDED, // Topic length too long
     MQTT_BUFFER_LENGTH_EXCEED,  // Message length too long
-    MQTT_PUBLISH_ERROR          // Publish error
+    MQTT_PUBLISH_ERROR,         // Publish error
+    MQTT_SUBSCRIBE_ERROR        // Subscribe failed, retried on the backoff
 } MQTT_MESSAGE_STATUS;
 
 // Type to hold the MQTT queue publish status
@@ -56,15 +86,36 @@ typedef enum {
     MQTT_QUEUE_SUCCESS,         // Success
     MQTT_QUEUE_FAIL,            // At least 1 message failed to publish
     MQTT_CONNECTION_DISCONNECT, // Disconnected
-    MQTT_QUEUE_EXCEEDED         // Queue size exceeded
+    MQTT_QUEUE_EXCEEDED,        // Queue size exceeded
+    MQTT_QUEUE_DROPPED          // Published, but messages that can never be sent were dropped
 } MQTT_QUEUE_STATUS;
 
 void mqtt_queue_init(int max_size);
 uint8 mqtt_connect(char *mqtt_host, char *mqtt_client_id, int mqtt_port, int mqtt_timeout, int mqtt_buff_length);
 void mqtt_disconnect();
+uint8 mqtt_is_connected();
+uint8 mqtt_keep_alive(int timeout_ms);
+uint32 mqtt_session_age();
+void mqtt_get_session_stats(struct MqttSessionStats *stats);
 uint8 mqtt_check_topic(char *topic, int qos_state);
 void ICACHE_FLASH_ATTR topic_received(MessageData* md);
-uint8 mqtt_enqueue(struct QueueData data);
+int ICACHE_FLASH_ATTR topic_streamed(MessageData* md, size_t offset, size_t total);
+uint8 mqtt_inbound_route(char *filter, MqttInboundHandler handler);
+uint8 mqtt_inbound_defer(struct MqttInbound *message);
+uint8 mqtt_inbound_peek(struct MqttRecord *record);
+void mqtt_inbound_drop();
+uint8 mqtt_enqueue_reserve(char *topic, uint16 payload_size, struct MqttRecord *record);
+void mqtt_enqueue_commit(struct MqttRecord *record, uint16 payload_len);
+void mqtt_enqueue_abort(struct MqttRecord *record);
+uint8 mqtt_enqueue_reserve_from_isr(char *topic, uint16 payload_size, struct MqttRecord *record);
+void mqtt_enqueue_commit_from_isr(struct MqttRecord *record, uint16 payload_len);
+void mqtt_enqueue_abort_from_isr(struct MqttRecord *record);
+uint8 mqtt_queue_spill();
+uint16 mqtt_queue_relieve();
+uint8 mqtt_queue_spooling(xTaskHandle task);
+uint8 mqtt_enqueue(char *topic, char *payload);
+void ICACHE_FLASH_ATTR mqtt_ack_received(unsigned short packet_id);
+void mqtt_inflight_requeue();
 uint8 mqtt_queue_publish();
 uint8 mqtt_publish(char *mqtt_message, char *mqtt_topic, uint16 mqtt_message_size, enum QoS qos_state, uint8 retained);
 void fake_publish(char *topic);
@@ -0,0 +1,118 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: mqtt_dedup.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Sliding window over the packet IDs of recent incoming
+ * messages. Detects QoS1/2 messages redelivered by the broker in O(1).
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "esp_common.h"
+#include "mqtt_dedup.h"
+
+/**
+ * Sets or clears the bit of a packet ID.
+ * @param MqttDedup *dedup Window
+ * @param uint16 packet_id Packet ID
+ * @param uint8 seen Set/Clear
+ * @return none
+ */
+static void mqtt_dedup_mark(MqttDedup *dedup, uint16 packet_id, uint8 seen) {
+    uint16 bit = packet_id % MQTT_DEDUP_WINDOW;
+
+    if (seen) {
+        dedup->bitmap[bit / 32] |= (1u << (bit % 32));
+    } else {
+        dedup->bitmap[bit / 32] &= ~(1u << (bit % 32));
+    }
+}
+
+/**
+ * Returns true if the bit of a packet ID is set.
+ * @param MqttDedup *dedup Window
+ * @param uint16 packet_id Packet ID
+ * @return int True/False
+ */
+static uint8 mqtt_dedup_seen(MqttDedup *dedup, uint16 packet_id) {
+    uint16 bit = packet_id % MQTT_DEDUP_WINDOW;
+
+    return (dedup->bitmap[bit / 32] >> (bit % 32)) & 1;
+}
+
+/**
+ * Forgets every packet ID. Called when the broker session ends, as the
+ * broker does not redeliver messages of an old session.
+ * @param MqttDedup *dedup Window
+ * @return none
+ */
+void mqtt_dedup_reset(MqttDedup *dedup) {
+    memset(dedup, 0, sizeof(MqttDedup));
+}
+
+/**
+ * Checks an incoming message against the window and records its ID.
+ * Only messages with the DUP flag are reported as duplicates, as the
+ * broker may reuse an ID for a new message once it has been acknowledged.
+ * IDs older than the window are reported as new. Returns the result as
+ * defined in MQTT_DEDUP_STATUS.
+ *      MQTT_DEDUP_NEW - Deliver the message
+ *      MQTT_DEDUP_DUPLICATE - Redelivery, drop the message
+ * @param MqttDedup *dedup Window
+ * @param uint16 packet_id Packet ID (0 for QoS0)
+ * @param uint8 dup DUP flag of the message
+ * @return int New/Duplicate
+ */
+uint8 mqtt_dedup_check(MqttDedup *dedup, uint16 packet_id, uint8 dup) {
+    if (packet_id == 0) {
+        // QoS0 messages are never redelivered
+        return MQTT_DEDUP_NEW;
+    }
+
+    if (dedup->newest == 0) {
+        dedup->newest = packet_id;
+        mqtt_dedup_mark(dedup, packet_id, TRUE);
+        return MQTT_DEDUP_NEW;
+    }
+
+    // Distance behind the newest ID. IDs wrap from 65535 to 1, counting in
+    // 16 bits keeps (id % MQTT_DEDUP_WINDOW) consistent across the wrap.
+    // IDs more than half the range behind are ahead of it.
+    uint16 behind = (uint16)(dedup->newest - packet_id);
+
+    if (behind > 0x8000) {
+        uint16 ahead = (uint16)(packet_id - dedup->newest);
+
+        if (ahead >= MQTT_DEDUP_WINDOW) {
+            memset(dedup->bitmap, 0, sizeof(dedup->bitmap));
+        } else {
+            // Forget the IDs that fall out of the window
+            for (uint16 i = 1; i <= ahead; i++) {
+                mqtt_dedup_mark(dedup, (uint16)(dedup->newest + i), FALSE);
+            }
+        }
+
+        dedup->newest = packet_id;
+        mqtt_dedup_mark(dedup, packet_id, TRUE);
+        return MQTT_DEDUP_NEW;
+    }
+
+    if (behind >= MQTT_DEDUP_WINDOW) {
+        return MQTT_DEDUP_NEW;
+    }
+
+    if (dup && mqtt_dedup_seen(dedup, packet_id)) {
+        return MQTT_DEDUP_DUPLICATE;
+    }
+
+    mqtt_dedup_mark(dedup, packet_id, TRUE);
+
+    return MQTT_DEDUP_NEW;
+}
@@ -0,0 +1,42 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: mqtt_dedup.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Sliding window over the packet IDs of recent incoming
+ * messages. Detects QoS1/2 messages redelivered by the broker in O(1).
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef MQTT_DEDUP_H
+#define MQTT_DEDUP_H
+
+#include "esp_common.h"
+#include "../../include/app_conf.h"
+
+#define MQTT_DEDUP_WORDS ((MQTT_DEDUP_WINDOW + 31) / 32)
+
+// Window state. Bit (id % MQTT_DEDUP_WINDOW) is set if the ID was seen
+// and is within MQTT_DEDUP_WINDOW IDs of the newest ID.
+typedef struct {
+    uint32 bitmap[MQTT_DEDUP_WORDS];    // Seen IDs
+    uint16 newest;                      // Newest ID seen (0 if none)
+} MqttDedup;
+
+// Type to hold the result of a check
+typedef enum {
+    MQTT_DEDUP_NEW,         // Not seen, or seen outside the window
+    MQTT_DEDUP_DUPLICATE    // Redelivery of a message in the window
+} MQTT_DEDUP_STATUS;
+
+void mqtt_dedup_reset(MqttDedup *dedup);
+uint8 mqtt_dedup_check(MqttDedup *dedup, uint16 packet_id, uint8 dup);
+
+#endif
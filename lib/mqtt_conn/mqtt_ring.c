@@ -0,0 +1,657 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: mqtt_ring.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Byte-granular ring buffer arena that stores MQTT messages
+ * as variable-length records (Topic + Payload).
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "esp_common.h"
+#include "mqtt_ring.h"
+
+// Constants ----------------------------------------------------------
+
+#define MQTT_RING_HEADER_SIZE sizeof(struct MqttRecordHeader)
+
+// The ring is shared between the producers and the MQTT thread. All
+// changes to the ring state are done with interrupts masked. Payloads
+// are written outside the lock. The _from_isr functions use the ISR
+// variant of the lock.
+#define MQTT_RING_LOCK() taskENTER_CRITICAL()
+#define MQTT_RING_UNLOCK() taskEXIT_CRITICAL()
+#define MQTT_RING_LOCK_FROM_ISR() portSET_INTERRUPT_MASK_FROM_ISR()
+#define MQTT_RING_UNLOCK_FROM_ISR(mask) portCLEAR_INTERRUPT_MASK_FROM_ISR(mask)
+
+// --------------------------------------------------------------------
+
+/**
+ * Returns the header of the record at the given offset.
+ * @param MqttRing *ring Ring
+ * @param uint32 offset Offset of the record
+ * @return struct MqttRecordHeader* Header
+ */
+static struct MqttRecordHeader *mqtt_ring_header(MqttRing *ring, uint32 offset) {
+    return (struct MqttRecordHeader *)(ring->buf + offset);
+}
+
+/**
+ * Fills a record view from the record at the given offset.
+ * @param MqttRing *ring Ring
+ * @param uint32 offset Offset of the record
+ * @param uint16 index Position from the head
+ * @param struct MqttRecord *record View to fill
+ * @return none
+ */
+static void mqtt_ring_view(MqttRing *ring, uint32 offset, uint16 index, struct MqttRecord *record) {
+    struct MqttRecordHeader *header = mqtt_ring_header(ring, offset);
+
+    record->offset = offset;
+    record->index = index;
+    record->topic = (char *)(ring->buf + offset + MQTT_RING_HEADER_SIZE);
+    record->payload = record->topic + header->topic_len + 1;
+    record->payload_len = header->payload_len;
+    record->flags = header->flags;
+}
+
+/**
+ * Returns the offset of the record following the given one, stepping over
+ * the pad at the end of the storage.
+ * @param MqttRing *ring Ring
+ * @param uint32 offset Offset of the record
+ * @return uint32 Offset of the next record
+ */
+static uint32 mqtt_ring_step(MqttRing *ring, uint32 offset) {
+    offset += mqtt_ring_header(ring, offset)->size;
+
+    if ((offset >= ring->size) || (mqtt_ring_header(ring, offset)->flags & MQTT_RECORD_PAD)) {
+        offset = 0;
+    }
+
+    return offset;
+}
+
+/**
+ * Removes the record at the head. Must be called with the lock held.
+ * @param MqttRing *ring Ring
+ * @return none
+ */
+static void mqtt_ring_pop(MqttRing *ring) {
+    struct MqttRecordHeader *header = mqtt_ring_header(ring, ring->head);
+
+    ring->used -= header->size;
+    ring->head += header->size;
+    ring->count--;
+
+    if (ring->count == 0) {
+        // Empty, start over from the beginning of the storage
+        ring->head = 0;
+        ring->tail = 0;
+        ring->used = 0;
+    } else if ((ring->head >= ring->size) || (mqtt_ring_header(ring, ring->head)->flags & MQTT_RECORD_PAD)) {
+        // Step over the pad at the end of the storage
+        ring->used -= ring->size - ring->head;
+        ring->head = 0;
+    }
+}
+
+/**
+ * Allocates a record at the tail. The record is not visible to the
+ * publisher until MQTT_RECORD_READY is set. Must be called with the lock
+ * held. Returns error state as defined in MQTT_RING_STATUS.
+ *      MQTT_RING_SUCCESS - Success
+ *      MQTT_RING_FULL - Not enough free space
+ *      MQTT_RING_TOO_LARGE - Record can never fit the ring
+ * @param MqttRing *ring Ring
+ * @param uint32 size Record size (Aligned)
+ * @param uint32 *offset Pointer to store the record offset
+ * @return int Success/Fail
+ */
+static uint8 mqtt_ring_alloc(MqttRing *ring, uint32 size, uint32 *offset) {
+    if (size > ring->size) {
+        return MQTT_RING_TOO_LARGE;
+    }
+
+    if ((ring->tail > ring->head) || (ring->used == 0)) {
+        // Free space is at the end and at the start of the storage
+        if (size > (ring->size - ring->tail)) {
+            if (size > ring->head) {
+                return MQTT_RING_FULL;
+            }
+
+            // Mark the rest of the storage as unused and wrap around
+            if (ring->tail < ring->size) {
+                struct MqttRecordHeader *pad = mqtt_ring_header(ring, ring->tail);
+
+                pad->size = ring->size - ring->tail;
+                pad->flags = MQTT_RECORD_PAD;
+                ring->used += pad->size;
+            }
+
+            ring->tail = 0;
+        }
+    } else if (size > (ring->head - ring->tail)) {
+        // Free space is between the tail and the head
+        return MQTT_RING_FULL;
+    }
+
+    *offset = ring->tail;
+
+    ring->tail += size;
+    ring->used += size;
+    ring->count++;
+
+    if (ring->tail >= ring->size) {
+        ring->tail = 0;
+    }
+
+    return MQTT_RING_SUCCESS;
+}
+
+/**
+ * Initializes a ring on the given storage. The storage must be 4 byte
+ * aligned. Size is rounded down to a multiple of the record alignment and
+ * capped at MQTT_RING_MAX_SIZE.
+ * @param MqttRing *ring Ring
+ * @param uint8 *storage Storage
+ * @param uint32 size Storage size (in bytes)
+ * @return none
+ */
+void mqtt_ring_init(MqttRing *ring, uint8 *storage, uint32 size) {
+    if (size > MQTT_RING_MAX_SIZE) {
+        size = MQTT_RING_MAX_SIZE;
+    }
+
+    ring->buf = storage;
+    ring->size = size & ~7;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->used = 0;
+    ring->count = 0;
+}
+
+/**
+ * Returns the number of bytes a record of the given size takes in the
+ * ring.
+ * @param uint8 topic_len Topic length
+ * @param uint16 payload_len Payload length
+ * @return int Record size (in bytes)
+ */
+uint32 mqtt_ring_record_size(uint8 topic_len, uint16 payload_len) {
+    return MQTT_RING_ALIGN(MQTT_RING_HEADER_SIZE + topic_len + 1 + payload_len + 1);
+}
+
+/**
+ * Allocates a record and copies the topic. Must be called with the lock
+ * held. The header is written after the allocation but the record stays
+ * invisible to the publisher until it is committed.
+ * @param MqttRing *ring Ring
+ * @param char *topic Topic (Need not be NUL terminated)
+ * @param uint32 topic_len Topic length
+ * @param uint16 payload_size Max payload length
+ * @param struct MqttRecord *record View to fill
+ * @return int Success/Fail
+ */
+static uint8 mqtt_ring_reserve_locked(MqttRing *ring, const char *topic, uint32 topic_len, uint16 payload_size, struct MqttRecord *record) {
+    uint32 offset = 0;
+
+    if (topic_len > 255) {
+        return MQTT_RING_TOO_LARGE;
+    }
+
+    uint32 size = mqtt_ring_record_size(topic_len, payload_size);
+    uint8 error = mqtt_ring_alloc(ring, size, &offset);
+
+    if (error != MQTT_RING_SUCCESS) {
+        return error;
+    }
+
+    struct MqttRecordHeader *header = mqtt_ring_header(ring, offset);
+
+    header->size = size;
+    header->payload_len = payload_size;
+    header->topic_len = topic_len;
+    header->flags = 0;
+    header->packet_id = 0;
+
+    mqtt_ring_view(ring, offset, ring->count - 1, record);
+    memcpy(record->topic, topic, topic_len);
+    record->topic[topic_len] = '\0';
+
+    return MQTT_RING_SUCCESS;
+}
+
+/**
+ * Sets the final payload length of a reserved record and makes it
+ * visible to the publisher. Must be called with the lock held.
+ * @param MqttRing *ring Ring
+ * @param struct MqttRecord *record Reserved record
+ * @param uint16 payload_len Payload length written
+ * @return none
+ */
+static void mqtt_ring_commit_locked(MqttRing *ring, struct MqttRecord *record, uint16 payload_len) {
+    struct MqttRecordHeader *header = mqtt_ring_header(ring, record->offset);
+
+    // Can not grow past the reserved size
+    if (payload_len > header->payload_len) {
+        payload_len = header->payload_len;
+    }
+
+    header->payload_len = payload_len;
+    header->flags = MQTT_RECORD_READY;
+    record->payload[payload_len] = '\0';
+    record->payload_len = payload_len;
+    record->flags = header->flags;
+}
+
+/**
+ * Discards a reserved record. The space is returned once the record
+ * reaches the head. Must be called with the lock held.
+ * @param MqttRing *ring Ring
+ * @param struct MqttRecord *record Reserved record
+ * @return none
+ */
+static void mqtt_ring_abort_locked(MqttRing *ring, struct MqttRecord *record) {
+    mqtt_ring_header(ring, record->offset)->flags = MQTT_RECORD_ACKED;
+    record->flags = MQTT_RECORD_ACKED;
+
+    while ((ring->count > 0) && (mqtt_ring_header(ring, ring->head)->flags & MQTT_RECORD_ACKED)) {
+        mqtt_ring_pop(ring);
+    }
+}
+
+/**
+ * Reserves a record for a payload of up to payload_size bytes. The caller
+ * writes the payload straight into record->payload and then calls
+ * mqtt_ring_commit() or mqtt_ring_abort(). Records are published in the
+ * order they are reserved, so a reservation should be committed quickly.
+ * Returns error state as defined in MQTT_RING_STATUS.
+ *      MQTT_RING_SUCCESS - Success
+ *      MQTT_RING_FULL - Not enough free space
+ *      MQTT_RING_TOO_LARGE - Record can never fit the ring
+ * @param MqttRing *ring Ring
+ * @param char *topic Topic
+ * @param uint16 payload_size Max payload length
+ * @param struct MqttRecord *record View to fill
+ * @return int Success/Fail
+ */
+uint8 mqtt_ring_reserve(MqttRing *ring, const char *topic, uint16 payload_size, struct MqttRecord *record) {
+    MQTT_RING_LOCK();
+    uint8 error = mqtt_ring_reserve_locked(ring, topic, strlen(topic), payload_size, record);
+    MQTT_RING_UNLOCK();
+
+    return error;
+}
+
+/**
+ * Commits a reserved record with the length of the payload written.
+ * @param MqttRing *ring Ring
+ * @param struct MqttRecord *record Reserved record
+ * @param uint16 payload_len Payload length written
+ * @return none
+ */
+void mqtt_ring_commit(MqttRing *ring, struct MqttRecord *record, uint16 payload_len) {
+    MQTT_RING_LOCK();
+    mqtt_ring_commit_locked(ring, record, payload_len);
+    MQTT_RING_UNLOCK();
+}
+
+/**
+ * Discards a reserved record.
+ * @param MqttRing *ring Ring
+ * @param struct MqttRecord *record Reserved record
+ * @return none
+ */
+void mqtt_ring_abort(MqttRing *ring, struct MqttRecord *record) {
+    MQTT_RING_LOCK();
+    mqtt_ring_abort_locked(ring, record);
+    MQTT_RING_UNLOCK();
+}
+
+/**
+ * ISR safe version of mqtt_ring_reserve().
+ * @param MqttRing *ring Ring
+ * @param char *topic Topic
+ * @param uint16 payload_size Max payload length
+ * @param struct MqttRecord *record View to fill
+ * @return int Success/Fail
+ */
+uint8 mqtt_ring_reserve_from_isr(MqttRing *ring, const char *topic, uint16 payload_size, struct MqttRecord *record) {
+    unsigned portBASE_TYPE mask = MQTT_RING_LOCK_FROM_ISR();
+    uint8 error = mqtt_ring_reserve_locked(ring, topic, strlen(topic), payload_size, record);
+    MQTT_RING_UNLOCK_FROM_ISR(mask);
+
+    return error;
+}
+
+/**
+ * ISR safe version of mqtt_ring_commit().
+ * @param MqttRing *ring Ring
+ * @param struct MqttRecord *record Reserved record
+ * @param uint16 payload_len Payload length written
+ * @return none
+ */
+void mqtt_ring_commit_from_isr(MqttRing *ring, struct MqttRecord *record, uint16 payload_len) {
+    unsigned portBASE_TYPE mask = MQTT_RING_LOCK_FROM_ISR();
+    mqtt_ring_commit_locked(ring, record, payload_len);
+    MQTT_RING_UNLOCK_FROM_ISR(mask);
+}
+
+/**
+ * ISR safe version of mqtt_ring_abort().
+ * @param MqttRing *ring Ring
+ * @param struct MqttRecord *record Reserved record
+ * @return none
+ */
+void mqtt_ring_abort_from_isr(MqttRing *ring, struct MqttRecord *record) {
+    unsigned portBASE_TYPE mask = MQTT_RING_LOCK_FROM_ISR();
+    mqtt_ring_abort_locked(ring, record);
+    MQTT_RING_UNLOCK_FROM_ISR(mask);
+}
+
+/**
+ * Copies a message into the ring. Returns error state as defined in
+ * MQTT_RING_STATUS.
+ *      MQTT_RING_SUCCESS - Success
+ *      MQTT_RING_FULL - Not enough free space
+ *      MQTT_RING_TOO_LARGE - Record can never fit the ring
+ * @param MqttRing *ring Ring
+ * @param char *topic Topic
+ * @param char *payload Payload
+ * @param uint16 payload_len Payload length
+ * @return int Success/Fail
+ */
+uint8 mqtt_ring_push(MqttRing *ring, const char *topic, const char *payload, uint16 payload_len) {
+    struct MqttRecord record = {0};
+    uint8 error = mqtt_ring_reserve(ring, topic, payload_len, &record);
+
+    if (error == MQTT_RING_SUCCESS) {
+        memcpy(record.payload, payload, payload_len);
+        mqtt_ring_commit(ring, &record, payload_len);
+    }
+
+    return error;
+}
+
+/**
+ * Copies a message whose topic is not NUL terminated (e.g. a slice of
+ * a received packet) into the ring. Returns error state as defined in
+ * MQTT_RING_STATUS.
+ *      MQTT_RING_SUCCESS - Success
+ *      MQTT_RING_FULL - Not enough free space
+ *      MQTT_RING_TOO_LARGE - Record can never fit the ring
+ * @param MqttRing *ring Ring
+ * @param char *topic Topic
+ * @param uint16 topic_len Topic length
+ * @param char *payload Payload
+ * @param uint16 payload_len Payload length
+ * @return int Success/Fail
+ */
+uint8 mqtt_ring_push_len(MqttRing *ring, const char *topic, uint16 topic_len, const char *payload, uint16 payload_len) {
+    struct MqttRecord record = {0};
+
+    MQTT_RING_LOCK();
+    uint8 error = mqtt_ring_reserve_locked(ring, topic, topic_len, payload_len, &record);
+    MQTT_RING_UNLOCK();
+
+    if (error == MQTT_RING_SUCCESS) {
+        memcpy(record.payload, payload, payload_len);
+        mqtt_ring_commit(ring, &record, payload_len);
+    }
+
+    return error;
+}
+
+/**
+ * Returns a view of the oldest record, once it is committed. A record
+ * still being written by its producer is not returned.
+ *      MQTT_RING_SUCCESS - Success
+ *      MQTT_RING_EMPTY - No committed record available
+ * @param MqttRing *ring Ring
+ * @param struct MqttRecord *record View to fill
+ * @return int Success/Fail
+ */
+uint8 mqtt_ring_peek(MqttRing *ring, struct MqttRecord *record) {
+    uint8 error = MQTT_RING_EMPTY;
+
+    MQTT_RING_LOCK();
+
+    if ((ring->count > 0) && (mqtt_ring_header(ring, ring->head)->flags & (MQTT_RECORD_READY | MQTT_RECORD_ACKED))) {
+        mqtt_ring_view(ring, ring->head, 0, record);
+        error = MQTT_RING_SUCCESS;
+    }
+
+    MQTT_RING_UNLOCK();
+
+    return error;
+}
+
+/**
+ * Moves a view to the record that follows it, once that is committed.
+ *      MQTT_RING_SUCCESS - Success
+ *      MQTT_RING_EMPTY - No more committed records
+ * @param MqttRing *ring Ring
+ * @param struct MqttRecord *record View to move
+ * @return int Success/Fail
+ */
+uint8 mqtt_ring_next(MqttRing *ring, struct MqttRecord *record) {
+    uint8 error = MQTT_RING_EMPTY;
+
+    MQTT_RING_LOCK();
+
+    if ((record->index + 1) < ring->count) {
+        uint32 offset = mqtt_ring_step(ring, record->offset);
+
+        if (mqtt_ring_header(ring, offset)->flags & (MQTT_RECORD_READY | MQTT_RECORD_ACKED)) {
+            mqtt_ring_view(ring, offset, record->index + 1, record);
+            error = MQTT_RING_SUCCESS;
+        }
+    }
+
+    MQTT_RING_UNLOCK();
+
+    return error;
+}
+
+/**
+ * Claims the oldest record that is ready and not yet in flight by marking
+ * it MQTT_RECORD_INFLIGHT. Records are claimed strictly in order, so
+ * nothing is claimed past a record that is not yet ready or is held.
+ *      MQTT_RING_SUCCESS - Success
+ *      MQTT_RING_EMPTY - No record available
+ * @param MqttRing *ring Ring
+ * @param struct MqttRecord *record View to fill
+ * @return int Success/Fail
+ */
+uint8 mqtt_ring_claim(MqttRing *ring, struct MqttRecord *record) {
+    uint8 error = MQTT_RING_EMPTY;
+
+    MQTT_RING_LOCK();
+
+    uint32 offset = ring->head;
+
+    for (uint16 i = 0; i < ring->count; i++) {
+        struct MqttRecordHeader *header = mqtt_ring_header(ring, offset);
+
+        if (!(header->flags & (MQTT_RECORD_INFLIGHT | MQTT_RECORD_ACKED))) {
+            if ((header->flags & (MQTT_RECORD_READY | MQTT_RECORD_HELD)) == MQTT_RECORD_READY) {
+                header->flags |= MQTT_RECORD_INFLIGHT;
+                mqtt_ring_view(ring, offset, i, record);
+                error = MQTT_RING_SUCCESS;
+            }
+
+            break;
+        }
+
+        offset = mqtt_ring_step(ring, offset);
+    }
+
+    MQTT_RING_UNLOCK();
+
+    return error;
+}
+
+/**
+ * Holds the oldest record if it is ready and not in flight by marking it
+ * MQTT_RECORD_HELD. A held record is not claimed or dropped, so it can be
+ * read outside the lock (e.g. to be spooled). It stays at the head until
+ * it is marked acked with mqtt_ring_set_flags().
+ *      MQTT_RING_SUCCESS - Success
+ *      MQTT_RING_EMPTY - No record can be held
+ * @param MqttRing *ring Ring
+ * @param struct MqttRecord *record View to fill
+ * @return int Success/Fail
+ */
+uint8 mqtt_ring_hold(MqttRing *ring, struct MqttRecord *record) {
+    uint8 error = MQTT_RING_EMPTY;
+
+    MQTT_RING_LOCK();
+
+    if (ring->count > 0) {
+        struct MqttRecordHeader *header = mqtt_ring_header(ring, ring->head);
+
+        if ((header->flags & (MQTT_RECORD_READY | MQTT_RECORD_INFLIGHT | MQTT_RECORD_ACKED | MQTT_RECORD_HELD)) ==
+            MQTT_RECORD_READY) {
+            header->flags |= MQTT_RECORD_HELD;
+            mqtt_ring_view(ring, ring->head, 0, record);
+            error = MQTT_RING_SUCCESS;
+        }
+    }
+
+    MQTT_RING_UNLOCK();
+
+    return error;
+}
+
+/**
+ * Sets the flags of a record. Used to mark a claimed record as acked.
+ * @param MqttRing *ring Ring
+ * @param struct MqttRecord *record Record
+ * @param uint8 flags MQTT_RECORD_x flags
+ * @return none
+ */
+void mqtt_ring_set_flags(MqttRing *ring, struct MqttRecord *record, uint8 flags) {
+    MQTT_RING_LOCK();
+    mqtt_ring_header(ring, record->offset)->flags = flags;
+    record->flags = flags;
+    MQTT_RING_UNLOCK();
+}
+
+/**
+ * Returns all records in flight back to the ready state so they are sent
+ * again, in order, on the next attempt. They are marked MQTT_RECORD_DUP
+ * as the broker may have received them.
+ * @param MqttRing *ring Ring
+ * @return none
+ */
+void mqtt_ring_release(MqttRing *ring) {
+    MQTT_RING_LOCK();
+
+    uint32 offset = ring->head;
+
+    for (uint16 i = 0; i < ring->count; i++) {
+        struct MqttRecordHeader *header = mqtt_ring_header(ring, offset);
+
+        if (header->flags & MQTT_RECORD_INFLIGHT) {
+            header->flags = (header->flags & ~MQTT_RECORD_INFLIGHT) | MQTT_RECORD_DUP;
+        }
+
+        offset = mqtt_ring_step(ring, offset);
+    }
+
+    MQTT_RING_UNLOCK();
+}
+
+/**
+ * Drops the oldest record. Must be called with the lock held.
+ * @param MqttRing *ring Ring
+ * @return int Success/Fail
+ */
+static uint8 mqtt_ring_drop_locked(MqttRing *ring) {
+    if (ring->count > 0) {
+        uint8 flags = mqtt_ring_header(ring, ring->head)->flags;
+
+        if ((flags & MQTT_RECORD_ACKED) ||
+            ((flags & (MQTT_RECORD_READY | MQTT_RECORD_INFLIGHT | MQTT_RECORD_HELD)) == MQTT_RECORD_READY)) {
+            mqtt_ring_pop(ring);
+            return MQTT_RING_SUCCESS;
+        }
+    }
+
+    return MQTT_RING_EMPTY;
+}
+
+/**
+ * Drops the oldest record. A record that is in flight, held or not yet
+ * ready is never dropped.
+ *      MQTT_RING_SUCCESS - Success
+ *      MQTT_RING_EMPTY - No record can be dropped
+ * @param MqttRing *ring Ring
+ * @return int Success/Fail
+ */
+uint8 mqtt_ring_drop(MqttRing *ring) {
+    MQTT_RING_LOCK();
+    uint8 error = mqtt_ring_drop_locked(ring);
+    MQTT_RING_UNLOCK();
+
+    return error;
+}
+
+/**
+ * ISR safe version of mqtt_ring_drop().
+ * @param MqttRing *ring Ring
+ * @return int Success/Fail
+ */
+uint8 mqtt_ring_drop_from_isr(MqttRing *ring) {
+    unsigned portBASE_TYPE mask = MQTT_RING_LOCK_FROM_ISR();
+    uint8 error = mqtt_ring_drop_locked(ring);
+    MQTT_RING_UNLOCK_FROM_ISR(mask);
+
+    return error;
+}
+
+/**
+ * Drops the acked records at the head of the ring.
+ * @param MqttRing *ring Ring
+ * @return int No of records dropped
+ */
+uint16 mqtt_ring_drop_acked(MqttRing *ring) {
+    uint16 dropped = 0;
+
+    MQTT_RING_LOCK();
+
+    while ((ring->count > 0) && (mqtt_ring_header(ring, ring->head)->flags & MQTT_RECORD_ACKED)) {
+        mqtt_ring_pop(ring);
+        dropped++;
+    }
+
+    MQTT_RING_UNLOCK();
+
+    return dropped;
+}
+
+/**
+ * Returns the number of records in the ring.
+ * @param MqttRing *ring Ring
+ * @return int No of records
+ */
+uint16 mqtt_ring_count(MqttRing *ring) {
+    return ring->count;
+}
+
+/**
+ * Returns the number of bytes used in the ring including padding.
+ * @param MqttRing *ring Ring
+ * @return int Bytes used
+ */
+uint32 mqtt_ring_used(MqttRing *ring) {
+    return ring->used;
+}
@@ -0,0 +1,100 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: mqtt_ring.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Byte-granular ring buffer arena that stores MQTT messages
+ * as variable-length records (Topic + Payload).
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef MQTT_RING_H
+#define MQTT_RING_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Every record starts at an 8 byte boundary (Header size), so the space
+// left at the end of the storage can always hold a pad record
+#define MQTT_RING_ALIGN(x) (((x) + 7) & ~7)
+#define MQTT_RING_MAX_SIZE 0xFFF8 // Record sizes are 16 bit
+
+// Record flags
+#define MQTT_RECORD_READY 0x01      // Committed and waiting to be sent
+#define MQTT_RECORD_INFLIGHT 0x02   // Claimed by the publisher
+#define MQTT_RECORD_ACKED 0x04      // Delivered/aborted, will be dropped at the head
+#define MQTT_RECORD_PAD 0x08        // Unused space until the end of the buffer
+#define MQTT_RECORD_HELD 0x10       // Held at the head while it is spooled
+#define MQTT_RECORD_DUP 0x20        // Released from flight, resent with the dup flag
+
+// Header in front of every record. The topic (NUL terminated) follows the
+// header and the payload (Also NUL terminated) follows the topic.
+struct MqttRecordHeader {
+    uint16 size;            // Record size including the header (in bytes)
+    uint16 payload_len;     // Payload length (Without the NUL)
+    uint8 topic_len;        // Topic length (Without the NUL)
+    uint8 flags;            // MQTT_RECORD_x flags
+    uint16 packet_id;       // Packet ID while in flight
+};
+
+// View of a single record. Pointers point into the ring storage and are
+// valid until the record is dropped.
+struct MqttRecord {
+    uint32 offset;          // Offset of the record in the ring
+    uint16 index;           // Position from the head (0 is the oldest)
+    char *topic;            // Topic
+    char *payload;          // Payload
+    uint16 payload_len;     // Payload length
+    uint8 flags;            // MQTT_RECORD_x flags
+};
+
+// Ring state. The storage is one contiguous block, records never wrap
+// around the end. When a record does not fit at the end, the rest of the
+// block is marked with a pad record and the record starts at offset 0.
+typedef struct {
+    uint8 *buf;             // Storage
+    uint32 size;            // Storage size (in bytes)
+    uint32 head;            // Offset of the oldest record
+    uint32 tail;            // Offset of the next record
+    uint32 used;            // Bytes used including padding
+    uint16 count;           // No of records
+} MqttRing;
+
+// Type to hold the ring status
+typedef enum {
+    MQTT_RING_SUCCESS,      // Success
+    MQTT_RING_FULL,         // Not enough free space
+    MQTT_RING_TOO_LARGE,    // Record can never fit the ring
+    MQTT_RING_EMPTY         // No record available
+} MQTT_RING_STATUS;
+
+void mqtt_ring_init(MqttRing *ring, uint8 *storage, uint32 size);
+uint32 mqtt_ring_record_size(uint8 topic_len, uint16 payload_len);
+uint8 mqtt_ring_reserve(MqttRing *ring, const char *topic, uint16 payload_size, struct MqttRecord *record);
+void mqtt_ring_commit(MqttRing *ring, struct MqttRecord *record, uint16 payload_len);
+void mqtt_ring_abort(MqttRing *ring, struct MqttRecord *record);
+uint8 mqtt_ring_reserve_from_isr(MqttRing *ring, const char *topic, uint16 payload_size, struct MqttRecord *record);
+void mqtt_ring_commit_from_isr(MqttRing *ring, struct MqttRecord *record, uint16 payload_len);
+void mqtt_ring_abort_from_isr(MqttRing *ring, struct MqttRecord *record);
+uint8 mqtt_ring_push(MqttRing *ring, const char *topic, const char *payload, uint16 payload_len);
+uint8 mqtt_ring_push_len(MqttRing *ring, const char *topic, uint16 topic_len, const char *payload, uint16 payload_len);
+uint8 mqtt_ring_peek(MqttRing *ring, struct MqttRecord *record);
+uint8 mqtt_ring_next(MqttRing *ring, struct MqttRecord *record);
+uint8 mqtt_ring_claim(MqttRing *ring, struct MqttRecord *record);
+uint8 mqtt_ring_hold(MqttRing *ring, struct MqttRecord *record);
+void mqtt_ring_set_flags(MqttRing *ring, struct MqttRecord *record, uint8 flags);
+void mqtt_ring_release(MqttRing *ring);
+uint8 mqtt_ring_drop(MqttRing *ring);
+uint8 mqtt_ring_drop_from_isr(MqttRing *ring);
+uint16 mqtt_ring_drop_acked(MqttRing *ring);
+uint16 mqtt_ring_count(MqttRing *ring);
+uint32 mqtt_ring_used(MqttRing *ring);
+
+#endif
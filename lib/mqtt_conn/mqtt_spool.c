@@ -0,0 +1,603 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: mqtt_spool.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Store-and-forward spool for outgoing MQTT messages. An
+ * append-only, CRC checked log kept in spare flash sectors that holds the
+ * messages that overflow the outgoing queue during long outages.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Layout:
+ *   Every sector starts with a sector header (Magic + sequence number).
+ *   Records follow back to back, each 4 byte aligned:
+ *     [Length (2)][Topic length (1)][State (1)][CRC-16 (2)][Reserved (2)]
+ *     [Topic][Payload]
+ *   A length of 0xFFFF (Erased flash) marks the end of the sector. The
+ *   state is only ever programmed from 1s to 0s: erased -> valid -> acked.
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "mqtt_spool.h"
+
+// Constants ----------------------------------------------------------
+
+#define SPOOL_MAGIC 0x4C50534C // Sector magic ("LSPL")
+#define SPOOL_ALIGN(x) (((x) + 3) & ~3) // Records are 4 byte aligned
+#define SPOOL_ERASED_LENGTH 0xFFFF // Length read from erased flash
+#define SPOOL_RECORD_VALID 0xAA // Record written, not yet delivered
+#define SPOOL_RECORD_ACKED 0x00 // Record delivered (Or corrupt)
+#define SPOOL_WRITE_CHUNK 32 // Size of the write buffer (Multiple of 4)
+
+// --------------------------------------------------------------------
+
+// Header at the start of every sector
+struct SpoolSectorHeader {
+    uint32 magic;           // SPOOL_MAGIC
+    uint32 seq;             // Sequence number, +1 for every sector written
+};
+
+// Header in front of every record
+struct SpoolRecordHeader {
+    uint16 length;          // Topic + payload length
+    uint8 topic_len;        // Topic length
+    uint8 state;            // SPOOL_RECORD_x
+    uint16 crc;             // CRC-16 of topic + payload
+    uint16 reserved;        // Left erased
+};
+
+// Buffers a record so that flash is always written in aligned words
+struct SpoolWriter {
+    struct SpoolFlash *flash;
+    uint32 addr;
+    uint32 fill;
+    uint32 buf[SPOOL_WRITE_CHUNK / 4];
+    int error;
+};
+
+#define SPOOL_SECTOR_HEADER_SIZE sizeof(struct SpoolSectorHeader)
+#define SPOOL_RECORD_HEADER_SIZE sizeof(struct SpoolRecordHeader)
+
+/**
+ * Calculates the CRC-16/CCITT of a block, continuing from a previous CRC.
+ * @param uint16 crc CRC so far (0xFFFF to start)
+ * @param uint8 *data Data
+ * @param uint32 len Data length
+ * @return int CRC
+ */
+static uint16 mqtt_spool_crc(uint16 crc, const uint8 *data, uint32 len) {
+    while (len--) {
+        crc ^= (uint16)(*data++) << 8;
+
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * Returns the flash address of a cursor.
+ * @param struct MqttSpool *spool Spool
+ * @param struct SpoolCursor *cursor Cursor
+ * @return int Address
+ */
+static uint32 mqtt_spool_addr(struct MqttSpool *spool, struct SpoolCursor *cursor) {
+    return (cursor->sector * spool->flash->sector_size) + cursor->offset;
+}
+
+/**
+ * Returns the flash size of a record.
+ * @param uint32 length Topic + payload length
+ * @return int Record size
+ */
+static uint32 mqtt_spool_record_size(uint32 length) {
+    return SPOOL_ALIGN(SPOOL_RECORD_HEADER_SIZE + length);
+}
+
+/**
+ * Moves a cursor to the start of the next sector.
+ * @param struct MqttSpool *spool Spool
+ * @param struct SpoolCursor *cursor Cursor
+ * @return none
+ */
+static void mqtt_spool_next_sector(struct MqttSpool *spool, struct SpoolCursor *cursor) {
+    cursor->sector = (cursor->sector + 1) % spool->flash->sector_count;
+    cursor->offset = SPOOL_SECTOR_HEADER_SIZE;
+    cursor->seq++;
+}
+
+/**
+ * Returns true if the cursor has reached the write position.
+ * @param struct MqttSpool *spool Spool
+ * @param struct SpoolCursor *cursor Cursor
+ * @return int True/False
+ */
+static uint8 mqtt_spool_at_tail(struct MqttSpool *spool, struct SpoolCursor *cursor) {
+    return (cursor->seq == spool->tail.seq) && (cursor->offset >= spool->tail.offset);
+}
+
+/**
+ * Moves a cursor forward to the next record present in flash (In any
+ * state) and reads its header.
+ *      MQTT_SPOOL_SUCCESS - Record found
+ *      MQTT_SPOOL_EMPTY - Cursor reached the write position
+ *      MQTT_SPOOL_FLASH_ERROR - Flash read failed
+ * @param struct MqttSpool *spool Spool
+ * @param struct SpoolCursor *cursor Cursor
+ * @param struct SpoolRecordHeader *header Pointer to store the header
+ * @return int Success/Fail
+ */
+static uint8 mqtt_spool_seek(struct MqttSpool *spool, struct SpoolCursor *cursor, struct SpoolRecordHeader *header) {
+    uint32 sector_size = spool->flash->sector_size;
+
+    while (!mqtt_spool_at_tail(spool, cursor)) {
+        if ((cursor->offset + SPOOL_RECORD_HEADER_SIZE) <= sector_size) {
+            if (spool->flash->read(spool->flash, mqtt_spool_addr(spool, cursor), header, SPOOL_RECORD_HEADER_SIZE)) {
+                return MQTT_SPOOL_FLASH_ERROR;
+            }
+
+            // Anything else than the end of the sector or a record that
+            // runs past the end of the sector
+            if ((header->length != SPOOL_ERASED_LENGTH) && ((cursor->offset + mqtt_spool_record_size(header->length)) <= sector_size)) {
+                return MQTT_SPOOL_SUCCESS;
+            }
+        }
+
+        if (cursor->seq == spool->tail.seq) {
+            break;
+        }
+
+        mqtt_spool_next_sector(spool, cursor);
+    }
+
+    *cursor = spool->tail;
+
+    return MQTT_SPOOL_EMPTY;
+}
+
+/**
+ * Marks the record at the cursor as acked. The first word of the header
+ * is programmed again with only the state bits cleared.
+ * @param struct MqttSpool *spool Spool
+ * @param struct SpoolCursor *cursor Cursor
+ * @param struct SpoolRecordHeader *header Header of the record
+ * @return int Success/Fail
+ */
+static uint8 mqtt_spool_mark(struct MqttSpool *spool, struct SpoolCursor *cursor, struct SpoolRecordHeader *header) {
+    struct SpoolRecordHeader acked = *header;
+    uint32 word = 0;
+
+    acked.state = SPOOL_RECORD_ACKED;
+    memcpy(&word, &acked, sizeof(word));
+
+    if (spool->flash->write(spool->flash, mqtt_spool_addr(spool, cursor), &word, sizeof(word))) {
+        return MQTT_SPOOL_FLASH_ERROR;
+    }
+
+    if (header->state == SPOOL_RECORD_VALID) {
+        spool->count--;
+    }
+
+    header->state = SPOOL_RECORD_ACKED;
+
+    return MQTT_SPOOL_SUCCESS;
+}
+
+/**
+ * Moves the head past all records that are acked. These bytes are free
+ * once the tail comes around to their sector.
+ * @param struct MqttSpool *spool Spool
+ * @return none
+ */
+static void mqtt_spool_trim(struct MqttSpool *spool) {
+    struct SpoolRecordHeader header = {0};
+
+    while (mqtt_spool_seek(spool, &spool->head, &header) == MQTT_SPOOL_SUCCESS) {
+        if (header.state == SPOOL_RECORD_VALID) {
+            break;
+        }
+
+        spool->head.offset += mqtt_spool_record_size(header.length);
+    }
+}
+
+/**
+ * Starts writing to the next sector. If it still holds undelivered
+ * records (Spool is full), they are dropped, oldest first.
+ * @param struct MqttSpool *spool Spool
+ * @return int Success/Fail
+ */
+static uint8 mqtt_spool_next_tail(struct MqttSpool *spool) {
+    struct SpoolCursor next = spool->tail;
+    struct SpoolRecordHeader header = {0};
+
+    mqtt_spool_next_sector(spool, &next);
+
+    // Drop the records left in the sector about to be erased
+    if (spool->head.sector == next.sector) {
+        while ((spool->head.sector == next.sector) && (mqtt_spool_seek(spool, &spool->head, &header) == MQTT_SPOOL_SUCCESS)) {
+            if (spool->head.sector != next.sector) {
+                break;
+            }
+
+            if (header.state == SPOOL_RECORD_VALID) {
+                spool->count--;
+                spool->stats.dropped++;
+            }
+
+            spool->head.offset += mqtt_spool_record_size(header.length);
+        }
+    }
+
+    struct SpoolSectorHeader sector_header = {SPOOL_MAGIC, next.seq};
+
+    spool->stats.erases++;
+
+    if (spool->flash->erase(spool->flash, next.sector)) {
+        return MQTT_SPOOL_FLASH_ERROR;
+    }
+
+    if (spool->flash->write(spool->flash, next.sector * spool->flash->sector_size, &sector_header, SPOOL_SECTOR_HEADER_SIZE)) {
+        return MQTT_SPOOL_FLASH_ERROR;
+    }
+
+    spool->tail = next;
+
+    if (spool->count == 0) {
+        spool->head = spool->tail;
+    }
+
+    return MQTT_SPOOL_SUCCESS;
+}
+
+/**
+ * Adds bytes to a record being written. Flash is programmed every
+ * SPOOL_WRITE_CHUNK bytes.
+ * @param struct SpoolWriter *writer Writer
+ * @param void *data Data
+ * @param uint32 len Data length
+ * @return none
+ */
+static void mqtt_spool_put(struct SpoolWriter *writer, const void *data, uint32 len) {
+    const uint8 *bytes = (const uint8 *)data;
+
+    while (len > 0) {
+        uint32 n = SPOOL_WRITE_CHUNK - writer->fill;
+
+        if (n > len) {
+            n = len;
+        }
+
+        memcpy((uint8 *)writer->buf + writer->fill, bytes, n);
+        writer->fill += n;
+        bytes += n;
+        len -= n;
+
+        if (writer->fill == SPOOL_WRITE_CHUNK) {
+            writer->error |= writer->flash->write(writer->flash, writer->addr, writer->buf, SPOOL_WRITE_CHUNK);
+            writer->addr += SPOOL_WRITE_CHUNK;
+            writer->fill = 0;
+        }
+    }
+}
+
+/**
+ * Writes the last bytes of a record, padded to a word with erased bytes.
+ * @param struct SpoolWriter *writer Writer
+ * @return none
+ */
+static void mqtt_spool_flush(struct SpoolWriter *writer) {
+    uint32 size = SPOOL_ALIGN(writer->fill);
+
+    if (size > 0) {
+        memset((uint8 *)writer->buf + writer->fill, 0xFF, size - writer->fill);
+        writer->error |= writer->flash->write(writer->flash, writer->addr, writer->buf, size);
+        writer->addr += size;
+        writer->fill = 0;
+    }
+}
+
+/**
+ * Mounts the spool on the given flash. The newest run of sectors with
+ * consecutive sequence numbers is taken as the log and the undelivered
+ * records in it are counted. If no log is found, the flash is formatted.
+ * Returns error state as defined in MQTT_SPOOL_STATUS.
+ *      MQTT_SPOOL_SUCCESS - Success
+ *      MQTT_SPOOL_FLASH_ERROR - Flash failure or less than 2 sectors
+ * @param struct MqttSpool *spool Spool
+ * @param struct SpoolFlash *flash Flash
+ * @return int Success/Fail
+ */
+uint8 mqtt_spool_init(struct MqttSpool *spool, struct SpoolFlash *flash) {
+    struct SpoolSectorHeader sector_header = {0};
+    struct SpoolRecordHeader header = {0};
+    uint8 found = 0;
+
+    memset(spool, 0, sizeof(struct MqttSpool));
+    spool->flash = flash;
+
+    if (flash->sector_count < 2) {
+        return MQTT_SPOOL_FLASH_ERROR;
+    }
+
+    // Newest sector is the one being written
+    for (uint32 i = 0; i < flash->sector_count; i++) {
+        if (flash->read(flash, i * flash->sector_size, &sector_header, SPOOL_SECTOR_HEADER_SIZE)) {
+            return MQTT_SPOOL_FLASH_ERROR;
+        }
+
+        if ((sector_header.magic == SPOOL_MAGIC) && (!found || ((int32)(sector_header.seq - spool->tail.seq) > 0))) {
+            spool->tail.sector = i;
+            spool->tail.seq = sector_header.seq;
+            found = 1;
+        }
+    }
+
+    if (!found) {
+        // Blank flash, format the first sector
+        spool->tail.sector = flash->sector_count - 1;
+        spool->tail.seq = 0;
+
+        return mqtt_spool_next_tail(spool);
+    }
+
+    // Oldest sector is the first of the run that leads up to the tail
+    spool->head = spool->tail;
+
+    for (uint32 i = 1; i < flash->sector_count; i++) {
+        uint32 sector = (spool->tail.sector + flash->sector_count - i) % flash->sector_count;
+
+        if (flash->read(flash, sector * flash->sector_size, &sector_header, SPOOL_SECTOR_HEADER_SIZE)) {
+            return MQTT_SPOOL_FLASH_ERROR;
+        }
+
+        if ((sector_header.magic != SPOOL_MAGIC) || (sector_header.seq != (spool->tail.seq - i))) {
+            break;
+        }
+
+        spool->head.sector = sector;
+        spool->head.seq = sector_header.seq;
+    }
+
+    spool->head.offset = SPOOL_SECTOR_HEADER_SIZE;
+
+    // Count the records and find the end of the tail sector
+    struct SpoolCursor cursor = spool->head;
+
+    while (1) {
+        header.length = SPOOL_ERASED_LENGTH;
+
+        if ((cursor.offset + SPOOL_RECORD_HEADER_SIZE) <= flash->sector_size) {
+            if (flash->read(flash, mqtt_spool_addr(spool, &cursor), &header, SPOOL_RECORD_HEADER_SIZE)) {
+                return MQTT_SPOOL_FLASH_ERROR;
+            }
+
+            if ((header.length != SPOOL_ERASED_LENGTH) && ((cursor.offset + mqtt_spool_record_size(header.length)) <= flash->sector_size)) {
+                if (header.state == SPOOL_RECORD_VALID) {
+                    spool->count++;
+                }
+
+                cursor.offset += mqtt_spool_record_size(header.length);
+                continue;
+            }
+        }
+
+        if (cursor.seq == spool->tail.seq) {
+            // A corrupt length leaves the rest of the sector unusable
+            spool->tail.offset = (header.length == SPOOL_ERASED_LENGTH) ? cursor.offset : flash->sector_size;
+            break;
+        }
+
+        mqtt_spool_next_sector(spool, &cursor);
+    }
+
+    mqtt_spool_trim(spool);
+
+    return MQTT_SPOOL_SUCCESS;
+}
+
+/**
+ * Appends a message to the spool. If the spool is full, the oldest
+ * undelivered sector is dropped. Returns error state as defined in
+ * MQTT_SPOOL_STATUS.
+ *      MQTT_SPOOL_SUCCESS - Success
+ *      MQTT_SPOOL_TOO_LARGE - Record does not fit a sector
+ *      MQTT_SPOOL_FLASH_ERROR - Flash failure
+ * @param struct MqttSpool *spool Spool
+ * @param char *topic Topic
+ * @param char *payload Payload
+ * @param uint16 payload_len Payload length
+ * @return int Success/Fail
+ */
+uint8 mqtt_spool_append(struct MqttSpool *spool, const char *topic, const char *payload, uint16 payload_len) {
+    uint32 topic_len = strlen(topic);
+    uint32 length = topic_len + payload_len;
+    uint32 size = mqtt_spool_record_size(length);
+
+    if ((topic_len > 255) || (length >= SPOOL_ERASED_LENGTH) || (size > (spool->flash->sector_size - SPOOL_SECTOR_HEADER_SIZE))) {
+        return MQTT_SPOOL_TOO_LARGE;
+    }
+
+    // Does not fit the current sector
+    if ((spool->tail.offset + size) > spool->flash->sector_size) {
+        uint8 error = mqtt_spool_next_tail(spool);
+
+        if (error != MQTT_SPOOL_SUCCESS) {
+            return error;
+        }
+    }
+
+    struct SpoolRecordHeader header = {
+        .length = length,
+        .topic_len = topic_len,
+        .state = SPOOL_RECORD_VALID,
+        .crc = mqtt_spool_crc(mqtt_spool_crc(0xFFFF, (const uint8 *)topic, topic_len), (const uint8 *)payload, payload_len),
+        .reserved = 0xFFFF
+    };
+
+    struct SpoolWriter writer = {
+        .flash = spool->flash,
+        .addr = mqtt_spool_addr(spool, &spool->tail),
+        .fill = 0,
+        .error = 0
+    };
+
+    mqtt_spool_put(&writer, &header, SPOOL_RECORD_HEADER_SIZE);
+    mqtt_spool_put(&writer, topic, topic_len);
+    mqtt_spool_put(&writer, payload, payload_len);
+    mqtt_spool_flush(&writer);
+
+    // Space is used even if the write failed, the CRC will catch it
+    spool->tail.offset += size;
+
+    if (writer.error) {
+        return MQTT_SPOOL_FLASH_ERROR;
+    }
+
+    spool->count++;
+    spool->stats.appended++;
+
+    return MQTT_SPOOL_SUCCESS;
+}
+
+/**
+ * Sets a cursor to the oldest undelivered record.
+ * @param struct MqttSpool *spool Spool
+ * @param struct SpoolCursor *cursor Cursor
+ * @return none
+ */
+void mqtt_spool_first(struct MqttSpool *spool, struct SpoolCursor *cursor) {
+    *cursor = spool->head;
+}
+
+/**
+ * Reads the first undelivered record at or after the cursor into buf as
+ * a NUL terminated topic followed by the NUL terminated payload. The
+ * cursor is left on the record so it can be acked. Records with a bad
+ * CRC are acked and skipped. A cursor to a sector that was overwritten is
+ * moved back to the head.
+ *      MQTT_SPOOL_SUCCESS - Success
+ *      MQTT_SPOOL_EMPTY - No more records
+ *      MQTT_SPOOL_TOO_LARGE - Record does not fit buf (Cursor is on it)
+ *      MQTT_SPOOL_FLASH_ERROR - Flash failure
+ * @param struct MqttSpool *spool Spool
+ * @param struct SpoolCursor *cursor Cursor
+ * @param char *buf Buffer
+ * @param uint32 buf_size Buffer size
+ * @param struct SpoolEntry *entry Pointer to store the record
+ * @return int Success/Fail
+ */
+uint8 mqtt_spool_read(struct MqttSpool *spool, struct SpoolCursor *cursor, char *buf, uint32 buf_size, struct SpoolEntry *entry) {
+    struct SpoolRecordHeader header = {0};
+    uint8 error = MQTT_SPOOL_SUCCESS;
+
+    if (((int32)(cursor->seq - spool->head.seq) < 0) || ((cursor->seq == spool->head.seq) && (cursor->offset < spool->head.offset))) {
+        *cursor = spool->head;
+    }
+
+    while ((error = mqtt_spool_seek(spool, cursor, &header)) == MQTT_SPOOL_SUCCESS) {
+        if (header.state == SPOOL_RECORD_VALID) {
+            uint32 addr = mqtt_spool_addr(spool, cursor) + SPOOL_RECORD_HEADER_SIZE;
+            uint32 payload_len = header.length - header.topic_len;
+
+            if ((header.topic_len > header.length) || ((uint32)(header.length + 2) > buf_size)) {
+                return MQTT_SPOOL_TOO_LARGE;
+            }
+
+            if (spool->flash->read(spool->flash, addr, buf, header.topic_len) ||
+                spool->flash->read(spool->flash, addr + header.topic_len, buf + header.topic_len + 1, payload_len)) {
+                return MQTT_SPOOL_FLASH_ERROR;
+            }
+
+            buf[header.topic_len] = '\0';
+            buf[header.length + 1] = '\0';
+
+            uint16 crc = mqtt_spool_crc(0xFFFF, (uint8 *)buf, header.topic_len);
+            crc = mqtt_spool_crc(crc, (uint8 *)buf + header.topic_len + 1, payload_len);
+
+            if (crc == header.crc) {
+                entry->topic = buf;
+                entry->payload = buf + header.topic_len + 1;
+                entry->payload_len = payload_len;
+
+                return MQTT_SPOOL_SUCCESS;
+            }
+
+            // Torn or corrupt record, never deliver it
+            spool->stats.crc_errors++;
+            mqtt_spool_mark(spool, cursor, &header);
+        }
+
+        cursor->offset += mqtt_spool_record_size(header.length);
+    }
+
+    mqtt_spool_trim(spool);
+
+    return error;
+}
+
+/**
+ * Moves a cursor past the record it is on.
+ * @param struct MqttSpool *spool Spool
+ * @param struct SpoolCursor *cursor Cursor
+ * @return none
+ */
+void mqtt_spool_next(struct MqttSpool *spool, struct SpoolCursor *cursor) {
+    struct SpoolRecordHeader header = {0};
+
+    if (mqtt_spool_seek(spool, cursor, &header) == MQTT_SPOOL_SUCCESS) {
+        cursor->offset += mqtt_spool_record_size(header.length);
+    }
+}
+
+/**
+ * Marks the record at the cursor as delivered and trims the delivered
+ * records from the head of the spool. Returns error state as defined in
+ * MQTT_SPOOL_STATUS.
+ *      MQTT_SPOOL_SUCCESS - Success
+ *      MQTT_SPOOL_EMPTY - Record was already dropped
+ *      MQTT_SPOOL_FLASH_ERROR - Flash failure
+ * @param struct MqttSpool *spool Spool
+ * @param struct SpoolCursor *cursor Cursor on the record
+ * @return int Success/Fail
+ */
+uint8 mqtt_spool_ack(struct MqttSpool *spool, struct SpoolCursor *cursor) {
+    struct SpoolRecordHeader header = {0};
+    struct SpoolCursor position = *cursor;
+
+    // Sector was overwritten since the record was read
+    if (((int32)(position.seq - spool->head.seq) < 0) || ((position.seq == spool->head.seq) && (position.offset < spool->head.offset))) {
+        return MQTT_SPOOL_EMPTY;
+    }
+
+    uint8 error = mqtt_spool_seek(spool, &position, &header);
+
+    if ((error == MQTT_SPOOL_SUCCESS) && (header.state == SPOOL_RECORD_VALID)) {
+        error = mqtt_spool_mark(spool, &position, &header);
+
+        if (error == MQTT_SPOOL_SUCCESS) {
+            spool->stats.acked++;
+        }
+    }
+
+    mqtt_spool_trim(spool);
+
+    return error;
+}
+
+/**
+ * Returns the number of undelivered records in the spool.
+ * @param struct MqttSpool *spool Spool
+ * @return int No of records
+ */
+uint32 mqtt_spool_count(struct MqttSpool *spool) {
+    return spool->count;
+}
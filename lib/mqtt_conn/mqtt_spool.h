@@ -0,0 +1,90 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: mqtt_spool.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Store-and-forward spool for outgoing MQTT messages. An
+ * append-only, CRC checked log kept in spare flash sectors that holds the
+ * messages that overflow the outgoing queue during long outages.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef MQTT_SPOOL_H
+#define MQTT_SPOOL_H
+
+#include "esp_common.h"
+
+// Flash interface. The spool only talks to flash through this, so it can
+// run on the SPI flash of the device or on a file on a Linux host.
+// Addresses are relative to the first spool sector. Functions return 0 on
+// success.
+struct SpoolFlash {
+    uint32 sector_size;     // Erase unit (in bytes)
+    uint32 sector_count;    // No of sectors used by the spool
+    int (*read)(struct SpoolFlash *flash, uint32 addr, void *data, uint32 len);
+    int (*write)(struct SpoolFlash *flash, uint32 addr, const void *data, uint32 len);
+    int (*erase)(struct SpoolFlash *flash, uint32 sector);
+    uint32 first_sector;    // First flash sector (Used by the implementation)
+    void *context;          // Implementation data
+};
+
+// Position of a record in the spool. The sector sequence number is kept
+// so a position in a sector that was overwritten is detected.
+struct SpoolCursor {
+    uint32 sector;          // Sector index
+    uint32 offset;          // Offset in the sector
+    uint32 seq;             // Sequence number of the sector
+};
+
+// Record read from the spool. Points into the caller's buffer.
+struct SpoolEntry {
+    char *topic;            // Topic (NUL terminated)
+    char *payload;          // Payload (NUL terminated)
+    uint16 payload_len;     // Payload length
+};
+
+// Spool counters
+struct MqttSpoolStats {
+    uint32 appended;        // Records written
+    uint32 acked;           // Records trimmed after a PUBACK
+    uint32 dropped;         // Unsent records overwritten when full
+    uint32 erases;          // Sector erases
+    uint32 crc_errors;      // Records skipped due to a bad CRC
+};
+
+// Spool state. Sectors are written in a circle, so every sector is erased
+// equally often (Wear levelling).
+struct MqttSpool {
+    struct SpoolFlash *flash;       // Flash
+    struct SpoolCursor head;        // Oldest unacked record
+    struct SpoolCursor tail;        // Next write position
+    uint32 count;                   // No of unacked records
+    struct MqttSpoolStats stats;    // Counters
+};
+
+// Type to hold the spool status
+typedef enum {
+    MQTT_SPOOL_SUCCESS,     // Success
+    MQTT_SPOOL_EMPTY,       // No record available
+    MQTT_SPOOL_TOO_LARGE,   // Record does not fit a sector/buffer
+    MQTT_SPOOL_FLASH_ERROR  // Flash read/write/erase failed
+} MQTT_SPOOL_STATUS;
+
+uint8 mqtt_spool_init(struct MqttSpool *spool, struct SpoolFlash *flash);
+uint8 mqtt_spool_append(struct MqttSpool *spool, const char *topic, const char *payload, uint16 payload_len);
+void mqtt_spool_first(struct MqttSpool *spool, struct SpoolCursor *cursor);
+uint8 mqtt_spool_read(struct MqttSpool *spool, struct SpoolCursor *cursor, char *buf, uint32 buf_size, struct SpoolEntry *entry);
+void mqtt_spool_next(struct MqttSpool *spool, struct SpoolCursor *cursor);
+uint8 mqtt_spool_ack(struct MqttSpool *spool, struct SpoolCursor *cursor);
+uint32 mqtt_spool_count(struct MqttSpool *spool);
+
+uint8 mqtt_spool_flash_init(struct SpoolFlash *flash, uint32 first_sector, uint32 sector_count);
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: mqtt_spool_flash.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: SPI flash backend for the MQTT spool.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "mqtt_spool.h"
+
+// Constants ----------------------------------------------------------
+
+#define SPOOL_FLASH_BOUNCE 32 // Bounce buffer for unaligned reads (in bytes)
+
+// --------------------------------------------------------------------
+
+/**
+ * Reads from the spool sectors. The SPI flash API needs word aligned
+ * addresses and buffers, so unaligned reads go through a bounce buffer.
+ * @param struct SpoolFlash *flash Flash
+ * @param uint32 addr Address relative to the first spool sector
+ * @param void *data Buffer
+ * @param uint32 len Length
+ * @return int Success/Fail
+ */
+static int mqtt_spool_flash_read(struct SpoolFlash *flash, uint32 addr, void *data, uint32 len) {
+    uint32 bounce[SPOOL_FLASH_BOUNCE / 4];
+    uint8 *bytes = (uint8 *)data;
+
+    addr += flash->first_sector * flash->sector_size;
+
+    if (!(addr & 3) && !((size_t)data & 3) && !(len & 3)) {
+        return spi_flash_read(addr, (uint32 *)data, len) != SPI_FLASH_RESULT_OK;
+    }
+
+    while (len > 0) {
+        uint32 skip = addr & 3;
+        uint32 n = SPOOL_FLASH_BOUNCE - skip;
+
+        if (n > len) {
+            n = len;
+        }
+
+        if (spi_flash_read(addr - skip, bounce, (skip + n + 3) & ~3) != SPI_FLASH_RESULT_OK) {
+            return 1;
+        }
+
+        memcpy(bytes, (uint8 *)bounce + skip, n);
+        bytes += n;
+        addr += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+/**
+ * Writes to the spool sectors. The spool only writes whole, aligned
+ * words.
+ * @param struct SpoolFlash *flash Flash
+ * @param uint32 addr Address relative to the first spool sector
+ * @param void *data Data (Word aligned)
+ * @param uint32 len Length (Multiple of 4)
+ * @return int Success/Fail
+ */
+static int mqtt_spool_flash_write(struct SpoolFlash *flash, uint32 addr, const void *data, uint32 len) {
+    if ((addr & 3) || ((size_t)data & 3) || (len & 3)) {
+        return 1;
+    }
+
+    addr += flash->first_sector * flash->sector_size;
+
+    return spi_flash_write(addr, (uint32 *)data, len) != SPI_FLASH_RESULT_OK;
+}
+
+/**
+ * Erases a spool sector.
+ * @param struct SpoolFlash *flash Flash
+ * @param uint32 sector Sector relative to the first spool sector
+ * @return int Success/Fail
+ */
+static int mqtt_spool_flash_erase(struct SpoolFlash *flash, uint32 sector) {
+    return spi_flash_erase_sector(flash->first_sector + sector) != SPI_FLASH_RESULT_OK;
+}
+
+/**
+ * Sets up a spool flash on the SPI flash of the device. The sectors must
+ * not overlap the firmware, the RF calibration or the system parameters.
+ * Returns error state as defined in MQTT_SPOOL_STATUS.
+ *      MQTT_SPOOL_SUCCESS - Success
+ *      MQTT_SPOOL_FLASH_ERROR - Invalid sectors
+ * @param struct SpoolFlash *flash Flash to set up
+ * @param uint32 first_sector First flash sector
+ * @param uint32 sector_count No of sectors
+ * @return int Success/Fail
+ */
+uint8 mqtt_spool_flash_init(struct SpoolFlash *flash, uint32 first_sector, uint32 sector_count) {
+    if ((first_sector == 0) || (sector_count < 2)) {
+        return MQTT_SPOOL_FLASH_ERROR;
+    }
+
+    flash->sector_size = SPI_FLASH_SEC_SIZE;
+    flash->sector_count = sector_count;
+    flash->read = mqtt_spool_flash_read;
+    flash->write = mqtt_spool_flash_write;
+    flash->erase = mqtt_spool_flash_erase;
+    flash->first_sector = first_sector;
+    flash->context = NULL;
+
+    return MQTT_SPOOL_SUCCESS;
+}
@@ -0,0 +1,482 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: mqtt_topic.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Topic filter trie. Maps MQTT topic filters (With '+' and
+ * '#' wildcards) to handlers and finds the handlers matching a topic in
+ * time proportional to its level count.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "esp_common.h"
+#include "mqtt_topic.h"
+
+// Constants ----------------------------------------------------------
+
+#define MQTT_TOPIC_ROOT 0 // Root node
+#define MQTT_TOPIC_MAX_LEVEL 0xFF // Max level name length
+
+// --------------------------------------------------------------------
+
+/**
+ * Returns the hash bucket of a level name under a parent (FNV-1a).
+ * @param MqttTopicTrie *trie Trie
+ * @param uint16 parent Parent node
+ * @param char *name Level name
+ * @param uint16 len Level name length
+ * @return int Bucket
+ */
+static uint16 mqtt_topic_bucket(MqttTopicTrie *trie, uint16 parent, const char *name, uint16 len) {
+    uint32 hash = 2166136261u ^ parent;
+
+    for (uint16 i = 0; i < len; i++) {
+        hash = (hash ^ (uint8)name[i]) * 16777619u;
+    }
+
+    return hash % trie->node_count;
+}
+
+/**
+ * Returns the length of the level starting at level (Up to the next '/'
+ * or the end).
+ * @param char *level Level
+ * @param char *end End of the topic
+ * @return int Length
+ */
+static uint16 mqtt_topic_level_len(const char *level, const char *end) {
+    const char *cursor = level;
+
+    while ((cursor < end) && (*cursor != '/')) {
+        cursor++;
+    }
+
+    return cursor - level;
+}
+
+/**
+ * Returns the exact level child of a node with the given name.
+ * @param MqttTopicTrie *trie Trie
+ * @param uint16 parent Parent node
+ * @param char *name Level name
+ * @param uint16 len Level name length
+ * @return int Child node (0 if none)
+ */
+static uint16 mqtt_topic_find(MqttTopicTrie *trie, uint16 parent, const char *name, uint16 len) {
+    uint16 node = trie->nodes[mqtt_topic_bucket(trie, parent, name, len)].bucket;
+
+    while (node != 0) {
+        MqttTopicNode *candidate = &trie->nodes[node];
+
+        if ((candidate->parent == parent) && (candidate->name_len == len) &&
+            !memcmp(trie->names + candidate->name, name, len)) {
+            return node;
+        }
+
+        node = candidate->chain;
+    }
+
+    return 0;
+}
+
+/**
+ * Takes a free node from the pool and links it under a parent. A name of
+ * NULL creates the '+' child.
+ * @param MqttTopicTrie *trie Trie
+ * @param uint16 parent Parent node
+ * @param char *name Level name (NULL for '+')
+ * @param uint16 len Level name length
+ * @return int New node (0 if the pool or the name storage is full)
+ */
+static uint16 mqtt_topic_new_node(MqttTopicTrie *trie, uint16 parent, const char *name, uint16 len) {
+    uint16 node = 0;
+
+    if ((len > MQTT_TOPIC_MAX_LEVEL) || ((trie->names_used + len) > trie->names_size)) {
+        return 0;
+    }
+
+    for (uint16 i = 1; i < trie->node_count; i++) {
+        if (!trie->nodes[i].in_use) {
+            node = i;
+            break;
+        }
+    }
+
+    if (node == 0) {
+        return 0;
+    }
+
+    MqttTopicNode *new_node = &trie->nodes[node];
+
+    // The bucket head belongs to the pool slot, not the node, so it stays
+    new_node->handler = NULL;
+    new_node->multi_handler = NULL;
+    new_node->parent = parent;
+    new_node->plus = 0;
+    new_node->chain = 0;
+    new_node->children = 0;
+    new_node->name = trie->names_used;
+    new_node->name_len = len;
+    new_node->in_use = 1;
+
+    if (name == NULL) {
+        trie->nodes[parent].plus = node;
+    } else {
+        uint16 bucket = mqtt_topic_bucket(trie, parent, name, len);
+
+        memcpy(trie->names + trie->names_used, name, len);
+        trie->names_used += len;
+
+        new_node->chain = trie->nodes[bucket].bucket;
+        trie->nodes[bucket].bucket = node;
+    }
+
+    trie->nodes[parent].children++;
+
+    return node;
+}
+
+/**
+ * Unlinks a node from its parent and returns it and its name to the pool.
+ * The name storage is compacted, removing filters is rare.
+ * @param MqttTopicTrie *trie Trie
+ * @param uint16 node Node
+ * @return none
+ */
+static void mqtt_topic_free_node(MqttTopicTrie *trie, uint16 node) {
+    MqttTopicNode *old_node = &trie->nodes[node];
+    MqttTopicNode *parent = &trie->nodes[old_node->parent];
+
+    if (parent->plus == node) {
+        parent->plus = 0;
+    } else {
+        uint16 *link = &trie->nodes[mqtt_topic_bucket(trie, old_node->parent, trie->names + old_node->name, old_node->name_len)].bucket;
+
+        while (*link != node) {
+            link = &trie->nodes[*link].chain;
+        }
+
+        *link = old_node->chain;
+    }
+
+    parent->children--;
+    old_node->in_use = 0;
+
+    if (old_node->name_len > 0) {
+        uint16 end = old_node->name + old_node->name_len;
+
+        memmove(trie->names + old_node->name, trie->names + end, trie->names_used - end);
+        trie->names_used -= old_node->name_len;
+
+        for (uint16 i = 1; i < trie->node_count; i++) {
+            if (trie->nodes[i].in_use && (trie->nodes[i].name >= end)) {
+                trie->nodes[i].name -= old_node->name_len;
+            }
+        }
+    }
+}
+
+/**
+ * Frees a node and its parents for as long as they carry no filter.
+ * @param MqttTopicTrie *trie Trie
+ * @param uint16 node Node
+ * @return none
+ */
+static void mqtt_topic_prune(MqttTopicTrie *trie, uint16 node) {
+    while (node != MQTT_TOPIC_ROOT) {
+        MqttTopicNode *current = &trie->nodes[node];
+        uint16 parent = current->parent;
+
+        if ((current->handler != NULL) || (current->multi_handler != NULL) || (current->children > 0)) {
+            break;
+        }
+
+        mqtt_topic_free_node(trie, node);
+        node = parent;
+    }
+}
+
+/**
+ * Returns true if a filter is well formed. Wildcards must take up a whole
+ * level and '#' must be the last level.
+ * @param char *filter Topic filter
+ * @param char *end End of the filter
+ * @return int True/False
+ */
+static uint8 mqtt_topic_valid(const char *filter, const char *end) {
+    const char *level = filter;
+
+    if (filter == end) {
+        return FALSE;
+    }
+
+    while (TRUE) {
+        uint16 len = mqtt_topic_level_len(level, end);
+        uint8 last = (level + len) == end;
+
+        for (uint16 i = 0; i < len; i++) {
+            if (((level[i] == '+') || (level[i] == '#')) && (len != 1)) {
+                return FALSE;
+            }
+        }
+
+        if ((len > MQTT_TOPIC_MAX_LEVEL) || ((len == 1) && (*level == '#') && !last)) {
+            return FALSE;
+        }
+
+        if (last) {
+            return TRUE;
+        }
+
+        level += len + 1;
+    }
+}
+
+/**
+ * Walks a filter down the trie, creating the missing nodes if asked.
+ * Returns the status of the walk as defined in MQTT_TOPIC_STATUS.
+ *      MQTT_TOPIC_SUCCESS - Filter found
+ *      MQTT_TOPIC_INVALID - Malformed filter
+ *      MQTT_TOPIC_FULL - Out of nodes or name storage (Nodes created so
+ *                          far are freed again)
+ *      MQTT_TOPIC_NOT_FOUND - Filter not in the trie
+ * @param MqttTopicTrie *trie Trie
+ * @param char *filter Topic filter
+ * @param uint8 create Create missing nodes
+ * @param uint16 *node Pointer to store the node of the last level
+ * @param uint8 *multi Pointer to store if the filter ends with '#'
+ * @return int Success/Fail
+ */
+static uint8 mqtt_topic_locate(MqttTopicTrie *trie, const char *filter, uint8 create, uint16 *node, uint8 *multi) {
+    const char *level = filter;
+    const char *end = filter + strlen(filter);
+    uint16 current = MQTT_TOPIC_ROOT;
+
+    *multi = 0;
+
+    if (!mqtt_topic_valid(filter, end)) {
+        return MQTT_TOPIC_INVALID;
+    }
+
+    while (TRUE) {
+        uint16 len = mqtt_topic_level_len(level, end);
+        uint8 last = (level + len) == end;
+        uint16 child = 0;
+
+        if ((len == 1) && (*level == '#')) {
+            *multi = 1;
+            break;
+        }
+
+        if ((len == 1) && (*level == '+')) {
+            child = trie->nodes[current].plus;
+
+            if ((child == 0) && create) {
+                child = mqtt_topic_new_node(trie, current, NULL, 0);
+            }
+        } else {
+            child = mqtt_topic_find(trie, current, level, len);
+
+            if ((child == 0) && create) {
+                child = mqtt_topic_new_node(trie, current, level, len);
+            }
+        }
+
+        if (child == 0) {
+            if (create) {
+                mqtt_topic_prune(trie, current);
+                return MQTT_TOPIC_FULL;
+            }
+
+            return MQTT_TOPIC_NOT_FOUND;
+        }
+
+        current = child;
+
+        if (last) {
+            break;
+        }
+
+        level += len + 1;
+    }
+
+    *node = current;
+
+    return MQTT_TOPIC_SUCCESS;
+}
+
+/**
+ * Visits the handlers of the filters below a node that match the rest of
+ * a topic. level is NULL once every level has been consumed.
+ * @param MqttTopicTrie *trie Trie
+ * @param uint16 node Node
+ * @param char *level Next level of the topic (NULL if none)
+ * @param char *end End of the topic
+ * @param uint8 wildcards Wildcards may match the next level
+ * @param MqttTopicVisitor visit Visitor
+ * @param void *context Visitor context
+ * @return int No of handlers visited
+ */
+static uint16 mqtt_topic_walk(MqttTopicTrie *trie, uint16 node, const char *level, const char *end, uint8 wildcards,
+                              MqttTopicVisitor visit, void *context) {
+    MqttTopicNode *current = &trie->nodes[node];
+    uint16 visited = 0;
+
+    // '#' also matches the level above it ("a/#" matches "a")
+    if ((current->multi_handler != NULL) && wildcards) {
+        visit(current->multi_handler, context);
+        visited++;
+    }
+
+    if (level == NULL) {
+        if (current->handler != NULL) {
+            visit(current->handler, context);
+            visited++;
+        }
+
+        return visited;
+    }
+
+    uint16 len = mqtt_topic_level_len(level, end);
+    const char *next = ((level + len) < end) ? (level + len + 1) : NULL;
+    uint16 child = mqtt_topic_find(trie, node, level, len);
+
+    if (child != 0) {
+        visited += mqtt_topic_walk(trie, child, next, end, TRUE, visit, context);
+    }
+
+    if ((current->plus != 0) && wildcards) {
+        visited += mqtt_topic_walk(trie, current->plus, next, end, TRUE, visit, context);
+    }
+
+    return visited;
+}
+
+/**
+ * Initializes the trie on the given storage.
+ * @param MqttTopicTrie *trie Trie
+ * @param MqttTopicNode *nodes Node pool (One per distinct filter level,
+ *                              plus the root)
+ * @param uint16 node_count No of nodes in the pool
+ * @param char *names Level name storage
+ * @param uint16 names_size Name storage size (in bytes)
+ * @return none
+ */
+void mqtt_topic_init(MqttTopicTrie *trie, MqttTopicNode *nodes, uint16 node_count, char *names, uint16 names_size) {
+    trie->nodes = nodes;
+    trie->node_count = node_count;
+    trie->names = names;
+    trie->names_size = names_size;
+
+    mqtt_topic_clear(trie);
+}
+
+/**
+ * Removes every filter.
+ * @param MqttTopicTrie *trie Trie
+ * @return none
+ */
+void mqtt_topic_clear(MqttTopicTrie *trie) {
+    memset(trie->nodes, 0, trie->node_count * sizeof(MqttTopicNode));
+
+    trie->nodes[MQTT_TOPIC_ROOT].in_use = 1;
+    trie->names_used = 0;
+    trie->filters = 0;
+}
+
+/**
+ * Adds a filter. An existing filter gets the new handler. Returns the
+ * status of the add as defined in MQTT_TOPIC_STATUS.
+ *      MQTT_TOPIC_SUCCESS - Added
+ *      MQTT_TOPIC_INVALID - Malformed filter
+ *      MQTT_TOPIC_FULL - Out of nodes or name storage
+ * @param MqttTopicTrie *trie Trie
+ * @param char *filter Topic filter
+ * @param void *handler Handler (Not NULL)
+ * @return int Success/Fail
+ */
+uint8 mqtt_topic_add(MqttTopicTrie *trie, const char *filter, void *handler) {
+    uint16 node = 0;
+    uint8 multi = 0;
+    uint8 status = mqtt_topic_locate(trie, filter, TRUE, &node, &multi);
+
+    if (status != MQTT_TOPIC_SUCCESS) {
+        return status;
+    }
+
+    void **slot = multi ? &trie->nodes[node].multi_handler : &trie->nodes[node].handler;
+
+    if (*slot == NULL) {
+        trie->filters++;
+    }
+
+    *slot = handler;
+
+    return MQTT_TOPIC_SUCCESS;
+}
+
+/**
+ * Removes a filter. Returns the status of the remove as defined in
+ * MQTT_TOPIC_STATUS.
+ *      MQTT_TOPIC_SUCCESS - Removed
+ *      MQTT_TOPIC_INVALID - Malformed filter
+ *      MQTT_TOPIC_NOT_FOUND - Filter not in the trie
+ * @param MqttTopicTrie *trie Trie
+ * @param char *filter Topic filter
+ * @return int Success/Fail
+ */
+uint8 mqtt_topic_remove(MqttTopicTrie *trie, const char *filter) {
+    uint16 node = 0;
+    uint8 multi = 0;
+    uint8 status = mqtt_topic_locate(trie, filter, FALSE, &node, &multi);
+
+    if (status != MQTT_TOPIC_SUCCESS) {
+        return status;
+    }
+
+    void **slot = multi ? &trie->nodes[node].multi_handler : &trie->nodes[node].handler;
+
+    if (*slot == NULL) {
+        return MQTT_TOPIC_NOT_FOUND;
+    }
+
+    *slot = NULL;
+    trie->filters--;
+    mqtt_topic_prune(trie, node);
+
+    return MQTT_TOPIC_SUCCESS;
+}
+
+/**
+ * Calls visit with the handler of every filter matching a topic. Topics
+ * starting with '$' are not matched by wildcards in the first level.
+ * @param MqttTopicTrie *trie Trie
+ * @param char *topic Topic (Need not be NUL terminated)
+ * @param uint16 topic_len Topic length
+ * @param MqttTopicVisitor visit Visitor
+ * @param void *context Visitor context
+ * @return int No of handlers visited
+ */
+uint16 mqtt_topic_match(MqttTopicTrie *trie, const char *topic, uint16 topic_len, MqttTopicVisitor visit, void *context) {
+    if (trie->filters == 0) {
+        return 0;
+    }
+
+    return mqtt_topic_walk(trie, MQTT_TOPIC_ROOT, topic, topic + topic_len, (topic_len == 0) || (topic[0] != '$'), visit, context);
+}
+
+/**
+ * Returns the no of filters in the trie.
+ * @param MqttTopicTrie *trie Trie
+ * @return int No of filters
+ */
+uint16 mqtt_topic_count(MqttTopicTrie *trie) {
+    return trie->filters;
+}
@@ -0,0 +1,72 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: mqtt_topic.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Topic filter trie. Maps MQTT topic filters (With '+' and
+ * '#' wildcards) to handlers and finds the handlers matching a topic in
+ * time proportional to its level count.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef MQTT_TOPIC_H
+#define MQTT_TOPIC_H
+
+#include "esp_common.h"
+
+// Every node is one level of a filter. Nodes sharing a prefix share the
+// nodes of the prefix. Exact level children are found through a hash
+// table whose bucket heads are kept in the nodes themselves (Node i holds
+// the head of bucket i), so no storage besides the node pool is needed.
+// '+' children are linked from the parent, '#' is not a node but a
+// handler of the level above it.
+typedef struct {
+    void *handler;          // Handler of the filter ending at this level
+    void *multi_handler;    // Handler of the filter ending with '#' below this level
+    uint16 parent;          // Parent node
+    uint16 plus;            // '+' child (0 if none)
+    uint16 bucket;          // First node of hash bucket no. <this node> (0 if empty)
+    uint16 chain;           // Next node in the same hash bucket (0 if last)
+    uint16 children;        // No of children
+    uint16 name;            // Offset of the level name in the name storage
+    uint8 name_len;         // Level name length
+    uint8 in_use;           // Node is used
+} MqttTopicNode;
+
+// Trie state. Node 0 is the root, it is never a child, so 0 also means
+// no node.
+typedef struct {
+    MqttTopicNode *nodes;   // Node pool
+    char *names;            // Level names (Not NUL terminated)
+    uint16 node_count;      // No of nodes in the pool
+    uint16 names_size;      // Name storage size (in bytes)
+    uint16 names_used;      // Name storage used (in bytes)
+    uint16 filters;         // No of filters
+} MqttTopicTrie;
+
+// Type to hold the trie status
+typedef enum {
+    MQTT_TOPIC_SUCCESS,     // Success
+    MQTT_TOPIC_INVALID,     // Malformed filter
+    MQTT_TOPIC_FULL,        // Out of nodes or name storage
+    MQTT_TOPIC_NOT_FOUND    // Filter not in the trie
+} MQTT_TOPIC_STATUS;
+
+// Called with the handler of every filter matching a topic
+typedef void (*MqttTopicVisitor)(void *handler, void *context);
+
+void mqtt_topic_init(MqttTopicTrie *trie, MqttTopicNode *nodes, uint16 node_count, char *names, uint16 names_size);
+void mqtt_topic_clear(MqttTopicTrie *trie);
+uint8 mqtt_topic_add(MqttTopicTrie *trie, const char *filter, void *handler);
+uint8 mqtt_topic_remove(MqttTopicTrie *trie, const char *filter);
+uint16 mqtt_topic_match(MqttTopicTrie *trie, const char *topic, uint16 topic_len, MqttTopicVisitor visit, void *context);
+uint16 mqtt_topic_count(MqttTopicTrie *trie);
+
+#endif
@@ -34,7 +34,7 @@ int ICACHE_FLASH_ATTR sendPacket(MQTTClient* c, int length, Timer* timer)
     
     while (sent < length && !expired(timer))
     {
-        rc = c->ipstack->mqttwrite(c->ipstack, &c->buf[sent], length, left_ms(timer));
+        rc = c->ipstack->mqttwrite(c->ipstack, &c->buf[sent], length - sent, left_ms(timer));
         if (rc < 0)  // there was an error writing the data
             break;
         sent += rc;
@@ -50,62 +50,47 @@ int ICACHE_FLASH_ATTR sendPacket(MQTTClient* c, int length, Timer* timer)
 }
 
 
-int ICACHE_FLASH_ATTR decodePacket(MQTTClient* c, int* value, int timeout)
+// sends the packet header in c->buf followed by the payload from the caller's
+// storage as one gather write, so the payload is not copied into c->buf and
+// is not limited by buf_size
+int ICACHE_FLASH_ATTR sendPacketv(MQTTClient* c, int length, unsigned char* payload, int payloadlen, Timer* timer)
 {
-    unsigned char i;
-    int multiplier = 1;
-    int len = 0;
-    const int MAX_NO_OF_REMAINING_LENGTH_BYTES = 4;
+    int rc = FAILURE,
+        sent = 0,
+        total = length + payloadlen;
+    NetworkSegment segments[2];
 
-    *value = 0;
-    do
+    while (sent < total && !expired(timer))
     {
-        int rc = MQTTPACKET_READ_ERROR;
-
-        if (++len > MAX_NO_OF_REMAINING_LENGTH_BYTES)
+        int count = 0;
+        if (sent < length)
         {
-            rc = MQTTPACKET_READ_ERROR; /* bad data */
-            goto exit;
+            segments[count].data = &c->buf[sent];
+            segments[count++].len = length - sent;
         }
-        rc = c->ipstack->mqttread(c->ipstack, &i, 1, timeout);
-        if (rc != 1)
-            goto exit;
-        *value += (i & 127) * multiplier;
-        multiplier *= 128;
-    } while ((i & 128) != 0);
-exit:
-    return len;
-}
-
-
-int ICACHE_FLASH_ATTR readPacket(MQTTClient* c, Timer* timer)
-{
-    int rc = FAILURE;
-    MQTTHeader header = {0};
-    int len = 0;
-    int rem_len = 0;
-
-    /* 1. read the header byte.  This has the packet type in it */
-    if (c->ipstack->mqttread(c->ipstack, c->readbuf, 1, left_ms(timer)) != 1)
-        goto exit;
-
-    len = 1;
-    /* 2. read the remaining length.  This is variable in itself */
-    decodePacket(c, &rem_len, left_ms(timer));
-    len += MQTTPacket_encode(c->readbuf + 1, rem_len); /* put the original remaining length back into the buffer */
-
-    /* 3. read the rest of the buffer using a callback to supply the rest of the data */
-    if (rem_len > 0 && (c->ipstack->mqttread(c->ipstack, c->readbuf + len, rem_len, left_ms(timer)) != rem_len))
-        goto exit;
-
-    header.byte = c->readbuf[0];
-    rc = header.bits.type;
-exit:
-    //dmsg_printf("readPacket=%d\r\n", rc);
+        if (payloadlen > 0)
+        {
+            int offset = (sent > length) ? sent - length : 0;
+            segments[count].data = payload + offset;
+            segments[count++].len = payloadlen - offset;
+        }
+        rc = c->ipstack->mqttwritev(c->ipstack, segments, count, left_ms(timer));
+        if (rc < 0)  // there was an error writing the data
+            break;
+        sent += rc;
+    }
+    if (sent == total)
+    {
+        countdown(&(c->ping_timer), c->keepAliveInterval); // record the fact that we have successfully sent the packet
+        rc = SUCCESS;
+    }
+    else
+        rc = FAILURE;
     return rc;
 }
 
 
+// linear matcher of a single filter, kept for comparison with the trie
 // assume topic filter and name is in correct format
 // # can only be at end
 // + and # can only be next to separator
@@ -137,34 +122,27 @@ char ICACHE_FLASH_ATTR isTopicMatched(char* topicFilter, MQTTString* topicName)
 }
 
 
+void ICACHE_FLASH_ATTR deliverToHandler(void* handler, void* md)
+{
+    ((messageHandler)handler)((MessageData*)md);
+}
+
+
 int ICACHE_FLASH_ATTR deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
 {
-    int i;
     int rc = FAILURE;
+    MessageData md;
 
-    // we have to find the right message handler - indexed by topic
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
-    {
-        if (c->messageHandlers[i].topicFilter != 0 && (MQTTPacket_equals(topicName, (char*)c->messageHandlers[i].topicFilter) ||
-                isTopicMatched((char*)c->messageHandlers[i].topicFilter, topicName)))
-        {
-            if (c->messageHandlers[i].fp != NULL)
-            {
-                MessageData md;
-                NewMessageData(&md, topicName, message);
-                c->messageHandlers[i].fp(&md);
-                rc = SUCCESS;
-            }
-        }
-    }
-    
-    if (rc == FAILURE && c->defaultMessageHandler != NULL) 
+    NewMessageData(&md, topicName, message);
+
+    // find the handlers of every subscription matching the topic
+    if (mqtt_topic_match(&c->messageHandlers, topicName->lenstring.data, topicName->lenstring.len, deliverToHandler, &md) > 0)
+        rc = SUCCESS;
+    else if (c->defaultMessageHandler != NULL)
     {
-        MessageData md;
-        NewMessageData(&md, topicName, message);
         c->defaultMessageHandler(&md);
         rc = SUCCESS;
-    }   
+    }
     
     return rc;
 }
@@ -211,24 +189,151 @@ exit:
 }
 
 
-int ICACHE_FLASH_ATTR cycle(MQTTClient* c, Timer* timer)
+int ICACHE_FLASH_ATTR setMessageHandler(MQTTClient* c, const char* topicFilter, messageHandler handler)
+{
+    if (handler == NULL)
+        return (mqtt_topic_remove(&c->messageHandlers, topicFilter) == MQTT_TOPIC_SUCCESS) ? SUCCESS : FAILURE;
+    return (mqtt_topic_add(&c->messageHandlers, topicFilter, (void*)handler) == MQTT_TOPIC_SUCCESS) ? SUCCESS : FAILURE;
+}
+
+
+// reserves a pending operation slot, NULL if all are taken
+struct PendingOp* ICACHE_FLASH_ATTR newPendingOp(MQTTClient* c, opHandler cb, void* context)
+{
+    int i;
+
+    for (i = 0; i < MAX_PENDING_OPS; ++i)
+    {
+        struct PendingOp* op = &c->pendingOps[i];
+
+        if (op->type == 0)
+        {
+            memset(op, 0, sizeof(struct PendingOp));
+            op->cb = cb;
+            op->context = context;
+            InitTimer(&op->timer);
+            countdown_ms(&op->timer, c->command_timeout_ms);
+            return op;
+        }
+    }
+    return NULL;
+}
+
+
+// frees the slot before calling back so that the callback can submit again
+void ICACHE_FLASH_ATTR finishPendingOp(struct PendingOp* op, int rc)
+{
+    opHandler cb = op->cb;
+    void* context = op->context;
+    unsigned short id = op->id;
+
+    op->type = 0;
+    if (cb != NULL)
+        cb(context, id, rc);
+}
+
+
+void ICACHE_FLASH_ATTR failPendingOps(MQTTClient* c, int rc, char expiredOnly)
+{
+    int i;
+
+    for (i = 0; i < MAX_PENDING_OPS; ++i)
+    {
+        struct PendingOp* op = &c->pendingOps[i];
+
+        if (op->type != 0 && (!expiredOnly || expired(&op->timer)))
+            finishPendingOp(op, rc);
+    }
+}
+
+
+// completes the pending operation waiting on the acknowledgement in readbuf
+void ICACHE_FLASH_ATTR completePendingOp(MQTTClient* c, int packet_type)
+{
+    unsigned short mypacketid = 0;
+    int rc = FAILURE;
+    int i;
+
+    if (packet_type == CONNACK)
+    {
+        unsigned char connack_rc = 255;
+        char sessionPresent = 0;
+        if (MQTTDeserialize_connack((unsigned char*)&sessionPresent, &connack_rc, c->readbuf, c->readbuf_size) == 1 && connack_rc == 0)
+        {
+            c->sessionPresent = sessionPresent;
+            rc = SUCCESS;
+        }
+    }
+    else if (packet_type == SUBACK)
+    {
+        int count = 0, grantedQoS = -1;
+        if (MQTTDeserialize_suback(&mypacketid, 1, &count, &grantedQoS, c->readbuf, c->readbuf_size) != 1)
+            return;
+        if (grantedQoS != 0x80)
+            rc = SUCCESS;
+    }
+    else if (packet_type == UNSUBACK)
+    {
+        if (MQTTDeserialize_unsuback(&mypacketid, c->readbuf, c->readbuf_size) != 1)
+            return;
+        rc = SUCCESS;
+    }
+    else
+    {
+        unsigned char dup, type;
+        if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
+            return;
+        rc = SUCCESS;
+    }
+
+    for (i = 0; i < MAX_PENDING_OPS; ++i)
+    {
+        struct PendingOp* op = &c->pendingOps[i];
+
+        if (op->type != packet_type || op->id != mypacketid)
+            continue;
+
+        if (rc == SUCCESS && packet_type == CONNACK)
+            c->isconnected = 1;
+        else if (rc == SUCCESS && packet_type == SUBACK)
+            rc = setMessageHandler(c, op->topicFilter, op->fp);
+        else if (rc == SUCCESS && packet_type == UNSUBACK)
+            setMessageHandler(c, op->topicFilter, NULL);
+        finishPendingOp(op, rc);
+        break;
+    }
+}
+
+
+// handles a packet read into readbuf
+int ICACHE_FLASH_ATTR handlePacket(MQTTClient* c, int packet_type, Timer* timer)
 {
-    // read the socket, see what work is due
-    unsigned short packet_type = readPacket(c, timer);
-    
     int len = 0,
         rc = SUCCESS;
 
     switch (packet_type)
     {
         case CONNACK:
-        case PUBACK:
         case SUBACK:
+        case UNSUBACK:
+            completePendingOp(c, packet_type);
             break;
+        case PUBACK:
+        {
+            unsigned short mypacketid;
+            unsigned char dup, type;
+            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
+                goto exit;
+            c->fail_count = 0; // we still can receive from broker, treat as recoverable
+            if (c->ackHandler != NULL)
+                c->ackHandler(mypacketid);
+            completePendingOp(c, packet_type);
+            break;
+        }
         case PUBLISH:
         {
             MQTTString topicName;
-            MQTTMessage msg;
+            MQTTMessage msg = {0}; // the packet id is only read for qos > 0
             if (MQTTDeserialize_publish((unsigned char*)&msg.dup, (int*)&msg.qos, (unsigned char*)&msg.retained, (unsigned short*)&msg.id, &topicName,
                (unsigned char**)&msg.payload, (int*)&msg.payloadlen, c->readbuf, c->readbuf_size) != 1)
                 goto exit;
@@ -263,6 +368,7 @@ int ICACHE_FLASH_ATTR cycle(MQTTClient* c, Timer* timer)
             break;
         }
         case PUBCOMP:
+            completePendingOp(c, packet_type);
             break;
         case PINGRESP:
             {
@@ -271,9 +377,172 @@ int ICACHE_FLASH_ATTR cycle(MQTTClient* c, Timer* timer)
             }
             break;
     }
-    if (c->isconnected)
-        rc = keepalive(c);
 exit:
+    return rc;
+}
+
+
+// MQTTTransport read function of readPacket. Only waits while the poll timer
+// runs, otherwise returns what has already arrived. returns 0 if nothing has
+// arrived yet and -1 if the socket is closed, so the read fails at once
+int ICACHE_FLASH_ATTR transportRead(void* sck, unsigned char* buf, int len)
+{
+    MQTTClient* c = (MQTTClient*)sck;
+    int rc = c->ipstack->mqttread(c->ipstack, buf, len, left_ms(&c->poll_timer));
+
+    if (rc > 0)
+        return rc;
+    return (rc == MQTT_NET_TIMEOUT) ? 0 : -1; // call again on the next poll, or give up
+}
+
+
+// reads the rest of a packet too large for readbuf. a PUBLISH has its topic and
+// packet id read into readbuf after the fixed header, then its payload is passed
+// to the stream handler in chunks, each read into the rest of readbuf. the socket
+// is only read as fast as the handler takes the chunks, so a slow handler holds
+// the broker back through the TCP window. other packets, and a PUBLISH whose
+// topic leaves no room in readbuf, are dropped. returns 0 while bytes are still
+// missing or once the packet is consumed, FAILURE if it is malformed or the
+// socket is closed
+int ICACHE_FLASH_ATTR streamPacket(MQTTClient* c)
+{
+    struct StreamState* s = &c->stream;
+    MQTTHeader header = {0};
+    unsigned char* ptr;
+    int rc = 0;
+
+    header.byte = c->readbuf[0];
+    if (header.bits.type != PUBLISH)
+        s->varlen = -1;
+
+    /* 1. read the topic length, then the topic and packet id */
+    while (s->varlen == 0 || (s->varlen > 0 && s->fill < s->varlen))
+    {
+        if ((rc = transportRead(c, c->readbuf + s->start + s->fill, ((s->varlen == 0) ? 2 : s->varlen) - s->fill)) <= 0)
+            return (rc == 0) ? 0 : FAILURE;
+        s->fill += rc;
+        s->remaining -= rc;
+        if (s->varlen == 0 && s->fill == 2)
+        {
+            ptr = c->readbuf + s->start;
+            s->varlen = 2 + readInt(&ptr) + ((header.bits.qos > 0) ? 2 : 0);
+            if (s->varlen - s->fill > s->remaining)
+                return FAILURE; // topic runs past the end of the packet
+            if (s->start + s->varlen >= (int)c->readbuf_size)
+            {
+                // no room left for the payload. the packet id is still read for the ack
+                if (header.bits.qos > 0)
+                    s->idleft = s->remaining - (s->varlen - 4);
+                s->varlen = -1;
+            }
+        }
+        if (s->varlen > 0 && s->fill == s->varlen)
+        {
+            s->total = s->remaining;
+            s->refused = (c->streamHandler == NULL);
+        }
+    }
+
+    /* 2. read the payload a chunk at a time */
+    while (s->remaining > 0)
+    {
+        int skip = (s->varlen > 0) ? s->start + s->varlen : s->start + 2;
+        int want = c->readbuf_size - skip;
+
+        if (want > s->remaining)
+            want = s->remaining;
+        if (s->varlen < 0 && s->idleft > 0 && s->remaining > s->idleft - 2)
+        {
+            // stop at the packet id of a dropped message and keep it at the start of the variable header
+            if (s->remaining > s->idleft)
+            {
+                if (want > s->remaining - s->idleft)
+                    want = s->remaining - s->idleft;
+            }
+            else
+            {
+                skip = s->start + (s->idleft - s->remaining);
+                want = s->remaining - (s->idleft - 2);
+            }
+        }
+        if ((rc = transportRead(c, c->readbuf + skip, want)) <= 0)
+            return (rc == 0) ? 0 : FAILURE;
+        s->remaining -= rc;
+        if (s->varlen > 0 && !s->refused)
+        {
+            MQTTString topicName = MQTTString_initializer;
+            MQTTMessage msg;
+            MessageData md;
+
+            ptr = c->readbuf + s->start;
+            topicName.lenstring.len = readInt(&ptr);
+            topicName.lenstring.data = (char*)ptr;
+            ptr += topicName.lenstring.len;
+            msg.qos = header.bits.qos;
+            msg.dup = header.bits.dup;
+            msg.retained = header.bits.retain;
+            msg.id = (msg.qos > 0) ? readInt(&ptr) : 0;
+            msg.payload = c->readbuf + skip;
+            msg.payloadlen = rc;
+            NewMessageData(&md, &topicName, &msg);
+            if (c->streamHandler(&md, s->offset, s->total) != SUCCESS)
+                s->refused = 1;
+        }
+        s->offset += rc;
+    }
+
+    /* 3. acknowledge the message, also when it was refused or dropped, as a redelivery would be too */
+    rc = 0;
+    if ((s->varlen > 0 || s->idleft > 0) && header.bits.qos > 0)
+    {
+        Timer timer;
+        int len;
+
+        InitTimer(&timer);
+        countdown_ms(&timer, c->command_timeout_ms);
+        ptr = c->readbuf + s->start + ((s->varlen > 0) ? s->varlen - 2 : 0);
+        len = MQTTSerialize_ack(c->buf, c->buf_size, (header.bits.qos == QOS1) ? PUBACK : PUBREC, 0, readInt(&ptr));
+        if (len <= 0 || sendPacket(c, len, &timer) != SUCCESS)
+            rc = FAILURE;
+    }
+    memset(s, 0, sizeof(struct StreamState));
+    return rc;
+}
+
+
+// reads the next packet into readbuf, waiting no longer than the poll timer. a
+// packet cut short is resumed on the next call. returns the packet type, 0 if no
+// packet is complete yet or it was too large for readbuf (see streamPacket), or
+// < 0 if the socket is closed or the stream cannot be followed any more
+int ICACHE_FLASH_ATTR readPacket(MQTTClient* c)
+{
+    int rc = 0;
+
+    if (c->stream.remaining == 0)
+    {
+        rc = MQTTPacket_readnb(c->readbuf, c->readbuf_size, &c->transport);
+        if (rc != MQTTPACKET_TOO_LARGE)
+            return rc;
+        c->stream.start = c->transport.len;
+        c->stream.remaining = c->transport.rem_len;
+        c->transport.state = 0;
+    }
+    if ((rc = streamPacket(c)) == FAILURE)
+        memset(&c->stream, 0, sizeof(struct StreamState));
+    return rc;
+}
+
+
+int ICACHE_FLASH_ATTR cycle(MQTTClient* c, Timer* timer)
+{
+    // read the socket, see what work is due
+    countdown_ms(&(c->poll_timer), left_ms(timer));
+    int packet_type = readPacket(c);
+
+    int rc = (packet_type < 0) ? FAILURE : handlePacket(c, packet_type, timer);
+
+    if (rc == SUCCESS && c->isconnected)
+        rc = keepalive(c);
     if (rc == SUCCESS)
         rc = packet_type;
     return rc;
@@ -285,18 +554,42 @@ void ICACHE_FLASH_ATTR NewMQTTClient(MQTTClient* c, Network* network, unsigned i
     int i;
     c->ipstack = network;
 
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
-        c->messageHandlers[i].topicFilter = 0;
+    mqtt_topic_init(&c->messageHandlers, c->handlerNodes, MAX_TOPIC_NODES, c->handlerNames, MAX_TOPIC_NAME_BYTES);
     c->command_timeout_ms = command_timeout_ms;
     c->buf = buf;
     c->buf_size = buf_size;
     c->readbuf = readbuf;
     c->readbuf_size = readbuf_size;
     c->isconnected = 0;
+    c->sessionPresent = 0;
     c->ping_outstanding = 0;
     c->fail_count = 0;
     c->defaultMessageHandler = NULL;
+    c->ackHandler = NULL;
+    c->streamHandler = NULL;
     InitTimer(&(c->ping_timer));
+
+    c->transport.getfn = transportRead;
+    c->transport.sck = c;
+    c->transport.state = 0;
+    InitTimer(&(c->poll_timer));
+    memset(&c->stream, 0, sizeof(struct StreamState));
+    for (i = 0; i < MAX_PENDING_OPS; ++i)
+        c->pendingOps[i].type = 0;
+}
+
+
+void ICACHE_FLASH_ATTR MQTTSetAckHandler(MQTTClient* c, ackHandler handler)
+{
+    c->ackHandler = handler;
+}
+
+
+// payloads of incoming messages larger than readbuf are passed to handler in
+// chunks instead of the message handlers. without one they are dropped
+void ICACHE_FLASH_ATTR MQTTSetStreamHandler(MQTTClient* c, streamHandler handler)
+{
+    c->streamHandler = handler;
 }
 
 
@@ -310,7 +603,7 @@ int ICACHE_FLASH_ATTR MQTTYield(MQTTClient* c, int timeout_ms)
     while (!expired(&timer))
     {
         rc = cycle(c, &timer);
-        // cycle could return 0 or packet_type or 65535 if nothing is read
+        // cycle could return 0 if nothing is read, packet_type or FAILURE
         // cycle returns DISCONNECTED only if keepalive() fails.
         if (rc == DISCONNECTED)
             break;
@@ -354,6 +647,8 @@ int ICACHE_FLASH_ATTR MQTTConnect(MQTTClient* c, MQTTPacket_connectData* options
 
     c->keepAliveInterval = options->keepAliveInterval;
     countdown(&(c->ping_timer), c->keepAliveInterval);
+    c->transport.state = 0;
+    memset(&c->stream, 0, sizeof(struct StreamState));
 
     if ((len = MQTTSerialize_connect(c->buf, c->buf_size, options)) <= 0)
         goto exit;
@@ -366,7 +661,10 @@ int ICACHE_FLASH_ATTR MQTTConnect(MQTTClient* c, MQTTPacket_connectData* options
         unsigned char connack_rc = 255;
         char sessionPresent = 0;
         if (MQTTDeserialize_connack((unsigned char*)&sessionPresent, &connack_rc, c->readbuf, c->readbuf_size) == 1)
+        {
+            c->sessionPresent = sessionPresent;
             rc = connack_rc;
+        }
         else
             rc = FAILURE;
     }
@@ -407,20 +705,8 @@ int ICACHE_FLASH_ATTR MQTTSubscribe(MQTTClient* c, const char* topic, enum QoS q
         unsigned short mypacketid;
         if (MQTTDeserialize_suback(&mypacketid, 1, &count, &grantedQoS, c->readbuf, c->readbuf_size) == 1)
             rc = grantedQoS; // 0, 1, 2 or 0x80
-        if (rc != 0x80)
-        {
-            int i;
-            for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
-            {
-                if (c->messageHandlers[i].topicFilter == 0)
-                {
-                    c->messageHandlers[i].topicFilter = topic;
-                    c->messageHandlers[i].fp = handler;
-                    rc = 0;
-                    break;
-                }
-            }
-        }
+        if (rc != 0x80 && setMessageHandler(c, topic, handler) == SUCCESS)
+            rc = 0;
     }
     else
         rc = FAILURE;
@@ -453,7 +739,10 @@ int ICACHE_FLASH_ATTR MQTTUnsubscribe(MQTTClient* c, const char* topicFilter)
     {
         unsigned short mypacketid;  // should be the same as the packetid above
         if (MQTTDeserialize_unsuback(&mypacketid, c->readbuf, c->readbuf_size) == 1)
+        {
+            setMessageHandler(c, topicFilter, NULL);
             rc = 0; 
+        }
     }
     else
         rc = FAILURE;
@@ -480,11 +769,11 @@ int ICACHE_FLASH_ATTR MQTTPublish(MQTTClient* c, const char* topic, MQTTMessage*
     if (message->qos == QOS1 || message->qos == QOS2)
         message->id = getNextPacketId(c);
     
-    len = MQTTSerialize_publish(c->buf, c->buf_size, 0, message->qos, message->retained, message->id, 
-              topicStr, (unsigned char*)message->payload, message->payloadlen);
+    len = MQTTSerialize_publishHeader(c->buf, c->buf_size, 0, message->qos, message->retained, message->id,
+              topicStr, message->payloadlen);
     if (len <= 0)
         goto exit;
-    if ((rc = sendPacket(c, len, &timer)) != SUCCESS) // send the subscribe packet
+    if ((rc = sendPacketv(c, len, (unsigned char*)message->payload, message->payloadlen, &timer)) != SUCCESS) // send the publish packet
     {
         goto exit; // there was a problem
     }
@@ -532,6 +821,42 @@ exit:
 }
 
 
+// sends the publish packet without waiting for the PUBACK/PUBCOMP. The
+// acknowledgement is picked up later by cycle() (e.g. through MQTTYield) and
+// reported to the ack handler. A message id of 0 allocates a new packet id,
+// a non-zero id is reused so that a message can be retransmitted with dup set.
+int ICACHE_FLASH_ATTR MQTTPublishAsync(MQTTClient* c, const char* topic, MQTTMessage* message)
+{
+    int rc = FAILURE;
+    Timer timer;
+    MQTTString topicStr = MQTTString_initializer;
+    topicStr.cstring = (char *)topic;
+    int len = 0;
+
+    InitTimer(&timer);
+    countdown_ms(&timer, c->command_timeout_ms);
+
+    if (!c->isconnected)
+        goto exit;
+
+    if ((message->qos == QOS1 || message->qos == QOS2) && message->id == 0)
+        message->id = getNextPacketId(c);
+
+    // only the header goes through c->buf, the payload is sent from its own storage
+    len = MQTTSerialize_publishHeader(c->buf, c->buf_size, message->dup, message->qos, message->retained, message->id,
+              topicStr, message->payloadlen);
+    if (len <= 0)
+    {
+        rc = BUFFER_OVERFLOW; // topic will never fit, retrying does not help
+        goto exit;
+    }
+    rc = sendPacketv(c, len, (unsigned char*)message->payload, message->payloadlen, &timer);
+
+exit:
+    return rc;
+}
+
+
 int ICACHE_FLASH_ATTR MQTTDisconnect(MQTTClient* c)
 {  
     int rc = FAILURE;
@@ -545,6 +870,178 @@ int ICACHE_FLASH_ATTR MQTTDisconnect(MQTTClient* c)
         rc = sendPacket(c, len, &timer);            // send the disconnect packet
         
     c->isconnected = 0;
+    c->transport.state = 0;
+    memset(&c->stream, 0, sizeof(struct StreamState));
+    failPendingOps(c, DISCONNECTED, 0);
+    return rc;
+}
+
+
+int ICACHE_FLASH_ATTR MQTTConnectSubmit(MQTTClient* c, MQTTPacket_connectData* options, opHandler cb, void* context)
+{
+    Timer timer;
+    int rc = FAILURE;
+    MQTTPacket_connectData default_options = MQTTPacket_connectData_initializer;
+    struct PendingOp* op;
+    int len = 0;
+
+    InitTimer(&timer);
+    countdown_ms(&timer, c->command_timeout_ms);
+
+    if (c->isconnected || (op = newPendingOp(c, cb, context)) == NULL)
+        goto exit;
+
+    if (options == 0)
+        options = &default_options; // set default options if none were supplied
+
+    c->keepAliveInterval = options->keepAliveInterval;
+    countdown(&(c->ping_timer), c->keepAliveInterval);
+    c->transport.state = 0;
+    memset(&c->stream, 0, sizeof(struct StreamState));
+
+    if ((len = MQTTSerialize_connect(c->buf, c->buf_size, options)) <= 0)
+        goto exit;
+    if ((rc = sendPacket(c, len, &timer)) == SUCCESS)
+        op->type = CONNACK;
+
+exit:
     return rc;
 }
 
+
+// QoS0 messages complete as soon as they are sent, QoS1 on PUBACK and QoS2 on
+// PUBCOMP. A non-zero message id is reused as in MQTTPublishAsync.
+int ICACHE_FLASH_ATTR MQTTPublishSubmit(MQTTClient* c, const char* topic, MQTTMessage* message, opHandler cb, void* context)
+{
+    int rc = FAILURE;
+    struct PendingOp* op;
+
+    if (!c->isconnected || (op = newPendingOp(c, cb, context)) == NULL)
+        goto exit;
+
+    if ((rc = MQTTPublishAsync(c, topic, message)) != SUCCESS)
+        goto exit;
+
+    op->id = message->id;
+    if (message->qos == QOS0)
+        finishPendingOp(op, SUCCESS);
+    else
+        op->type = (message->qos == QOS1) ? PUBACK : PUBCOMP;
+
+exit:
+    return rc;
+}
+
+
+int ICACHE_FLASH_ATTR MQTTSubscribeSubmit(MQTTClient* c, const char* topic, enum QoS qos, messageHandler handler, opHandler cb, void* context)
+{
+    int rc = FAILURE;
+    Timer timer;
+    int len = 0;
+    struct PendingOp* op;
+    MQTTString topicStr = MQTTString_initializer;
+    topicStr.cstring = (char *)topic;
+
+    InitTimer(&timer);
+    countdown_ms(&timer, c->command_timeout_ms);
+
+    if (!c->isconnected || (op = newPendingOp(c, cb, context)) == NULL)
+        goto exit;
+
+    op->id = getNextPacketId(c);
+    op->topicFilter = topic;
+    op->fp = handler;
+
+    len = MQTTSerialize_subscribe(c->buf, c->buf_size, 0, op->id, 1, &topicStr, (int*)&qos);
+    if (len <= 0)
+        goto exit;
+    if ((rc = sendPacket(c, len, &timer)) == SUCCESS)
+        op->type = SUBACK;
+
+exit:
+    return rc;
+}
+
+
+int ICACHE_FLASH_ATTR MQTTUnsubscribeSubmit(MQTTClient* c, const char* topicFilter, opHandler cb, void* context)
+{
+    int rc = FAILURE;
+    Timer timer;
+    int len = 0;
+    struct PendingOp* op;
+    MQTTString topic = MQTTString_initializer;
+    topic.cstring = (char *)topicFilter;
+
+    InitTimer(&timer);
+    countdown_ms(&timer, c->command_timeout_ms);
+
+    if (!c->isconnected || (op = newPendingOp(c, cb, context)) == NULL)
+        goto exit;
+
+    op->id = getNextPacketId(c);
+    op->topicFilter = topicFilter;
+
+    if ((len = MQTTSerialize_unsubscribe(c->buf, c->buf_size, 0, op->id, 1, &topic)) <= 0)
+        goto exit;
+    if ((rc = sendPacket(c, len, &timer)) == SUCCESS)
+        op->type = UNSUBACK;
+
+exit:
+    return rc;
+}
+
+
+// advances the non-blocking mode. Waits up to timeout_ms for the first packet,
+// then handles whatever else has already arrived without waiting. A packet cut
+// short by the timeout is resumed on the next call. Also fails the operations
+// that timed out and keeps the connection alive. Returns the number of packets
+// handled or DISCONNECTED.
+int ICACHE_FLASH_ATTR MQTTPoll(MQTTClient* c, int timeout_ms)
+{
+    int rc = SUCCESS;
+    int packets = 0;
+    Timer timer;
+
+    InitTimer(&timer);
+    countdown_ms(&timer, c->command_timeout_ms);
+    countdown_ms(&(c->poll_timer), timeout_ms);
+
+    while (packets < MAX_POLL_PACKETS)
+    {
+        int packet_type = readPacket(c);
+
+        if (packet_type == 0)
+            break; // nothing more has arrived
+        if (packet_type < 0)
+        {
+            // a bad length or a closed socket, the stream cannot be followed any more
+            rc = DISCONNECTED;
+            goto exit;
+        }
+
+        ++packets;
+        countdown_ms(&(c->poll_timer), 0);
+        if (handlePacket(c, packet_type, &timer) != SUCCESS)
+        {
+            rc = DISCONNECTED;
+            goto exit;
+        }
+    }
+
+    failPendingOps(c, FAILURE, 1);
+
+    if (c->isconnected)
+        rc = keepalive(c);
+
+exit:
+    if (rc == DISCONNECTED)
+    {
+        c->isconnected = 0;
+        c->transport.state = 0;
+        memset(&c->stream, 0, sizeof(struct StreamState));
+        failPendingOps(c, DISCONNECTED, 0);
+        return rc;
+    }
+    return packets;
+}
+
@@ -19,10 +19,18 @@
 
 #include "MQTTPacket.h"
 #include "MQTTESP8266.h"
+#include "../mqtt_topic.h"
 
 #define MAX_PACKET_ID 65535
-#define MAX_MESSAGE_HANDLERS 5
+#if !defined(MAX_TOPIC_NODES)
+#define MAX_TOPIC_NODES 16          // Message handler trie nodes, one per distinct filter level plus the root
+#endif
+#if !defined(MAX_TOPIC_NAME_BYTES)
+#define MAX_TOPIC_NAME_BYTES 128    // Storage for the level names of all filters
+#endif
 #define MAX_FAIL_ALLOWED  2
+#define MAX_PENDING_OPS 8       // Max operations submitted and not yet completed
+#define MAX_POLL_PACKETS 16     // Max packets handled by one MQTTPoll
 
 enum QoS { QOS0, QOS1, QOS2 };
 
@@ -48,6 +56,14 @@ typedef struct _MessageData
 } MessageData;
 
 typedef void (*messageHandler)(MessageData*);
+typedef void (*ackHandler)(unsigned short);
+// called when a submitted operation completes, rc is SUCCESS, FAILURE (refused
+// or timed out) or DISCONNECTED. id is the packet id (0 for CONNECT)
+typedef void (*opHandler)(void* context, unsigned short id, int rc);
+// called in order with each chunk of a PUBLISH too large for readbuf, as the
+// chunks arrive. md->message->payload and payloadlen hold the chunk, offset is
+// its position in a payload of total bytes. anything but SUCCESS drops the rest
+typedef int (*streamHandler)(MessageData* md, size_t offset, size_t total);
 
 struct _MQTTClient
 {
@@ -60,17 +76,44 @@ struct _MQTTClient
     char ping_outstanding;
     int fail_count;
     int isconnected;
+    unsigned char sessionPresent;   // Broker resumed a stored session (Set on CONNACK)
 
-    struct MessageHandlers
-    {
-        const char* topicFilter;
-        void (*fp) (MessageData*);
-    } messageHandlers[MAX_MESSAGE_HANDLERS];      // Message handlers are indexed by subscription topic
+    MqttTopicTrie messageHandlers;                  // Message handlers are indexed by subscription topic filter
+    MqttTopicNode handlerNodes[MAX_TOPIC_NODES];
+    char handlerNames[MAX_TOPIC_NAME_BYTES];
     
     void (*defaultMessageHandler) (MessageData*);
+    void (*ackHandler) (unsigned short);        // Called with the packet id of every PUBACK
+    int (*streamHandler) (MessageData*, size_t, size_t);    // Gets PUBLISH payloads too large for readbuf in chunks
     
     Network* ipstack;
     Timer ping_timer;
+
+    MQTTTransport transport;    // Resumable reader of MQTTPoll, keeps partly received packets between polls
+    Timer poll_timer;           // Time the current MQTTPoll may still block
+
+    struct StreamState
+    {
+        int remaining;              // Bytes of the oversized packet not read yet, 0 when not streaming
+        int start;                  // Length of the fixed header in readbuf
+        int fill;                   // Bytes of the variable header read so far
+        int varlen;                 // Length of the variable header, 0 until known, -1 to drop the packet
+        int idleft;                 // Bytes left where the packet id of a dropped message starts, 0 if none
+        size_t offset;              // Payload bytes delivered
+        size_t total;               // Payload length
+        char refused;               // Handler refused the message, the rest is dropped
+    } stream;                       // Oversized packet being read, kept between reads
+
+    struct PendingOp
+    {
+        unsigned char type;         // Packet type that completes the operation, 0 if the slot is free
+        unsigned short id;          // Packet id (0 for CONNECT)
+        const char* topicFilter;    // Handler registered on SUBACK
+        messageHandler fp;
+        opHandler cb;
+        void* context;
+        Timer timer;                // Fails the operation on expiry
+    } pendingOps[MAX_PENDING_OPS];  // Operations submitted in non-blocking mode
 };
 
 
@@ -79,13 +122,25 @@ typedef struct _MQTTClient MQTTClient;
 
 int MQTTConnect(MQTTClient* c, MQTTPacket_connectData* options);
 int MQTTPublish(MQTTClient* c, const char* topic, MQTTMessage* message);
+int MQTTPublishAsync(MQTTClient* c, const char* topic, MQTTMessage* message);
 int MQTTSubscribe(MQTTClient* c, const char* topic, enum QoS qos, messageHandler handler);
 int MQTTUnsubscribe(MQTTClient* c, const char* topic);
 int MQTTDisconnect(MQTTClient* c);
 int MQTTYield(MQTTClient* c, int timeout_ms);
+void MQTTSetAckHandler(MQTTClient* c, ackHandler handler);
+void MQTTSetStreamHandler(MQTTClient* c, streamHandler handler);
+
+// non-blocking mode. Operations are submitted and return as soon as the packet
+// is sent, MQTTPoll reads whatever has arrived and completes them through their
+// callbacks. Do not mix with the blocking calls above while operations are pending.
+int MQTTConnectSubmit(MQTTClient* c, MQTTPacket_connectData* options, opHandler cb, void* context);
+int MQTTPublishSubmit(MQTTClient* c, const char* topic, MQTTMessage* message, opHandler cb, void* context);
+int MQTTSubscribeSubmit(MQTTClient* c, const char* topic, enum QoS qos, messageHandler handler, opHandler cb, void* context);
+int MQTTUnsubscribeSubmit(MQTTClient* c, const char* topic, opHandler cb, void* context);
+int MQTTPoll(MQTTClient* c, int timeout_ms);
 
 void NewMQTTClient(MQTTClient*, Network*, unsigned int, unsigned char*, size_t, unsigned char*, size_t);
 
-#define DefaultClient {0, 0, 0, 0, NULL, NULL, 0, 0, 0}
+#define DefaultClient {0}
 
 #endif
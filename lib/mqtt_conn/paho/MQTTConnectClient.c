@@ -145,6 +145,9 @@ int ICACHE_FLASH_ATTR MQTTDeserialize_connack(unsigned char* sessionPresent, uns
 
 	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
 	enddata = curdata + mylen;
+	rc = 0;
+	if (enddata > buf + buflen) /* the packet runs past the end of the buffer */
+		goto exit;
 	if (enddata - curdata < 2)
 		goto exit;
 
@@ -52,6 +52,9 @@ int ICACHE_FLASH_ATTR MQTTDeserialize_publish(unsigned char* dup, int* qos, unsi
 
 	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
 	enddata = curdata + mylen;
+	rc = 0;
+	if (enddata > buf + buflen) /* the packet runs past the end of the buffer */
+		goto exit;
 
 	if (!readMQTTLenString(topicName, &curdata, enddata) ||
 		enddata - curdata < 0) /* do we have enough data to read the protocol version byte? */
@@ -94,6 +97,9 @@ int ICACHE_FLASH_ATTR MQTTDeserialize_ack(unsigned char* packettype, unsigned ch
 
 	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
 	enddata = curdata + mylen;
+	rc = 0;
+	if (enddata > buf + buflen) /* the packet runs past the end of the buffer */
+		goto exit;
 
 	if (enddata - curdata < 2)
 		goto exit;
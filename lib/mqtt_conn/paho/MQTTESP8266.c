@@ -33,6 +33,7 @@
 #include "lwip/sys.h"
 
 #include "MQTTESP8266.h"
+#include "../../wifi_conn/dns_cache.h"
 
 char ICACHE_FLASH_ATTR expired(Timer* timer)
 {
@@ -70,28 +71,93 @@ void ICACHE_FLASH_ATTR InitTimer(Timer* timer)
 
 
 
+// copies up to len bytes from the receive buffer, returns the no of bytes copied
+int ICACHE_FLASH_ATTR mqtt_esp_buffered(Network* n, unsigned char* buffer, int len)
+{
+    int avail = n->rxtail - n->rxhead;
+
+    if (len > avail)
+        len = avail;
+    if (len > 0)
+    {
+        memcpy(buffer, n->rxbuf + n->rxhead, len);
+        n->rxhead += len;
+    }
+    if (n->rxhead == n->rxtail)
+        n->rxhead = n->rxtail = 0;
+    return len;
+}
+
+
+// the packet parser reads a byte at a time for the header and remaining
+// length, so reads are served from rxbuf and the socket is only touched
+// when it is empty. each recv takes whatever the socket has, usually the
+// rest of the packet and the packets behind it. reads as large as rxbuf
+// go straight to the caller's buffer. returns the bytes read, MQTT_NET_TIMEOUT
+// if nothing arrived in time or MQTT_NET_CLOSED if the socket is closed
 int ICACHE_FLASH_ATTR mqtt_esp_read(Network* n, unsigned char* buffer, int len, int timeout_ms)
 {
     struct timeval tv;
     fd_set fdset;
+    Timer timer;
     int rc = 0;
     int rcvd = 0;
-    FD_ZERO(&fdset);
-    FD_SET(n->my_socket, &fdset);
-    // It seems tv_sec actually means FreeRTOS tick
-    tv.tv_sec = timeout_ms / portTICK_RATE_MS;
-    tv.tv_usec = 0;
-    rc = select(n->my_socket + 1, &fdset, 0, 0, &tv);
-    if ((rc > 0) && (FD_ISSET(n->my_socket, &fdset)))
+    int closed = 0;
+
+    n->stats.reads++;
+    rcvd = mqtt_esp_buffered(n, buffer, len);
+    if (rcvd == len)
     {
-        rcvd = recv(n->my_socket, buffer, len, 0);
+        n->stats.buffered++;
+        return rcvd;
     }
-    else
+
+    countdown_ms(&timer, timeout_ms);
+    while (rcvd < len)
     {
-        // select fail
-        return -1;
+        FD_ZERO(&fdset);
+        FD_SET(n->my_socket, &fdset);
+        // It seems tv_sec actually means FreeRTOS tick
+        tv.tv_sec = left_ms(&timer) / portTICK_RATE_MS;
+        tv.tv_usec = 0;
+        n->stats.selects++;
+        rc = select(n->my_socket + 1, &fdset, 0, 0, &tv);
+        if (rc < 0)
+        {
+            closed = 1; // socket error
+            break;
+        }
+        if ((rc == 0) || !FD_ISSET(n->my_socket, &fdset))
+            break; // timeout
+
+        n->stats.recvs++;
+        if (len - rcvd >= MQTT_RX_BUFFER_SIZE)
+        {
+            rc = recv(n->my_socket, buffer + rcvd, len - rcvd, 0);
+            if (rc <= 0)
+            {
+                closed = 1; // closed by the broker or socket error
+                break;
+            }
+            rcvd += rc;
+        }
+        else
+        {
+            rc = recv(n->my_socket, n->rxbuf, MQTT_RX_BUFFER_SIZE, 0);
+            if (rc <= 0)
+            {
+                closed = 1;
+                break;
+            }
+            n->rxtail = rc;
+            rcvd += mqtt_esp_buffered(n, buffer + rcvd, len - rcvd);
+        }
+        n->stats.bytes += rc;
     }
-    return rcvd;
+    // bytes that arrived before a close are returned, the next read reports it
+    if (rcvd > 0)
+        return rcvd;
+    return closed ? MQTT_NET_CLOSED : MQTT_NET_TIMEOUT;
 }
 
 
@@ -122,11 +188,53 @@ int ICACHE_FLASH_ATTR mqtt_esp_write(Network* n, unsigned char* buffer, int len,
 
 
 
+// writes the segments as one stream. every segment but the last is sent
+// with MSG_MORE so lwIP queues them into the same TCP segment instead of
+// sending the packet header on its own. returns the bytes written, which
+// may end inside any segment.
+int ICACHE_FLASH_ATTR mqtt_esp_writev(Network* n, NetworkSegment* segments, int count, int timeout_ms)
+{
+    struct timeval tv;
+    fd_set fdset;
+    int rc = 0;
+    int sent = 0;
+    int i;
+
+    FD_ZERO(&fdset);
+    FD_SET(n->my_socket, &fdset);
+    // It seems tv_sec actually means FreeRTOS tick
+    tv.tv_sec = timeout_ms / portTICK_RATE_MS;
+    tv.tv_usec = 0;
+    rc = select(n->my_socket + 1, 0, &fdset, 0, &tv);
+    if ((rc <= 0) || !FD_ISSET(n->my_socket, &fdset))
+        return -1; // select fail
+
+    for (i = 0; i < count; i++)
+    {
+        int flags = 0;
+#if defined(MSG_MORE)
+        if (i < count - 1)
+            flags = MSG_MORE;
+#endif
+        rc = send(n->my_socket, segments[i].data, segments[i].len, flags);
+        if (rc < 0)
+            return (sent > 0) ? sent : -1;
+        sent += rc;
+        if (rc < segments[i].len)
+            break; // send buffer full, the caller continues from here
+    }
+    return sent;
+}
+
+
 void ICACHE_FLASH_ATTR NewNetwork(Network* n)
 {
 	n->my_socket = -1;
 	n->mqttread = mqtt_esp_read;
 	n->mqttwrite = mqtt_esp_write;
+	n->mqttwritev = mqtt_esp_writev;
+	n->rxhead = n->rxtail = 0;
+	memset(&n->stats, 0, sizeof(n->stats));
 }
 
 
@@ -194,38 +302,13 @@ int TLSConnectNetwork(Network *n, char* addr, int port, SlSockSecureFiles_t* cer
 #endif
 
 
-LOCAL int ICACHE_FLASH_ATTR host2addr(const char *hostname , struct in_addr *in)
-{
-    struct addrinfo hints, *servinfo, *p;
-    struct sockaddr_in *h;
-    int rv;
-
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-    rv = getaddrinfo(hostname, 0 , &hints , &servinfo);
-    if (rv != 0)
-    {
-        return rv;
-    }
-
-    // loop through all the results and get the first resolve
-    for (p = servinfo; p != 0; p = p->ai_next)
-    {
-        h = (struct sockaddr_in *)p->ai_addr;
-        in->s_addr = h->sin_addr.s_addr;
-    }
-    freeaddrinfo(servinfo); // all done with this structure
-    return 0;
-}
-
-
 int ICACHE_FLASH_ATTR ConnectNetwork(Network* n, const char* host, int port)
 {
     struct sockaddr_in addr;
     int ret;
 
-    if (host2addr(host, &(addr.sin_addr)) != 0)
+    // resolved through the shared cache, a reconnect does not wait on DNS
+    if (dns_cache_lookup(host, &(addr.sin_addr)) == DNS_CACHE_FAIL)
     {
         return -1;
     }
@@ -242,8 +325,9 @@ int ICACHE_FLASH_ATTR ConnectNetwork(Network* n, const char* host, int port)
     ret = connect(n->my_socket, ( struct sockaddr *)&addr, sizeof(struct sockaddr_in));
     if( ret < 0 )
     {
-        // error
+        // error, the broker may have moved
         close(n->my_socket);
+        dns_cache_expire(host);
         return ret;
     }
 
@@ -255,5 +339,6 @@ int ICACHE_FLASH_ATTR DisconnectNetwork(Network* n)
 {
     close(n->my_socket);
     n->my_socket = -1;
+    n->rxhead = n->rxtail = 0; // bytes of the old connection
     return 0;
 }
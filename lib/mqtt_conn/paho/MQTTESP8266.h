@@ -32,13 +32,44 @@ struct Timer
     portTickType end_time;
 };
 
+#if !defined(MQTT_RX_BUFFER_SIZE)
+#define MQTT_RX_BUFFER_SIZE 128     // Socket receive buffer the packet parser reads from
+#endif
+
+// mqttread results other than the number of bytes read
+#define MQTT_NET_TIMEOUT -1         // nothing arrived before the timeout
+#define MQTT_NET_CLOSED -2          // closed by the broker or socket error
+
 typedef struct Network Network;
 
+// one piece of a gather write
+typedef struct NetworkSegment
+{
+    unsigned char* data;
+    int len;
+} NetworkSegment;
+
+// counters of the read path, reads / (selects + recvs) shows how many
+// parser reads each round trip into the socket layer served
+typedef struct NetworkStats
+{
+    unsigned long reads;        // mqttread calls
+    unsigned long buffered;     // mqttread calls served from the receive buffer alone
+    unsigned long selects;      // select calls
+    unsigned long recvs;        // recv calls
+    unsigned long bytes;        // bytes received
+} NetworkStats;
+
 struct Network
 {
 	int my_socket;
 	int (*mqttread) (Network*, unsigned char*, int, int);
 	int (*mqttwrite) (Network*, unsigned char*, int, int);
+	int (*mqttwritev) (Network*, NetworkSegment*, int, int);
+	unsigned char rxbuf[MQTT_RX_BUFFER_SIZE];   // bytes received and not yet read
+	int rxhead;                                 // next byte to read
+	int rxtail;                                 // end of the received bytes
+	NetworkStats stats;
 };
 
 char expired(Timer*);
@@ -49,7 +80,9 @@ int left_ms(Timer*);
 void InitTimer(Timer*);
 
 int mqtt_esp_read(Network*, unsigned char*, int, int);
+int mqtt_esp_buffered(Network*, unsigned char*, int);
 int mqtt_esp_write(Network*, unsigned char*, int, int);
+int mqtt_esp_writev(Network*, NetworkSegment*, int, int);
 void mqtt_esp_disconnect(Network*);
 
 void NewNetwork(Network* n);
@@ -338,6 +338,7 @@ static int ICACHE_FLASH_ATTR MQTTPacket_decodenb(MQTTTransport *trp)
 		if ((frc=(*trp->getfn)(trp->sck, &c, 1)) == -1)
 			goto exit;
 		if (frc == 0){
+			--(trp->len);	/* nothing read, the byte is counted again on the next call */
 			rc = 0;
 			goto exit;
 		}
@@ -355,8 +356,10 @@ exit:
  * @param buf the buffer into which the packet will be serialized
  * @param buflen the length in bytes of the supplied buffer
  * @param trp pointer to a transport structure holding what is needed to solve getting data from it
- * @return integer MQTT packet type, 0 for call again, or -1 on error
- * @note  the whole message must fit into the caller's buffer
+ * @return integer MQTT packet type, 0 for call again, -1 on error, or MQTTPACKET_TOO_LARGE
+ * @note  the whole message must fit into the caller's buffer. a larger packet returns
+ * MQTTPACKET_TOO_LARGE with the fixed header in buf (trp->len bytes) and trp->rem_len
+ * bytes left unread, the caller reads or drops them and resets trp->state
  */
 int ICACHE_FLASH_ATTR MQTTPacket_readnb(unsigned char* buf, int buflen, MQTTTransport *trp)
 {
@@ -384,19 +387,24 @@ int ICACHE_FLASH_ATTR MQTTPacket_readnb(unsigned char* buf, int buflen, MQTTTran
 			return 0;
 		trp->len = 1 + MQTTPacket_encode(buf + 1, trp->rem_len); /* put the original remaining length back into the buffer */
 		if((trp->rem_len + trp->len) > buflen)
-			goto exit;
+		{
+			trp->state = 3;
+			return MQTTPACKET_TOO_LARGE;
+		}
 		++trp->state;
 		/*FALLTHROUGH*/
 	case 2:
 		/* read the rest of the buffer using a callback to supply the rest of the data */
-		if ((frc=(*trp->getfn)(trp->sck, buf + trp->len, trp->rem_len)) == -1)
-			goto exit;
-		if (frc == 0)
-			return 0;
-		trp->rem_len -= frc;
-		trp->len += frc;
-		if(trp->rem_len)
-			return 0;
+		if (trp->rem_len > 0){	/* packets without a body (e.g. PINGRESP) are complete */
+			if ((frc=(*trp->getfn)(trp->sck, buf + trp->len, trp->rem_len)) == -1)
+				goto exit;
+			if (frc == 0)
+				return 0;
+			trp->rem_len -= frc;
+			trp->len += frc;
+			if(trp->rem_len)
+				return 0;
+		}
 
 		header.byte = buf[0];
 		rc = header.bits.type;
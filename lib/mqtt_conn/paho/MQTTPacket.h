@@ -35,6 +35,7 @@ extern "C" {
 
 enum errors
 {
+	MQTTPACKET_TOO_LARGE = -3,
 	MQTTPACKET_BUFFER_TOO_SHORT = -2,
 	MQTTPACKET_READ_ERROR = -1,
 	MQTTPACKET_READ_COMPLETE
@@ -112,6 +112,9 @@ int ICACHE_FLASH_ATTR MQTTDeserialize_suback(unsigned short* packetid, int maxco
 
 	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
 	enddata = curdata + mylen;
+	rc = 0;
+	if (enddata > buf + buflen) /* the packet runs past the end of the buffer */
+		goto exit;
 	if (enddata - curdata < 2)
 		goto exit;
 
@@ -24,14 +24,28 @@
 #include "acetimec/zoned_date_time.h"
 #include "acetimec/zone_registrar.h"
 #include "acetimec/zoned_extra.h"
+
+/*
+ * The firmware links only zonedbpruned, the zones of ZONEDB_ZONES in
+ * app_conf.h, which has the same symbols as zonedb. Host tools that need
+ * every zone build with ATC_ZONEDB_FULL and link the full databases instead.
+ */
+#ifdef ATC_ZONEDB_FULL
 #include "zonedb/zone_infos.h"
 #include "zonedb/zone_policies.h"
 #include "zonedb/zone_registry.h"
+#include "zonedb/zone_hash.h"
 #include "zonedball/zone_infos.h"
 #include "zonedball/zone_policies.h"
 #include "zonedball/zone_registry.h"
 #include "zonedbtesting/zone_infos.h"
 #include "zonedbtesting/zone_policies.h"
 #include "zonedbtesting/zone_registry.h"
+#else
+#include "zonedbpruned/zone_infos.h"
+#include "zonedbpruned/zone_policies.h"
+#include "zonedbpruned/zone_registry.h"
+#include "zonedbpruned/zone_hash.h"
+#endif
 
 #endif
@@ -615,6 +615,7 @@ void atc_processor_init(AtcZoneProcessor *processor)
   processor->epoch_year = kAtcInvalidYear;
   processor->year = kAtcInvalidYear;
   processor->num_matches = 0;
+  processor->is_fixed = false;
 }
 
 void atc_processor_init_for_zone_info(
@@ -649,6 +650,7 @@ int8_t atc_processor_init_for_year(
   processor->epoch_year = atc_get_current_epoch_year();
   processor->year = year;
   processor->num_matches = 0;
+  processor->is_fixed = false;
   atc_transition_storage_init(
     &processor->transition_storage, processor->zone_info);
 
@@ -664,6 +666,24 @@ int8_t atc_processor_init_for_year(
     processor->matches,
     kAtcMaxMatches);
 
+#if ATC_FIXED_OFFSET_FAST_PATH
+  // A single era without a zone policy has a constant UTC offset over the
+  // whole window, so skip the transitions and keep just the offset.
+  if (num_matches == 1 && processor->matches[0].era->zone_policy == NULL) {
+    const AtcZoneEra *era = processor->matches[0].era;
+    processor->is_fixed = true;
+    processor->fixed_std_offset_seconds = atc_zone_era_std_offset_seconds(era);
+    processor->fixed_dst_offset_seconds = atc_zone_era_dst_offset_seconds(era);
+    atc_processor_create_abbreviation(
+        processor->fixed_abbrev,
+        kAtcAbbrevSize,
+        era->format,
+        processor->fixed_dst_offset_seconds,
+        "" /*letter*/);
+    return kAtcErrOk;
+  }
+#endif
+
   // Step 2: Create Transitions.
   atc_processor_create_transitions(
     &processor->transition_storage,
@@ -700,6 +720,23 @@ int8_t atc_processor_init_for_epoch_seconds(
 // LocalDatetime.
 //---------------------------------------------------------------------------
 
+/**
+ * Fill the result of a year window with a fixed UTC offset. Every epoch
+ * seconds and LocalDateTime in the window is an exact match.
+ */
+static void atc_processor_find_fixed(
+    const AtcZoneProcessor *processor,
+    AtcFindResult *result)
+{
+  result->type = kAtcFindResultExact;
+  result->fold = 0;
+  result->std_offset_seconds = processor->fixed_std_offset_seconds;
+  result->dst_offset_seconds = processor->fixed_dst_offset_seconds;
+  result->req_std_offset_seconds = processor->fixed_std_offset_seconds;
+  result->req_dst_offset_seconds = processor->fixed_dst_offset_seconds;
+  result->abbrev = processor->fixed_abbrev;
+}
+
 void atc_processor_find_by_epoch_seconds(
     AtcZoneProcessor *processor,
     atc_time_t epoch_seconds,
@@ -711,6 +748,11 @@ void atc_processor_find_by_epoch_seconds(
     return;
   }
 
+  if (processor->is_fixed) {
+    atc_processor_find_fixed(processor, result);
+    return;
+  }
+
   AtcTransitionForSeconds tfs = atc_transition_storage_find_for_seconds(
       &processor->transition_storage, epoch_seconds);
   const AtcTransition *t = tfs.curr;
@@ -746,6 +788,11 @@ void atc_processor_find_by_local_date_time(
     return;
   }
 
+  if (processor->is_fixed) {
+    atc_processor_find_fixed(processor, result);
+    return;
+  }
+
   AtcTransitionForDateTime tfd = atc_transition_storage_find_for_date_time(
       &processor->transition_storage, ldt);
 
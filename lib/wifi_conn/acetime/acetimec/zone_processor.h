@@ -22,6 +22,14 @@
 #include "date_tuple.h" // AtcDateTuple
 #include "transition.h" // AtcTransition, AtcTransitionStorage
 
+#ifndef ATC_FIXED_OFFSET_FAST_PATH
+/**
+ * Set to 0 to create the transitions of every year window, including the ones
+ * with a single fixed-offset era. Only useful as a reference for benchmarks.
+ */
+#define ATC_FIXED_OFFSET_FAST_PATH 1
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -125,6 +133,22 @@ typedef struct AtcZoneProcessor {
   /** Number of valid matches in the array. */
   uint8_t num_matches;
 
+  /**
+   * Set when the year window has a single matching era without a zone policy.
+   * The UTC offset is then constant over the window, no transitions are
+   * created, and the find functions answer from the fixed_xxx fields below.
+   */
+  bool is_fixed;
+
+  /** STD offset of the fixed era. */
+  int32_t fixed_std_offset_seconds;
+
+  /** DST offset of the fixed era, from its RULES column. */
+  int32_t fixed_dst_offset_seconds;
+
+  /** Abbreviation of the fixed era. */
+  char fixed_abbrev[kAtcAbbrevSize];
+
   /** The matching eras for the current zone and year. */
   AtcMatchingEra matches[kAtcMaxMatches];
 
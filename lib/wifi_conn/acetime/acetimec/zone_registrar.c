@@ -14,6 +14,39 @@ void atc_registrar_init(
   registrar->registry = registry;
   registrar->size = size;
   registrar->is_sorted = atc_registrar_is_registry_sorted(registry, size);
+  registrar->hash = NULL;
+}
+
+void atc_registrar_init_hashed(
+    AtcZoneRegistrar *registrar,
+    const AtcZoneInfo * const * registry,
+    uint16_t size,
+    const AtcZoneHash *hash)
+{
+  if (hash == NULL || hash->size != size || hash->num_seeds == 0) {
+    atc_registrar_init(registrar, registry, size);
+    return;
+  }
+
+  registrar->registry = registry;
+  registrar->size = size;
+  registrar->is_sorted = false;
+  registrar->hash = hash;
+}
+
+uint32_t atc_hash_mix(uint32_t x)
+{
+  x ^= x >> 16;
+  x *= UINT32_C(0x7feb352d);
+  x ^= x >> 15;
+  x *= UINT32_C(0x846ca68b);
+  x ^= x >> 16;
+  return x;
+}
+
+uint16_t atc_hash_reduce(uint32_t hash, uint16_t range)
+{
+  return (uint16_t) (((hash >> 16) * range) >> 16);
 }
 
 bool atc_registrar_is_registry_sorted(
@@ -69,6 +102,25 @@ static uint16_t linear_search(
   return UINT16_MAX;
 }
 
+/**
+ * Look up 'zone_id' in the perfect hash of 'registry'. Return index if found,
+ * or UINT16_MAX if not found. Every zone_id maps to some slot, so the zone in
+ * it is checked.
+ */
+static uint16_t hash_search(
+    const AtcZoneInfo * const * registry,
+    const AtcZoneHash *hash,
+    uint32_t zone_id)
+{
+  uint16_t bucket = atc_hash_reduce(atc_hash_mix(zone_id), hash->num_seeds);
+  uint32_t seed = hash->seeds[bucket];
+  uint16_t slot = atc_hash_reduce(
+      atc_hash_mix(zone_id ^ (UINT32_C(0x9e3779b9) * (seed + 1))), hash->size);
+  uint16_t index = hash->index[slot];
+  if (registry[index]->zone_id != zone_id) return UINT16_MAX;
+  return index;
+}
+
 const AtcZoneInfo *atc_registrar_find_by_name(
     const AtcZoneRegistrar *registrar,
     const char *name)
@@ -87,9 +139,14 @@ const AtcZoneInfo *atc_registrar_find_by_id(
     const AtcZoneRegistrar *registrar,
     uint32_t zone_id)
 {
-  uint16_t index = (registrar->is_sorted)
-      ? binary_search(registrar->registry, registrar->size, zone_id)
-      : linear_search(registrar->registry, registrar->size, zone_id);
+  uint16_t index;
+  if (registrar->hash) {
+    index = hash_search(registrar->registry, registrar->hash, zone_id);
+  } else if (registrar->is_sorted) {
+    index = binary_search(registrar->registry, registrar->size, zone_id);
+  } else {
+    index = linear_search(registrar->registry, registrar->size, zone_id);
+  }
   if (index == UINT16_MAX) return NULL;
   const AtcZoneInfo *match = registrar->registry[index];
   return match;
@@ -32,6 +32,9 @@ typedef struct AtcZoneRegistrar {
 
   /** True if the registry is sorted according by zone_id. */
   bool is_sorted;
+
+  /** Perfect hash of the registry by zone_id, NULL if none. */
+  const AtcZoneHash *hash;
 } AtcZoneRegistrar;
 
 /**Initialize the given registrar data structure with the given registry. */
@@ -40,6 +43,24 @@ void atc_registrar_init(
     const AtcZoneInfo * const * registry,
     uint16_t size);
 
+/**
+ * Initialize the given registrar with the given registry and its perfect
+ * hash (e.g. kAtcZoneAndLinkHash), which finds a zone in constant time and
+ * needs no check that the registry is sorted. Falls back to
+ * atc_registrar_init() if the hash is NULL or not of the same size.
+ */
+void atc_registrar_init_hashed(
+    AtcZoneRegistrar *registrar,
+    const AtcZoneInfo * const * registry,
+    uint16_t size,
+    const AtcZoneHash *hash);
+
+/** Mix the bits of a zone_id for the perfect hash. */
+uint32_t atc_hash_mix(uint32_t x);
+
+/** Map a mixed hash to [0, range) with a multiply, as division is slow. */
+uint16_t atc_hash_reduce(uint32_t hash, uint16_t range);
+
 /** Determine if the registry is sorted by zone id. */
 bool atc_registrar_is_registry_sorted(
     const AtcZoneInfo * const * registry,
@@ -0,0 +1,87 @@
+// This file was generated by host/zone_hash_gen.py from zone_registry.c.
+//
+// Minimal perfect hash of kAtcZoneAndLinkRegistry by zone_id, for
+// atc_registrar_init_hashed().
+//
+// Zones: 596, Buckets: 149
+// Memory: 1490 bytes of seeds and index
+//
+// DO NOT EDIT, regenerate with make -C host zonedb
+
+#include "zone_hash.h"
+
+static const uint16_t kAtcZoneAndLinkHashSeeds[149] = {
+  0, 0, 21, 10, 167, 1, 0, 0, 53, 30, 0, 0,
+  47, 68, 75, 3, 0, 3, 306, 36, 5, 19, 0, 328,
+  78, 1, 1, 0, 0, 8, 0, 142, 2, 76, 49, 169,
+  47, 41, 24, 15, 26, 41, 12, 5, 22, 21, 172, 228,
+  25, 12, 21, 551, 133, 244, 10, 2, 18, 0, 52, 27,
+  154, 57, 199, 148, 608, 5, 17, 87, 319, 3, 80, 67,
+  22, 9, 116, 124, 82, 18, 201, 11, 5, 39, 4, 54,
+  0, 3, 337, 36, 477, 9, 24, 24, 61, 748, 41, 23,
+  8, 239, 268, 406, 0, 1348, 137, 0, 1546, 146, 47, 2,
+  95, 33, 495, 801, 282, 1018, 1380, 0, 188, 2, 12, 29,
+  0, 42, 147, 34, 16, 34, 246, 233, 98, 21, 263, 103,
+  0, 542, 4, 273, 28, 176, 136, 1431, 4, 2, 842, 11,
+  1, 880, 2569, 15, 1498,
+};
+
+static const uint16_t kAtcZoneAndLinkHashIndex[596] = {
+  114, 467, 89, 238, 583, 545, 272, 31, 364, 170, 256, 90,
+  407, 283, 535, 292, 371, 274, 118, 488, 508, 315, 14, 482,
+  546, 176, 343, 236, 202, 280, 334, 219, 81, 282, 16, 321,
+  225, 204, 494, 335, 1, 562, 415, 517, 84, 326, 6, 594,
+  516, 509, 340, 165, 432, 408, 260, 402, 191, 589, 387, 436,
+  428, 574, 500, 328, 470, 592, 113, 347, 375, 4, 129, 233,
+  196, 206, 215, 258, 320, 542, 567, 269, 145, 216, 299, 53,
+  51, 52, 161, 356, 369, 2, 366, 285, 444, 383, 289, 209,
+  77, 451, 286, 420, 578, 93, 10, 374, 95, 67, 310, 422,
+  473, 231, 449, 143, 412, 507, 278, 66, 581, 205, 499, 455,
+  468, 92, 477, 271, 445, 159, 558, 385, 276, 570, 262, 267,
+  571, 75, 380, 146, 275, 42, 505, 140, 22, 187, 528, 373,
+  469, 194, 355, 403, 504, 400, 117, 98, 439, 107, 306, 577,
+  80, 133, 401, 549, 167, 518, 97, 466, 232, 530, 242, 511,
+  119, 50, 139, 73, 138, 39, 519, 96, 59, 60, 7, 230,
+  174, 540, 226, 480, 228, 497, 190, 414, 465, 88, 496, 173,
+  502, 178, 116, 559, 515, 386, 64, 345, 259, 388, 99, 155,
+  365, 248, 120, 539, 553, 131, 40, 460, 141, 398, 525, 391,
+  128, 297, 573, 83, 452, 33, 163, 552, 313, 197, 9, 18,
+  362, 478, 277, 265, 533, 434, 34, 68, 123, 156, 584, 532,
+  126, 41, 201, 368, 582, 222, 48, 94, 351, 124, 57, 101,
+  273, 337, 181, 377, 296, 55, 151, 336, 392, 169, 580, 56,
+  105, 287, 217, 142, 207, 12, 316, 303, 38, 453, 23, 268,
+  384, 534, 158, 175, 397, 593, 103, 239, 27, 394, 270, 435,
+  411, 327, 291, 74, 127, 203, 587, 198, 555, 188, 564, 180,
+  333, 29, 367, 474, 300, 454, 157, 483, 487, 395, 136, 437,
+  381, 71, 461, 227, 527, 556, 503, 456, 290, 250, 0, 419,
+  85, 358, 241, 438, 588, 547, 200, 341, 361, 44, 32, 255,
+  134, 144, 565, 568, 61, 457, 249, 572, 11, 125, 210, 318,
+  501, 36, 410, 551, 484, 405, 330, 294, 252, 389, 331, 379,
+  526, 521, 595, 319, 171, 354, 498, 544, 548, 111, 312, 91,
+  193, 382, 149, 214, 62, 489, 317, 486, 543, 342, 186, 442,
+  35, 220, 423, 58, 464, 153, 514, 284, 409, 132, 309, 137,
+  418, 399, 349, 441, 166, 433, 560, 106, 404, 17, 245, 329,
+  537, 49, 223, 471, 396, 295, 301, 522, 344, 427, 590, 424,
+  585, 184, 446, 26, 332, 475, 350, 5, 463, 339, 251, 63,
+  24, 307, 531, 154, 566, 324, 152, 162, 70, 529, 348, 352,
+  72, 550, 495, 147, 510, 43, 576, 421, 237, 485, 208, 536,
+  563, 263, 430, 150, 569, 19, 360, 490, 586, 130, 87, 100,
+  293, 520, 8, 281, 491, 493, 253, 524, 579, 353, 168, 314,
+  304, 378, 448, 160, 46, 213, 199, 338, 413, 523, 13, 288,
+  305, 28, 254, 122, 346, 308, 65, 224, 15, 447, 112, 221,
+  234, 177, 183, 47, 557, 172, 243, 513, 325, 357, 541, 247,
+  298, 21, 472, 512, 476, 261, 76, 538, 235, 370, 440, 240,
+  462, 363, 376, 429, 479, 264, 244, 110, 311, 481, 554, 591,
+  279, 86, 458, 102, 561, 189, 69, 121, 54, 575, 211, 179,
+  417, 218, 416, 302, 322, 30, 45, 148, 459, 79, 425, 108,
+  37, 229, 3, 20, 212, 406, 266, 195, 359, 372, 25, 164,
+  506, 431, 393, 192, 185, 115, 182, 257, 323, 135, 390, 492,
+  246, 443, 78, 450, 109, 104, 82, 426,
+};
+
+const AtcZoneHash kAtcZoneAndLinkHash = {
+  kAtcZoneAndLinkHashSeeds /*seeds*/,
+  kAtcZoneAndLinkHashIndex /*index*/,
+  149 /*num_seeds*/,
+  596 /*size*/,
+};
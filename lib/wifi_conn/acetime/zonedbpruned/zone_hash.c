@@ -0,0 +1,26 @@
+// This file was generated by host/zone_hash_gen.py from zone_registry.c.
+//
+// Minimal perfect hash of kAtcZoneAndLinkRegistry by zone_id, for
+// atc_registrar_init_hashed().
+//
+// Zones: 2, Buckets: 1
+// Memory: 6 bytes of seeds and index
+//
+// DO NOT EDIT, regenerate with make -C host zonedb
+
+#include "zone_hash.h"
+
+static const uint16_t kAtcZoneAndLinkHashSeeds[1] = {
+  2,
+};
+
+static const uint16_t kAtcZoneAndLinkHashIndex[2] = {
+  0, 1,
+};
+
+const AtcZoneHash kAtcZoneAndLinkHash = {
+  kAtcZoneAndLinkHashSeeds /*seeds*/,
+  kAtcZoneAndLinkHashIndex /*index*/,
+  1 /*num_seeds*/,
+  2 /*size*/,
+};
@@ -0,0 +1,27 @@
+// This file was generated by host/zone_hash_gen.py from zone_registry.c.
+//
+// Minimal perfect hash of kAtcZoneAndLinkRegistry by zone_id, for
+// atc_registrar_init_hashed().
+//
+// Zones: 2, Buckets: 1
+// Memory: 6 bytes of seeds and index
+//
+// DO NOT EDIT, regenerate with make -C host zonedb
+
+#ifndef ACE_TIME_C_ZONEDBPRUNED_ATC_ZONE_HASH_H
+#define ACE_TIME_C_ZONEDBPRUNED_ATC_ZONE_HASH_H
+
+#include "../zoneinfo/zone_info.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Perfect hash of kAtcZoneAndLinkRegistry
+extern const AtcZoneHash kAtcZoneAndLinkHash;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
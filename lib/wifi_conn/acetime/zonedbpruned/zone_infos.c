@@ -0,0 +1,165 @@
+// This file was generated by the following script:
+//
+//   $ /home/brian/src/AceTimeTools/src/acetimetools/tzcompiler.py
+//     --input_dir /home/brian/src/acetimec/src/zonedb/tzfiles
+//     --output_dir /home/brian/src/acetimec/src/zonedb
+//     --tz_version 2024a
+//     --actions zonedb
+//     --languages c
+//     --scope complete
+//     --db_namespace Atc
+//     --start_year 2000
+//     --until_year 2200
+//     --nocompress
+//
+// using the TZ Database files
+//
+//   africa
+//   antarctica
+//   asia
+//   australasia
+//   backward
+//   etcetera
+//   europe
+//   northamerica
+//   southamerica
+//
+// from https://github.com/eggert/tz/releases/tag/2024a
+//
+// Pruned by host/zonedb_prune.py to ZONEDB_ZONES of include/app_conf.h:
+//
+//   Asia/Colombo
+//   Asia/Shanghai
+//
+// Records: Infos 2, Eras 3, Policies 1, Rules 1
+// Memory (32-bits): 265 (zonedb: 49073)
+//
+// DO NOT EDIT, regenerate with make -C host zonedb
+
+#include "zone_policies.h"
+#include "zone_infos.h"
+
+//---------------------------------------------------------------------------
+// ZoneContext
+//---------------------------------------------------------------------------
+
+static const char kAtcTzDatabaseVersion[] = "2024a";
+
+static const char * const kAtcFragments[] = {
+/*\x00*/ NULL,
+
+};
+
+static const char* const kAtcLetters[] = {
+/*0*/ "",
+/*1*/ "+00",
+/*2*/ "+02",
+/*3*/ "CAT",
+/*4*/ "CST",
+/*5*/ "D",
+/*6*/ "DD",
+/*7*/ "S",
+/*8*/ "WAT",
+
+};
+
+const AtcZoneContext kAtcZoneContext = {
+  2000 /*start_year*/,
+  2200 /*until_year*/,
+  2000 /*start_year_accurate*/,
+  32767 /*until_year_accurate*/,
+  7 /*max_transitions*/,
+  kAtcTzDatabaseVersion /*tz_version*/,
+  1 /*num_fragments*/,
+  9 /*num_letters*/,
+  kAtcFragments /*fragments*/,
+  kAtcLetters /*letters*/,
+};
+
+//---------------------------------------------------------------------------
+// Zones: 2
+// Eras: 3
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// Zone name: Asia/Colombo
+// Zone Eras: 2
+//---------------------------------------------------------------------------
+
+static const AtcZoneEra kAtcZoneEraAsia_Colombo[]  = {
+  //             6:00    -    +06    2006 Apr 15  0:30
+  {
+    NULL /*zone_policy*/,
+    "+06" /*format*/,
+    1440 /*offset_code (21600/15)*/,
+    0 /*offset_remainder (21600%15)*/,
+    0 /*delta_minutes*/,
+    2006 /*until_year*/,
+    4 /*until_month*/,
+    15 /*until_day*/,
+    120 /*until_time_code (1800/15)*/,
+    0 /*until_time_modifier (kAtcSuffixW + seconds=0)*/,
+  },
+  //             5:30    -    +0530
+  {
+    NULL /*zone_policy*/,
+    "+0530" /*format*/,
+    1320 /*offset_code (19800/15)*/,
+    0 /*offset_remainder (19800%15)*/,
+    0 /*delta_minutes*/,
+    32767 /*until_year*/,
+    1 /*until_month*/,
+    1 /*until_day*/,
+    0 /*until_time_code (0/15)*/,
+    0 /*until_time_modifier (kAtcSuffixW + seconds=0)*/,
+  },
+
+};
+
+static const char kAtcZoneNameAsia_Colombo[]  = "Asia/Colombo";
+
+const AtcZoneInfo kAtcZoneAsia_Colombo  = {
+  kAtcZoneNameAsia_Colombo /*name*/,
+  0x0af0e91d /*zone_id*/,
+  &kAtcZoneContext /*zone_context*/,
+  2 /*num_eras*/,
+  kAtcZoneEraAsia_Colombo /*eras*/,
+  NULL /*target_info*/,
+};
+
+//---------------------------------------------------------------------------
+// Zone name: Asia/Shanghai
+// Zone Eras: 1
+//---------------------------------------------------------------------------
+
+static const AtcZoneEra kAtcZoneEraAsia_Shanghai[]  = {
+  //             8:00    PRC    C%sT
+  {
+    &kAtcZonePolicyPRC /*zone_policy*/,
+    "C%T" /*format*/,
+    1920 /*offset_code (28800/15)*/,
+    0 /*offset_remainder (28800%15)*/,
+    0 /*delta_minutes*/,
+    32767 /*until_year*/,
+    1 /*until_month*/,
+    1 /*until_day*/,
+    0 /*until_time_code (0/15)*/,
+    0 /*until_time_modifier (kAtcSuffixW + seconds=0)*/,
+  },
+
+};
+
+static const char kAtcZoneNameAsia_Shanghai[]  = "Asia/Shanghai";
+
+const AtcZoneInfo kAtcZoneAsia_Shanghai  = {
+  kAtcZoneNameAsia_Shanghai /*name*/,
+  0xf895a7f5 /*zone_id*/,
+  &kAtcZoneContext /*zone_context*/,
+  1 /*num_eras*/,
+  kAtcZoneEraAsia_Shanghai /*eras*/,
+  NULL /*target_info*/,
+};
+
+//---------------------------------------------------------------------------
+// Links: 0
+//---------------------------------------------------------------------------
@@ -0,0 +1,95 @@
+// This file was generated by the following script:
+//
+//   $ /home/brian/src/AceTimeTools/src/acetimetools/tzcompiler.py
+//     --input_dir /home/brian/src/acetimec/src/zonedb/tzfiles
+//     --output_dir /home/brian/src/acetimec/src/zonedb
+//     --tz_version 2024a
+//     --actions zonedb
+//     --languages c
+//     --scope complete
+//     --db_namespace Atc
+//     --start_year 2000
+//     --until_year 2200
+//     --nocompress
+//
+// using the TZ Database files
+//
+//   africa
+//   antarctica
+//   asia
+//   australasia
+//   backward
+//   etcetera
+//   europe
+//   northamerica
+//   southamerica
+//
+// from https://github.com/eggert/tz/releases/tag/2024a
+//
+// Pruned by host/zonedb_prune.py to ZONEDB_ZONES of include/app_conf.h:
+//
+//   Asia/Colombo
+//   Asia/Shanghai
+//
+// Records: Infos 2, Eras 3, Policies 1, Rules 1
+// Memory (32-bits): 265 (zonedb: 49073)
+//
+// DO NOT EDIT, regenerate with make -C host zonedb
+
+#ifndef ACE_TIME_C_ZONEDBPRUNED_ATC_ZONE_INFOS_H
+#define ACE_TIME_C_ZONEDBPRUNED_ATC_ZONE_INFOS_H
+
+#include "../zoneinfo/zone_info.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------------------------------------------------
+// ZoneContext (should not be in PROGMEM)
+//---------------------------------------------------------------------------
+
+// Metadata about the zonedb files.
+extern const AtcZoneContext kAtcZoneContext;
+
+//---------------------------------------------------------------------------
+// Supported zones: 2
+// Supported eras: 3
+//---------------------------------------------------------------------------
+
+extern const AtcZoneInfo kAtcZoneAsia_Colombo; // Asia/Colombo
+extern const AtcZoneInfo kAtcZoneAsia_Shanghai; // Asia/Shanghai
+
+
+// Zone Ids
+
+#define kAtcZoneIdAsia_Colombo 0x0af0e91d /* Asia/Colombo */
+#define kAtcZoneIdAsia_Shanghai 0xf895a7f5 /* Asia/Shanghai */
+
+
+//---------------------------------------------------------------------------
+// Supported links: 0
+//---------------------------------------------------------------------------
+
+
+
+// Zone Ids
+
+
+
+//---------------------------------------------------------------------------
+// Maximum size of the Transition buffer in ExtendedZoneProcessor for each zone
+// over the given years. Used only in the AceTimeValidation/Extended*Test tests
+// for ExtendedZoneProcessor.
+//
+// MaxBufSize: 7
+//---------------------------------------------------------------------------
+
+#define kAtcZoneBufSizeAsia_Colombo 2  /* Asia/Colombo in 2006 */
+#define kAtcZoneBufSizeAsia_Shanghai 2  /* Asia/Shanghai in 1949 */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+// This file was generated by the following script:
+//
+//   $ /home/brian/src/AceTimeTools/src/acetimetools/tzcompiler.py
+//     --input_dir /home/brian/src/acetimec/src/zonedb/tzfiles
+//     --output_dir /home/brian/src/acetimec/src/zonedb
+//     --tz_version 2024a
+//     --actions zonedb
+//     --languages c
+//     --scope complete
+//     --db_namespace Atc
+//     --start_year 2000
+//     --until_year 2200
+//     --nocompress
+//
+// using the TZ Database files
+//
+//   africa
+//   antarctica
+//   asia
+//   australasia
+//   backward
+//   etcetera
+//   europe
+//   northamerica
+//   southamerica
+//
+// from https://github.com/eggert/tz/releases/tag/2024a
+//
+// Pruned by host/zonedb_prune.py to ZONEDB_ZONES of include/app_conf.h:
+//
+//   Asia/Colombo
+//   Asia/Shanghai
+//
+// Records: Infos 2, Eras 3, Policies 1, Rules 1
+// Memory (32-bits): 265 (zonedb: 49073)
+//
+// DO NOT EDIT, regenerate with make -C host zonedb
+
+#include "zone_policies.h"
+
+//---------------------------------------------------------------------------
+// Policies: 1
+// Rules: 1
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// Policy name: PRC
+// Rules: 1
+//---------------------------------------------------------------------------
+
+static const AtcZoneRule kAtcZoneRulesPRC[]  = {
+  // Anchor: Rule    PRC    1986    1991    -    Sep    Sun>=11     2:00    0    S
+  {
+    -32767 /*from_year*/,
+    -32767 /*to_year*/,
+    1 /*in_month*/,
+    0 /*on_day_of_week*/,
+    1 /*on_day_of_month*/,
+    0 /*at_time_modifier (kAtcSuffixW + seconds=0)*/,
+    0 /*at_time_code (0/15)*/,
+    0 /*delta_minutes*/,
+    7 /*letterIndex ("S")*/,
+  },
+
+};
+
+const AtcZonePolicy kAtcZonePolicyPRC  = {
+  kAtcZoneRulesPRC /*rules*/,
+  1 /*num_rules*/,
+};
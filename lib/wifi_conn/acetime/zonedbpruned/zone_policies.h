@@ -0,0 +1,58 @@
+// This file was generated by the following script:
+//
+//   $ /home/brian/src/AceTimeTools/src/acetimetools/tzcompiler.py
+//     --input_dir /home/brian/src/acetimec/src/zonedb/tzfiles
+//     --output_dir /home/brian/src/acetimec/src/zonedb
+//     --tz_version 2024a
+//     --actions zonedb
+//     --languages c
+//     --scope complete
+//     --db_namespace Atc
+//     --start_year 2000
+//     --until_year 2200
+//     --nocompress
+//
+// using the TZ Database files
+//
+//   africa
+//   antarctica
+//   asia
+//   australasia
+//   backward
+//   etcetera
+//   europe
+//   northamerica
+//   southamerica
+//
+// from https://github.com/eggert/tz/releases/tag/2024a
+//
+// Pruned by host/zonedb_prune.py to ZONEDB_ZONES of include/app_conf.h:
+//
+//   Asia/Colombo
+//   Asia/Shanghai
+//
+// Records: Infos 2, Eras 3, Policies 1, Rules 1
+// Memory (32-bits): 265 (zonedb: 49073)
+//
+// DO NOT EDIT, regenerate with make -C host zonedb
+
+#ifndef ACE_TIME_C_ZONEDBPRUNED_ATC_ZONE_POLICIES_H
+#define ACE_TIME_C_ZONEDBPRUNED_ATC_ZONE_POLICIES_H
+
+#include "../zoneinfo/zone_info.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------------------------------------------------
+// Supported policies: 1
+//---------------------------------------------------------------------------
+
+extern const AtcZonePolicy kAtcZonePolicyPRC;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
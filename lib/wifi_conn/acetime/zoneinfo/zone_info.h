@@ -422,6 +422,28 @@ typedef struct AtcZoneInfo {
   const struct AtcZoneInfo * target_info;
 } AtcZoneInfo;
 
+/**
+ * Minimal perfect hash of a zone registry by zone_id, generated next to the
+ * registry by zone_hash_gen.py. A zone_id falls in the bucket
+ * atc_hash_reduce(atc_hash_mix(zone_id), num_seeds), and the seed of the
+ * bucket moves it to the slot atc_hash_reduce(atc_hash_mix(zone_id ^
+ * (0x9e3779b9 * (seed + 1))), size), which is unique to it. index[slot] is
+ * the position of the zone in the registry.
+ */
+typedef struct AtcZoneHash {
+  /** Seed of each bucket. */
+  const uint16_t * const seeds;
+
+  /** Registry index of each slot. */
+  const uint16_t * const index;
+
+  /** Number of buckets. */
+  uint16_t const num_seeds;
+
+  /** Number of slots, the size of the registry. */
+  uint16_t const size;
+} AtcZoneHash;
+
 //---------------------------------------------------------------------------
 
 #ifdef __cplusplus
@@ -0,0 +1,334 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: clock_sync.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Clock disciplined by SNTP samples. The newest sample is the
+ * anchor, time since it is counted on the tick and corrected by the drift
+ * measured between the oldest and the newest of the last
+ * CLOCK_SYNC_SAMPLES samples. Each sample is first compared with the time
+ * the clock would have served, and the resync interval is scaled so that
+ * the next error lands at half of CLOCK_SYNC_ERROR (Within CLOCK_SYNC_MIN
+ * and CLOCK_SYNC_MAX).
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "clock_sync.h"
+
+// Constants ----------------------------------------------------------
+
+#define CLOCK_PPB 1000000000LL // Parts per billion
+#define CLOCK_RATE_SCALE 1000 // Drift rate unit (ppb per 1000 secs)
+#define CLOCK_RATE_LAG 3 // Error of a moving drift over an interval, in drift rate x interval^2
+
+// --------------------------------------------------------------------
+
+ClockSync system_clock = {0};       // Clock served by clock_now_ms()
+uint8 system_clock_ready = FALSE;   // System clock was synced once
+
+portTickType clock_last_tick = 0;   // Tick count at the last monotonic read
+uint32 clock_tick_wraps = 0;        // Times the tick count wrapped
+
+/**
+ * Returns the time the clock serves at a local time, without the
+ * monotonic hold.
+ * @param ClockSync *clock Clock
+ * @param uint64 local_ms Monotonic time (in msec)
+ * @return uint64 Unix time (in msec)
+ */
+static uint64 clock_sync_predict(ClockSync *clock, uint64 local_ms) {
+    ClockSample *anchor = &clock->samples[(clock->head + clock->count - 1) % CLOCK_SYNC_SAMPLES];
+    sint64 elapsed = (sint64)(local_ms - anchor->local_ms);
+
+    return anchor->unix_ms + elapsed + ((elapsed * clock->stats.drift_ppb) / CLOCK_PPB);
+}
+
+/**
+ * Returns the integer square root.
+ * @param uint64 value Value
+ * @return uint64 Square root (Rounded down)
+ */
+static uint64 clock_isqrt(uint64 value) {
+    uint64 root = 0;
+    uint64 bit = 1ULL << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+
+    while (bit != 0) {
+        if (value >= (root + bit)) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+/**
+ * Resets a clock to unsynced.
+ * @param ClockSync *clock Clock
+ * @return none
+ */
+void clock_sync_init(ClockSync *clock) {
+    memset(clock, 0, sizeof(ClockSync));
+    clock->stats.interval_s = CLOCK_SYNC_MIN;
+}
+
+/**
+ * Adds a reference sample. Measures the error of the served time against
+ * it, adapts the resync interval to that error, re-estimates the drift and
+ * makes the sample the anchor. While the drift keeps moving between
+ * samples, the interval is also capped by how fast it moves. A reference
+ * that stepped further than CLOCK_DRIFT_MAX can explain restarts the
+ * estimate.
+ * @param ClockSync *clock Clock
+ * @param uint64 local_ms Monotonic time of the sample (in msec)
+ * @param uint64 unix_ms Reference Unix time (in msec)
+ * @return none
+ */
+void clock_sync_sample(ClockSync *clock, uint64 local_ms, uint64 unix_ms) {
+    if (clock->count > 0) {
+        ClockSample *anchor = &clock->samples[(clock->head + clock->count - 1) % CLOCK_SYNC_SAMPLES];
+        sint64 error = (sint64)unix_ms - (sint64)clock_sync_predict(clock, local_ms);
+        sint64 magnitude = (error < 0) ? -error : error;
+        sint64 bound = (((sint64)(local_ms - anchor->local_ms) * CLOCK_DRIFT_MAX) / 1000000) + CLOCK_SYNC_ERROR;
+
+        clock->stats.last_error_ms = (int32)error;
+
+        if (magnitude > bound) {
+            // Reference stepped, the samples no longer describe the drift
+            clock->head = 0;
+            clock->count = 0;
+            clock->served_ms = 0;
+            clock->stats.drift_ppb = 0;
+            clock->stats.interval_s = CLOCK_SYNC_MIN;
+            clock->drift_rate = 0;
+            clock->stats.restarts++;
+        } else {
+            if (magnitude > clock->stats.max_error_ms) {
+                clock->stats.max_error_ms = (uint32)magnitude;
+            }
+
+            // The error grows with the interval, scale it to land at half of
+            // CLOCK_SYNC_ERROR (At most doubled or halved per sample)
+            uint64 interval = ((uint64)clock->stats.interval_s * (CLOCK_SYNC_ERROR / 2)) / (magnitude + 1);
+
+            if (interval > ((uint64)clock->stats.interval_s * 2)) {
+                interval = (uint64)clock->stats.interval_s * 2;
+            } else if (interval < (clock->stats.interval_s / 2)) {
+                interval = clock->stats.interval_s / 2;
+            }
+
+            clock->stats.interval_s = (uint32)interval;
+
+            if (clock->stats.interval_s > CLOCK_SYNC_MAX) {
+                clock->stats.interval_s = CLOCK_SYNC_MAX;
+            } else if (clock->stats.interval_s < CLOCK_SYNC_MIN) {
+                clock->stats.interval_s = CLOCK_SYNC_MIN;
+            }
+        }
+    }
+
+    // Newest sample becomes the anchor, the oldest is dropped once full
+    if (clock->count == CLOCK_SYNC_SAMPLES) {
+        clock->head = (clock->head + 1) % CLOCK_SYNC_SAMPLES;
+        clock->count--;
+    }
+
+    ClockSample *sample = &clock->samples[(clock->head + clock->count) % CLOCK_SYNC_SAMPLES];
+    sample->local_ms = local_ms;
+    sample->unix_ms = unix_ms;
+    clock->count++;
+
+    // Drift over the whole window, the sample jitter is divided by its span
+    if (clock->count > 1) {
+        ClockSample *oldest = &clock->samples[clock->head];
+        ClockSample *previous = &clock->samples[(clock->head + clock->count - 2) % CLOCK_SYNC_SAMPLES];
+        sint64 span = (sint64)(local_ms - oldest->local_ms);
+        sint64 step = (sint64)(local_ms - previous->local_ms) / 1000;
+
+        if (span > 0) {
+            sint64 drift = (((sint64)(unix_ms - oldest->unix_ms) - span) * CLOCK_PPB) / span;
+            sint64 limit = (sint64)CLOCK_DRIFT_MAX * 1000;
+
+            drift = (drift > limit) ? limit : ((drift < -limit) ? -limit : drift);
+
+            // How fast the drift moves (e.g. with the temperature), the fastest
+            // recently seen fading by an eighth per sample
+            if ((clock->count > 2) && (step > 0)) {
+                sint64 change = drift - clock->stats.drift_ppb;
+                uint64 rate = (((change < 0) ? -change : change) * CLOCK_RATE_SCALE) / step;
+
+                clock->drift_rate = (clock->drift_rate * 7) / 8;
+
+                if (rate > clock->drift_rate) {
+                    clock->drift_rate = (uint32)rate;
+                }
+            }
+
+            clock->stats.drift_ppb = (int32)drift;
+        }
+    }
+
+    // A moving drift adds an error that grows with the square of the
+    // interval, as the estimate lags it. Keep that within half of
+    // CLOCK_SYNC_ERROR
+    if (clock->drift_rate > 0) {
+        uint64 limit = clock_isqrt(((uint64)(CLOCK_SYNC_ERROR / 2) * 1000000 * CLOCK_RATE_SCALE) /
+                                   ((uint64)clock->drift_rate * CLOCK_RATE_LAG));
+
+        if (limit < clock->stats.interval_s) {
+            clock->stats.interval_s = (limit < CLOCK_SYNC_MIN) ? CLOCK_SYNC_MIN : (uint32)limit;
+        }
+    }
+
+    clock->stats.syncs++;
+    clock->next_ms = local_ms + ((uint64)clock->stats.interval_s * 1000);
+}
+
+/**
+ * Returns the Unix time at a local time. Never returns less than the last
+ * time served, so a sync that sets the clock back holds the time until the
+ * clock catches up.
+ * @param ClockSync *clock Clock
+ * @param uint64 local_ms Monotonic time (in msec)
+ * @param uint64 *unix_ms Unix time (in msec)
+ * @return int Success/Fail (Not synced)
+ */
+uint8 clock_sync_read(ClockSync *clock, uint64 local_ms, uint64 *unix_ms) {
+    if (clock->count == 0) {
+        return FALSE;
+    }
+
+    uint64 now = clock_sync_predict(clock, local_ms);
+
+    if (now < clock->served_ms) {
+        now = clock->served_ms;
+    }
+
+    clock->served_ms = now;
+    *unix_ms = now;
+
+    return TRUE;
+}
+
+/**
+ * Returns the time until a clock is due a resync, 0 if due now or never
+ * synced.
+ * @param ClockSync *clock Clock
+ * @param uint64 local_ms Monotonic time (in msec)
+ * @return uint64 Time (in msec)
+ */
+uint64 clock_sync_due(ClockSync *clock, uint64 local_ms) {
+    if ((clock->count == 0) || (local_ms >= clock->next_ms)) {
+        return 0;
+    }
+
+    return clock->next_ms - local_ms;
+}
+
+/**
+ * Returns the tick count in msec, extended past the 32 bit wrap. Call in
+ * a critical section.
+ * @param none
+ * @return uint64 Monotonic time (in msec)
+ */
+static uint64 clock_ticks_ms() {
+    portTickType tick = xTaskGetTickCount();
+
+    if (tick < clock_last_tick) {
+        clock_tick_wraps++;
+    }
+
+    clock_last_tick = tick;
+
+    return ((((uint64)clock_tick_wraps) << 32) | tick) * portTICK_RATE_MS;
+}
+
+/**
+ * Returns the monotonic time since boot in msec, at the tick resolution.
+ * Must be called at least once per tick count wrap, which get_time() and
+ * the network monitor do.
+ * @param none
+ * @return uint64 Monotonic time (in msec)
+ */
+uint64 clock_monotonic_ms() {
+    taskENTER_CRITICAL();
+    uint64 now = clock_ticks_ms();
+    taskEXIT_CRITICAL();
+
+    return now;
+}
+
+/**
+ * Adds an SNTP sample to the system clock.
+ * @param uint64 unix_ms SNTP Unix time (in msec)
+ * @return none
+ */
+void clock_resync(uint64 unix_ms) {
+    taskENTER_CRITICAL();
+
+    if (!system_clock_ready) {
+        clock_sync_init(&system_clock);
+        system_clock_ready = TRUE;
+    }
+
+    clock_sync_sample(&system_clock, clock_ticks_ms(), unix_ms);
+
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Returns the disciplined Unix time of the system clock.
+ * @param uint64 *unix_ms Unix time (in msec)
+ * @return int Success/Fail (Not synced)
+ */
+uint8 clock_now_ms(uint64 *unix_ms) {
+    taskENTER_CRITICAL();
+
+    uint8 synced = system_clock_ready && clock_sync_read(&system_clock, clock_ticks_ms(), unix_ms);
+
+    taskEXIT_CRITICAL();
+
+    return synced;
+}
+
+/**
+ * Returns the ticks until the system clock is due a resync, 0 if due now
+ * or never synced.
+ * @param none
+ * @return portTickType Ticks
+ */
+portTickType clock_resync_wait() {
+    taskENTER_CRITICAL();
+
+    uint64 wait = clock_sync_due(&system_clock, clock_ticks_ms()) / portTICK_RATE_MS;
+
+    taskEXIT_CRITICAL();
+
+    return (wait > portMAX_DELAY) ? portMAX_DELAY : (portTickType)wait;
+}
+
+/**
+ * Copies the system clock counters.
+ * @param ClockSyncStats *stats Counters
+ * @return none
+ */
+void clock_stats(ClockSyncStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = system_clock.stats;
+    taskEXIT_CRITICAL();
+}
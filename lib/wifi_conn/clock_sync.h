@@ -0,0 +1,67 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: clock_sync.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Clock disciplined by SNTP samples. Timestamps are served in
+ * msec from the tick count, corrected by the drift estimated over the
+ * recent samples, and the next resync is scheduled from how well the
+ * last one was predicted.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include "esp_common.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "../../include/app_conf.h"
+
+// Reference time paired with the local time it was taken at
+typedef struct {
+    uint64 local_ms;                // Monotonic time (in msec)
+    uint64 unix_ms;                 // Reference Unix time (in msec)
+} ClockSample;
+
+// Clock counters
+typedef struct {
+    uint32 syncs;                   // Samples taken
+    uint32 restarts;                // Times the reference stepped beyond the drift and the estimate restarted
+    int32 drift_ppb;                // Rate correction of the local clock (in ppb, > 0 when it runs slow)
+    int32 last_error_ms;            // Reference minus the served time at the last sample (in msec)
+    uint32 max_error_ms;            // Largest error at a sample (in msec)
+    uint32 interval_s;              // Current resync interval (in secs)
+} ClockSyncStats;
+
+// Clock state
+typedef struct {
+    ClockSample samples[CLOCK_SYNC_SAMPLES]; // Recent samples (Ring, the newest is the anchor)
+    uint8 head;                     // Oldest sample
+    uint8 count;                    // No of samples
+    uint64 served_ms;               // Latest time served, later reads never go below it
+    uint64 next_ms;                 // Monotonic time the next resync is due (in msec)
+    uint32 drift_rate;              // Fastest recent change of the drift (in ppb per 1000 secs)
+    ClockSyncStats stats;           // Counters
+} ClockSync;
+
+void clock_sync_init(ClockSync *clock);
+void clock_sync_sample(ClockSync *clock, uint64 local_ms, uint64 unix_ms);
+uint8 clock_sync_read(ClockSync *clock, uint64 local_ms, uint64 *unix_ms);
+uint64 clock_sync_due(ClockSync *clock, uint64 local_ms);
+
+uint64 clock_monotonic_ms();
+void clock_resync(uint64 unix_ms);
+uint8 clock_now_ms(uint64 *unix_ms);
+portTickType clock_resync_wait();
+void clock_stats(ClockSyncStats *stats);
+
+#endif
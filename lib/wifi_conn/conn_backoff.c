@@ -0,0 +1,155 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: conn_backoff.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Retry scheduler shared by the WiFi, internet, SNTP, MQTT
+ * connect and subscribe retry paths. After the nth consecutive failure a
+ * stage waits a random time between 0 and min(cap, base * 2^(n - 1)).
+ * The jitter spreads the retries of a fleet that lost the AP or broker at
+ * the same moment, instead of all devices retrying in lockstep.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "conn_backoff.h"
+
+// Retry window of a stage
+typedef struct {
+    uint32 base_ms;                 // Window after the first failure (in msec)
+    uint32 cap_ms;                  // Largest window (in msec)
+} ConnBackoffPolicy;
+
+// State of a stage
+typedef struct {
+    ConnBackoffStats stats;         // Counters
+    portTickType failed_at;         // Tick of the first failure of the current outage
+    portTickType next_at;           // Tick before which the stage is not retried
+} ConnBackoffStage;
+
+static const ConnBackoffPolicy backoff_policies[CONN_STAGE_COUNT] = {
+    {BACKOFF_WIFI_BASE, BACKOFF_WIFI_CAP},
+    {BACKOFF_INTERNET_BASE, BACKOFF_INTERNET_CAP},
+    {BACKOFF_NTP_BASE, BACKOFF_NTP_CAP},
+    {BACKOFF_MQTT_BASE, BACKOFF_MQTT_CAP},
+    {BACKOFF_SUBSCRIBE_BASE, BACKOFF_SUBSCRIBE_CAP}
+};
+
+ConnBackoffStage backoff_stages[CONN_STAGE_COUNT] = {0};
+
+/**
+ * Returns the ticks until a stage may be retried, 0 if it may be retried
+ * now.
+ * @param uint8 stage Stage as defined in CONN_BACKOFF_STAGE
+ * @return portTickType Ticks
+ */
+portTickType conn_backoff_wait(uint8 stage) {
+    portTickType wait = 0;
+
+    taskENTER_CRITICAL();
+
+    ConnBackoffStage *state = &backoff_stages[stage];
+    portTickType now = xTaskGetTickCount();
+
+    if ((state->stats.attempts > 0) && ((int32)(state->next_at - now) > 0)) {
+        wait = state->next_at - now;
+    }
+
+    taskEXIT_CRITICAL();
+
+    return wait;
+}
+
+/**
+ * Records a failed attempt of a stage and draws the wait before the next
+ * one.
+ * @param uint8 stage Stage as defined in CONN_BACKOFF_STAGE
+ * @return none
+ */
+void conn_backoff_failed(uint8 stage) {
+    const ConnBackoffPolicy *policy = &backoff_policies[stage];
+    uint32 window = policy->base_ms;
+    uint32 jitter = os_random();
+
+    taskENTER_CRITICAL();
+
+    ConnBackoffStage *state = &backoff_stages[stage];
+    portTickType now = xTaskGetTickCount();
+
+    if (state->stats.attempts == 0) {
+        state->failed_at = now;
+    }
+
+    for (uint32 i = 0; (i < state->stats.attempts) && (window < policy->cap_ms); i++) {
+        window *= 2;
+    }
+
+    if (window > policy->cap_ms) {
+        window = policy->cap_ms;
+    }
+
+    state->stats.attempts++;
+    state->stats.failures++;
+    state->stats.delay_ms = jitter % (window + 1);
+    state->next_at = now + (state->stats.delay_ms / portTICK_RATE_MS);
+
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Records a successful attempt of a stage. Ends the outage, if any, and
+ * lets the next failure retry from the base window.
+ * @param uint8 stage Stage as defined in CONN_BACKOFF_STAGE
+ * @return none
+ */
+void conn_backoff_succeeded(uint8 stage) {
+    taskENTER_CRITICAL();
+
+    ConnBackoffStage *state = &backoff_stages[stage];
+
+    if (state->stats.attempts > 0) {
+        uint32 elapsed = (xTaskGetTickCount() - state->failed_at) * portTICK_RATE_MS;
+
+        state->stats.recoveries++;
+        state->stats.recover_ms = elapsed;
+
+        if (elapsed > state->stats.recover_max_ms) {
+            state->stats.recover_max_ms = elapsed;
+        }
+
+        state->stats.attempts = 0;
+    }
+
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Lets a stage be retried at once from the base window, without counting
+ * a recovery. Called when a lower stage went down, so the failures so far
+ * say nothing about the next attempt.
+ * @param uint8 stage Stage as defined in CONN_BACKOFF_STAGE
+ * @return none
+ */
+void conn_backoff_reset(uint8 stage) {
+    taskENTER_CRITICAL();
+    backoff_stages[stage].stats.attempts = 0;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Copies the counters of a stage.
+ * @param uint8 stage Stage as defined in CONN_BACKOFF_STAGE
+ * @param ConnBackoffStats *stats Counters
+ * @return none
+ */
+void conn_backoff_stats(uint8 stage, ConnBackoffStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = backoff_stages[stage].stats;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,54 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: conn_backoff.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Retry scheduler shared by the WiFi, internet, SNTP, MQTT
+ * connect and subscribe retry paths. Each stage backs off exponentially
+ * with full jitter up to its cap, and resets once it succeeds.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef CONN_BACKOFF_H
+#define CONN_BACKOFF_H
+
+#include "esp_common.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "../../include/app_conf.h"
+
+// Type to hold the retried stages
+typedef enum {
+    CONN_STAGE_WIFI,                // WiFi association
+    CONN_STAGE_INTERNET,            // Internet probe
+    CONN_STAGE_NTP,                 // SNTP update
+    CONN_STAGE_MQTT,                // MQTT connect
+    CONN_STAGE_SUBSCRIBE,           // MQTT subscribe
+    CONN_STAGE_COUNT                // No of stages
+} CONN_BACKOFF_STAGE;
+
+// Retry counters of a stage
+typedef struct {
+    uint32 attempts;                // Failed attempts in the current outage
+    uint32 failures;                // Failed attempts in total
+    uint32 recoveries;              // Outages recovered from
+    uint32 recover_ms;              // Time from the first failure to success of the last outage (in msec)
+    uint32 recover_max_ms;          // Longest outage (in msec)
+    uint32 delay_ms;                // Wait drawn after the last failure (in msec)
+} ConnBackoffStats;
+
+portTickType conn_backoff_wait(uint8 stage);
+void conn_backoff_failed(uint8 stage);
+void conn_backoff_succeeded(uint8 stage);
+void conn_backoff_reset(uint8 stage);
+void conn_backoff_stats(uint8 stage, ConnBackoffStats *stats);
+
+#endif
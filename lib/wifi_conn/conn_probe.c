@@ -0,0 +1,149 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: conn_probe.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Internet connectivity inferred from the MQTT traffic that
+ * is already flowing. Every packet from the broker proves the link for
+ * CONN_PROBE_IDLE, with MQTT up PINGRESPs alone arrive every keep-alive
+ * interval. Only when the link has been quiet that long is an active probe
+ * due, and failed probes are retried on the CONN_STAGE_INTERNET backoff.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "conn_probe.h"
+
+// Constants ----------------------------------------------------------
+
+#define CONN_PROBE_SECS(x) ((portTickType)(((x) * 1000) / portTICK_RATE_MS)) // Secs to ticks
+
+// --------------------------------------------------------------------
+
+portTickType probe_last_ok = 0;         // Tick the link was last proven
+uint8 probe_proven = FALSE;             // Link was proven and no probe failed since
+ConnProbeStats probe_counters = {0};
+
+/**
+ * Records a packet from the broker, which proves the link. Called from the
+ * MQTT thread on every CONNACK, PUBACK and PINGRESP.
+ * @param none
+ * @return none
+ */
+void conn_probe_heard() {
+    taskENTER_CRITICAL();
+
+    probe_last_ok = xTaskGetTickCount();
+    probe_proven = TRUE;
+    probe_counters.heard++;
+
+    taskEXIT_CRITICAL();
+
+    conn_backoff_succeeded(CONN_STAGE_INTERNET);
+}
+
+/**
+ * Forgets the link evidence and resets the backoff, so the next check probes at
+ * once. Called when WiFi drops, as traffic heard before says nothing about
+ * the new association.
+ * @param none
+ * @return none
+ */
+void conn_probe_reset() {
+    taskENTER_CRITICAL();
+
+    probe_proven = FALSE;
+
+    taskEXIT_CRITICAL();
+
+    conn_backoff_reset(CONN_STAGE_INTERNET);
+}
+
+/**
+ * Returns true if the link was proven within CONN_PROBE_IDLE, in which
+ * case no probe is needed.
+ * @param none
+ * @return int True/False
+ */
+uint8 conn_probe_online() {
+    taskENTER_CRITICAL();
+
+    uint8 online = probe_proven && ((xTaskGetTickCount() - probe_last_ok) < CONN_PROBE_SECS(CONN_PROBE_IDLE));
+
+    taskEXIT_CRITICAL();
+
+    return online;
+}
+
+/**
+ * Returns the ticks until the next probe is due, 0 if due now.
+ * @param none
+ * @return portTickType Ticks
+ */
+portTickType conn_probe_wait() {
+    portTickType wait = 0;
+
+    taskENTER_CRITICAL();
+
+    portTickType now = xTaskGetTickCount();
+
+    if (probe_proven && ((now - probe_last_ok) < CONN_PROBE_SECS(CONN_PROBE_IDLE))) {
+        wait = CONN_PROBE_SECS(CONN_PROBE_IDLE) - (now - probe_last_ok);
+    }
+
+    taskEXIT_CRITICAL();
+
+    return wait ? wait : conn_backoff_wait(CONN_STAGE_INTERNET);
+}
+
+/**
+ * Records the outcome of an active probe. A failure schedules the next
+ * probe on the CONN_STAGE_INTERNET backoff.
+ * @param uint8 success Reached a target
+ * @param uint8 attempts Targets tried
+ * @param uint32 cost_ms Time the probe took (in msec)
+ * @return none
+ */
+void conn_probe_result(uint8 success, uint8 attempts, uint32 cost_ms) {
+    taskENTER_CRITICAL();
+
+    portTickType now = xTaskGetTickCount();
+
+    probe_counters.probes++;
+    probe_counters.attempts += attempts;
+    probe_counters.probe_ms += cost_ms;
+    probe_counters.last_probe_ms = cost_ms;
+
+    if (success) {
+        probe_last_ok = now;
+        probe_proven = TRUE;
+    } else {
+        probe_proven = FALSE;
+        probe_counters.failures++;
+    }
+
+    taskEXIT_CRITICAL();
+
+    if (success) {
+        conn_backoff_succeeded(CONN_STAGE_INTERNET);
+    } else {
+        conn_backoff_failed(CONN_STAGE_INTERNET);
+    }
+}
+
+/**
+ * Copies the probe counters.
+ * @param ConnProbeStats *stats Counters
+ * @return none
+ */
+void conn_probe_stats(ConnProbeStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = probe_counters;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,47 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: conn_probe.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Internet connectivity inferred from the MQTT traffic that
+ * is already flowing. Active probes are only scheduled once nothing has
+ * been heard from the broker for CONN_PROBE_IDLE, and failed probes are
+ * retried on the CONN_STAGE_INTERNET backoff.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef CONN_PROBE_H
+#define CONN_PROBE_H
+
+#include "esp_common.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "../../include/app_conf.h"
+#include "conn_backoff.h"
+
+// Probe counters
+typedef struct {
+    uint32 heard;           // Broker packets that proved the link (PUBACK, PINGRESP, CONNACK)
+    uint32 probes;          // Active probes run
+    uint32 failures;        // Probes that reached no target
+    uint32 attempts;        // Targets tried by the probes
+    uint32 probe_ms;        // Time spent probing (in msec)
+    uint32 last_probe_ms;   // Time the last probe took (in msec)
+} ConnProbeStats;
+
+void conn_probe_heard();
+void conn_probe_reset();
+uint8 conn_probe_online();
+portTickType conn_probe_wait();
+void conn_probe_result(uint8 success, uint8 attempts, uint32 cost_ms);
+void conn_probe_stats(ConnProbeStats *stats);
+
+#endif
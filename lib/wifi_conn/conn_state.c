@@ -0,0 +1,203 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: conn_state.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Connection lifecycle state shared between the tasks. The
+ * SDK runs FreeRTOS 7.5, which has no event groups or task notifications,
+ * so each blocked task waits on its own binary semaphore that is given
+ * when the state it waits for is reached.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "conn_state.h"
+
+// Task blocked on the state
+struct ConnWaiter {
+    xSemaphoreHandle wake;  // Given when the condition is met
+    uint32 mask;            // Bits of interest
+    uint32 expected;        // Value of the bits waited for
+    uint8 mode;             // CONN_WAIT_x
+    uint8 in_use;           // Slot is used by a task
+};
+
+uint32 conn_state = 0;                                  // Current state bits
+portTickType conn_state_ticks[CONN_STATE_BITS] = {0};   // Tick of the last change per bit
+struct ConnWaiter conn_waiters[CONN_STATE_MAX_WAITERS] = {0};
+
+/**
+ * Returns true if the state satisfies a wait condition.
+ * @param uint32 state State
+ * @param uint32 mask Bits of interest
+ * @param uint32 expected Value of the bits waited for
+ * @param uint8 mode CONN_WAIT_x
+ * @return int True/False
+ */
+static uint8 conn_state_matches(uint32 state, uint32 mask, uint32 expected, uint8 mode) {
+    uint32 matching = ~(state ^ expected) & mask;
+
+    if (mode == CONN_WAIT_ALL) {
+        return matching == mask;
+    }
+
+    return matching != 0;
+}
+
+/**
+ * Creates the waiter semaphores. Must be called once before the tasks
+ * are started.
+ * @param none
+ * @return none
+ */
+void conn_state_init() {
+    for (int i = 0; i < CONN_STATE_MAX_WAITERS; i++) {
+        vSemaphoreCreateBinary(conn_waiters[i].wake);
+        xSemaphoreTake(conn_waiters[i].wake, 0); // Created given
+    }
+}
+
+/**
+ * Returns the current state bits.
+ * @param none
+ * @return int State
+ */
+uint32 conn_state_get() {
+    return conn_state;
+}
+
+/**
+ * Sets the bits in mask to the values in bits. Changed bits are
+ * timestamped and the tasks waiting on them are woken.
+ * @param uint32 mask Bits to update
+ * @param uint32 bits New values
+ * @return none
+ */
+void conn_state_update(uint32 mask, uint32 bits) {
+    xSemaphoreHandle wake[CONN_STATE_MAX_WAITERS];
+    int woken = 0;
+
+    taskENTER_CRITICAL();
+
+    uint32 changed = (conn_state ^ bits) & mask;
+
+    if (changed) {
+        portTickType now = xTaskGetTickCount();
+
+        conn_state = (conn_state & ~mask) | (bits & mask);
+
+        for (int i = 0; i < CONN_STATE_BITS; i++) {
+            if (changed & (1 << i)) {
+                conn_state_ticks[i] = now;
+            }
+        }
+
+        for (int i = 0; i < CONN_STATE_MAX_WAITERS; i++) {
+            struct ConnWaiter *waiter = &conn_waiters[i];
+
+            if (waiter->in_use && (waiter->mask & changed) &&
+                conn_state_matches(conn_state, waiter->mask, waiter->expected, waiter->mode)) {
+                waiter->mask = 0; // Only woken once
+                wake[woken++] = waiter->wake;
+            }
+        }
+    }
+
+    taskEXIT_CRITICAL();
+
+    // Given outside the critical section as it may switch tasks
+    for (int i = 0; i < woken; i++) {
+        xSemaphoreGive(wake[i]);
+    }
+}
+
+/**
+ * Sets state bits.
+ * @param uint32 bits Bits to set
+ * @return none
+ */
+void conn_state_set(uint32 bits) {
+    conn_state_update(bits, bits);
+}
+
+/**
+ * Clears state bits.
+ * @param uint32 bits Bits to clear
+ * @return none
+ */
+void conn_state_clear(uint32 bits) {
+    conn_state_update(bits, 0);
+}
+
+/**
+ * Blocks until the bits in mask reach the expected values or the timeout
+ * expires. With CONN_WAIT_ALL every bit must match, with CONN_WAIT_ANY
+ * one is enough (e.g. mask WIFI_UP | MQTT_UP, expected 0 wakes when
+ * either goes down). Returns immediately if already met. The wait may
+ * end early, so the caller must check the returned state.
+ * @param uint32 mask Bits of interest
+ * @param uint32 expected Value of the bits waited for
+ * @param uint8 mode CONN_WAIT_x
+ * @param portTickType timeout Max time to block (in ticks)
+ * @return int State
+ */
+uint32 conn_state_wait(uint32 mask, uint32 expected, uint8 mode, portTickType timeout) {
+    struct ConnWaiter *waiter = NULL;
+
+    taskENTER_CRITICAL();
+
+    if (conn_state_matches(conn_state, mask, expected, mode) || (timeout == 0)) {
+        taskEXIT_CRITICAL();
+        return conn_state;
+    }
+
+    for (int i = 0; i < CONN_STATE_MAX_WAITERS; i++) {
+        if (!conn_waiters[i].in_use) {
+            waiter = &conn_waiters[i];
+            waiter->mask = mask;
+            waiter->expected = expected;
+            waiter->mode = mode;
+            waiter->in_use = 1;
+            break;
+        }
+    }
+
+    taskEXIT_CRITICAL();
+
+    if (waiter == NULL) {
+        // All slots taken, fall back to a short poll
+        vTaskDelay(1);
+        return conn_state;
+    }
+
+    xSemaphoreTake(waiter->wake, timeout);
+
+    taskENTER_CRITICAL();
+    waiter->in_use = 0;
+    uint32 state = conn_state;
+    taskEXIT_CRITICAL();
+
+    return state;
+}
+
+/**
+ * Returns the tick at which a state bit last changed. Used to measure the
+ * time each bring-up stage takes.
+ * @param uint32 bit State bit
+ * @return int Tick (0 if never changed)
+ */
+portTickType conn_state_changed_at(uint32 bit) {
+    for (int i = 0; i < CONN_STATE_BITS; i++) {
+        if (bit == (1u << i)) {
+            return conn_state_ticks[i];
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: conn_state.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Connection lifecycle state shared between the tasks. Each
+ * stage (WiFi, internet, SNTP, MQTT) is a bit. Tasks block on the bits
+ * they need and are woken as soon as they change. Every change is
+ * timestamped so that bring-up latency can be measured.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef CONN_STATE_H
+#define CONN_STATE_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+// State bits
+#define CONN_WIFI_UP 0x01           // WiFi connected and got IP
+#define CONN_INTERNET_UP 0x02       // Internet reachable
+#define CONN_TIME_SYNCED 0x04       // SNTP time updated
+#define CONN_MQTT_UP 0x08           // MQTT session connected
+#define CONN_MQTT_PUBLISHING 0x10   // MQTT thread is publishing
+#define CONN_STATE_BITS 5           // No of state bits
+
+// All network stages needed before MQTT can run
+#define CONN_NETWORK_READY (CONN_WIFI_UP | CONN_INTERNET_UP | CONN_TIME_SYNCED)
+
+#define CONN_STATE_MAX_WAITERS 4    // Max tasks blocked at once
+
+// Wait modes
+#define CONN_WAIT_ANY 0             // Any bit in the mask reaches its value
+#define CONN_WAIT_ALL 1             // Every bit in the mask reaches its value
+
+void conn_state_init();
+uint32 conn_state_get();
+void conn_state_update(uint32 mask, uint32 bits);
+void conn_state_set(uint32 bits);
+void conn_state_clear(uint32 bits);
+uint32 conn_state_wait(uint32 mask, uint32 expected, uint8 mode, portTickType timeout);
+portTickType conn_state_changed_at(uint32 bit);
+
+#endif
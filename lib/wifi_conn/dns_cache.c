@@ -0,0 +1,227 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: dns_cache.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Cache of resolved host addresses shared by the connectivity
+ * check and the MQTT connect. The lwIP socket API does not return the TTL
+ * of a record, so addresses are reused for DNS_CACHE_TTL (lwIP's own table
+ * still drops records on their TTL below that). Failed lookups fall back
+ * to the last-known-good address, and are not retried for DNS_CACHE_RETRY
+ * as every retry blocks the task for the resolver timeout.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "dns_cache.h"
+
+// Constants ----------------------------------------------------------
+
+#define DNS_CACHE_SECS(x) ((portTickType)(((x) * 1000) / portTICK_RATE_MS)) // Secs to ticks
+
+// --------------------------------------------------------------------
+
+DnsCacheEntry dns_cache[DNS_CACHE_ENTRIES] = {0};
+DnsCacheStats dns_cache_counters = {0};
+
+/**
+ * Returns the entry of a hostname, NULL if not cached. Call in a critical
+ * section.
+ * @param char *hostname Hostname
+ * @return DnsCacheEntry* Entry
+ */
+static DnsCacheEntry *dns_cache_find(const char *hostname) {
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        if (dns_cache[i].in_use && (strcmp(dns_cache[i].name, hostname) == 0)) {
+            return &dns_cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Returns a free entry, or the least recently resolved one. Call in a
+ * critical section.
+ * @param none
+ * @return DnsCacheEntry* Entry
+ */
+static DnsCacheEntry *dns_cache_victim() {
+    portTickType now = xTaskGetTickCount();
+    DnsCacheEntry *victim = &dns_cache[0];
+
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        if (!dns_cache[i].in_use) {
+            return &dns_cache[i];
+        }
+
+        if ((now - dns_cache[i].resolved_at) > (now - victim->resolved_at)) {
+            victim = &dns_cache[i];
+        }
+    }
+
+    return victim;
+}
+
+/**
+ * Resolves a hostname to its first IPv4 address. Blocks for the DNS round
+ * trip.
+ * @param char *hostname Hostname
+ * @param struct in_addr *addr Address
+ * @return int Success/Fail
+ */
+static uint8 dns_cache_resolve(const char *hostname, struct in_addr *addr) {
+    struct addrinfo hints;
+    struct addrinfo *result = NULL;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if ((getaddrinfo(hostname, NULL, &hints, &result) != 0) || (result == NULL)) {
+        return FALSE;
+    }
+
+    *addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+
+    return TRUE;
+}
+
+/**
+ * Returns the address of a hostname. A cached address younger than
+ * DNS_CACHE_TTL is returned without a lookup. Otherwise the resolver is
+ * called, and if it fails the last-known-good address is returned for up
+ * to DNS_CACHE_STALE_TTL. Returns the status as defined in
+ * DNS_CACHE_STATUS.
+ *      DNS_CACHE_HIT - Cached address
+ *      DNS_CACHE_RESOLVED - Resolved now
+ *      DNS_CACHE_STALE - Resolver failed, last-known-good address
+ *      DNS_CACHE_FAIL - Not resolved
+ * @param char *hostname Hostname
+ * @param struct in_addr *addr Address
+ * @return int Status
+ */
+uint8 dns_cache_lookup(const char *hostname, struct in_addr *addr) {
+    uint8 cacheable = (strlen(hostname) < DNS_CACHE_NAME_SIZE);
+    uint8 status = DNS_CACHE_FAIL;
+    struct in_addr resolved;
+
+    if (cacheable) {
+        taskENTER_CRITICAL();
+
+        DnsCacheEntry *entry = dns_cache_find(hostname);
+        portTickType now = xTaskGetTickCount();
+
+        if ((entry != NULL) && !entry->expired && !entry->failed &&
+            ((now - entry->resolved_at) < DNS_CACHE_SECS(DNS_CACHE_TTL))) {
+            status = DNS_CACHE_HIT;
+        } else if ((entry != NULL) && entry->failed &&
+                   ((now - entry->failed_at) < DNS_CACHE_SECS(DNS_CACHE_RETRY)) &&
+                   ((now - entry->resolved_at) < DNS_CACHE_SECS(DNS_CACHE_STALE_TTL))) {
+            // Resolver failed recently, do not block on it again yet
+            status = DNS_CACHE_STALE;
+        }
+
+        if (status != DNS_CACHE_FAIL) {
+            *addr = entry->addr;
+
+            if (status == DNS_CACHE_HIT) {
+                dns_cache_counters.hits++;
+            } else {
+                dns_cache_counters.stale++;
+            }
+        }
+
+        taskEXIT_CRITICAL();
+
+        if (status != DNS_CACHE_FAIL) {
+            return status;
+        }
+    }
+
+    // Resolve outside the critical section
+    portTickType started = xTaskGetTickCount();
+    uint8 ok = dns_cache_resolve(hostname, &resolved);
+    uint32 elapsed = (xTaskGetTickCount() - started) * portTICK_RATE_MS;
+
+    taskENTER_CRITICAL();
+
+    dns_cache_counters.misses++;
+    dns_cache_counters.lookup_ms += elapsed;
+
+    if (elapsed > dns_cache_counters.lookup_max_ms) {
+        dns_cache_counters.lookup_max_ms = elapsed;
+    }
+
+    DnsCacheEntry *entry = cacheable ? dns_cache_find(hostname) : NULL;
+    portTickType now = xTaskGetTickCount();
+
+    if (ok) {
+        if (cacheable && (entry == NULL)) {
+            entry = dns_cache_victim();
+            memset(entry, 0, sizeof(DnsCacheEntry));
+            strcpy(entry->name, hostname);
+            entry->in_use = TRUE;
+        }
+
+        if (entry != NULL) {
+            entry->addr = resolved;
+            entry->resolved_at = now;
+            entry->expired = FALSE;
+            entry->failed = FALSE;
+        }
+
+        *addr = resolved;
+        status = DNS_CACHE_RESOLVED;
+    } else if ((entry != NULL) && ((now - entry->resolved_at) < DNS_CACHE_SECS(DNS_CACHE_STALE_TTL))) {
+        entry->failed = TRUE;
+        entry->failed_at = now;
+        *addr = entry->addr;
+        dns_cache_counters.stale++;
+        status = DNS_CACHE_STALE;
+    } else {
+        dns_cache_counters.failures++;
+    }
+
+    taskEXIT_CRITICAL();
+
+    return status;
+}
+
+/**
+ * Makes the next lookup of a hostname go to the resolver, keeping the
+ * cached address as the fallback. Called when the cached address does not
+ * answer.
+ * @param char *hostname Hostname
+ * @return none
+ */
+void dns_cache_expire(const char *hostname) {
+    taskENTER_CRITICAL();
+
+    DnsCacheEntry *entry = dns_cache_find(hostname);
+
+    if (entry != NULL) {
+        entry->expired = TRUE;
+        entry->failed = FALSE;
+    }
+
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Copies the cache counters.
+ * @param DnsCacheStats *stats Counters
+ * @return none
+ */
+void dns_cache_stats(DnsCacheStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = dns_cache_counters;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,69 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: dns_cache.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Cache of resolved host addresses shared by the connectivity
+ * check and the MQTT connect. Saves a DNS round trip per check, and keeps
+ * the last-known-good address for when the resolver is unreachable.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#ifndef LWIP_TIMEVAL_PRIVATE
+#define LWIP_TIMEVAL_PRIVATE 0
+#endif
+
+#include "esp_common.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+
+#include "../../include/app_conf.h"
+
+#define DNS_CACHE_NAME_SIZE 64 // Max hostname length cached (Longer names are always resolved)
+
+// Cached address of a hostname
+typedef struct {
+    char name[DNS_CACHE_NAME_SIZE]; // Hostname
+    struct in_addr addr;            // Last-known-good address
+    portTickType resolved_at;       // Tick of the last successful lookup
+    portTickType failed_at;         // Tick of the last failed lookup
+    uint8 expired;                  // Resolve on the next lookup regardless of the TTL
+    uint8 failed;                   // Last lookup failed
+    uint8 in_use;                   // Entry is used
+} DnsCacheEntry;
+
+// Cache counters
+typedef struct {
+    uint32 hits;                    // Answered from the cache within the TTL
+    uint32 misses;                  // Sent to the resolver
+    uint32 stale;                   // Resolver failed or held off, last-known-good used
+    uint32 failures;                // Resolver failed with nothing to fall back to
+    uint32 lookup_ms;               // Time spent in the resolver (in msec)
+    uint32 lookup_max_ms;           // Slowest lookup (in msec)
+} DnsCacheStats;
+
+// Type to hold the result of a lookup
+typedef enum {
+    DNS_CACHE_HIT,                  // Cached address within the TTL
+    DNS_CACHE_RESOLVED,             // Resolved now
+    DNS_CACHE_STALE,                // Resolver unreachable, last-known-good address
+    DNS_CACHE_FAIL                  // Not resolved
+} DNS_CACHE_STATUS;
+
+uint8 dns_cache_lookup(const char *hostname, struct in_addr *addr);
+void dns_cache_expire(const char *hostname);
+void dns_cache_stats(DnsCacheStats *stats);
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: time_fmt.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Fixed width timestamp formatter. A timestamp outside of the
+ * cached day converts its day number to a civil date once (Days to civil,
+ * in 32 bit). Timestamps of the cached day split the seconds of the day
+ * into hh:mm:ss, and every two digit field is copied from a lookup table
+ * straight into the caller's buffer.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Reference:
+ *   - https://howardhinnant.github.io/date_algorithms.html#civil_from_days
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "time_fmt.h"
+
+// Constants ----------------------------------------------------------
+
+#define TIME_FMT_DAY 86400 // Secs in a day
+
+// --------------------------------------------------------------------
+
+// Two digit form of 0 - 99
+static const char time_fmt_digits[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+TimeFmtDay time_fmt_day = {0};      // Day cached by time_fmt()
+
+/**
+ * Caches the civil date and the midnight of the day of a time.
+ * @param TimeFmtDay *day Day
+ * @param sint64 seconds Time (in secs since 1970-01-01)
+ * @return none
+ */
+void time_fmt_civil(TimeFmtDay *day, sint64 seconds) {
+    sint64 days = seconds / TIME_FMT_DAY;
+
+    if ((days * TIME_FMT_DAY) > seconds) {
+        days--;
+    }
+
+    day->midnight = days * TIME_FMT_DAY;
+
+    // Days since 0000-03-01, split into 400 year eras
+    int32 shifted = (int32)days + 719468;
+    int32 era = ((shifted >= 0) ? shifted : (shifted - 146096)) / 146097;
+    uint32 day_of_era = (uint32)(shifted - (era * 146097));
+    uint32 year_of_era = (day_of_era - (day_of_era / 1460) + (day_of_era / 36524) - (day_of_era / 146096)) / 365;
+    uint32 day_of_year = day_of_era - ((365 * year_of_era) + (year_of_era / 4) - (year_of_era / 100));
+    uint32 month = ((5 * day_of_year) + 2) / 153;
+
+    day->day = (uint8)(day_of_year - (((153 * month) + 2) / 5) + 1);
+    day->month = (uint8)((month < 10) ? (month + 3) : (month - 9));
+    day->year = (int16)((int32)year_of_era + (era * 400) + (day->month <= 2));
+}
+
+/**
+ * Writes a two digit field.
+ * @param char *buffer Buffer
+ * @param uint32 value Value [0, 99]
+ * @return none
+ */
+static inline void time_fmt_two(char *buffer, uint32 value) {
+    buffer[0] = time_fmt_digits[value * 2];
+    buffer[1] = time_fmt_digits[(value * 2) + 1];
+}
+
+/**
+ * Writes a timestamp into a buffer of at least TIME_FMT_LENGTH + 1 bytes,
+ * terminated. Refreshes the cached day if the time is outside of it.
+ * @param TimeFmtDay *day Cached day
+ * @param char *buffer Buffer
+ * @param sint64 seconds Time (in secs since 1970-01-01, years 0 - 9999)
+ * @param uint8 style Format as defined in TIME_FMT_STYLE
+ * @return uint8 Length written, without the terminator
+ */
+uint8 time_fmt_write(TimeFmtDay *day, char *buffer, sint64 seconds, uint8 style) {
+    if ((day->month == 0) || (seconds < day->midnight) || (seconds >= (day->midnight + TIME_FMT_DAY))) {
+        time_fmt_civil(day, seconds);
+    }
+
+    uint32 second_of_day = (uint32)(seconds - day->midnight);
+    uint32 hour = second_of_day / 3600;
+    uint32 minute = (second_of_day - (hour * 3600)) / 60;
+    uint32 second = second_of_day - (hour * 3600) - (minute * 60);
+    uint32 year = (uint32)day->year;
+
+    if (style == TIME_FMT_ISO8601) {
+        time_fmt_two(buffer, year / 100);
+        time_fmt_two(buffer + 2, year % 100);
+        buffer[4] = '-';
+        time_fmt_two(buffer + 5, day->month);
+        buffer[7] = '-';
+        time_fmt_two(buffer + 8, day->day);
+        buffer[10] = 'T';
+    } else {
+        time_fmt_two(buffer, day->day);
+        buffer[2] = '-';
+        time_fmt_two(buffer + 3, day->month);
+        buffer[5] = '-';
+        time_fmt_two(buffer + 6, year / 100);
+        time_fmt_two(buffer + 8, year % 100);
+        buffer[10] = ' ';
+    }
+
+    time_fmt_two(buffer + 11, hour);
+    buffer[13] = ':';
+    time_fmt_two(buffer + 14, minute);
+    buffer[16] = ':';
+    time_fmt_two(buffer + 17, second);
+    buffer[TIME_FMT_LENGTH] = '\0';
+
+    return TIME_FMT_LENGTH;
+}
+
+/**
+ * Writes a timestamp into a buffer of at least TIME_FMT_LENGTH + 1 bytes,
+ * terminated, using the day cache shared by all threads.
+ * @param char *buffer Buffer
+ * @param sint64 seconds Time (in secs since 1970-01-01, years 0 - 9999)
+ * @param uint8 style Format as defined in TIME_FMT_STYLE
+ * @return uint8 Length written, without the terminator
+ */
+uint8 time_fmt(char *buffer, sint64 seconds, uint8 style) {
+    taskENTER_CRITICAL();
+    TimeFmtDay day = time_fmt_day;
+    taskEXIT_CRITICAL();
+
+    uint8 length = time_fmt_write(&day, buffer, seconds, style);
+
+    taskENTER_CRITICAL();
+    time_fmt_day = day;
+    taskEXIT_CRITICAL();
+
+    return length;
+}
@@ -0,0 +1,50 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: time_fmt.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Fixed width timestamp formatter. The civil date of the last
+ * day formatted is cached with its midnight, so timestamps of the same day
+ * only split the seconds of the day.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef TIME_FMT_H
+#define TIME_FMT_H
+
+#include "esp_common.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Constants ----------------------------------------------------------
+
+#define TIME_FMT_LENGTH 19 // Length of a timestamp, without the terminator
+
+// --------------------------------------------------------------------
+
+// Type to hold the timestamp formats
+typedef enum {
+    TIME_FMT_DMY,                   // DD-MM-YYYY hh:mm:ss
+    TIME_FMT_ISO8601                // YYYY-MM-DDThh:mm:ss
+} TIME_FMT_STYLE;
+
+// Civil date of a day
+typedef struct {
+    sint64 midnight;                // Start of the day (in secs since 1970-01-01)
+    int16 year;                     // Year [1970, 9999]
+    uint8 month;                    // Month [1, 12], 0 if nothing cached
+    uint8 day;                      // Day [1, 31]
+} TimeFmtDay;
+
+void time_fmt_civil(TimeFmtDay *day, sint64 seconds);
+uint8 time_fmt_write(TimeFmtDay *day, char *buffer, sint64 seconds, uint8 style);
+uint8 time_fmt(char *buffer, sint64 seconds, uint8 style);
+
+#endif
@@ -0,0 +1,274 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: tz_cache.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: UTC offset cache of a timezone. A miss runs the zone
+ * processor for the year of the lookup and keeps the offset of the
+ * transition in effect, valid from its start until the start of the next
+ * one. Past the last transition the processor generated, or in a year
+ * with a fixed offset, the offset is only trusted until the end of that
+ * year. All caches share one processor, so the ~1 KB work space is
+ * neither on the stack nor duplicated per zone. A cache with a transition
+ * table refills from it without the processor, so times that straddle a
+ * year boundary don't rebuild the processor's window back and forth.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "tz_cache.h"
+
+AtcZoneProcessor tz_processor;      // Work space shared by all caches
+xSemaphoreHandle tz_lock = NULL;    // Guards the work space
+
+/**
+ * Initializes the shared zone processor. Must be called once before any
+ * thread looks up an offset.
+ * @param none
+ * @return none
+ */
+void tz_cache_init() {
+    if (tz_lock == NULL) {
+        tz_lock = xSemaphoreCreateMutex();
+        atc_processor_init(&tz_processor);
+    }
+}
+
+/**
+ * Attaches a precomputed transition table (Built at startup or generated)
+ * to a cache. Lookups within the table's years are then answered from it.
+ * @param TzOffsetCache *cache Cache
+ * @param TzTable *table Transition table of the cache's timezone
+ * @return int Success/Fail (Table of another timezone)
+ */
+uint8 tz_cache_use_table(TzOffsetCache *cache, const TzTable *table) {
+    if (table->zone_info != cache->zone_info) {
+        return FALSE;
+    }
+
+    taskENTER_CRITICAL();
+    cache->table = table;
+    taskEXIT_CRITICAL();
+
+    return TRUE;
+}
+
+/**
+ * Builds the transition table of a cache's timezone for the years
+ * [from_year, until_year) with the shared zone processor, and attaches it.
+ * @param TzOffsetCache *cache Cache
+ * @param TzTable *table Table
+ * @param TzTableEntry *entries Transitions of the table
+ * @param uint16 capacity No of transitions the entries hold
+ * @param int16 from_year First year
+ * @param int16 until_year Year after the last
+ * @return int Success/Fail (Invalid year or table full)
+ */
+uint8 tz_cache_build_table(TzOffsetCache *cache, TzTable *table, TzTableEntry *entries, uint16 capacity,
+                           int16 from_year, int16 until_year) {
+    xSemaphoreTake(tz_lock, portMAX_DELAY);
+
+    uint8 built = tz_table_build(table, entries, capacity, &tz_processor, cache->zone_info, from_year, until_year);
+
+    xSemaphoreGive(tz_lock);
+
+    return built && tz_cache_use_table(cache, table);
+}
+
+/**
+ * Fills the cache from its transition table.
+ * @param TzOffsetCache *cache Cache
+ * @param sint64 unix_seconds Unix time (in secs)
+ * @return int Success/Fail (No table, or the time is outside of it)
+ */
+static uint8 tz_cache_fill_table(TzOffsetCache *cache, sint64 unix_seconds) {
+    const TzTable *table = cache->table;
+
+    if (table == NULL) {
+        return FALSE;
+    }
+
+    const TzTableEntry *entry = tz_table_find(table, atc_epoch_seconds_from_unix_seconds(unix_seconds));
+
+    if (entry == NULL) {
+        return FALSE;
+    }
+
+    const TzTableEntry *next = entry + 1;
+    atc_time_t until = (next < (table->entries + table->count)) ? next->start_epoch_seconds : table->valid_until;
+
+    taskENTER_CRITICAL();
+    cache->valid_from = atc_unix_seconds_from_epoch_seconds(entry->start_epoch_seconds);
+    cache->valid_until = atc_unix_seconds_from_epoch_seconds(until);
+    cache->offset_seconds = (entry->offset_seconds + entry->delta_seconds);
+    cache->valid = TRUE;
+    cache->stats.table++;
+    taskEXIT_CRITICAL();
+
+    return TRUE;
+}
+
+/**
+ * Runs the zone processor for a Unix time and fills the cache with the
+ * offset in effect and the interval it holds in. Call with tz_lock taken.
+ * @param TzOffsetCache *cache Cache
+ * @param sint64 unix_seconds Unix time (in secs)
+ * @return int Success/Fail
+ */
+static uint8 tz_cache_fill(TzOffsetCache *cache, sint64 unix_seconds) {
+    atc_time_t epoch_seconds = atc_epoch_seconds_from_unix_seconds(unix_seconds);
+
+    if (epoch_seconds == kAtcInvalidEpochSeconds) {
+        return FALSE;
+    }
+
+    atc_processor_init_for_zone_info(&tz_processor, cache->zone_info);
+
+    if (atc_processor_init_for_epoch_seconds(&tz_processor, epoch_seconds) != kAtcErrOk) {
+        return FALSE;
+    }
+
+    if (tz_processor.is_fixed) {
+        // Constant over the window, trusted for the year
+        AtcLocalDateTime year_start = {tz_processor.year, 1, 1, 0, 0, 0, 0};
+        AtcLocalDateTime year_end = {tz_processor.year + 1, 1, 1, 0, 0, 0, 0};
+
+        taskENTER_CRITICAL();
+        cache->valid_from = atc_local_date_time_to_unix_seconds(&year_start);
+        cache->valid_until = atc_local_date_time_to_unix_seconds(&year_end);
+        cache->offset_seconds = (tz_processor.fixed_std_offset_seconds + tz_processor.fixed_dst_offset_seconds);
+        cache->valid = TRUE;
+        taskEXIT_CRITICAL();
+
+        return TRUE;
+    }
+
+    // Transitions are sorted, the last one started by then is in effect
+    const AtcTransitionStorage *storage = &tz_processor.transition_storage;
+    const AtcTransition *curr = NULL;
+    const AtcTransition *next = NULL;
+
+    for (uint8 i = 0; i < storage->index_free; i++) {
+        if (storage->transitions[i]->start_epoch_seconds > epoch_seconds) {
+            next = storage->transitions[i];
+            break;
+        }
+
+        curr = storage->transitions[i];
+    }
+
+    if (curr == NULL) {
+        return FALSE;
+    }
+
+    sint64 valid_until;
+
+    if (next != NULL) {
+        valid_until = atc_unix_seconds_from_epoch_seconds(next->start_epoch_seconds);
+    } else {
+        // No transition generated past it, trusted to the end of the year
+        AtcLocalDateTime year_end = {tz_processor.year + 1, 1, 1, 0, 0, 0, 0};
+
+        valid_until = atc_local_date_time_to_unix_seconds(&year_end);
+    }
+
+    taskENTER_CRITICAL();
+    cache->valid_from = atc_unix_seconds_from_epoch_seconds(curr->start_epoch_seconds);
+    cache->valid_until = valid_until;
+    cache->offset_seconds = (curr->offset_seconds + curr->delta_seconds);
+    cache->valid = TRUE;
+    taskEXIT_CRITICAL();
+
+    return TRUE;
+}
+
+/**
+ * Returns the UTC offset of the cache's timezone at a Unix time. Answered
+ * from the cache while the time is within the cached interval, otherwise
+ * from the transition table if it covers the time, otherwise recomputed.
+ * @param TzOffsetCache *cache Cache
+ * @param sint64 unix_seconds Unix time (in secs)
+ * @param int32 *offset_seconds UTC offset (in secs, 0 on failure)
+ * @return int Success/Fail
+ */
+uint8 tz_cache_offset(TzOffsetCache *cache, sint64 unix_seconds, int32 *offset_seconds) {
+    uint8 hit = FALSE;
+
+    taskENTER_CRITICAL();
+
+    if (cache->valid && (unix_seconds >= cache->valid_from) && (unix_seconds < cache->valid_until)) {
+        *offset_seconds = cache->offset_seconds;
+        cache->stats.hits++;
+        hit = TRUE;
+    }
+
+    taskEXIT_CRITICAL();
+
+    if (hit) {
+        return TRUE;
+    }
+
+    if (tz_cache_fill_table(cache, unix_seconds)) {
+        taskENTER_CRITICAL();
+        *offset_seconds = cache->offset_seconds;
+        taskEXIT_CRITICAL();
+
+        return TRUE;
+    }
+
+    xSemaphoreTake(tz_lock, portMAX_DELAY);
+
+    uint8 filled = tz_cache_fill(cache, unix_seconds);
+
+    taskENTER_CRITICAL();
+
+    if (filled) {
+        *offset_seconds = cache->offset_seconds;
+        cache->stats.misses++;
+    } else {
+        *offset_seconds = 0;
+        cache->stats.failures++;
+    }
+
+    taskEXIT_CRITICAL();
+
+    xSemaphoreGive(tz_lock);
+
+    return filled;
+}
+
+/**
+ * Converts a local time of the cache's timezone to Unix time. The offset
+ * is looked up at the local time first and then at the Unix time it gives,
+ * which settles on the right side of a transition except within a DST gap
+ * or overlap. Falls back to offset 0 if the offset can't be found.
+ * @param TzOffsetCache *cache Cache
+ * @param sint64 local_seconds Local time (in secs, since 1970-01-01 local)
+ * @return sint64 Unix time (in secs)
+ */
+sint64 tz_cache_to_utc(TzOffsetCache *cache, sint64 local_seconds) {
+    int32 offset = 0;
+
+    tz_cache_offset(cache, local_seconds, &offset);
+    tz_cache_offset(cache, local_seconds - offset, &offset);
+
+    return local_seconds - offset;
+}
+
+/**
+ * Copies the counters of a cache.
+ * @param TzOffsetCache *cache Cache
+ * @param TzCacheStats *stats Counters
+ * @return none
+ */
+void tz_cache_stats(TzOffsetCache *cache, TzCacheStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = cache->stats;
+    taskEXIT_CRITICAL();
+}
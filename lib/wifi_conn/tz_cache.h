@@ -0,0 +1,58 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: tz_cache.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: UTC offset cache of a timezone. The offset is computed once
+ * with the AceTime zone processor, together with the interval it holds in
+ * (Until the next transition), and answered from the cache until a lookup
+ * falls outside of it.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef TZ_CACHE_H
+#define TZ_CACHE_H
+
+#include "esp_common.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "acetime/acetimec.h"
+#include "tz_table.h"
+
+// Offset cache counters
+typedef struct {
+    uint32 hits;                    // Lookups answered from the cache
+    uint32 misses;                  // Lookups that ran the zone processor
+    uint32 table;                   // Lookups answered from the transition table
+    uint32 failures;                // Lookups the zone processor could not answer
+} TzCacheStats;
+
+// Offset of a timezone and the interval it holds in
+typedef struct {
+    const AtcZoneInfo *zone_info;   // Timezone
+    const TzTable *table;           // Precomputed transitions, looked up before the zone processor (NULL if none)
+    uint8 valid;                    // Offset computed at least once
+    sint64 valid_from;              // Start of the interval (Unix time in secs, inclusive)
+    sint64 valid_until;             // End of the interval (Unix time in secs, exclusive)
+    int32 offset_seconds;           // UTC offset in the interval, STD + DST (in secs)
+    TzCacheStats stats;             // Counters
+} TzOffsetCache;
+
+void tz_cache_init();
+uint8 tz_cache_use_table(TzOffsetCache *cache, const TzTable *table);
+uint8 tz_cache_build_table(TzOffsetCache *cache, TzTable *table, TzTableEntry *entries, uint16 capacity,
+                           int16 from_year, int16 until_year);
+uint8 tz_cache_offset(TzOffsetCache *cache, sint64 unix_seconds, int32 *offset_seconds);
+sint64 tz_cache_to_utc(TzOffsetCache *cache, sint64 local_seconds);
+void tz_cache_stats(TzOffsetCache *cache, TzCacheStats *stats);
+
+#endif
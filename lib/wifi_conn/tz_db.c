@@ -0,0 +1,528 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: tz_db.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Binary zone database loader. A zone is found by a binary
+ * search of the zone records, then the eras and rules it needs over a range
+ * of years are found and rebuilt into the AtcZoneInfo, AtcZoneEra and
+ * AtcZonePolicy structs the zone processor reads. Rule records are laid out
+ * as AtcZoneRule, so they and the strings are used in place from a memory
+ * source and copied from a flash source. Every reference is checked against
+ * the database, so a corrupt database fails to load instead of being
+ * followed.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "tz_db.h"
+
+// Rule records are handed to the zone processor as they are
+typedef char tz_db_rule_layout[((sizeof(TzDbRuleRecord) == sizeof(AtcZoneRule)) && ATC_HIRES_ZONEDB) ? 1 : -1];
+
+// Constants ----------------------------------------------------------
+
+#define TZ_DB_STRING_CHUNK 16 // Bytes read at a time while looking for the end of a string
+#define TZ_DB_RULE_CHUNK 8 // Rules read at a time
+
+// --------------------------------------------------------------------
+
+/**
+ * Reads a memory source.
+ * @param TzDbSource *source Source
+ * @param uint32 offset Offset in the database
+ * @param void *data Buffer
+ * @param uint32 len Length
+ * @return int Success/Fail
+ */
+static int tz_db_memory_read(TzDbSource *source, uint32 offset, void *data, uint32 len) {
+    memcpy(data, source->data + offset, len);
+
+    return 0;
+}
+
+/**
+ * Sets up a source over a database in memory, e.g. a mapped file or a
+ * const array in RAM, word aligned. Rules and strings are used in place,
+ * so the database must outlive the zones loaded from it.
+ * @param TzDbSource *source Source to set up
+ * @param void *data Start of the database
+ * @param uint32 size Size of the database (in bytes)
+ * @return none
+ */
+void tz_db_memory(TzDbSource *source, const void *data, uint32 size) {
+    source->read = tz_db_memory_read;
+    source->size = size;
+    source->address = 0;
+    source->data = data;
+}
+
+/**
+ * Reads a part of the database after checking that it lies within it.
+ * @param TzDb *db Database
+ * @param uint32 offset Offset in the database
+ * @param void *data Buffer
+ * @param uint32 len Length
+ * @return int Success/Fail as defined in TZ_DB_STATUS
+ */
+static uint8 tz_db_read(TzDb *db, uint32 offset, void *data, uint32 len) {
+    if ((offset > db->header.size) || (len > (db->header.size - offset))) {
+        return TZ_DB_INVALID;
+    }
+
+    return db->source->read(db->source, offset, data, len) ? TZ_DB_READ_ERROR : TZ_DB_SUCCESS;
+}
+
+/**
+ * Opens a database, reading and checking its header.
+ * Returns error state as defined in TZ_DB_STATUS.
+ *      TZ_DB_SUCCESS - Success
+ *      TZ_DB_INVALID - Not a database of this version
+ *      TZ_DB_READ_ERROR - Source read failed
+ * @param TzDb *db Database to open
+ * @param TzDbSource *source Source
+ * @return int Success/Fail
+ */
+uint8 tz_db_open(TzDb *db, TzDbSource *source) {
+    TzDbHeader *header = &db->header;
+
+    db->source = source;
+
+    if (source->size < sizeof(TzDbHeader)) {
+        return TZ_DB_INVALID;
+    }
+
+    if (source->read(source, 0, header, sizeof(TzDbHeader))) {
+        return TZ_DB_READ_ERROR;
+    }
+
+    if ((header->magic != TZ_DB_MAGIC) || (header->version != TZ_DB_VERSION) || (header->size > source->size) ||
+        (header->zones < sizeof(TzDbHeader)) || (header->strings > header->size) || (header->rules & 3)) {
+        header->size = 0;
+        return TZ_DB_INVALID;
+    }
+
+    return TZ_DB_SUCCESS;
+}
+
+/**
+ * Finds the record of a zone by a binary search of the zone records.
+ * @param TzDb *db Database
+ * @param uint32 zone_id Zone ID
+ * @param TzDbZoneRecord *record Record found
+ * @return int Success/Fail as defined in TZ_DB_STATUS
+ */
+static uint8 tz_db_find(TzDb *db, uint32 zone_id, TzDbZoneRecord *record) {
+    uint16 low = 0;
+    uint16 high = db->header.zone_count;
+
+    while (low < high) {
+        uint16 middle = low + ((high - low) / 2);
+        uint8 status = tz_db_read(db, db->header.zones + (middle * sizeof(TzDbZoneRecord)), record,
+                                  sizeof(TzDbZoneRecord));
+
+        if (status != TZ_DB_SUCCESS) {
+            return status;
+        }
+
+        if (record->zone_id == zone_id) {
+            return TZ_DB_SUCCESS;
+        } else if (record->zone_id < zone_id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return TZ_DB_NOT_FOUND;
+}
+
+/**
+ * Finds a string of the database. Used in place from a memory source once
+ * it is known to end within the database, copied into the strings of the
+ * zone from a flash source.
+ * @param TzDb *db Database
+ * @param uint16 offset String offset
+ * @param TzDbZone *zone Zone
+ * @param uint16 *used Bytes of the zone strings used, advanced past the string
+ * @param char **string String
+ * @return int Success/Fail as defined in TZ_DB_STATUS
+ */
+static uint8 tz_db_string(TzDb *db, uint16 offset, TzDbZone *zone, uint16 *used, const char **string) {
+    uint32 at = db->header.strings + offset;
+
+    if (db->source->data != NULL) {
+        if ((at >= db->header.size) || (memchr(db->source->data + at, '\0', db->header.size - at) == NULL)) {
+            return TZ_DB_INVALID;
+        }
+
+        *string = (const char *)db->source->data + at;
+        return TZ_DB_SUCCESS;
+    }
+
+    *string = zone->strings + *used;
+
+    while (TRUE) {
+        uint32 len = TZ_DB_STRING_CHUNK;
+
+        if (len > (uint32)(TZ_DB_STRINGS - *used)) {
+            len = TZ_DB_STRINGS - *used;
+        }
+
+        if ((at < db->header.size) && (len > (db->header.size - at))) {
+            len = db->header.size - at;
+        }
+
+        if (len == 0) {
+            return (*used == TZ_DB_STRINGS) ? TZ_DB_TOO_LARGE : TZ_DB_INVALID;
+        }
+
+        uint8 status = tz_db_read(db, at, zone->strings + *used, len);
+
+        if (status != TZ_DB_SUCCESS) {
+            return status;
+        }
+
+        char *end = memchr(zone->strings + *used, '\0', len);
+
+        if (end != NULL) {
+            *used = (end - zone->strings) + 1;
+            return TZ_DB_SUCCESS;
+        }
+
+        *used += len;
+        at += len;
+    }
+}
+
+/**
+ * Finds the rules of a policy the zone processor reads over a range of
+ * years: those in effect in it, and those of the latest year before it
+ * with a rule, which the prior transition comes from. Any other rule only
+ * gives transitions the processor drops. The rules between the first and
+ * the last found are the ones loaded.
+ * @param TzDb *db Database
+ * @param TzDbPolicyRecord *record Policy
+ * @param int16 low First year
+ * @param int16 high Last year
+ * @param uint8 *first First rule loaded
+ * @param uint8 *count No of rules loaded
+ * @return int Success/Fail as defined in TZ_DB_STATUS
+ */
+static uint8 tz_db_rule_window(TzDb *db, const TzDbPolicyRecord *record, int16 low, int16 high, uint8 *first,
+                               uint8 *count) {
+    TzDbRuleRecord chunk[TZ_DB_RULE_CHUNK];
+    int16 prior = kAtcInvalidYear;
+
+    *first = 0;
+    *count = 0;
+
+    // The latest year before the range is found first, then the rules
+    for (uint8 pass = 0; pass < 2; pass++) {
+        for (uint16 i = 0; i < record->num_rules; i += TZ_DB_RULE_CHUNK) {
+            uint16 n = ((record->num_rules - i) < TZ_DB_RULE_CHUNK) ? (record->num_rules - i) : TZ_DB_RULE_CHUNK;
+            uint8 status = tz_db_read(db, db->header.rules + ((record->rule_index + i) * sizeof(TzDbRuleRecord)),
+                                      chunk, n * sizeof(TzDbRuleRecord));
+
+            if (status != TZ_DB_SUCCESS) {
+                return status;
+            }
+
+            for (uint16 j = 0; j < n; j++) {
+                const TzDbRuleRecord *r = &chunk[j];
+
+                if (pass == 0) {
+                    if (r->from_year < low) {
+                        int16 year = (r->to_year < low) ? r->to_year : (low - 1);
+
+                        prior = (year > prior) ? year : prior;
+                    }
+                } else if ((r->to_year >= prior) && (r->from_year <= high)) {
+                    if (*count == 0) {
+                        *first = i + j;
+                    }
+
+                    *count = (i + j) - *first + 1;
+                }
+            }
+        }
+    }
+
+    return TZ_DB_SUCCESS;
+}
+
+/**
+ * Loads a policy and the rules of it needed over a range of years into a
+ * zone.
+ * @param TzDb *db Database
+ * @param uint16 index Policy
+ * @param int16 low First year
+ * @param int16 high Last year
+ * @param TzDbZone *zone Zone
+ * @param uint8 policy_count Policies loaded, the policy goes after them
+ * @param uint16 *rule_count Rules copied, advanced past the policy's
+ * @return int Success/Fail as defined in TZ_DB_STATUS
+ */
+static uint8 tz_db_policy(TzDb *db, uint16 index, int16 low, int16 high, TzDbZone *zone, uint8 policy_count,
+                          uint16 *rule_count) {
+    TzDbPolicyRecord record;
+    const AtcZoneRule *rules;
+    uint8 first;
+    uint8 count;
+    uint8 status;
+
+    if (index >= db->header.policy_count) {
+        return TZ_DB_INVALID;
+    }
+
+    status = tz_db_read(db, db->header.policies + (index * sizeof(TzDbPolicyRecord)), &record,
+                        sizeof(TzDbPolicyRecord));
+
+    if (status != TZ_DB_SUCCESS) {
+        return status;
+    }
+
+    if ((record.rule_index + record.num_rules) > db->header.rule_count) {
+        return TZ_DB_INVALID;
+    }
+
+    status = tz_db_rule_window(db, &record, low, high, &first, &count);
+
+    if (status != TZ_DB_SUCCESS) {
+        return status;
+    }
+
+    uint32 at = db->header.rules + ((record.rule_index + first) * sizeof(TzDbRuleRecord));
+
+    if (db->source->data != NULL) {
+        rules = (const AtcZoneRule *)(db->source->data + at);
+    } else {
+        if ((*rule_count + count) > TZ_DB_RULES) {
+            return TZ_DB_TOO_LARGE;
+        }
+
+        status = tz_db_read(db, at, (void *)&zone->rules[*rule_count], count * sizeof(TzDbRuleRecord));
+
+        if (status != TZ_DB_SUCCESS) {
+            return status;
+        }
+
+        rules = &zone->rules[*rule_count];
+        *rule_count += count;
+    }
+
+    for (uint8 i = 0; i < count; i++) {
+        if (rules[i].letter_index >= db->header.letter_count) {
+            return TZ_DB_INVALID;
+        }
+    }
+
+    // The structs have const members, so they are built whole and copied in
+    AtcZonePolicy policy = {rules, count};
+    memcpy(&zone->policies[policy_count], &policy, sizeof(AtcZonePolicy));
+
+    return TZ_DB_SUCCESS;
+}
+
+/**
+ * Loads a zone or link by ID for a range of years. The AtcZoneInfo to hand
+ * to the zone processor is zone->info, and only times within the years
+ * (UTC for epoch seconds, local for a local date time) may be looked up
+ * with it.
+ * Returns error state as defined in TZ_DB_STATUS.
+ *      TZ_DB_SUCCESS - Success
+ *      TZ_DB_INVALID - Reference out of the database, or no years
+ *      TZ_DB_NOT_FOUND - No such zone
+ *      TZ_DB_TOO_LARGE - Zone does not fit a TzDbZone over the years
+ *      TZ_DB_READ_ERROR - Source read failed
+ * @param TzDb *db Database
+ * @param uint32 zone_id Zone ID (kAtcZoneId* or atc_djb2() of the name)
+ * @param int16 from_year First year
+ * @param int16 until_year Year after the last one
+ * @param TzDbZone *zone Zone to load into
+ * @return int Success/Fail
+ */
+uint8 tz_db_load(TzDb *db, uint32 zone_id, int16 from_year, int16 until_year, TzDbZone *zone) {
+    const TzDbHeader *header = &db->header;
+    uint16 policy_indices[TZ_DB_ERAS];
+    uint16 letters[TZ_DB_LETTERS];
+    TzDbZoneRecord record;
+    TzDbZoneRecord target;
+    uint8 era_count = 0;
+    uint8 policy_count = 0;
+    uint16 rule_count = 0;
+    uint16 used = 0;
+    const char *name;
+    const char *target_name;
+    uint8 status;
+
+    if ((header->size == 0) || (from_year >= until_year)) {
+        return TZ_DB_INVALID;
+    }
+
+    // The processor matches eras from the year before the one looked up to the one after
+    int16 low = from_year - 1;
+    int16 high = until_year;
+
+    status = tz_db_find(db, zone_id, &record);
+
+    if (status != TZ_DB_SUCCESS) {
+        return status;
+    }
+
+    // A link loads the eras of its target
+    target = record;
+
+    if (record.target != TZ_DB_NONE) {
+        if (record.target >= header->zone_count) {
+            return TZ_DB_INVALID;
+        }
+
+        status = tz_db_read(db, header->zones + (record.target * sizeof(TzDbZoneRecord)), &target,
+                            sizeof(TzDbZoneRecord));
+
+        if (status != TZ_DB_SUCCESS) {
+            return status;
+        }
+    }
+
+    if (header->letter_count > TZ_DB_LETTERS) {
+        return TZ_DB_TOO_LARGE;
+    }
+
+    if ((target.era_index + target.num_eras) > header->era_count) {
+        return TZ_DB_INVALID;
+    }
+
+    status = tz_db_read(db, header->letters, letters, header->letter_count * sizeof(uint16));
+
+    for (uint16 i = 0; (status == TZ_DB_SUCCESS) && (i < header->letter_count); i++) {
+        status = tz_db_string(db, letters[i], zone, &used, &zone->letters[i]);
+    }
+
+    if (status == TZ_DB_SUCCESS) {
+        status = tz_db_string(db, header->tz_version, zone, &used, &zone->context.tz_version);
+    }
+
+    if (status != TZ_DB_SUCCESS) {
+        return status;
+    }
+
+    zone->context.start_year = (header->start_year > from_year) ? header->start_year : from_year;
+    zone->context.until_year = (header->until_year < until_year) ? header->until_year : until_year;
+    zone->context.start_year_accurate =
+        (header->start_year_accurate > from_year) ? header->start_year_accurate : from_year;
+    zone->context.until_year_accurate =
+        (header->until_year_accurate < until_year) ? header->until_year_accurate : until_year;
+    zone->context.max_transitions = header->max_transitions;
+    zone->context.num_fragments = 0;
+    zone->context.num_letters = header->letter_count;
+    zone->context.fragments = NULL;
+    zone->context.letters = zone->letters;
+
+    for (uint8 i = 0; i < target.num_eras; i++) {
+        const AtcZonePolicy *policy = NULL;
+        TzDbEraRecord e;
+        const char *format;
+
+        status = tz_db_read(db, header->eras + ((target.era_index + i) * sizeof(TzDbEraRecord)), &e,
+                            sizeof(TzDbEraRecord));
+
+        if (status != TZ_DB_SUCCESS) {
+            return status;
+        }
+
+        // Eras are sorted by their end, those over before the years are left out
+        if (e.until_year < low) {
+            continue;
+        }
+
+        if (era_count == TZ_DB_ERAS) {
+            return TZ_DB_TOO_LARGE;
+        }
+
+        if (e.policy != TZ_DB_NONE) {
+            uint8 j = 0;
+
+            // Eras often share a policy, it is loaded once
+            while ((j < policy_count) && (policy_indices[j] != e.policy)) {
+                j++;
+            }
+
+            if (j == policy_count) {
+                status = tz_db_policy(db, e.policy, low, high, zone, policy_count, &rule_count);
+
+                if (status != TZ_DB_SUCCESS) {
+                    return status;
+                }
+
+                policy_indices[policy_count++] = e.policy;
+            }
+
+            policy = &zone->policies[j];
+        }
+
+        status = tz_db_string(db, e.format, zone, &used, &format);
+
+        if (status != TZ_DB_SUCCESS) {
+            return status;
+        }
+
+        AtcZoneEra era = {policy, format, e.offset_code, e.offset_remainder, e.delta_minutes, e.until_year,
+                          e.until_month, e.until_day, e.until_time_code, e.until_time_modifier};
+        memcpy(&zone->eras[era_count++], &era, sizeof(AtcZoneEra));
+
+        if (e.until_year > high) {
+            break;
+        }
+    }
+
+    if (era_count == 0) {
+        return TZ_DB_INVALID;
+    }
+
+    status = tz_db_string(db, record.name, zone, &used, &name);
+
+    if ((status == TZ_DB_SUCCESS) && (record.target != TZ_DB_NONE)) {
+        status = tz_db_string(db, target.name, zone, &used, &target_name);
+
+        AtcZoneInfo info = {target_name, target.zone_id, &zone->context, era_count, zone->eras, NULL};
+        memcpy(&zone->target, &info, sizeof(AtcZoneInfo));
+    }
+
+    if (status != TZ_DB_SUCCESS) {
+        return status;
+    }
+
+    AtcZoneInfo info = {name, record.zone_id, &zone->context, era_count, zone->eras,
+                        (record.target != TZ_DB_NONE) ? &zone->target : NULL};
+    memcpy(&zone->info, &info, sizeof(AtcZoneInfo));
+
+    return TZ_DB_SUCCESS;
+}
+
+/**
+ * Loads a zone or link by name for a range of years. See tz_db_load().
+ * @param TzDb *db Database
+ * @param char *name Zone name (e.g. Asia/Colombo)
+ * @param int16 from_year First year
+ * @param int16 until_year Year after the last one
+ * @param TzDbZone *zone Zone to load into
+ * @return int Success/Fail as defined in TZ_DB_STATUS
+ */
+uint8 tz_db_load_name(TzDb *db, const char *name, int16 from_year, int16 until_year, TzDbZone *zone) {
+    uint8 status = tz_db_load(db, atc_djb2(name), from_year, until_year, zone);
+
+    // IDs are hashes, so make sure the name matches
+    if ((status == TZ_DB_SUCCESS) && (strcmp(zone->info.name, name) != 0)) {
+        return TZ_DB_NOT_FOUND;
+    }
+
+    return status;
+}
@@ -0,0 +1,167 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: tz_db.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Binary zone database. Holds the same data as the AceTime
+ * zonedb structs, but references are indices and offsets instead of
+ * pointers, so the database can sit in a flash partition or a mapped file
+ * and be replaced without reflashing the firmware. A zone is loaded for a
+ * range of years into a TzDbZone, which atc_processor_* take like any
+ * compiled zone. Only the eras and rules of those years are loaded. From a
+ * mapped file the rules and strings are used in place, from flash they are
+ * copied. Generated on the host with host/build/tz_db_gen. Left out of
+ * the firmware build (library.json) until the firmware loads its zones
+ * from a database.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef TZ_DB_H
+#define TZ_DB_H
+
+#include "esp_common.h"
+
+#include "acetime/acetimec.h"
+
+// Constants ----------------------------------------------------------
+
+#define TZ_DB_MAGIC 0x425a544c      // "LTZB"
+#define TZ_DB_VERSION 2             // Format version
+#define TZ_DB_NONE 0xffff           // No policy/link target
+#define TZ_DB_ERAS 8                // Most eras of a zone loaded (7 over a year in zonedb)
+#define TZ_DB_RULES 32              // Most rules copied from flash (28 over a year in zonedb)
+#define TZ_DB_LETTERS 16            // Most letters loaded
+#define TZ_DB_STRINGS 192           // Names, formats and letters of a zone loaded (in bytes)
+
+// --------------------------------------------------------------------
+
+// Layout, little endian with every field naturally aligned:
+//   TzDbHeader
+//   TzDbZoneRecord[zone_count]     Zones and links, sorted by zone ID
+//   TzDbEraRecord[era_count]       Eras of a zone are contiguous, links share their target's
+//   TzDbPolicyRecord[policy_count]
+//   TzDbRuleRecord[rule_count]     Rules of a policy are contiguous
+//   uint16[letter_count]           String offsets of the letters
+//   char[]                         NUL terminated strings, each stored once
+typedef struct {
+    uint32 magic;                   // TZ_DB_MAGIC
+    uint16 version;                 // TZ_DB_VERSION
+    uint16 zone_count;              // No of zones and links
+    uint16 era_count;               // No of eras
+    uint16 policy_count;            // No of policies
+    uint16 rule_count;              // No of rules
+    uint16 letter_count;            // No of letters
+    int16 start_year;               // AtcZoneContext
+    int16 until_year;
+    int16 start_year_accurate;
+    int16 until_year_accurate;
+    int16 max_transitions;
+    uint16 tz_version;              // TZ database version (String offset)
+    uint32 zones;                   // Offset of the zones
+    uint32 eras;                    // Offset of the eras
+    uint32 policies;                // Offset of the policies
+    uint32 rules;                   // Offset of the rules
+    uint32 letters;                 // Offset of the letters
+    uint32 strings;                 // Offset of the strings
+    uint32 size;                    // Size of the database (in bytes)
+} TzDbHeader;
+
+typedef struct {
+    uint32 zone_id;                 // Zone ID (djb2 of the name)
+    uint16 name;                    // Name (String offset)
+    uint16 era_index;               // First era
+    uint16 target;                  // Zone a link points to (TZ_DB_NONE for a zone)
+    uint8 num_eras;                 // No of eras
+    uint8 reserved;
+} TzDbZoneRecord;
+
+typedef struct {
+    uint16 policy;                  // Policy (TZ_DB_NONE if none)
+    uint16 format;                  // Abbreviation format (String offset)
+    int16 offset_code;              // AtcZoneEra fields
+    int16 until_year;
+    uint16 until_time_code;
+    uint8 offset_remainder;
+    int8 delta_minutes;
+    uint8 until_month;
+    uint8 until_day;
+    uint8 until_time_modifier;
+    uint8 reserved;
+} TzDbEraRecord;
+
+typedef struct {
+    uint16 rule_index;              // First rule
+    uint8 num_rules;                // No of rules
+    uint8 reserved;
+} TzDbPolicyRecord;
+
+// Laid out as AtcZoneRule, so rules are used in place or copied whole
+typedef struct {
+    int16 from_year;                // AtcZoneRule fields
+    int16 to_year;
+    uint8 in_month;
+    uint8 on_day_of_week;
+    int8 on_day_of_month;
+    uint8 at_time_modifier;
+    uint16 at_time_code;
+    int8 delta_minutes;
+    uint8 letter_index;
+} TzDbRuleRecord;
+
+// Where a database is read from. Offsets are relative to its start and
+// read returns 0 on success, as the spool flash does. data is set when
+// the database can be read with byte loads (Not the flash cache of the
+// ESP8266), and its rules and strings are then used in place.
+typedef struct TzDbSource {
+    int (*read)(struct TzDbSource *source, uint32 offset, void *data, uint32 len);
+    uint32 size;                    // Size of the database (in bytes)
+    uint32 address;                 // Flash address of the database (Flash source)
+    const uint8 *data;              // Start of the database (Memory source)
+} TzDbSource;
+
+// Opened database
+typedef struct {
+    TzDbSource *source;             // Source
+    TzDbHeader header;              // Header
+} TzDb;
+
+// Zone loaded from a database, in the structs the zone processor reads.
+// Holds the years context.start_year to context.until_year only, so only
+// look up times within them. Reloading a zone into the same TzDbZone keeps
+// the AtcZoneInfo address, so reset processors using it with
+// atc_processor_init(). 940 bytes on the ESP8266, 576 of them the rules
+// and strings, which only a flash source uses.
+typedef struct {
+    AtcZoneInfo info;               // Zone or link, handed to atc_processor_*
+    AtcZoneInfo target;             // Zone a link points to
+    AtcZoneContext context;
+    AtcZoneEra eras[TZ_DB_ERAS];
+    AtcZonePolicy policies[TZ_DB_ERAS];
+    AtcZoneRule rules[TZ_DB_RULES]; // Rules copied from flash
+    const char *letters[TZ_DB_LETTERS];
+    char strings[TZ_DB_STRINGS];    // Strings copied from flash
+} TzDbZone;
+
+// Type to hold the database status
+typedef enum {
+    TZ_DB_SUCCESS,                  // Success
+    TZ_DB_INVALID,                  // Not a database of this version, a reference out of it or no years
+    TZ_DB_NOT_FOUND,                // No such zone
+    TZ_DB_TOO_LARGE,                // Zone does not fit a TzDbZone over the years
+    TZ_DB_READ_ERROR                // Source read failed
+} TZ_DB_STATUS;
+
+void tz_db_memory(TzDbSource *source, const void *data, uint32 size);
+uint8 tz_db_flash(TzDbSource *source, uint32 address, uint32 size);
+uint8 tz_db_open(TzDb *db, TzDbSource *source);
+uint8 tz_db_load(TzDb *db, uint32 zone_id, int16 from_year, int16 until_year, TzDbZone *zone);
+uint8 tz_db_load_name(TzDb *db, const char *name, int16 from_year, int16 until_year, TzDbZone *zone);
+
+#endif
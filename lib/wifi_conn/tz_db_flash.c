@@ -0,0 +1,86 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: tz_db_flash.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: SPI flash source for the binary zone database, read from
+ * a flash partition. The flash cache cannot do byte loads, so the records
+ * a zone needs are copied out of it.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "tz_db.h"
+
+// Constants ----------------------------------------------------------
+
+#define TZ_DB_FLASH_BOUNCE 32 // Bounce buffer for unaligned reads (in bytes)
+
+// --------------------------------------------------------------------
+
+/**
+ * Reads the database from flash. The SPI flash API needs word aligned
+ * addresses and buffers, so unaligned reads go through a bounce buffer.
+ * @param TzDbSource *source Source
+ * @param uint32 offset Offset in the database
+ * @param void *data Buffer
+ * @param uint32 len Length
+ * @return int Success/Fail
+ */
+static int tz_db_flash_read(TzDbSource *source, uint32 offset, void *data, uint32 len) {
+    uint32 bounce[TZ_DB_FLASH_BOUNCE / 4];
+    uint32 addr = source->address + offset;
+    uint8 *bytes = (uint8 *)data;
+
+    if (!(addr & 3) && !((size_t)data & 3) && !(len & 3)) {
+        return spi_flash_read(addr, (uint32 *)data, len) != SPI_FLASH_RESULT_OK;
+    }
+
+    while (len > 0) {
+        uint32 skip = addr & 3;
+        uint32 n = TZ_DB_FLASH_BOUNCE - skip;
+
+        if (n > len) {
+            n = len;
+        }
+
+        if (spi_flash_read(addr - skip, bounce, (skip + n + 3) & ~3) != SPI_FLASH_RESULT_OK) {
+            return 1;
+        }
+
+        memcpy(bytes, (uint8 *)bounce + skip, n);
+        bytes += n;
+        addr += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+/**
+ * Sets up a source over a database written to flash, e.g. with
+ * esptool.py write_flash <address> zonedb.bin. It must not overlap the
+ * firmware, the RF calibration, the system parameters or the spool.
+ * @param TzDbSource *source Source to set up
+ * @param uint32 address Flash address of the database (Word aligned)
+ * @param uint32 size Size of the flash area (in bytes)
+ * @return int Success/Fail
+ */
+uint8 tz_db_flash(TzDbSource *source, uint32 address, uint32 size) {
+    if ((address == 0) || (address & 3)) {
+        return FALSE;
+    }
+
+    source->read = tz_db_flash_read;
+    source->size = size;
+    source->address = address;
+    source->data = NULL;
+
+    return TRUE;
+}
@@ -0,0 +1,175 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: tz_table.c
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Precomputed transition table of a timezone. The zone
+ * processor is run once per year of the range and the transitions that
+ * start within the year are appended. The transition in effect at the
+ * start of the first year is clamped to it, and transitions that change
+ * neither the offset nor the abbreviation are dropped. A lookup is a
+ * binary search for the last transition started by then.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#include "tz_table.h"
+
+/**
+ * Appends a transition to a table under construction. A transition at or
+ * before the start of the last one replaces it.
+ * @param TzTable *table Table
+ * @param TzTableEntry *entries Transitions of the table
+ * @param uint16 capacity No of transitions the entries hold
+ * @param atc_time_t start Start (AceTime epoch secs)
+ * @param int32 offset_seconds STD offset (in secs)
+ * @param int32 delta_seconds DST offset (in secs)
+ * @param char *abbrev Abbreviation
+ * @return int Success/Fail (Table full)
+ */
+static uint8 tz_table_append(TzTable *table, TzTableEntry *entries, uint16 capacity, atc_time_t start,
+                             int32 offset_seconds, int32 delta_seconds, const char *abbrev) {
+    uint8 index = 0;
+
+    while ((index < table->abbrev_count) && (strcmp(table->abbrevs[index], abbrev) != 0)) {
+        index++;
+    }
+
+    if (index == table->abbrev_count) {
+        if (index == TZ_TABLE_ABBREVS) {
+            return FALSE;
+        }
+
+        strncpy(table->abbrevs[index], abbrev, kAtcAbbrevSize - 1);
+        table->abbrev_count++;
+    }
+
+    if ((table->count > 0) && (entries[table->count - 1].start_epoch_seconds >= start)) {
+        table->count--;
+    }
+
+    if (table->count > 0) {
+        TzTableEntry *last = &entries[table->count - 1];
+
+        if ((last->offset_seconds == offset_seconds) && (last->delta_seconds == delta_seconds) &&
+            (last->abbrev_index == index)) {
+            return TRUE;
+        }
+    }
+
+    if (table->count == capacity) {
+        return FALSE;
+    }
+
+    TzTableEntry *entry = &entries[table->count];
+    entry->start_epoch_seconds = start;
+    entry->offset_seconds = offset_seconds;
+    entry->delta_seconds = (int16)delta_seconds;
+    entry->abbrev_index = index;
+    table->count++;
+
+    return TRUE;
+}
+
+/**
+ * Builds the transition table of a timezone for the years
+ * [from_year, until_year). The processor is left initialized for the last
+ * year. On failure the table is left empty, so lookups fall through.
+ * @param TzTable *table Table
+ * @param TzTableEntry *entries Transitions of the table
+ * @param uint16 capacity No of transitions the entries hold
+ * @param AtcZoneProcessor *processor Zone processor to build with
+ * @param AtcZoneInfo *zone_info Timezone
+ * @param int16 from_year First year
+ * @param int16 until_year Year after the last
+ * @return int Success/Fail (Invalid year or table full)
+ */
+uint8 tz_table_build(TzTable *table, TzTableEntry *entries, uint16 capacity, AtcZoneProcessor *processor,
+                     const AtcZoneInfo *zone_info, int16 from_year, int16 until_year) {
+    memset(table, 0, sizeof(TzTable));
+    table->zone_info = zone_info;
+    table->epoch_year = atc_get_current_epoch_year();
+    table->entries = entries;
+
+    atc_processor_init_for_zone_info(processor, zone_info);
+
+    for (int16 year = from_year; year < until_year; year++) {
+        AtcLocalDateTime next_year = {year + 1, 1, 1, 0, 0, 0, 0};
+        AtcLocalDateTime this_year = {year, 1, 1, 0, 0, 0, 0};
+        atc_time_t year_start = atc_local_date_time_to_epoch_seconds(&this_year);
+        atc_time_t year_end = atc_local_date_time_to_epoch_seconds(&next_year);
+        uint8 appended = TRUE;
+
+        if ((year_start == kAtcInvalidEpochSeconds) || (year_end == kAtcInvalidEpochSeconds) ||
+            (atc_processor_init_for_year(processor, year) != kAtcErrOk)) {
+            table->count = 0;
+            return FALSE;
+        }
+
+        if (processor->is_fixed) {
+            appended = tz_table_append(table, entries, capacity, year_start, processor->fixed_std_offset_seconds,
+                                       processor->fixed_dst_offset_seconds, processor->fixed_abbrev);
+        } else {
+            const AtcTransitionStorage *storage = &processor->transition_storage;
+
+            for (uint8 i = 0; appended && (i < storage->index_free); i++) {
+                const AtcTransition *transition = storage->transitions[i];
+
+                if (transition->start_epoch_seconds >= year_end) {
+                    break;
+                }
+
+                atc_time_t start = transition->start_epoch_seconds;
+
+                appended = tz_table_append(table, entries, capacity, (start < year_start) ? year_start : start,
+                                           transition->offset_seconds, transition->delta_seconds,
+                                           transition->abbrev);
+            }
+        }
+
+        if (!appended) {
+            table->count = 0;
+            return FALSE;
+        }
+
+        table->valid_until = year_end;
+    }
+
+    return TRUE;
+}
+
+/**
+ * Returns the transition in effect at a time, NULL if the time is outside
+ * of the table or the table was built for another AceTime epoch.
+ * @param TzTable *table Table
+ * @param atc_time_t epoch_seconds Time (AceTime epoch secs)
+ * @return TzTableEntry* Transition
+ */
+const TzTableEntry *tz_table_find(const TzTable *table, atc_time_t epoch_seconds) {
+    if ((table->count == 0) || (table->epoch_year != atc_get_current_epoch_year()) ||
+        (epoch_seconds < table->entries[0].start_epoch_seconds) || (epoch_seconds >= table->valid_until)) {
+        return NULL;
+    }
+
+    // Last transition started by then, entries[low] always qualifies
+    uint16 low = 0;
+    uint16 high = table->count;
+
+    while ((high - low) > 1) {
+        uint16 middle = low + ((high - low) / 2);
+
+        if (table->entries[middle].start_epoch_seconds <= epoch_seconds) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    return &table->entries[low];
+}
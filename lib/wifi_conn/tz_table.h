@@ -0,0 +1,57 @@
+/*
+ * Project Name: Project Lihini
+ * File Name: tz_table.h
+ * Author: Asanka Sovis
+ * Created: 16/10/2026
+ * Description: Precomputed transition table of a timezone over a range of
+ * years, searched by binary search instead of rebuilding the zone
+ * processor's year window. Built at startup with tz_table_build(), or
+ * generated at build time with host/build/tz_table_gen, which prints a
+ * const TzTable to compile in.
+ *
+ * Modified By: Asanka Sovis
+ * Modified: 16/10/2026
+ *
+ * Changelog:
+ *   - Initial Commit
+ *
+ * Copyright (C) 2024 Project Lihini. All rights reserved.
+ */
+
+#ifndef TZ_TABLE_H
+#define TZ_TABLE_H
+
+#include "esp_common.h"
+
+#include "acetime/acetimec.h"
+
+// Constants ----------------------------------------------------------
+
+#define TZ_TABLE_ABBREVS 6 // Distinct abbreviations a table holds
+
+// --------------------------------------------------------------------
+
+// Offset from a transition until the next one
+typedef struct {
+    atc_time_t start_epoch_seconds; // Start (AceTime epoch secs, clamped to the first year)
+    int32 offset_seconds;           // STD offset (in secs)
+    int16 delta_seconds;            // DST offset (in secs)
+    uint8 abbrev_index;             // Abbreviation in TzTable.abbrevs
+} TzTableEntry;
+
+// Transitions of a timezone over a range of years
+typedef struct {
+    const AtcZoneInfo *zone_info;   // Timezone
+    int16 epoch_year;               // AceTime epoch year the starts are relative to
+    atc_time_t valid_until;         // Start of the year after the range (AceTime epoch secs)
+    const TzTableEntry *entries;    // Transitions, sorted by start
+    uint16 count;                   // No of transitions
+    uint8 abbrev_count;             // No of abbreviations
+    char abbrevs[TZ_TABLE_ABBREVS][kAtcAbbrevSize]; // Abbreviations
+} TzTable;
+
+uint8 tz_table_build(TzTable *table, TzTableEntry *entries, uint16 capacity, AtcZoneProcessor *processor,
+                     const AtcZoneInfo *zone_info, int16 from_year, int16 until_year);
+const TzTableEntry *tz_table_find(const TzTable *table, atc_time_t epoch_seconds);
+
+#endif
@@ -22,6 +22,7 @@
  */
 
 #include "wifi_conn.h"
+#include "conn_state.h"
 
 // Constants ----------------------------------------------------------
 
@@ -32,6 +33,10 @@
 #define SNTP_EPOCH_THRESHOLD 905536800 // Value after which NTP update is assumed to
 // be successful
 
+#define SNTP_PORT 123 // SNTP server port
+#define SNTP_PACKET_SIZE 48 // SNTP packet without extensions (in bytes)
+#define SNTP_UNIX_OFFSET 2208988800UL // Seconds from 1900 (NTP era 0) to 1970
+
 // --------------------------------------------------------------------
 
 // External Variables -------------------------------------------------
@@ -39,19 +44,21 @@
 extern int8 wifi_status;            // WiFi conn.
 
 extern char *target_host;           // Address
-extern struct hostent *host;        // DNS resolution
+extern struct in_addr target_addr;  // DNS resolution
 
 extern char mac_address[18];        // MAC address of the ESP32
 extern char unique_identifier[22];  //Unique identifier of the ESP32
 // NOTE: This is used as the client ID for MQTT
 
-// Timeshift to store the timezone deviation between ESPs NTP updated time (Relative
-// to Asia/Shanghai) to the timezone used by the server for reference (Relative t0
-// Asia/Colombo)
-extern long timeshift;
-
 // --------------------------------------------------------------------
 
+uint8 sntp_started = FALSE;         // SNTP client initialized
+
+TzOffsetCache tz_sntp = {&SNTP_TIMEZONE};       // UTC offset of the SNTP time
+TzOffsetCache tz_local = {&DEFAULT_TIMEZONE};   // UTC offset of the served time
+TzTable tz_local_table;                         // Precomputed transitions of DEFAULT_TIMEZONE
+TzTableEntry tz_local_entries[TZ_TABLE_ENTRIES];
+
 /**
  * Connects to WiFi using the provided SSID and password. This only handles the
  * initial configuration. Connection is handled in the backend by the RTOS. State
@@ -104,6 +111,14 @@ void wifi_conn_event(System_Event_t *evt) {
     // Setting the status to wifi_status flag
     wifi_status = evt->event_id;
 
+    // Wake the threads waiting on the WiFi state
+    if (evt->event_id == EVENT_STAMODE_GOT_IP) {
+        conn_backoff_succeeded(CONN_STAGE_WIFI);
+        conn_state_set(CONN_WIFI_UP);
+    } else if (evt->event_id == EVENT_STAMODE_DISCONNECTED) {
+        conn_state_clear(CONN_WIFI_UP);
+    }
+
     printf("Station: " MACSTR "join, AID: %d\n", MAC2STR(evt->event_info.sta_connected.mac),
                     evt->event_info.sta_connected.aid);
 
@@ -166,20 +181,29 @@ uint8 identifier_resolve() {
 }
 
 /**
- * Returns the IP address from a given hostname by connecting to a DNS server.
+ * Returns the IP address from a given hostname through the DNS cache. The
+ * DNS server is only asked once the cached address is older than
+ * DNS_CACHE_TTL.
  *      CONNECTION_DNS_RESOLUTION_FAIL  - DNS fail
  *      CONNECTION_SUCCESS              - DNS success
  * @param none
  * @return int Success/Fail
  */
 int get_ip() {
-    host = gethostbyname(target_host);
+    uint8 status = dns_cache_lookup(target_host, &target_addr);
 
-    if (host == NULL) {
+    if (status == DNS_CACHE_FAIL) {
         printf("DNS resolution failed.\n");
         return CONNECTION_DNS_RESOLUTION_FAIL;
+    } else if (status == DNS_CACHE_STALE) {
+        printf("DNS resolution failed. Using the last known address.\n");
+        return CONNECTION_SUCCESS;
     } else {
-        printf("DNS resolution successful.\n");
+        DnsCacheStats stats;
+
+        dns_cache_stats(&stats);
+        printf("DNS resolution successful. Cache hits: %d | Lookups: %d | Avg. lookup: %d ms\n",
+               stats.hits, stats.misses, stats.misses ? (stats.lookup_ms / stats.misses) : 0);
         return CONNECTION_SUCCESS;
     }
 }
@@ -208,17 +232,17 @@ int ping() {
 
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
-    addr.sin_port = htons(80);
-
-    char *ip_addr = inet_ntoa(*host->h_addr_list[0]);
+    addr.sin_port = htons(CONN_PROBE_PORT);
 
-    printf("Connecting: %s...\n", ip_addr);
-    inet_aton(ip_addr, &addr.sin_addr);
+    addr.sin_addr = target_addr;
+    printf("Connecting: %s...\n", inet_ntoa(target_addr));
 
     int ret = connect(sock, (struct sockaddr*)&addr, sizeof(addr));
     if (ret == -1) {
         printf("Connection failure.\n");
         close(sock);
+        // The host may have moved, resolve again on the next check
+        dns_cache_expire(target_host);
         return CONNECTION_FAIL;
     }
 
@@ -229,10 +253,53 @@ int ping() {
     return CONNECTION_SUCCESS;
 }
 
+/**
+ * Probes the internet connection by pinging CONN_PROBE_TARGETS in order
+ * until one answers, and records the outcome and cost for the probe
+ * scheduler. target_host is left at the target that answered.
+ *      CONNECTION_DNS_RESOLUTION_FAIL  - DNS fail
+ *      CONNECTION_SOCKET_FAIL          - Socket connection fail
+ *      CONNECTION_FAIL                 - Connection fail
+ *      CONNECTION_SUCCESS              - Success
+ * @param none
+ * @return int Success/Fail
+ */
+int check_internet() {
+    static char *targets[] = CONN_PROBE_TARGETS;
+    int status = CONNECTION_FAIL;
+    uint8 attempts = 0;
+    portTickType started = xTaskGetTickCount();
+
+    for (uint8 i = 0; (i < (sizeof(targets) / sizeof(targets[0]))) && (status != CONNECTION_SUCCESS); i++) {
+        target_host = targets[i];
+        attempts++;
+
+        status = get_ip();
+
+        if (status == CONNECTION_SUCCESS)
+            status = ping();
+    }
+
+    uint32 elapsed = (xTaskGetTickCount() - started) * portTICK_RATE_MS;
+    conn_probe_result(status == CONNECTION_SUCCESS, attempts, elapsed);
+
+    ConnProbeStats stats;
+    ConnBackoffStats backoff;
+
+    conn_probe_stats(&stats);
+    conn_backoff_stats(CONN_STAGE_INTERNET, &backoff);
+    printf("Connectivity probe %s in %d ms. Probes: %d | Failed: %d | Heard: %d | Retry in: %d ms\n",
+           (status == CONNECTION_SUCCESS) ? "passed" : "failed", elapsed, stats.probes, stats.failures,
+           stats.heard, (status == CONNECTION_SUCCESS) ? 0 : backoff.delay_ms);
+
+    return status;
+}
+
 /**
  * This function is called by the threads when NTP time needs to be
  * first updated. This initializes the NTP time related functions of
- * the OS and call get_ntp_time() to update it.
+ * the OS and call get_ntp_time() to update it. The outcome schedules the
+ * next retry on the CONN_STAGE_NTP backoff.
  *      SNTP_ERROR                      - SNTP error
  *      CONNECTION_SUCCESS              - Success
  * 
@@ -250,10 +317,13 @@ int ping() {
 int update_ntp_time(char *sntp_server) {
     printf("Updating the SNTP time: Server: %s...\n", sntp_server);
 
-    // SNTP init
-    sntp_setoperatingmode(SNTP_OPMODE_POLL);
-    sntp_setservername(0, sntp_server);
-    sntp_init();
+    // SNTP init, the client then keeps polling on its own
+    if (!sntp_started) {
+        sntp_setoperatingmode(SNTP_OPMODE_POLL);
+        sntp_setservername(0, sntp_server);
+        sntp_init();
+        sntp_started = TRUE;
+    }
 
     printf("Waiting for SNTP update...\n");
 
@@ -262,14 +332,31 @@ int update_ntp_time(char *sntp_server) {
     int error = get_ntp_time(&ntp_time);
 
     if (error == SNTP_ERROR) {
+        conn_backoff_failed(CONN_STAGE_NTP);
         printf("SNTP update timed out. Will retry again...\n");
     } else {
+        conn_backoff_succeeded(CONN_STAGE_NTP);
         printf("NTP time updated. Time: %d\n", ntp_time);
     }
 
     return error;
 }
 
+/**
+ * Shifts a UTC time to the local time of DEFAULT_TIMEZONE. The UTC offset
+ * comes from its offset cache, so the AceTime zone processor only runs
+ * when a transition (Or the end of the year) is crossed.
+ * @param sint64 unix_seconds Unix time (in secs)
+ * @return u_long Local time
+ */
+static u_long utc_to_local(sint64 unix_seconds) {
+    int32 offset = 0;
+
+    tz_cache_offset(&tz_local, unix_seconds, &offset);
+
+    return (u_long)(unix_seconds + offset);
+}
+
 /**
  * Gets the NTP time from the provided NTP server. NTP server is provided in
  * DEFAULT_SNTP_SERVER. The received NTP time is stored in *ntp_time.
@@ -295,113 +382,228 @@ int get_ntp_time(u_long *ntp_time) {
         count += SNTP_RECHECK_DELAY;
     }
 
+    // The clock runs in UTC, ESP8266 sets the time of Asia/Shanghai
+    sint64 unix_seconds = tz_cache_to_utc(&tz_sntp, tv.tv_sec);
+
+    clock_resync(((uint64)unix_seconds * 1000) + (tv.tv_usec / 1000));
+
     // Time shifted to Asia/Colombo
-    u_long current_time = shift_timezone(tv.tv_sec);
+    u_long current_time = utc_to_local(unix_seconds);
+    AtcLocalDateTime current_time_lk = {0};
+
+    atc_local_date_time_from_unix_seconds(&current_time_lk, current_time);
+
+    printf("%d.%d.%d %d:%d:%d %s\n",
+        current_time_lk.day,
+        current_time_lk.month,
+        current_time_lk.year,
+        current_time_lk.hour,
+        current_time_lk.minute,
+        current_time_lk.second,
+        DEFAULT_TIMEZONE.name
+    );
 
     *ntp_time = current_time;
-    timeshift =  current_time - (u_long)tv.tv_sec;
 
     return CONNECTION_SUCCESS;
 }
 
 /**
- * Calculates the amount of seconds to be shifted using AceTime C library.
- * The process is resource-heavy, thus the shift in seconds is calculated
- * and stored for later. [Asia/Shanghai -> Asia/Colombo]
- * @param u_long ntp_time NTP time received
- * @return u_long Corrected NTP time
+ * Reads an NTP timestamp from a packet as Unix time.
+ * @param uint8 *field Timestamp (Seconds and fraction, big endian)
+ * @return uint64 Unix time (in msec)
  */
-u_long shift_timezone(u_long ntp_time) {
-    // Convert the NTP time received to the local data format
-    AtcLocalDateTime current_time = {0};
+static uint64 sntp_timestamp_ms(const uint8 *field) {
+    uint32 seconds = ((uint32)field[0] << 24) | ((uint32)field[1] << 16) | ((uint32)field[2] << 8) | field[3];
+    uint32 fraction = ((uint32)field[4] << 24) | ((uint32)field[5] << 16) | ((uint32)field[6] << 8) | field[7];
 
-    atc_local_date_time_from_unix_seconds(&current_time, ntp_time);
+    // Era 0 ends in 2036, later times wrap below SNTP_UNIX_OFFSET
+    uint64 unix_s = (seconds >= SNTP_UNIX_OFFSET) ? (seconds - SNTP_UNIX_OFFSET) : (seconds + 0x100000000ULL - SNTP_UNIX_OFFSET);
 
-    // Attaching the Shanghai timezone because ESP8266 request NTP time
-    // for timezone Asia/Shanghai
+    return (unix_s * 1000) + (((uint64)fraction * 1000) >> 32);
+}
 
-    AtcZoneProcessor processor_sh;
-    atc_processor_init(&processor_sh);
-    AtcTimeZone tz_sh = {&kAtcZoneAsia_Shanghai, &processor_sh};
+/**
+ * Asks an SNTP server for the time with a single request on a UDP
+ * socket, apart from the SNTP client of the SDK. Only a server reply that
+ * echoes the request is taken. The time is corrected for the round trip
+ * with the receive and transmit timestamps of the reply.
+ *      SNTP_ERROR                      - No valid reply within SNTP_UPDATE_TIMEOUT
+ *      CONNECTION_SUCCESS              - Success
+ * @param char *sntp_server NTP server URL
+ * @param uint64 *unix_ms Pointer to store the Unix time, at the current monotonic time (in msec)
+ * @return int Success/Fail
+ */
+static int sntp_query(char *sntp_server, uint64 *unix_ms) {
+    struct sockaddr_in addr;
+    uint8 packet[SNTP_PACKET_SIZE] = {0};
+    uint8 request[8] = {0};
 
-    AtcZonedDateTime current_time_sh = {0};
+    if (dns_cache_lookup(sntp_server, &addr.sin_addr) == DNS_CACHE_FAIL) {
+        return SNTP_ERROR;
+    }
 
-    atc_zoned_date_time_from_local_date_time(&current_time_sh, &current_time, &tz_sh);
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
 
-    // Converting Asia/Shanghai time to Asia/Colombo time
+    if (sock == -1) {
+        return SNTP_ERROR;
+    }
 
-    AtcZoneProcessor processor_sl;
-    atc_processor_init(&processor_sl);
-    AtcTimeZone tz_sl = {&DEFAULT_TIMEZONE, &processor_sl};
+    memset(addr.sin_zero, 0, sizeof(addr.sin_zero));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SNTP_PORT);
+
+    // Version 4, client. The transmit timestamp is a nonce the reply must echo
+    uint64 sent_ms = clock_monotonic_ms();
+    uint32 nonce = (uint32)sent_ms ^ (xTaskGetTickCount() << 16);
+
+    packet[0] = (4 << 3) | 3;
+    memcpy(request, &sent_ms, 4);
+    memcpy(request + 4, &nonce, 4);
+    memcpy(packet + 40, request, sizeof(request));
+
+    int status = SNTP_ERROR;
+
+    if (sendto(sock, packet, SNTP_PACKET_SIZE, 0, (struct sockaddr *)&addr, sizeof(addr)) == SNTP_PACKET_SIZE) {
+        while (status == SNTP_ERROR) {
+            sint32 left = SNTP_UPDATE_TIMEOUT - (sint32)(clock_monotonic_ms() - sent_ms);
+            struct timeval tv = {0, 0};
+            fd_set fdset;
+
+            if (left <= 0) {
+                break;
+            }
+
+            tv.tv_sec = left / 1000;
+            tv.tv_usec = (left % 1000) * 1000;
+            FD_ZERO(&fdset);
+            FD_SET(sock, &fdset);
+
+            if ((select(sock + 1, &fdset, 0, 0, &tv) <= 0) ||
+                (recv(sock, packet, SNTP_PACKET_SIZE, 0) < SNTP_PACKET_SIZE)) {
+                break;
+            }
+
+            uint64 received_ms = clock_monotonic_ms();
+
+            // Server mode, synchronized (Leap indicator not 3, stratum 1-15) and
+            // answering this request
+            if (((packet[0] & 0x07) != 4) || ((packet[0] >> 6) == 3) || (packet[1] == 0) || (packet[1] > 15) ||
+                (memcmp(packet + 24, request, sizeof(request)) != 0)) {
+                continue;
+            }
+
+            uint64 server_rx_ms = sntp_timestamp_ms(packet + 32);
+            uint64 server_tx_ms = sntp_timestamp_ms(packet + 40);
+            sint64 delay_ms = (sint64)(received_ms - sent_ms) - (sint64)(server_tx_ms - server_rx_ms);
+
+            *unix_ms = server_tx_ms + ((delay_ms > 0) ? (delay_ms / 2) : 0) + (clock_monotonic_ms() - received_ms);
+            status = CONNECTION_SUCCESS;
+        }
+    }
 
-    AtcZonedDateTime current_time_lk = {0};
+    close(sock);
 
-    atc_zoned_date_time_convert(&current_time_sh, &tz_sl, &current_time_lk);
+    return status;
+}
 
-    // Converting Asia/Colombo time to local NTP time
+/**
+ * Resyncs the clock once clock_resync_wait() is due. Asks the SNTP server
+ * directly with sntp_query(), without restarting the SNTP client or
+ * recalculating the timezone shift. Only an actual reply is taken as a
+ * sample, otherwise the resync fails and is retried on the
+ * CONN_STAGE_NTP backoff while the clock runs on the drift estimate.
+ *      SNTP_ERROR                      - SNTP error
+ *      CONNECTION_SUCCESS              - Success
+ * @param char *sntp_server NTP server URL
+ * @return int Success/Fail
+ */
+int resync_ntp_time(char *sntp_server) {
+    uint64 unix_ms = 0;
+
+    if (sntp_query(sntp_server, &unix_ms) != CONNECTION_SUCCESS) {
+        conn_backoff_failed(CONN_STAGE_NTP);
+        printf("SNTP resync failed. Server: %s\n", sntp_server);
+        return SNTP_ERROR;
+    }
 
-    AtcLocalDateTime current_time_loc = {
-        .day = current_time_lk.day,
-        .month = current_time_lk.month,
-        .year = current_time_lk.year,
-        .hour = current_time_lk.hour,
-        .minute = current_time_lk.minute,
-        .second = current_time_lk.second
-    };
+    conn_backoff_succeeded(CONN_STAGE_NTP);
+    clock_resync(unix_ms);
 
-    ntp_time = atc_local_date_time_to_unix_seconds(&current_time_loc);
-    
-    printf("%d.%d.%d %d:%d:%d %s\n", 
-        current_time_lk.day, 
-        current_time_lk.month, 
-        current_time_lk.year, 
-        current_time_lk.hour, 
-        current_time_lk.minute, 
-        current_time_lk.second, 
-        current_time_lk.tz.zone_info->name
-    );
+    ClockSyncStats stats;
 
-    return ntp_time;
+    clock_stats(&stats);
+    printf("Clock resynced. Error: %d ms | Drift: %d ppb | Next in: %d s\n",
+           stats.last_error_ms, stats.drift_ppb, stats.interval_s);
+
+    return CONNECTION_SUCCESS;
 }
 
 /**
- * Returns the current time using gettimeofday(). Only to be used after
- * update_ntp_time() is called. It can only return correct time once
- * NTP time is correctly updated.
+ * Initializes the timezone caches and precomputes the transitions of
+ * DEFAULT_TIMEZONE for TZ_TABLE_YEARS from TZ_TABLE_FROM_YEAR. Must be
+ * called before any thread reads the time.
+ * @param none
+ * @return none
+ */
+void timezone_init() {
+    tz_cache_init();
+
+    if (TZ_TABLE_YEARS == 0) {
+        return;
+    }
+
+    if (tz_cache_build_table(&tz_local, &tz_local_table, tz_local_entries, TZ_TABLE_ENTRIES,
+                             TZ_TABLE_FROM_YEAR, TZ_TABLE_FROM_YEAR + TZ_TABLE_YEARS)) {
+        printf("Timezone table: %s %d-%d, %d transitions\n", DEFAULT_TIMEZONE.name, TZ_TABLE_FROM_YEAR,
+               TZ_TABLE_FROM_YEAR + TZ_TABLE_YEARS - 1, tz_local_table.count);
+    } else {
+        printf("Timezone table of %s does not fit TZ_TABLE_ENTRIES, not used.\n", DEFAULT_TIMEZONE.name);
+    }
+}
+
+/**
+ * Shifts the SNTP time to the local time of DEFAULT_TIMEZONE. Both UTC
+ * offsets come from their offset cache, so the AceTime zone processor only
+ * runs when a transition (Or the end of the year) is crossed, and a DST
+ * change between SNTP updates is picked up. [Asia/Shanghai -> Asia/Colombo]
+ * @param u_long ntp_time NTP time received
+ * @return u_long Corrected NTP time
+ */
+u_long shift_timezone(u_long ntp_time) {
+    // ESP8266 sets the time of Asia/Shanghai, back to UTC first
+    return utc_to_local(tz_cache_to_utc(&tz_sntp, ntp_time));
+}
+
+/**
+ * Returns the current time from the disciplined clock, or gettimeofday()
+ * before the first SNTP sample. Only to be used after update_ntp_time()
+ * is called. It can only return correct time once NTP time is correctly
+ * updated.
  * @param none
  * @return u_long Current time
  */
 u_long get_time() {
     struct timeval tv = {0};
+    uint64 now_ms = 0;
+
+    // The clock runs in UTC, only gettimeofday() is in the SNTP timezone
+    if (clock_now_ms(&now_ms)) {
+        return utc_to_local((sint64)(now_ms / 1000));
+    }
 
     gettimeofday(&tv, NULL);
 
-    return (tv.tv_sec + timeshift);
+    return shift_timezone(tv.tv_sec);
 }
 
 /**
  * Creates a string with the date and time.
  * DD-MM-YYYY hh:mm:ss
- * @param char *timestamp Generated timestamp
+ * @param char *timestamp Generated timestamp (TIME_FMT_LENGTH + 1 bytes)
  * @param u_long time Current time in Unix secs.
  * @return none
  */
 void time_to_str(char *timestamp, u_long time) {
-    AtcLocalDateTime current_time = {0};
-
-    // Unix time -> Local time (Hours, Mins, etc. separate)
-    atc_local_date_time_from_unix_seconds(&current_time, time);
-
-    // Formatting to add a 0 at the front if number is < 10
-    int values[5] = {current_time.day, current_time.month, current_time.hour, current_time.minute, current_time.second};
-    char str_values[5][3] = {0};
-
-    for (int i = 0; i < 5; i++) {
-        if (values[i] < 10)
-            sprintf(str_values[i], "0%d\0", values[i]);
-        else
-            sprintf(str_values[i], "%d\0", values[i]);
-    }
-    
-    sprintf(timestamp, "%s-%s-%d %s:%s:%s\0", str_values[0], str_values[1], current_time.year, str_values[2], str_values[3], str_values[4]);
+    time_fmt(timestamp, time, TIME_FMT_DMY);
 }
@@ -42,6 +42,13 @@
 
 #include "../../include/app_conf.h"
 #include "acetime/acetimec.h"
+#include "dns_cache.h"
+#include "conn_probe.h"
+#include "conn_backoff.h"
+#include "clock_sync.h"
+#include "tz_cache.h"
+#include "tz_table.h"
+#include "time_fmt.h"
 
 // Type for WiFi status is defined already in the esp_wifi.h CONNECTION_IN_PROGRESS
 // is added to this in addition to define the state where it's still connecting.
@@ -63,8 +70,11 @@ void wifi_conn_event(System_Event_t *evt);
 uint8 identifier_resolve();
 int get_ip();
 int ping();
+int check_internet();
 int update_ntp_time(char *sntp_server);
+int resync_ntp_time(char *sntp_server);
 int get_ntp_time(u_long *ntp_time);
+void timezone_init();
 u_long shift_timezone(u_long ntp_time);
 u_long get_time();
 void time_to_str(char *timestamp, u_long time);
@@ -53,6 +53,7 @@
 
 #include "app_conf.h"
 #include "../lib/wifi_conn/wifi_conn.h"
+#include "../lib/wifi_conn/conn_state.h"
 #include "../lib/mqtt_conn/mqtt_conn.h"
 #include "../lib/wifi_conn/acetime/acetimec.h"
 
@@ -67,11 +68,18 @@
 #define NETWORK_MANAGEMENT_DELAY 100 // Network management delay
 #define MQTT_PROCESS_DELAY 100// MQTT process delay
 #define THREAD_MONITOR_DELAY 1000 // Thread monitor delay
+#define STATE_WAIT_TIMEOUT 500 // Max time a thread blocks on a state change
+// NOTE: Must stay below THREAD_MONITOR_DELAY so the watchdog is reset
+
+#define SENSOR_PUBLISH_TOPIC "lihini/income" // Topic of the polled samples
+#define SENSOR_PAYLOAD_SIZE 32 // Max payload of a polled sample
 
 // --------------------------------------------------------------------
 
 // Status Flags--------------------------------------------------------
-// These are set to indicate the status of each task.
+// These are set to indicate the status of each task. The threads do not
+// poll these, publish_conn_state() mirrors them into the conn_state bits
+// that the threads block on.
 
 int8 wifi_status = EVENT_STAMODE_DISCONNECTED;  // WiFi conn.
 int8 connection_status = CONNECTION_FAIL;       // Internet
@@ -106,7 +114,7 @@ char *sntp_server = DEFAULT_SNTP_SERVER;        // SNTP Server
 
 // Host to check the connectivity of the network
 char *target_host = DEFAULT_CONN_SERVER;        // Address
-struct hostent *host = {0};                     // DNS resolution
+struct in_addr target_addr = {0};               // DNS resolution
 
 // Current subscribe topic
 char *current_subscribe_topic = MQTT_SUBSCRIBE_TOPIC;
@@ -116,16 +124,11 @@ char mac_address[18] = {0};                     // MAC address of the ESP32
 char unique_identifier[22] = {0};               //Unique identifier of the ESP32
 // NOTE: This is used as the client ID for MQTT [lihini_c0:a8:01:02:ff:ff]
 
-// Main queues
-xQueueHandle incoming_queue = {0};              // Incoming from server
-xQueueHandle outgoing_queue = {0};              // Outgoing to server
-
-// Timeshift to store the timezone deviation between ESPs NTP updated time (Relative
-// to Asia/Shanghai) to the timezone used by the server for reference (Relative t0
-// Asia/Colombo)
-long timeshift = 0;
+// NOTE: Incoming and outgoing messages are held in the ring arenas in mqtt_conn.c
 
 void task_monitor();
+void publish_conn_state();
+void print_bring_up();
 void network_monitor();
 void mqtt_monitor();
 void live_indication();
@@ -182,6 +185,9 @@ uint32 user_rf_cal_sector_set(void) {
  */
 void user_init(void)
 {
+    conn_state_init(); // Before any thread waits on it
+    timezone_init(); // Before any thread reads the time
+
     //create_timed_interrupt();
 
     xTaskCreate(task_monitor, "task_monitor", 500, NULL, 6, NULL); // Tasnk monitor
@@ -207,10 +213,16 @@ void task_monitor() {
             }
         }
 
-        // MQTT thread reset
-        if (mqtt_monitor_reset) {
-            printf("MQTT thread has timed out. Restarting thread...\n");
-            if (mqtt_monitor_handle != NULL) {
+        // MQTT thread reset. The thread is stopped first and is left to run
+        // while it holds the spool lock, as it would never release it if deleted
+        if (mqtt_monitor_reset && (mqtt_monitor_handle != NULL)) {
+            vTaskSuspend(mqtt_monitor_handle);
+
+            if (mqtt_queue_spooling(mqtt_monitor_handle)) {
+                printf("MQTT thread has timed out writing the spool. Waiting...\n");
+                vTaskResume(mqtt_monitor_handle);
+            } else {
+                printf("MQTT thread has timed out. Restarting thread...\n");
                 vTaskDelete(mqtt_monitor_handle);
                 mqtt_monitor_handle = NULL;
             }
@@ -251,6 +263,63 @@ void task_monitor() {
     vTaskDelete(NULL);
 }
 
+/**
+ * Mirrors the status flags into the conn_state bits. Only bits that
+ * changed wake the threads waiting on them.
+ * @param none
+ * @return none
+ */
+void publish_conn_state() {
+    uint32 bits = 0;
+
+    if (wifi_status_decode(wifi_status))
+        bits |= CONN_WIFI_UP;
+
+    if (connection_status == CONNECTION_SUCCESS)
+        bits |= CONN_INTERNET_UP;
+
+    if (ntp_status == CONNECTION_SUCCESS)
+        bits |= CONN_TIME_SYNCED;
+
+    if (mqtt_is_connected())
+        bits |= CONN_MQTT_UP;
+
+    if (mqtt_status == MQTT_PUBLISHING)
+        bits |= CONN_MQTT_PUBLISHING;
+
+    conn_state_update(CONN_WIFI_UP | CONN_INTERNET_UP | CONN_TIME_SYNCED | CONN_MQTT_UP | CONN_MQTT_PUBLISHING, bits);
+}
+
+/**
+ * Prints the time each bring-up stage took, from WiFi up to MQTT
+ * connected, and the failed attempts and last recovery time of each
+ * stage.
+ * @param none
+ * @return none
+ */
+void print_bring_up() {
+    portTickType wifi_at = conn_state_changed_at(CONN_WIFI_UP);
+    portTickType internet_at = conn_state_changed_at(CONN_INTERNET_UP);
+    portTickType time_at = conn_state_changed_at(CONN_TIME_SYNCED);
+    portTickType mqtt_at = conn_state_changed_at(CONN_MQTT_UP);
+
+    printf("Bring-up: WiFi at %d ms | Internet +%d ms | SNTP +%d ms | MQTT +%d ms\n",
+           wifi_at * portTICK_RATE_MS, (internet_at - wifi_at) * portTICK_RATE_MS,
+           (time_at - internet_at) * portTICK_RATE_MS, (mqtt_at - time_at) * portTICK_RATE_MS);
+
+    ConnBackoffStats stages[CONN_STAGE_COUNT];
+
+    for (uint8 i = 0; i < CONN_STAGE_COUNT; i++) {
+        conn_backoff_stats(i, &stages[i]);
+    }
+
+    printf("Retries: WiFi %d (%d ms) | Internet %d (%d ms) | SNTP %d (%d ms) | MQTT %d (%d ms)\n",
+           stages[CONN_STAGE_WIFI].failures, stages[CONN_STAGE_WIFI].recover_ms,
+           stages[CONN_STAGE_INTERNET].failures, stages[CONN_STAGE_INTERNET].recover_ms,
+           stages[CONN_STAGE_NTP].failures, stages[CONN_STAGE_NTP].recover_ms,
+           stages[CONN_STAGE_MQTT].failures, stages[CONN_STAGE_MQTT].recover_ms);
+}
+
 /**
  * Thread that monitors the network state of the device. These include WiFi connection,
  * internet connection and SNTP update. Each will depend on the success of the others.
@@ -268,43 +337,79 @@ void network_monitor() {
             wifi_status = EVENT_STAMODE_GOT_IP;
         }
 
-        // If WiFi status is disconnected, connect
+        // If WiFi status is disconnected, connect and wait for the GOT_IP
+        // event. A connect that times out is retried on the backoff, in
+        // between the GOT_IP event is still waited for.
         if (!wifi_status_decode(wifi_status)) {
             connection_status = CONNECTION_FAIL;
             ntp_status = SNTP_ERROR;
             mqtt_status = MQTT_DISCONNECT;
+            conn_probe_reset();
+            conn_backoff_reset(CONN_STAGE_NTP);
+            conn_backoff_reset(CONN_STAGE_MQTT);
+            publish_conn_state();
 
-            connect_wifi(wifi_ssid, wifi_password);
+            portTickType wait = conn_backoff_wait(CONN_STAGE_WIFI);
 
-            vTaskDelay(NETWORK_MANAGEMENT_DELAY);
-        }
+            if (wait == 0) {
+                connect_wifi(wifi_ssid, wifi_password);
 
-        // If WiFi status is connected but internet is disconnected, wait until
-        // connectivity is available
-        if (wifi_status_decode(wifi_status) && (connection_status != CONNECTION_SUCCESS)) {
-            ntp_status = SNTP_ERROR;
-            mqtt_status = MQTT_DISCONNECT;
+                if (!(conn_state_wait(CONN_WIFI_UP, CONN_WIFI_UP, CONN_WAIT_ALL, STATE_WAIT_TIMEOUT) & CONN_WIFI_UP))
+                    conn_backoff_failed(CONN_STAGE_WIFI);
+            } else {
+                conn_state_wait(CONN_WIFI_UP, CONN_WIFI_UP, CONN_WAIT_ALL, (wait < STATE_WAIT_TIMEOUT) ? wait : STATE_WAIT_TIMEOUT);
+            }
+        }
 
-            connection_status = get_ip();
+        // If WiFi status is connected, infer internet connectivity from the
+        // broker traffic. Only probe once the link has been quiet for
+        // CONN_PROBE_IDLE, or on the backoff schedule after a failed probe.
+        if (wifi_status_decode(wifi_status)) {
+            if (conn_probe_online()) {
+                connection_status = CONNECTION_SUCCESS;
+            } else if (conn_probe_wait() == 0) {
+                connection_status = check_internet();
+            }
 
-            if (connection_status == CONNECTION_SUCCESS)
-                connection_status = ping();
+            if (connection_status != CONNECTION_SUCCESS) {
+                ntp_status = SNTP_ERROR;
+                mqtt_status = MQTT_DISCONNECT;
 
-            vTaskDelay(NETWORK_MANAGEMENT_DELAY);
+                portTickType wait = conn_probe_wait();
+                vTaskDelay((wait < NETWORK_MANAGEMENT_DELAY) ? wait : NETWORK_MANAGEMENT_DELAY);
+            }
         }
 
-        // If WiFi status is connected and internet ping is successful, update NTP
+        // If WiFi status is connected and internet ping is successful, update NTP.
+        // A failed update is retried on the backoff.
         if (wifi_status_decode(wifi_status) && (connection_status == CONNECTION_SUCCESS) && (ntp_status == SNTP_ERROR)) {
             mqtt_status = MQTT_DISCONNECT;
-            ntp_status = update_ntp_time(sntp_server);
 
-            vTaskDelay(NETWORK_MANAGEMENT_DELAY);
+            portTickType wait = conn_backoff_wait(CONN_STAGE_NTP);
+
+            if (wait == 0) {
+                ntp_status = update_ntp_time(sntp_server);
+            } else {
+                vTaskDelay((wait < NETWORK_MANAGEMENT_DELAY) ? wait : NETWORK_MANAGEMENT_DELAY);
+            }
         }
 
+        // Resync the clock once its error could exceed CLOCK_SYNC_ERROR. A failed
+        // resync leaves the clock running on the drift estimate.
+        if (wifi_status_decode(wifi_status) && (ntp_status == CONNECTION_SUCCESS) &&
+            (clock_resync_wait() == 0) && (conn_backoff_wait(CONN_STAGE_NTP) == 0)) {
+            resync_ntp_time(sntp_server);
+        }
+
+        publish_conn_state();
+
         //printf("wifi_status:%d | connection_status: %d | ntp_status: %d", wifi_status, connection_status, ntp_status);
         network_monitor_reset = 0; // Watchdog reset
 
-        vTaskDelay(NETWORK_MANAGEMENT_DELAY);
+        // Once the network is up, sleep until WiFi drops
+        if ((conn_state_get() & CONN_NETWORK_READY) == CONN_NETWORK_READY) {
+            conn_state_wait(CONN_WIFI_UP, 0, CONN_WAIT_ALL, STATE_WAIT_TIMEOUT);
+        }
     }
 
     vTaskDelete(NULL);
@@ -324,12 +429,24 @@ void mqtt_monitor() {
 
     while (TRUE) {
         // MQTT thread handles MQTT only if WiFi is connected, internet is working and
-        // NTP time is updated
-        if (wifi_status_decode(wifi_status) && (connection_status == CONNECTION_SUCCESS) && (ntp_status == CONNECTION_SUCCESS)) {
+        // NTP time is updated. Blocks until the network thread gets there.
+        uint32 state = conn_state_wait(CONN_NETWORK_READY, CONN_NETWORK_READY, CONN_WAIT_ALL, STATE_WAIT_TIMEOUT);
+
+        if ((state & CONN_NETWORK_READY) == CONN_NETWORK_READY) {
             // Check for the availability of a unique identifier
             if (strncmp(unique_identifier, "\0", 1)) {
-                // Connect MQTT
-                mqtt_status = mqtt_connect(DEFAULT_MQTT_SERVER, unique_identifier, MQTT_PORT, MQTT_TIMEOUT, MQTT_BUFF_SIZE);
+                if (MQTT_PERSISTENT_SESSION && mqtt_is_connected()) {
+                    // Session still open, process incoming packets and keep-alive
+                    mqtt_status = mqtt_keep_alive(MQTT_PUBLISH_TIMEOUT);
+                } else {
+                    // Connect MQTT (Held off on the backoff after a failure)
+                    mqtt_status = mqtt_connect(DEFAULT_MQTT_SERVER, unique_identifier, MQTT_PORT, MQTT_TIMEOUT, MQTT_BUFF_SIZE);
+
+                    if (mqtt_status == MQTT_CONNECTION_SUCCESS) {
+                        conn_state_set(CONN_MQTT_UP);
+                        print_bring_up();
+                    }
+                }
 
                 // If MQTT connection was successful
                 if (mqtt_status == MQTT_CONNECTION_SUCCESS) {
@@ -338,8 +455,9 @@ void mqtt_monitor() {
                     // Publish MQTT queue
                     uint8 error = mqtt_queue_publish();
 
-                    // Queue publish was successful
-                    if (error == MQTT_QUEUE_SUCCESS) {
+                    // Queue publish was successful. Messages dropped one by one
+                    // do not mean the link is down, so the session is kept
+                    if ((error == MQTT_QUEUE_SUCCESS) || (error == MQTT_QUEUE_DROPPED)) {
                         mqtt_status = MQTT_CONNECTION_SUCCESS;
 
                         // Subscribe MQTT topic
@@ -373,18 +491,33 @@ void mqtt_monitor() {
                     }
                 }
 
-                mqtt_disconnect(); // Disconnect MQTT
+                // Disconnect MQTT unless the session is kept alive. A failed
+                // session is always dropped so that the next cycle reconnects.
+                if (!MQTT_PERSISTENT_SESSION || (mqtt_status != MQTT_CONNECTION_SUCCESS)) {
+                    mqtt_disconnect();
+                }
             } else {
                 // Resolving the unique identifier unavailability
                 if (identifier_resolve() == MAC_ADDRESS_NOT_SET) {
                     printf("No unique identifier is yet processed.");
                 }
             }
+        } else if (mqtt_is_connected()) {
+            // Network went down under a persistent session
+            mqtt_disconnect();
         }
 
+        // Move old messages to the spool before the timer producer has to drop them
+        mqtt_queue_relieve();
+
+        publish_conn_state();
+
         mqtt_monitor_reset = 0; // Watchdog reset
 
-        vTaskDelay(MQTT_PROCESS_DELAY);
+        // Publish cadence while the network is up
+        if ((state & CONN_NETWORK_READY) == CONN_NETWORK_READY) {
+            vTaskDelay(MQTT_PROCESS_DELAY);
+        }
     }
 
     vTaskDelete(NULL);
@@ -427,7 +560,7 @@ void live_indication() {
         int counter = SLOW_PULSE_FREQ;
 
         // Slow Red LED pulse, WiFi connecting
-        while (connection_status != CONNECTION_SUCCESS) {
+        while (!(conn_state_get() & CONN_INTERNET_UP)) {
             GPIO_OUTPUT_SET(INDICATION_LED_1, counter / SLOW_PULSE_FREQ);
             vTaskDelay(1);
             counter = (counter + 1) % (SLOW_PULSE_FREQ * 2);
@@ -437,7 +570,7 @@ void live_indication() {
         counter = QUICK_PULSE_FREQ;
 
         // Fast Red LED pulse, connection and NTP update
-        while ((connection_status == CONNECTION_SUCCESS) && (ntp_status != CONNECTION_SUCCESS)) {
+        while ((conn_state_get() & (CONN_INTERNET_UP | CONN_TIME_SYNCED)) == CONN_INTERNET_UP) {
             GPIO_OUTPUT_SET(INDICATION_LED_1, counter / QUICK_PULSE_FREQ);
             vTaskDelay(1);
             counter = (counter + 1) % (QUICK_PULSE_FREQ * 2);
@@ -450,7 +583,7 @@ void live_indication() {
         counter = QUICK_PULSE_FREQ;
 
         // Fast Green LED pulse, MQTT publishing
-        while (mqtt_status == MQTT_PUBLISHING) {
+        while (conn_state_get() & CONN_MQTT_PUBLISHING) {
             GPIO_OUTPUT_SET(INDICATION_LED_2, counter / QUICK_PULSE_FREQ);
             vTaskDelay(1);
             counter = (counter + 1) % (QUICK_PULSE_FREQ * 2);
@@ -462,7 +595,8 @@ void live_indication() {
 
         live_indication_reset = 0; // Watchdog reset
 
-        vTaskDelay(QUICK_PULSE_FREQ);
+        // Idle until publishing starts or the network goes down
+        conn_state_wait(CONN_MQTT_PUBLISHING | CONN_INTERNET_UP | CONN_TIME_SYNCED, CONN_MQTT_PUBLISHING, CONN_WAIT_ANY, STATE_WAIT_TIMEOUT);
     }
 
     vTaskDelete(NULL);
@@ -480,7 +614,11 @@ void fake_mqtt_traffic() {
     vTaskDelay(1000);
     
     while(TRUE) {
-        fake_publish("lihini/income\0");
+        // Time is needed for the timestamp
+        if (conn_state_wait(CONN_TIME_SYNCED, CONN_TIME_SYNCED, CONN_WAIT_ALL, portMAX_DELAY) & CONN_TIME_SYNCED) {
+            fake_publish("lihini/income\0");
+        }
+
         vTaskDelay(10000); // Every x times
     }
     
@@ -495,6 +633,16 @@ void fake_mqtt_traffic() {
  */
 void timed_interrupt_callback( xTimerHandle interrupt_timer ) {
     // Polling code here
+    struct MqttRecord record = {0};
+
+    // Sample is written straight into the outgoing queue using the ISR
+    // safe API, so no buffer is needed on the stack.
+    // NOTE: Tick count is a placeholder for the sensor readings
+    if (mqtt_enqueue_reserve_from_isr(SENSOR_PUBLISH_TOPIC, SENSOR_PAYLOAD_SIZE, &record) != MQTT_QUEUE_FAIL) {
+        int length = sprintf(record.payload, "%d", xTaskGetTickCountFromISR());
+
+        mqtt_enqueue_commit_from_isr(&record, length);
+    }
 }
 
 /**